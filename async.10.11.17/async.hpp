@@ -0,0 +1,97 @@
+#pragma once
+
+// future returning launch helpers. make_async_future without an executor is
+// std::async(std::launch::async), which on libstdc++ starts a fresh thread per
+// call. the executor overloads queue the call on a persistent pool instead, so
+// concurrency is bounded by the pool and a launch costs a queue push.
+// make_continuable_future does the same but hands back a future.hpp future.
+// either takes a stop_token after the executor to make the task cancellable.
+
+#include <future>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "future.hpp"
+#include "stop_token.hpp"
+#include "thread_pool.hpp"
+
+// Returns a future where a a new thread is launched to execute the task asynchronously
+template < typename Function, typename... Args >
+auto make_async_future( Function&& func, Args&&... args )
+{
+  return std::async( std::launch::async, func, std::forward< Args >( args )... );
+};
+
+// Returns a future where the task runs on one of the executor's threads. The
+// arguments are moved into the task, the future is a plain std::future.
+template < typename Function, typename... Args >
+auto make_async_future( thread_pool& executor, Function&& func, Args&&... args )
+{
+  return executor.submit( std::forward< Function >( func ), std::forward< Args >( args )... );
+};
+
+// The same, cancellable: stopping token before a worker takes the task up makes
+// the future throw operation_cancelled straight away and the task is never run.
+// A function taking a stop_token first gets token, to give up part way.
+template < typename Function, typename... Args >
+auto make_async_future( thread_pool& executor, stop_token token, Function&& func, Args&&... args )
+{
+  return executor.submit( std::move( token ), std::forward< Function >( func ),
+                          std::forward< Args >( args )... );
+};
+
+// Returns a continuable future (future.hpp) for the task run on the executor, chain
+// onto it with then() or combine it with when_all()/when_any() instead of blocking
+template < typename Function, typename... Args >
+auto make_continuable_future( thread_pool& executor, Function&& func, Args&&... args )
+{
+  using result_type = decltype( std::declval< std::decay_t< Function >& >()(
+      std::declval< std::decay_t< Args > >()... ) );
+
+  promise< result_type > p;
+  auto                   fut = p.get_future();
+
+  executor.post( [p     = std::move( p ),
+                  fn    = std::decay_t< Function >( std::forward< Function >( func ) ),
+                  bound = std::make_tuple( std::forward< Args >( args )... )]() mutable {
+    auto call = [&] {
+      return detail::apply_moved( fn, bound, std::index_sequence_for< Args... >{} );
+    };
+    detail::fulfil< result_type >::run( p, call );
+  } );
+  return fut;
+};
+
+// The same, cancellable through token like make_async_future above
+template < typename Function, typename... Args >
+auto make_continuable_future( thread_pool& executor, stop_token token, Function&& func,
+                              Args&&... args )
+{
+  using result_type = detail::token_call_result_t< Function, Args... >;
+
+  auto call = detail::bind_with_token( std::forward< Function >( func ),
+                                       std::forward< Args >( args )... );
+  using job_type = detail::promise_job< promise< result_type >, decltype( call ) >;
+
+  job_type job{promise< result_type >(), std::move( call )};
+  auto     fut = job.promise.get_future();
+  executor.post_job( std::move( token ), std::move( job ) );
+  return fut;
+};
+
+// Returns a future where a the task is executed on the calling thread the first time its result is
+// requested (lazy evaluation)
+template < typename Function, typename... Args >
+auto make_deferred_future( Function&& func, Args&&... args )
+{
+  return std::async( std::launch::deferred, func, std::forward< Args >( args )... );
+};
+
+// process wide pool, one worker per cpu, started on first use
+inline thread_pool& default_executor()
+{
+  static thread_pool pool;
+  return pool;
+}
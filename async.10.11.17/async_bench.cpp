@@ -0,0 +1,93 @@
+// make_async_future on a fresh thread per call (std::async) vs queued on a
+// persistent thread_pool: launch latency and the cost of many tiny tasks
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "async.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+// time from the launch call until the task body starts, one launch at a time
+template < class Launch >
+void launch_latency( const std::string& name, size_t launches, Launch&& launch )
+{
+  std::vector< double > samples;
+  samples.reserve( launches );
+
+  for ( size_t ix = 0; ix < launches; ++ix )
+  {
+    auto                                  start = clock_type::now();
+    std::future< clock_type::time_point > fut   = launch( [] { return clock_type::now(); } );
+    std::chrono::duration< double, std::micro > latency = fut.get() - start;
+    samples.push_back( latency.count() );
+  }
+
+  std::sort( samples.begin(), samples.end() );
+  std::cout << name << " launch latency us: p50=" << samples[samples.size() / 2]
+            << " p99=" << samples[samples.size() * 99 / 100] << " max=" << samples.back()
+            << std::endl;
+}
+
+// launch a window of tasks, collect it, repeat. std::async can't have all 100K
+// outstanding at once, every pending future pins a live thread and the process
+// runs out of them.
+template < class Launch >
+void tiny_tasks( const std::string& name, size_t tasks, size_t window, Launch&& launch )
+{
+  auto start = clock_type::now();
+
+  std::vector< std::future< size_t > > futs;
+  futs.reserve( window );
+  size_t sum = 0;
+  for ( size_t ix = 0; ix < tasks; )
+  {
+    for ( size_t n = 0; n < window && ix < tasks; ++n, ++ix )
+    {
+      futs.push_back( launch( [ix] { return ix; } ) );
+    }
+    for ( auto& f : futs )
+    {
+      sum += f.get();
+    }
+    futs.clear();
+  }
+  EXPECT_EQ( sum, tasks * ( tasks - 1 ) / 2 );
+
+  std::chrono::duration< double, std::milli > elapsed = clock_type::now() - start;
+  std::cout << name << " " << tasks << " tiny tasks, window " << window << ": " << elapsed.count()
+            << "ms, " << elapsed.count() * 1000.0 / tasks << "us per task" << std::endl;
+}
+} // namespace
+
+TEST( AsyncBench, LaunchLatency )
+{
+  thread_pool executor;
+
+  launch_latency( "std::async", 10000, []( auto f ) { return make_async_future( f ); } );
+  launch_latency( "thread_pool", 10000,
+                  [&]( auto f ) { return make_async_future( executor, f ); } );
+}
+
+TEST( AsyncBench, TinyTasks )
+{
+  thread_pool executor;
+
+  auto fresh  = []( auto f ) { return make_async_future( f ); };
+  auto pooled = [&]( auto f ) { return make_async_future( executor, f ); };
+
+  tiny_tasks( "std::async", 100000, 1000, fresh );
+  tiny_tasks( "thread_pool", 100000, 1000, pooled );
+  tiny_tasks( "thread_pool", 100000, 100000, pooled );
+}
@@ -0,0 +1,116 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "async.hpp"
+#include "timer_wheel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+using namespace std::chrono_literals;
+
+TEST( Async, ExecutorFutureBehavesLikeAsync )
+{
+  thread_pool executor( 2 );
+
+  auto add    = []( int a, int b ) { return a + b; };
+  auto pooled = make_async_future( executor, add, 2, 3 );
+  auto fresh  = make_async_future( add, 2, 3 );
+  EXPECT_EQ( pooled.get(), fresh.get() );
+
+  std::future< std::string > moved = make_async_future(
+      executor, []( std::unique_ptr< std::string > s ) { return *s + "!"; },
+      std::unique_ptr< std::string >( new std::string( "hi" ) ) );
+  EXPECT_EQ( moved.get(), "hi!" );
+
+  auto thrower = make_async_future( executor, []() -> int { throw std::logic_error( "no" ); } );
+  EXPECT_THROW( thrower.get(), std::logic_error );
+}
+
+TEST( Async, ExecutorBoundsConcurrency )
+{
+  thread_pool executor( 2 );
+
+  std::mutex                         lock;
+  std::set< std::thread::id >        threads;
+  std::atomic< int >                 running{0};
+  std::atomic< int >                 peak{0};
+  std::vector< std::future< void > > futs;
+
+  for ( int ix = 0; ix < 64; ++ix )
+  {
+    futs.push_back( make_async_future( executor, [&] {
+      int now = running.fetch_add( 1 ) + 1;
+      int old = peak.load();
+      while ( now > old && !peak.compare_exchange_weak( old, now ) )
+      {
+      }
+      {
+        std::lock_guard< std::mutex > locker{lock};
+        threads.insert( std::this_thread::get_id() );
+      }
+      std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+      running.fetch_sub( 1 );
+    } ) );
+  }
+  for ( auto& f : futs )
+  {
+    f.get();
+  }
+
+  EXPECT_LE( peak.load(), 2 );
+  EXPECT_LE( threads.size(), 2u );
+}
+
+TEST( Async, DefaultExecutorIsShared )
+{
+  EXPECT_EQ( &default_executor(), &default_executor() );
+  EXPECT_GE( default_executor().size(), 1u );
+
+  auto fut = make_async_future( default_executor(), [] { return 42; } );
+  EXPECT_EQ( fut.get(), 42 );
+}
+
+TEST( Async, DeadlinesCancelQueuedWork )
+{
+  thread_pool executor( 1 );
+  timer_wheel timers;
+
+  // the worker is stuck for a while, the deadline passes first
+  std::promise< void > gate;
+  auto                 wait_for_gate = [open = gate.get_future()]() mutable { open.wait(); };
+  auto                 stuck         = make_async_future( executor, std::move( wait_for_gate ) );
+
+  stop_source source;
+  cancel_after( timers, source, 20ms );
+  auto looks = []( const stop_token& token ) { return token.stop_requested(); };
+  auto plain = make_async_future( executor, source.get_token(), [] { return 1; } );
+  auto chain = make_continuable_future( executor, source.get_token(), [] { return 2; } )
+                   .then( []( int v ) { return v * 10; } );
+  auto cooperates = make_async_future( executor, source.get_token(), looks );
+
+  EXPECT_THROW( plain.get(), operation_cancelled );
+  EXPECT_THROW( chain.get(), operation_cancelled );
+  EXPECT_THROW( cooperates.get(), operation_cancelled );
+  gate.set_value();
+  stuck.get();
+
+  // without a stop they are ordinary futures, a function taking the token gets it
+  stop_source idle;
+  auto        possible = []( const stop_token& token, int v ) {
+    return token.stop_possible() ? v : 0;
+  };
+  auto        three    = [] { return 3; };
+  EXPECT_EQ( make_continuable_future( executor, idle.get_token(), possible, 7 ).get(), 7 );
+  EXPECT_EQ( make_async_future( executor, idle.get_token(), three ).get(), 3 );
+}
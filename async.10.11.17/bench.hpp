@@ -0,0 +1,44 @@
+#pragma once
+
+// what the *_bench.cpp files linked into build/bench share: the clock they time
+// with, the thread counts they sweep, and the throughput line they print
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench
+{
+using clock_type = std::chrono::steady_clock;
+
+// hardware threads, at least 1
+inline size_t cpus()
+{
+  size_t n = std::thread::hardware_concurrency();
+  return n ? n : 1;
+}
+
+// 1, 2, 4, ... below cpus(), then cpus() itself
+inline std::vector< size_t > thread_counts()
+{
+  std::vector< size_t > counts;
+  for ( size_t n = 1; n < cpus(); n *= 2 )
+  {
+    counts.push_back( n );
+  }
+  counts.push_back( cpus() );
+  return counts;
+}
+
+// "name threads=4 12.5ms 8.1M units/s" for count units done since start
+inline void report( const std::string& name, size_t threads, double count, const std::string& unit,
+                    clock_type::time_point start )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " threads=" << threads << " " << elapsed.count() * 1000 << "ms "
+            << count / elapsed.count() / 1e6 << "M " << unit << "/s" << std::endl;
+}
+} // namespace bench
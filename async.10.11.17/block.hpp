@@ -1,10 +1,20 @@
 #pragma once
 
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "hex.hpp"
+
+// tag for a block whose storage is left as is, for bulk fills that
+// are about to overwrite every byte anyway
+struct block_no_init_t {};
+constexpr block_no_init_t block_no_init{};
 
 // represents a byte addressable chunk of memory
 template <int NumBytes>
@@ -35,6 +45,10 @@ public:
     clear();
   }
 
+  explicit block(block_no_init_t)
+  {
+  }
+
   explicit block(const value_type& val)
   {
     fill(val);
@@ -138,39 +152,58 @@ public:
   std::string str() const
   {
     std::string buf(NumBytes*2, '0');
-    std::stringstream ss(buf);
-
-    for (auto ix = cbegin(); ix != cend(); ++ix) {
-      ss << std::hex << std::setfill('0') << std::setw(2) <<  (static_cast<unsigned int>(*ix) & 0x000000FF);
-    }
+    hex_encode(data(), NumBytes, &buf[0]);
+    return buf;
+  }
 
-    return ss.str();
+  // write the hex representation through out, returns the advanced iterator
+  template <class OutputIt>
+  OutputIt str(OutputIt out) const
+  {
+    return hex_encode(data(), NumBytes, out);
   }
 
   friend std::ostream& operator<<(std::ostream& os, const block& a)
   {
-    os << a.str();
+    char buf[256];
+    for (size_t ix = 0; ix < m_bytes; ix += sizeof(buf) / 2) {
+      size_t n = std::min(m_bytes - ix, sizeof(buf) / 2);
+      hex_encode(a.data() + ix, n, buf);
+      os.write(buf, n * 2);
+    }
     return os;
   }
 
   // hexdump like formatting
   std::string hexdump() const
   {
-    std::stringstream os;
+    // "xx " per byte, two more spaces after every 8th byte and a newline after every 16th
+    std::string buf(NumBytes * 3 + (NumBytes / 8) * 2 + NumBytes / 16, ' ');
+    char* out = &buf[0];
 
-    int skip = 0;
-    for (const_iterator ix = cbegin(); ix != cend(); ++ix) {
-      os << std::hex << std::setfill('0') << std::setw(2) << (static_cast<unsigned int>(*ix) & 0x000000FF) << " ";
-      ++skip;
+    char hex[32];
+    for (size_t line = 0; line < m_bytes; line += 16) {
+      size_t n = std::min<size_t>(m_bytes - line, 16);
+      hex_encode(data() + line, n, hex);
 
-      if (skip % 8 == 0) {
-        os << "  ";
+      for (size_t ix = 0; ix < n; ++ix) {
+        out[0] = hex[ix * 2];
+        out[1] = hex[ix * 2 + 1];
+        out += (ix == 7) ? 5 : 3;
       }
-      if (skip % 16 == 0) {
-        os << "\n";
+      if (n == 16) {
+        out += 2;
+        *out++ = '\n';
       }
     }
-    return os.str();
+    return buf;
+  }
+
+  // raw digest of the contents, Algo is one of the tags in digest.hpp
+  template <class Algo>
+  typename Algo::digest_type digest() const
+  {
+    return Algo::hash(data(), m_bytes);
   }
 
   friend bool operator==(const block& lhs, const block& rhs)
@@ -3,6 +3,86 @@
 #include <random>
 #include <chrono>
 #include <mutex>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "block.hpp"
+#include "csprng.hpp"
+
+// batches bigger than this won't fit in a typical last level cache, so filling
+// them through the cache only evicts everything else on the way to memory
+constexpr size_t block_stream_threshold = 8 * 1024 * 1024;
+
+// copy with non-temporal stores, bypassing the cache on the way to memory
+inline void stream_store(void* dest, const void* src, size_t len)
+{
+  auto* out = static_cast<unsigned char*>(dest);
+  auto* in  = static_cast<const unsigned char*>(src);
+
+  // movntdq wants 16 byte aligned destinations
+  size_t head = std::min(len, (16 - (reinterpret_cast<uintptr_t>(out) & 15)) & 15);
+  memcpy(out, in, head);
+  out += head;
+  in  += head;
+  len -= head;
+
+  for (; len >= 64; len -= 64, out += 64, in += 64) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 32));
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 48));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(out), a);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(out + 16), b);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(out + 32), c);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(out + 48), d);
+  }
+  _mm_sfence();
+
+  memcpy(out, in, len);
+}
+
+inline void stream_zero(void* dest, size_t len)
+{
+  auto* out = static_cast<unsigned char*>(dest);
+
+  size_t head = std::min(len, (16 - (reinterpret_cast<uintptr_t>(out) & 15)) & 15);
+  memset(out, 0, head);
+  out += head;
+  len -= head;
+
+  const __m128i zero = _mm_setzero_si128();
+  for (; len >= 16; len -= 16, out += 16) {
+    _mm_stream_si128(reinterpret_cast<__m128i*>(out), zero);
+  }
+  _mm_sfence();
+
+  memset(out, 0, len);
+}
+
+// generate into a small cache resident buffer and stream it out
+template <class Generator>
+void stream_generate(void* dest, size_t len, Generator&& gen)
+{
+  alignas(64) unsigned char staging[16 * 1024];
+  auto* out = static_cast<unsigned char*>(dest);
+
+  while (len > 0) {
+    size_t n = std::min(len, sizeof(staging));
+    gen(staging, n);
+    stream_store(out, staging, n);
+    out += n;
+    len -= n;
+  }
+}
+
+// fill policies provide fill() for a single block and may provide
+// fill_range(first, last, stream) for a contiguous batch of them
 
 template <class BlockType>
 struct op_zero_fill {
@@ -12,6 +92,16 @@ struct op_zero_fill {
   {
     memset(block.data(), 0, block.size());
   }
+
+  static void fill_range(block_type* first, block_type* last, bool stream)
+  {
+    size_t bytes = (last - first) * sizeof(block_type);
+    if (stream) {
+      stream_zero(first, bytes);
+    } else {
+      memset(reinterpret_cast<unsigned char*>(first), 0, bytes);
+    }
+  }
 };
 
 template <class BlockType>
@@ -29,8 +119,72 @@ struct op_random_fill {
       byte = dis(gen);
     }
   }
+
+  // one engine for the whole batch, eight bytes per draw
+  static void fill_range(block_type* first, block_type* last, bool stream)
+  {
+    // threads filling chunks of the same batch start in the same tick
+    auto seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    seed ^= std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::mt19937_64 gen(seed);
+
+    auto generate = [&](unsigned char* out, size_t len) {
+      for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t), out += sizeof(uint64_t)) {
+        uint64_t word = gen();
+        memcpy(out, &word, sizeof(word));
+      }
+      if (len) {
+        uint64_t word = gen();
+        memcpy(out, &word, len);
+      }
+    };
+
+    size_t bytes = (last - first) * sizeof(block_type);
+    if (stream) {
+      stream_generate(first, bytes, generate);
+    } else {
+      generate(reinterpret_cast<unsigned char*>(first), bytes);
+    }
+  }
 };
 
+// key material, nonces: anything that must not be predictable.
+// each thread draws from its own chacha20_drbg so fillers never contend.
+template <class BlockType>
+struct op_secure_random_fill {
+  using block_type = BlockType;
+
+  static void fill(block_type& block)
+  {
+    chacha20_drbg::local().generate(block.data(), block.size());
+  }
+
+  static void fill_range(block_type* first, block_type* last, bool stream)
+  {
+    auto&  drbg  = chacha20_drbg::local();
+    size_t bytes = (last - first) * sizeof(block_type);
+    if (stream) {
+      stream_generate(first, bytes, [&](unsigned char* out, size_t len) {
+        drbg.generate(out, len);
+      });
+    } else {
+      drbg.generate(first, bytes);
+    }
+  }
+};
+
+namespace detail {
+template <class Policy, class = void>
+struct has_fill_range : std::false_type {};
+
+template <class Policy>
+struct has_fill_range<Policy,
+                      decltype(Policy::fill_range(std::declval<typename Policy::block_type*>(),
+                                                  std::declval<typename Policy::block_type*>(),
+                                                  true),
+                               void())> : std::true_type {};
+} // namespace detail
+
 template <class BlockType,
           template <class> class FillPolicy = op_zero_fill>
 struct block_factory {
@@ -45,4 +199,76 @@ struct block_factory {
     fill_policy_type::fill(b);
     return b;
   }
+
+  // fill the contiguous range [first, last) in one pass. with threads > 1 the
+  // range is cut into that many contiguous chunks, the caller fills the last one.
+  static void fill_range(block_type* first, block_type* last, size_t threads = 1)
+  {
+    const size_t count  = last - first;
+    const bool   stream = count * sizeof(block_type) >= block_stream_threshold;
+
+    threads = std::max<size_t>(1, std::min(threads, count));
+    if (threads == 1) {
+      fill_chunk(first, last, stream);
+      return;
+    }
+
+    // the first count % threads chunks take one extra block
+    const size_t chunk = count / threads;
+    const size_t extra = count % threads;
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+
+    block_type* begin = first;
+    for (size_t ix = 0; ix < threads - 1; ++ix) {
+      block_type* end = begin + chunk + (ix < extra ? 1 : 0);
+      workers.emplace_back([=] { fill_chunk(begin, end, stream); });
+      begin = end;
+    }
+    fill_chunk(begin, last, stream);
+
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  // count blocks in a single allocation, each byte written exactly once
+  static std::vector<block_type> create_n(size_t count, size_t threads = 1)
+  {
+    std::vector<block_type> blocks;
+    blocks.reserve(count);
+    for (size_t ix = 0; ix < count; ++ix) {
+      blocks.emplace_back(block_no_init);
+    }
+
+    fill_range(blocks.data(), blocks.data() + count, threads);
+    return blocks;
+  }
+
+private:
+  template <class Policy = fill_policy_type>
+  static typename std::enable_if<detail::has_fill_range<Policy>::value>::type
+  fill_chunk(block_type* first, block_type* last, bool stream)
+  {
+    Policy::fill_range(first, last, stream);
+  }
+
+  template <class Policy = fill_policy_type>
+  static typename std::enable_if<!detail::has_fill_range<Policy>::value>::type
+  fill_chunk(block_type* first, block_type* last, bool stream)
+  {
+    if (!stream) {
+      for (; first != last; ++first) {
+        Policy::fill(*first);
+      }
+      return;
+    }
+
+    block_type staging(block_no_init);
+    for (; first != last; ++first) {
+      Policy::fill(staging);
+      stream_store(first, staging.data(), staging.size());
+    }
+  }
 };
@@ -0,0 +1,173 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "block_factory.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+// only provides fill(), so the factory has to fall back to one call per block
+template < class BlockType >
+struct op_pattern_fill
+{
+  using block_type = BlockType;
+
+  static void fill( block_type& block )
+  {
+    for ( size_t ix = 0; ix < block.size(); ++ix )
+    {
+      block[ix] = static_cast< uint8_t >( ix );
+    }
+  }
+};
+
+template < class BlockType >
+bool all_distinct( const std::vector< BlockType >& blocks )
+{
+  std::set< BlockType > seen( blocks.begin(), blocks.end() );
+  return seen.size() == blocks.size();
+}
+} // namespace
+
+TEST( BlockFactory, SecureRandomFill )
+{
+  using BlockType          = block< 4096 >;
+  using SecureBlockFactory = block_factory< BlockType, op_secure_random_fill >;
+
+  auto a = SecureBlockFactory::create();
+  auto b = SecureBlockFactory::create();
+  EXPECT_FALSE( a.zero() );
+  EXPECT_TRUE( a != b );
+}
+
+TEST( BlockFactory, SecureRandomFillPerThread )
+{
+  using BlockType          = block< 32 >;
+  using SecureBlockFactory = block_factory< BlockType, op_secure_random_fill >;
+
+  constexpr int              threads = 4;
+  constexpr int              per     = 256;
+  std::set< BlockType >      seen;
+  std::mutex                 seen_lock;
+  std::vector< std::thread > pool;
+
+  for ( int t = 0; t < threads; ++t )
+  {
+    pool.emplace_back( [&] {
+      std::vector< BlockType > local;
+      for ( int ix = 0; ix < per; ++ix )
+      {
+        local.push_back( SecureBlockFactory::create() );
+      }
+      std::lock_guard< std::mutex > locker{seen_lock};
+      seen.insert( local.begin(), local.end() );
+    } );
+  }
+  for ( auto& t : pool )
+  {
+    t.join();
+  }
+
+  // 256 bit values, any collision means the threads shared a stream
+  EXPECT_EQ( seen.size(), static_cast< size_t >( threads * per ) );
+}
+
+TEST( BlockFactory, CreateNZero )
+{
+  using BlockType        = block< 512 >;
+  using ZeroBlockFactory = block_factory< BlockType, op_zero_fill >;
+
+  auto blocks = ZeroBlockFactory::create_n( 1000 );
+  ASSERT_EQ( blocks.size(), 1000u );
+  EXPECT_TRUE( std::all_of( blocks.begin(), blocks.end(), []( const BlockType& b ) {
+    return b.zero();
+  } ) );
+}
+
+TEST( BlockFactory, CreateNEmpty )
+{
+  using SecureBlockFactory = block_factory< block< 64 >, op_secure_random_fill >;
+
+  EXPECT_TRUE( SecureBlockFactory::create_n( 0 ).empty() );
+  EXPECT_TRUE( SecureBlockFactory::create_n( 0, 4 ).empty() );
+}
+
+TEST( BlockFactory, CreateNRandom )
+{
+  using BlockType          = block< 256 >;
+  using RandomBlockFactory = block_factory< BlockType, op_random_fill >;
+  using SecureBlockFactory = block_factory< BlockType, op_secure_random_fill >;
+
+  EXPECT_TRUE( all_distinct( RandomBlockFactory::create_n( 1024 ) ) );
+  EXPECT_TRUE( all_distinct( SecureBlockFactory::create_n( 1024 ) ) );
+}
+
+TEST( BlockFactory, CreateNThreaded )
+{
+  using BlockType          = block< 128 >;
+  using RandomBlockFactory = block_factory< BlockType, op_random_fill >;
+  using SecureBlockFactory = block_factory< BlockType, op_secure_random_fill >;
+
+  // 1001 doesn't split evenly, the leftover blocks still have to be filled
+  for ( size_t threads : {2, 3, 7, 4096} )
+  {
+    auto random = RandomBlockFactory::create_n( 1001, threads );
+    ASSERT_EQ( random.size(), 1001u );
+    EXPECT_TRUE( all_distinct( random ) );
+
+    auto secure = SecureBlockFactory::create_n( 1001, threads );
+    ASSERT_EQ( secure.size(), 1001u );
+    EXPECT_TRUE( all_distinct( secure ) );
+  }
+}
+
+TEST( BlockFactory, FillRangeFallsBackToFill )
+{
+  using BlockType           = block< 100 >;
+  using PatternBlockFactory = block_factory< BlockType, op_pattern_fill >;
+
+  BlockType expected;
+  op_pattern_fill< BlockType >::fill( expected );
+
+  std::vector< BlockType > blocks( 37 );
+  PatternBlockFactory::fill_range( blocks.data(), blocks.data() + blocks.size(), 3 );
+  for ( const auto& b : blocks )
+  {
+    EXPECT_TRUE( b == expected );
+  }
+}
+
+TEST( BlockFactory, StreamingFill )
+{
+  // large enough to take the non-temporal path, odd sized so stores are misaligned
+  using BlockType           = block< 4099 >;
+  using ZeroBlockFactory    = block_factory< BlockType, op_zero_fill >;
+  using PatternBlockFactory = block_factory< BlockType, op_pattern_fill >;
+  using SecureBlockFactory  = block_factory< BlockType, op_secure_random_fill >;
+
+  const size_t count = block_stream_threshold / sizeof( BlockType ) + 1;
+
+  std::vector< BlockType > blocks( count, BlockType( 0xff ) );
+  ZeroBlockFactory::fill_range( blocks.data(), blocks.data() + count, 2 );
+  EXPECT_TRUE( std::all_of( blocks.begin(), blocks.end(), []( const BlockType& b ) {
+    return b.zero();
+  } ) );
+
+  BlockType expected;
+  op_pattern_fill< BlockType >::fill( expected );
+  PatternBlockFactory::fill_range( blocks.data(), blocks.data() + count );
+  EXPECT_TRUE( std::all_of( blocks.begin(), blocks.end(), [&]( const BlockType& b ) {
+    return b == expected;
+  } ) );
+
+  auto secure = SecureBlockFactory::create_n( count );
+  EXPECT_TRUE( all_distinct( secure ) );
+}
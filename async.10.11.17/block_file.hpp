@@ -0,0 +1,606 @@
+#pragma once
+
+// an on disk array of block<N>, written once, then read through mmap.
+//
+//   offset 0    block_file_header, 64 bytes, its own crc32c in the last word
+//   offset 64   count records of stride N + 8 bytes:
+//                 N bytes of block, then a trailer of the crc32c of those bytes
+//                 and the low 32 bits of the record's index, so a record written
+//                 to the wrong place fails verification as well as a torn one
+//
+// integers are host order; the header records the block size and stride so a
+// reader built for another N refuses the file instead of misreading it.
+//
+// block_file hands out block_view's that point straight into the mapping: no
+// read(), no copy. views stay valid as long as the block_file. indexing and
+// iteration do not check crcs, verify() does, serially or on a thread_pool.
+//
+//   block_file_writer< 4096 > out( "blocks.dat" );
+//   out.append( blocks.data(), blocks.size() );
+//   out.close();
+//
+//   block_file< 4096 > in( "blocks.dat", access_pattern::sequential );
+//   for ( block_view< 4096 > b : in ) { ... b.get() ... }
+//   auto bad = in.verify( pool );
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "block.hpp"
+#include "crc32c.hpp"
+#include "parallel.hpp"
+#include "thread_pool.hpp"
+
+struct block_file_header
+{
+  static constexpr char     magic_value[8] = {'B', 'L', 'K', 'F', 'I', 'L', 'E', 0};
+  static constexpr uint32_t current        = 1;
+
+  char     magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t block_size;
+  uint32_t stride;
+  uint64_t count;
+  uint8_t  reserved[28];
+  uint32_t crc; // crc32c of everything above
+
+  uint32_t expected_crc() const
+  {
+    return crc32c::hash( this, offsetof( block_file_header, crc ) );
+  }
+};
+static_assert( sizeof( block_file_header ) == 64, "block_file_header is 64 bytes on disk" );
+
+// what follows each block on disk
+struct block_file_trailer
+{
+  uint32_t crc;
+  uint32_t index;
+};
+
+enum class access_pattern
+{
+  normal,
+  sequential,
+  random
+};
+
+namespace detail
+{
+inline std::system_error file_error( const std::string& what, const std::string& path )
+{
+  return std::system_error( errno, std::generic_category(), what + " " + path );
+}
+
+inline bool write_all( int fd, const uint8_t* data, size_t bytes, off_t offset )
+{
+  while ( bytes > 0 )
+  {
+    const ssize_t n = pwrite( fd, data, bytes, offset );
+    if ( n < 0 && errno == EINTR )
+    {
+      continue;
+    }
+    if ( n <= 0 )
+    {
+      return false;
+    }
+    data += n;
+    bytes -= size_t( n );
+    offset += n;
+  }
+  return true;
+}
+} // namespace detail
+
+// one record in a mapped block_file
+template < int NumBytes >
+class block_view
+{
+public:
+  using block_type = block< NumBytes >;
+
+  static constexpr size_t stride = NumBytes + sizeof( block_file_trailer );
+
+  block_view( const uint8_t* record, uint64_t index )
+      : m_record( record )
+      , m_index( index )
+  {
+  }
+
+  const block_type& get() const
+  {
+    return *reinterpret_cast< const block_type* >( m_record );
+  }
+
+  const block_type& operator*() const
+  {
+    return get();
+  }
+
+  const block_type* operator->() const
+  {
+    return &get();
+  }
+
+  const uint8_t* data() const
+  {
+    return m_record;
+  }
+
+  size_t size() const
+  {
+    return NumBytes;
+  }
+
+  uint64_t index() const
+  {
+    return m_index;
+  }
+
+  block_file_trailer trailer() const
+  {
+    block_file_trailer t;
+    memcpy( &t, m_record + NumBytes, sizeof( t ) );
+    return t;
+  }
+
+  // the stored crc32c against the bytes, and the stored index against the position
+  bool valid() const
+  {
+    return matches( crc32c::hash( m_record, NumBytes ) );
+  }
+
+  bool matches( uint32_t crc ) const
+  {
+    const block_file_trailer t = trailer();
+    return t.crc == crc && t.index == uint32_t( m_index );
+  }
+
+private:
+  const uint8_t* m_record;
+  uint64_t       m_index;
+}; // block_view
+
+// appends blocks to a new file, the header is final after close()
+template < int NumBytes >
+class block_file_writer
+{
+public:
+  using block_type = block< NumBytes >;
+
+  static constexpr size_t stride = block_view< NumBytes >::stride;
+
+  explicit block_file_writer( const std::string& path )
+      : m_path( path )
+      , m_fd( ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) )
+  {
+    if ( m_fd < 0 )
+    {
+      throw detail::file_error( "block_file: cannot create", path );
+    }
+    m_buffer.reserve( batch * stride );
+    write_header();
+  }
+
+  block_file_writer( const block_file_writer& ) = delete;
+  block_file_writer& operator=( const block_file_writer& ) = delete;
+
+  ~block_file_writer()
+  {
+    try
+    {
+      close();
+    }
+    catch ( ... )
+    {
+    }
+  }
+
+  void append( const block_type& b )
+  {
+    append( &b, 1 );
+  }
+
+  // crcs are computed batch at a time, through crc32c::hash_many
+  void append( const block_type* blocks, size_t count )
+  {
+    while ( count > 0 )
+    {
+      const size_t n = std::min( count, batch - m_buffer.size() / stride );
+      stage( blocks, n );
+      blocks += n;
+      count -= n;
+      if ( m_buffer.size() == batch * stride )
+      {
+        flush();
+      }
+    }
+  }
+
+  uint64_t size() const
+  {
+    return m_count + m_staged;
+  }
+
+  // writes what is staged and the final header, optionally fsync's
+  void close( bool sync = false )
+  {
+    if ( m_fd < 0 )
+    {
+      return;
+    }
+    flush();
+    write_header();
+    const bool synced = !sync || fsync( m_fd ) == 0;
+    ::close( m_fd );
+    m_fd = -1;
+    if ( !synced )
+    {
+      throw detail::file_error( "block_file: fsync", m_path );
+    }
+  }
+
+private:
+  static constexpr size_t batch = 256;
+
+  void stage( const block_type* blocks, size_t count )
+  {
+    const uint8_t* data[batch];
+    uint32_t       crcs[batch];
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      data[ix] = blocks[ix].data();
+    }
+    crc32c::hash_many( data, NumBytes, count, crcs );
+
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      const block_file_trailer t{crcs[ix], uint32_t( m_count + m_staged + ix )};
+      const auto*              tb = reinterpret_cast< const uint8_t* >( &t );
+      m_buffer.insert( m_buffer.end(), data[ix], data[ix] + NumBytes );
+      m_buffer.insert( m_buffer.end(), tb, tb + sizeof( t ) );
+    }
+    m_staged += count;
+  }
+
+  void flush()
+  {
+    const off_t offset = off_t( sizeof( block_file_header ) + m_count * stride );
+    if ( !detail::write_all( m_fd, m_buffer.data(), m_buffer.size(), offset ) )
+    {
+      throw detail::file_error( "block_file: write", m_path );
+    }
+    m_count += m_staged;
+    m_staged = 0;
+    m_buffer.clear();
+  }
+
+  void write_header()
+  {
+    block_file_header h{};
+    memcpy( h.magic, block_file_header::magic_value, sizeof( h.magic ) );
+    h.version     = block_file_header::current;
+    h.header_size = sizeof( block_file_header );
+    h.block_size  = NumBytes;
+    h.stride      = stride;
+    h.count       = m_count;
+    h.crc         = h.expected_crc();
+    if ( !detail::write_all( m_fd, reinterpret_cast< const uint8_t* >( &h ), sizeof( h ), 0 ) )
+    {
+      throw detail::file_error( "block_file: write header", m_path );
+    }
+  }
+
+  std::string            m_path;
+  int                    m_fd;
+  uint64_t               m_count  = 0;
+  uint64_t               m_staged = 0;
+  std::vector< uint8_t > m_buffer;
+}; // block_file_writer
+
+// a read only mapping of a block_file
+template < int NumBytes >
+class block_file
+{
+public:
+  using block_type = block< NumBytes >;
+  using view_type  = block_view< NumBytes >;
+
+  static constexpr size_t stride = view_type::stride;
+
+  class iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = view_type;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = void;
+    using reference         = view_type;
+
+    iterator( const uint8_t* records, uint64_t index )
+        : m_records( records )
+        , m_index( index )
+    {
+    }
+
+    view_type operator*() const
+    {
+      return view_type( m_records + m_index * stride, m_index );
+    }
+
+    iterator& operator++()
+    {
+      ++m_index;
+      return *this;
+    }
+
+    iterator operator++( int )
+    {
+      iterator before = *this;
+      ++m_index;
+      return before;
+    }
+
+    bool operator==( const iterator& rhs ) const
+    {
+      return m_index == rhs.m_index;
+    }
+
+    bool operator!=( const iterator& rhs ) const
+    {
+      return m_index != rhs.m_index;
+    }
+
+  private:
+    const uint8_t* m_records;
+    uint64_t       m_index;
+  };
+
+  explicit block_file( const std::string& path, access_pattern pattern = access_pattern::normal )
+  {
+    const int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 )
+    {
+      throw detail::file_error( "block_file: cannot open", path );
+    }
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 )
+    {
+      const auto error = detail::file_error( "block_file: stat", path );
+      ::close( fd );
+      throw error;
+    }
+    if ( size_t( st.st_size ) < sizeof( block_file_header ) )
+    {
+      ::close( fd );
+      throw std::runtime_error( "block_file: no header in " + path );
+    }
+
+    m_bytes     = size_t( st.st_size );
+    void* where = mmap( nullptr, m_bytes, PROT_READ, MAP_SHARED, fd, 0 );
+    // the mapping keeps the file open
+    ::close( fd );
+    if ( where == MAP_FAILED )
+    {
+      throw detail::file_error( "block_file: mmap", path );
+    }
+    m_map = static_cast< const uint8_t* >( where );
+
+    try
+    {
+      check_header( path );
+    }
+    catch ( ... )
+    {
+      munmap( const_cast< uint8_t* >( m_map ), m_bytes );
+      throw;
+    }
+    advise( pattern );
+  }
+
+  block_file( block_file&& other ) noexcept
+      : m_map( std::exchange( other.m_map, nullptr ) )
+      , m_bytes( std::exchange( other.m_bytes, 0 ) )
+      , m_count( std::exchange( other.m_count, 0 ) )
+  {
+  }
+
+  block_file& operator=( block_file&& other ) noexcept
+  {
+    if ( this != &other )
+    {
+      unmap();
+      m_map   = std::exchange( other.m_map, nullptr );
+      m_bytes = std::exchange( other.m_bytes, 0 );
+      m_count = std::exchange( other.m_count, 0 );
+    }
+    return *this;
+  }
+
+  block_file( const block_file& ) = delete;
+  block_file& operator=( const block_file& ) = delete;
+
+  ~block_file()
+  {
+    unmap();
+  }
+
+  uint64_t size() const
+  {
+    return m_count;
+  }
+
+  bool empty() const
+  {
+    return m_count == 0;
+  }
+
+  const block_file_header& header() const
+  {
+    return *reinterpret_cast< const block_file_header* >( m_map );
+  }
+
+  view_type operator[]( uint64_t index ) const
+  {
+    return view_type( records() + index * stride, index );
+  }
+
+  view_type at( uint64_t index ) const
+  {
+    if ( index >= m_count )
+    {
+      throw std::out_of_range( "block_file: index " + std::to_string( index ) + " of "
+                               + std::to_string( m_count ) );
+    }
+    return ( *this )[index];
+  }
+
+  iterator begin() const
+  {
+    return iterator( records(), 0 );
+  }
+
+  iterator end() const
+  {
+    return iterator( records(), m_count );
+  }
+
+  // readahead hint for the whole mapping
+  void advise( access_pattern pattern ) const
+  {
+    const int advice = pattern == access_pattern::sequential ? MADV_SEQUENTIAL
+                       : pattern == access_pattern::random   ? MADV_RANDOM
+                                                             : MADV_NORMAL;
+    madvise( const_cast< uint8_t* >( m_map ), m_bytes, advice );
+  }
+
+  // start paging in [first, first + count) without waiting for it
+  void prefetch( uint64_t first, uint64_t count ) const
+  {
+    const uintptr_t page  = uintptr_t( sysconf( _SC_PAGESIZE ) );
+    const uintptr_t begin = uintptr_t( records() + first * stride ) & ~( page - 1 );
+    const uintptr_t end   = uintptr_t( records() + std::min( first + count, m_count ) * stride );
+    if ( end > begin )
+    {
+      madvise( reinterpret_cast< void* >( begin ), end - begin, MADV_WILLNEED );
+    }
+  }
+
+  // indexes of the records in [first, last) whose crc or index does not match
+  std::vector< uint64_t > verify( uint64_t first, uint64_t last ) const
+  {
+    std::vector< uint64_t > bad;
+    const uint8_t*          data[batch];
+    uint32_t                crcs[batch];
+    last = std::min( last, m_count );
+    for ( uint64_t at = first; at < last; at += batch )
+    {
+      const size_t n = size_t( std::min< uint64_t >( batch, last - at ) );
+      for ( size_t ix = 0; ix < n; ++ix )
+      {
+        data[ix] = records() + ( at + ix ) * stride;
+      }
+      crc32c::hash_many( data, NumBytes, n, crcs );
+      for ( size_t ix = 0; ix < n; ++ix )
+      {
+        if ( !( *this )[at + ix].matches( crcs[ix] ) )
+        {
+          bad.push_back( at + ix );
+        }
+      }
+    }
+    return bad;
+  }
+
+  std::vector< uint64_t > verify() const
+  {
+    return verify( 0, m_count );
+  }
+
+  // the same on a pool, one contiguous part per worker so each streams its own
+  // stretch of the file; the result is in index order
+  std::vector< uint64_t > verify( thread_pool& pool ) const
+  {
+    using list = std::vector< uint64_t >;
+    list bad   = parallel_reduce(
+        pool, 0, m_count, grain, list{},
+        [this]( size_t lo, size_t hi, list acc ) {
+          list bad = verify( lo, hi );
+          acc.insert( acc.end(), bad.begin(), bad.end() );
+          return acc;
+        },
+        []( list lhs, const list& rhs ) {
+          lhs.insert( lhs.end(), rhs.begin(), rhs.end() );
+          return lhs;
+        },
+        chunking::fixed );
+    std::sort( bad.begin(), bad.end() );
+    return bad;
+  }
+
+private:
+  static constexpr size_t batch = 64;
+  static constexpr size_t grain = 1024;
+
+  const uint8_t* records() const
+  {
+    return m_map + sizeof( block_file_header );
+  }
+
+  void check_header( const std::string& path )
+  {
+    const block_file_header& h = header();
+    if ( memcmp( h.magic, block_file_header::magic_value, sizeof( h.magic ) ) != 0 )
+    {
+      throw std::runtime_error( "block_file: not a block file " + path );
+    }
+    if ( h.crc != h.expected_crc() )
+    {
+      throw std::runtime_error( "block_file: header crc mismatch in " + path );
+    }
+    if ( h.version != block_file_header::current || h.header_size != sizeof( h ) )
+    {
+      throw std::runtime_error( "block_file: unsupported version in " + path );
+    }
+    if ( h.block_size != NumBytes || h.stride != stride )
+    {
+      throw std::runtime_error( "block_file: " + path + " holds blocks of "
+                                + std::to_string( h.block_size ) + " bytes, not "
+                                + std::to_string( NumBytes ) );
+    }
+    if ( h.count > ( m_bytes - sizeof( h ) ) / stride )
+    {
+      throw std::runtime_error( "block_file: " + path + " is truncated" );
+    }
+    m_count = h.count;
+  }
+
+  void unmap()
+  {
+    if ( m_map )
+    {
+      munmap( const_cast< uint8_t* >( m_map ), m_bytes );
+      m_map = nullptr;
+    }
+  }
+
+  const uint8_t* m_map   = nullptr;
+  size_t         m_bytes = 0;
+  uint64_t       m_count = 0;
+}; // block_file
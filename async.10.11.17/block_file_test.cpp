@@ -0,0 +1,184 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "block_file.hpp"
+#include "thread_pool.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using block_type = block< 4096 >;
+
+// a path under /tmp, removed again
+struct scratch_path
+{
+  scratch_path()
+  {
+    char name[] = "/tmp/block_file_test.XXXXXX";
+    ::close( mkstemp( name ) );
+    path = name;
+  }
+
+  ~scratch_path()
+  {
+    unlink( path.c_str() );
+  }
+
+  std::string path;
+};
+
+block_type make_block( uint64_t seed )
+{
+  block_type b( block_no_init );
+  for ( size_t ix = 0; ix < b.size(); ++ix )
+  {
+    b.data()[ix] = uint8_t( seed * 31 + ix * 7 );
+  }
+  return b;
+}
+
+void write_blocks( const std::string& path, size_t count )
+{
+  std::vector< block_type > blocks;
+  for ( size_t ix = 0; ix < count; ++ix )
+  {
+    blocks.push_back( make_block( ix ) );
+  }
+  block_file_writer< 4096 > out( path );
+  // one on its own, then the rest across several staging batches
+  out.append( blocks[0] );
+  out.append( blocks.data() + 1, count - 1 );
+  EXPECT_EQ( out.size(), count );
+  out.close( true );
+}
+
+void poke( const std::string& path, off_t offset, uint8_t value )
+{
+  const int fd = ::open( path.c_str(), O_WRONLY );
+  ASSERT_GE( fd, 0 );
+  ASSERT_EQ( pwrite( fd, &value, 1, offset ), 1 );
+  ::close( fd );
+}
+
+off_t record_offset( uint64_t index )
+{
+  return off_t( sizeof( block_file_header ) + index * block_file< 4096 >::stride );
+}
+} // namespace
+
+TEST( BlockFile, WritesThenMaps )
+{
+  scratch_path scratch;
+  write_blocks( scratch.path, 1000 );
+
+  block_file< 4096 > in( scratch.path, access_pattern::sequential );
+  ASSERT_EQ( in.size(), 1000u );
+  EXPECT_EQ( in.header().block_size, 4096u );
+
+  // streaming, the views point into the mapping
+  uint64_t expect = 0;
+  for ( block_view< 4096 > b : in )
+  {
+    EXPECT_EQ( b.index(), expect );
+    EXPECT_TRUE( b.get() == make_block( expect ) );
+    EXPECT_TRUE( b.valid() );
+    ++expect;
+  }
+  EXPECT_EQ( expect, 1000u );
+  EXPECT_EQ( in[0].data(), in.begin().operator*().data() );
+  EXPECT_EQ( in[1].data() - in[0].data(), ptrdiff_t( in.stride ) );
+
+  // random access
+  in.advise( access_pattern::random );
+  in.prefetch( 900, 50 );
+  for ( uint64_t ix : {999, 0, 517, 3} )
+  {
+    EXPECT_TRUE( *in.at( ix ) == make_block( ix ) );
+  }
+  EXPECT_THROW( in.at( 1000 ), std::out_of_range );
+
+  EXPECT_TRUE( in.verify().empty() );
+  thread_pool pool( 4 );
+  EXPECT_TRUE( in.verify( pool ).empty() );
+
+  // moves keep the mapping
+  block_file< 4096 > moved( std::move( in ) );
+  EXPECT_EQ( moved.size(), 1000u );
+  EXPECT_TRUE( moved[10].valid() );
+}
+
+TEST( BlockFile, Empty )
+{
+  scratch_path scratch;
+  {
+    block_file_writer< 4096 > out( scratch.path );
+  }
+  block_file< 4096 > in( scratch.path );
+  EXPECT_TRUE( in.empty() );
+  EXPECT_TRUE( in.begin() == in.end() );
+  thread_pool pool( 2 );
+  EXPECT_TRUE( in.verify( pool ).empty() );
+}
+
+TEST( BlockFile, FindsCorruption )
+{
+  scratch_path scratch;
+  write_blocks( scratch.path, 5000 );
+
+  // a flipped data byte, a flipped crc, and a block copied to the wrong place
+  poke( scratch.path, record_offset( 7 ) + 100, 0x55 );
+  poke( scratch.path, record_offset( 2500 ) + 4096, 0x00 );
+  {
+    block_file< 4096 > in( scratch.path );
+    const block_type   copy = in[4998].get();
+    std::vector< uint8_t > record( in[4998].data(), in[4998].data() + in.stride );
+    const int              fd = ::open( scratch.path.c_str(), O_WRONLY );
+    ASSERT_EQ( pwrite( fd, record.data(), record.size(), record_offset( 4999 ) ),
+               ssize_t( record.size() ) );
+    ::close( fd );
+    EXPECT_TRUE( in[4999].get() == copy );
+  }
+
+  block_file< 4096 > in( scratch.path );
+  const std::vector< uint64_t > expect{7, 2500, 4999};
+  EXPECT_EQ( in.verify(), expect );
+  thread_pool pool( 4 );
+  EXPECT_EQ( in.verify( pool ), expect );
+  EXPECT_FALSE( in[7].valid() );
+  EXPECT_TRUE( in[8].valid() );
+  EXPECT_EQ( in.verify( 0, 100 ), std::vector< uint64_t >{7} );
+}
+
+TEST( BlockFile, RejectsBadFiles )
+{
+  scratch_path scratch;
+  write_blocks( scratch.path, 10 );
+
+  // another block size
+  EXPECT_THROW( block_file< 512 >{scratch.path}, std::runtime_error );
+
+  // fewer records than the header claims
+  ASSERT_EQ( truncate( scratch.path.c_str(), record_offset( 9 ) ), 0 );
+  EXPECT_THROW( block_file< 4096 >{scratch.path}, std::runtime_error );
+
+  // a damaged header
+  write_blocks( scratch.path, 10 );
+  poke( scratch.path, 20, 0x7f );
+  EXPECT_THROW( block_file< 4096 >{scratch.path}, std::runtime_error );
+
+  // not a block file at all
+  ASSERT_EQ( truncate( scratch.path.c_str(), 10 ), 0 );
+  EXPECT_THROW( block_file< 4096 >{scratch.path}, std::runtime_error );
+  EXPECT_THROW( block_file< 4096 >{"/nonexistent/blocks"}, std::system_error );
+}
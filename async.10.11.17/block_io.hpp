@@ -0,0 +1,779 @@
+#pragma once
+
+// asynchronous block reads and writes, completions as future.hpp futures (and so
+// awaitable from a task<>, see task.hpp).
+//
+// where the kernel has io_uring, requests go through the submission ring with
+// raw syscalls and one reaper thread completes them: no thread per request, and
+// a batch of any size costs one io_uring_enter per ring's worth. files added to
+// the engine sit in the ring's fixed file table, and buffers registered with
+// register_buffer() are pinned once, so reads and writes into them skip the per
+// request fd lookup and page pinning (READ_FIXED / WRITE_FIXED).
+//
+// elsewhere, or with io_uring turned off, a thread_pool runs pread / pwrite.
+//
+// for O_DIRECT open the file with it and use aligned_blocks: the data, the length
+// and the offset must all be multiples of the device's logical block size, which
+// whole block<4096>s at block indices are.
+//
+// completions, and whatever then() hangs off them, run on the reaper thread (or
+// a pool worker): keep that short or hop to an executor. they may submit again:
+// what finds no room then is queued, and the reaper sends it as slots free up.
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "block.hpp"
+#include "future.hpp"
+#include "thread_pool.hpp"
+
+enum class io_backend
+{
+  io_uring,
+  threads,
+};
+
+enum class io_op
+{
+  read,
+  write,
+};
+
+// a file added to a block_io
+struct io_file
+{
+  unsigned slot;
+};
+
+struct io_request
+{
+  io_op    op;
+  io_file  file;
+  void*    data;
+  size_t   bytes; // at most 4GiB - 1
+  uint64_t offset;
+};
+
+struct block_io_options
+{
+  unsigned queue_depth{256}; // requests in flight at once, io_uring only
+  size_t   threads{8};       // pread / pwrite workers otherwise
+  bool     use_io_uring{true};
+};
+
+// owning array of blocks on 4096 byte boundaries, what O_DIRECT wants. Block is
+// a block<N>, left uninitialised.
+template < class Block >
+class aligned_blocks
+{
+public:
+  static constexpr size_t alignment = 4096;
+
+  explicit aligned_blocks( size_t count )
+      : m_count( count )
+  {
+    const size_t bytes = ( std::max< size_t >( 1, count * sizeof( Block ) ) + alignment - 1 )
+                         / alignment * alignment;
+    m_data.reset( static_cast< Block* >( std::aligned_alloc( alignment, bytes ) ) );
+    if ( !m_data )
+    {
+      throw std::bad_alloc();
+    }
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      new ( m_data.get() + ix ) Block( block_no_init );
+    }
+  }
+
+  Block* data() const
+  {
+    return m_data.get();
+  }
+
+  size_t size() const
+  {
+    return m_count;
+  }
+
+  size_t bytes() const
+  {
+    return m_count * sizeof( Block );
+  }
+
+  Block& operator[]( size_t ix ) const
+  {
+    return m_data.get()[ix];
+  }
+
+private:
+  struct release
+  {
+    void operator()( Block* p ) const
+    {
+      std::free( p );
+    }
+  };
+
+  size_t                           m_count;
+  std::unique_ptr< Block, release > m_data;
+};
+
+namespace detail
+{
+// the io_uring rings, mapped from a raw io_uring_setup. submitting is for one
+// thread at a time, reaping for one (other) thread.
+class io_ring
+{
+public:
+  io_ring() = default;
+
+  io_ring( const io_ring& ) = delete;
+  io_ring& operator=( const io_ring& ) = delete;
+
+  ~io_ring()
+  {
+    if ( m_sqes )
+    {
+      munmap( m_sqes, m_sqes_size );
+    }
+    if ( m_cq_map && m_cq_map != m_sq_map )
+    {
+      munmap( m_cq_map, m_cq_size );
+    }
+    if ( m_sq_map )
+    {
+      munmap( m_sq_map, m_sq_size );
+    }
+    if ( m_fd >= 0 )
+    {
+      close( m_fd );
+    }
+  }
+
+  // false when the kernel lacks io_uring or will not give us one
+  bool setup( unsigned entries )
+  {
+    io_uring_params p;
+    memset( &p, 0, sizeof( p ) );
+    m_fd = int( syscall( __NR_io_uring_setup, entries, &p ) );
+    if ( m_fd < 0 )
+    {
+      return false;
+    }
+
+    m_sq_size = p.sq_off.array + p.sq_entries * sizeof( unsigned );
+    m_cq_size = p.cq_off.cqes + p.cq_entries * sizeof( io_uring_cqe );
+    if ( p.features & IORING_FEAT_SINGLE_MMAP )
+    {
+      m_sq_size = m_cq_size = std::max( m_sq_size, m_cq_size );
+    }
+
+    m_sq_map = map( m_sq_size, IORING_OFF_SQ_RING );
+    if ( !m_sq_map )
+    {
+      return false;
+    }
+    m_cq_map    = p.features & IORING_FEAT_SINGLE_MMAP ? m_sq_map
+                                                      : map( m_cq_size, IORING_OFF_CQ_RING );
+    m_sqes_size = p.sq_entries * sizeof( io_uring_sqe );
+    m_sqes      = static_cast< io_uring_sqe* >( map( m_sqes_size, IORING_OFF_SQES ) );
+    if ( !m_cq_map || !m_sqes )
+    {
+      return false;
+    }
+
+    char* sq     = static_cast< char* >( m_sq_map );
+    char* cq     = static_cast< char* >( m_cq_map );
+    m_sq_head    = reinterpret_cast< unsigned* >( sq + p.sq_off.head );
+    m_sq_tail    = reinterpret_cast< unsigned* >( sq + p.sq_off.tail );
+    m_sq_mask    = *reinterpret_cast< unsigned* >( sq + p.sq_off.ring_mask );
+    m_sq_array   = reinterpret_cast< unsigned* >( sq + p.sq_off.array );
+    m_cq_head    = reinterpret_cast< unsigned* >( cq + p.cq_off.head );
+    m_cq_tail    = reinterpret_cast< unsigned* >( cq + p.cq_off.tail );
+    m_cq_mask    = *reinterpret_cast< unsigned* >( cq + p.cq_off.ring_mask );
+    m_cqes       = reinterpret_cast< io_uring_cqe* >( cq + p.cq_off.cqes );
+    m_entries    = p.sq_entries;
+    m_local_tail = *m_sq_tail;
+    return true;
+  }
+
+  unsigned entries() const
+  {
+    return m_entries;
+  }
+
+  // whether the kernel knows every one of ops
+  bool supports( std::initializer_list< unsigned > ops )
+  {
+    constexpr unsigned  slots = 256;
+    std::vector< char > buffer( sizeof( io_uring_probe ) + slots * sizeof( io_uring_probe_op ) );
+    auto*               probe = reinterpret_cast< io_uring_probe* >( buffer.data() );
+    if ( enroll( IORING_REGISTER_PROBE, probe, slots ) < 0 )
+    {
+      return false;
+    }
+    for ( unsigned op : ops )
+    {
+      if ( op > probe->last_op || !( probe->ops[op].flags & IO_URING_OP_SUPPORTED ) )
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // io_uring_register, -errno on failure
+  int enroll( unsigned opcode, const void* arg, unsigned count )
+  {
+    const int rc = int( syscall( __NR_io_uring_register, m_fd, opcode, arg, count ) );
+    return rc < 0 ? -errno : rc;
+  }
+
+  // the next free entry, zeroed. null when every entry is waiting for submit().
+  io_uring_sqe* next_sqe()
+  {
+    const unsigned head = __atomic_load_n( m_sq_head, __ATOMIC_ACQUIRE );
+    if ( m_local_tail - head >= m_entries )
+    {
+      return nullptr;
+    }
+    const unsigned ix = m_local_tail++ & m_sq_mask;
+    m_sq_array[ix]    = ix;
+    memset( &m_sqes[ix], 0, sizeof( io_uring_sqe ) );
+    return &m_sqes[ix];
+  }
+
+  // hand the entries filled since the last submit to the kernel
+  void submit( unsigned count )
+  {
+    __atomic_store_n( m_sq_tail, m_local_tail, __ATOMIC_RELEASE );
+    while ( count > 0 )
+    {
+      const int rc = int( syscall( __NR_io_uring_enter, m_fd, count, 0, 0, nullptr, 0 ) );
+      if ( rc < 0 )
+      {
+        if ( errno != EINTR && errno != EAGAIN && errno != EBUSY )
+        {
+          throw std::system_error( errno, std::generic_category(), "io_uring_enter" );
+        }
+        std::this_thread::yield();
+        continue;
+      }
+      count -= std::min< unsigned >( count, unsigned( rc ) );
+    }
+  }
+
+  // sleep until at least one completion is there
+  void wait()
+  {
+    syscall( __NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0 );
+  }
+
+  // f( cqe ) for every completion there is, returns how many
+  template < class F >
+  unsigned drain( F&& f )
+  {
+    unsigned       head = *m_cq_head;
+    const unsigned tail = __atomic_load_n( m_cq_tail, __ATOMIC_ACQUIRE );
+    unsigned       seen = 0;
+    for ( ; head != tail; ++head, ++seen )
+    {
+      f( m_cqes[head & m_cq_mask] );
+    }
+    __atomic_store_n( m_cq_head, head, __ATOMIC_RELEASE );
+    return seen;
+  }
+
+private:
+  void* map( size_t bytes, uint64_t offset )
+  {
+    void* p = mmap( nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                    off_t( offset ) );
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  int           m_fd{-1};
+  void*         m_sq_map{nullptr};
+  void*         m_cq_map{nullptr};
+  io_uring_sqe* m_sqes{nullptr};
+  size_t        m_sq_size{0};
+  size_t        m_cq_size{0};
+  size_t        m_sqes_size{0};
+  unsigned*     m_sq_head{nullptr};
+  unsigned*     m_sq_tail{nullptr};
+  unsigned*     m_sq_array{nullptr};
+  unsigned*     m_cq_head{nullptr};
+  unsigned*     m_cq_tail{nullptr};
+  io_uring_cqe* m_cqes{nullptr};
+  unsigned      m_sq_mask{0};
+  unsigned      m_cq_mask{0};
+  unsigned      m_entries{0};
+  unsigned      m_local_tail{0};
+}; // io_ring
+} // namespace detail
+
+class block_io
+{
+public:
+  explicit block_io( block_io_options options = {} )
+      : m_options( options )
+  {
+    if ( options.use_io_uring && start_ring() )
+    {
+      return;
+    }
+    m_ring.reset();
+    m_pool.reset( new thread_pool( std::max< size_t >( 1, options.threads ) ) );
+  }
+
+  block_io( const block_io& ) = delete;
+  block_io& operator=( const block_io& ) = delete;
+
+  // waits for everything in flight. submits from then on, continuations of the
+  // requests still in flight included, throw std::logic_error.
+  ~block_io()
+  {
+    std::unique_lock< std::mutex > locker{m_lock};
+    m_stopping = true;
+    if ( m_pool )
+    {
+      locker.unlock();
+      m_pool.reset();
+      return;
+    }
+
+    m_space.wait( locker, [this] { return m_inflight == 0; } );
+    io_uring_sqe* stop = m_ring->next_sqe();
+    stop->opcode       = IORING_OP_NOP;
+    stop->user_data    = 0;
+    m_ring->submit( 1 );
+    locker.unlock();
+    m_reaper.join();
+  }
+
+  io_backend backend() const
+  {
+    return m_ring ? io_backend::io_uring : io_backend::threads;
+  }
+
+  // use fd, which stays the caller's to close after the last request on it
+  io_file add_file( int fd )
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+
+    const unsigned slot = unsigned( m_fds.size() );
+    m_fds.push_back( fd );
+    m_fixed.push_back( false );
+    if ( m_ring && slot < m_fixed_slots )
+    {
+      io_uring_files_update update;
+      memset( &update, 0, sizeof( update ) );
+      update.offset = slot;
+      update.fds    = reinterpret_cast< uintptr_t >( &m_fds[slot] );
+      m_fixed[slot] = m_ring->enroll( IORING_REGISTER_FILES_UPDATE, &update, 1 ) == 1;
+    }
+    return io_file{slot};
+  }
+
+  // pin [data, data + bytes) for the engine's lifetime, requests inside it then
+  // go out as fixed buffer reads and writes. false if the kernel refused (or
+  // there is no io_uring), requests still work, just without the shortcut.
+  // not while requests are in flight.
+  bool register_buffer( const void* data, size_t bytes )
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+    if ( m_inflight > 0 )
+    {
+      throw std::logic_error( "block_io: register_buffer with requests in flight" );
+    }
+    if ( !m_ring )
+    {
+      return false;
+    }
+
+    std::vector< iovec > buffers = m_buffers;
+    buffers.push_back( iovec{const_cast< void* >( data ), bytes} );
+    if ( !m_buffers.empty() )
+    {
+      m_ring->enroll( IORING_UNREGISTER_BUFFERS, nullptr, 0 );
+    }
+    if ( m_ring->enroll( IORING_REGISTER_BUFFERS, buffers.data(), unsigned( buffers.size() ) ) < 0 )
+    {
+      if ( !m_buffers.empty() )
+      {
+        m_ring->enroll( IORING_REGISTER_BUFFERS, m_buffers.data(), unsigned( m_buffers.size() ) );
+      }
+      return false;
+    }
+    m_buffers = std::move( buffers );
+    return true;
+  }
+
+  template < class Block >
+  bool register_buffer( const aligned_blocks< Block >& blocks )
+  {
+    return register_buffer( blocks.data(), blocks.bytes() );
+  }
+
+  // the bytes transferred, fewer than asked when a read runs into the end of the
+  // file. failures arrive as std::system_error.
+  future< size_t > read( io_file file, void* data, size_t bytes, uint64_t offset )
+  {
+    const io_request r{io_op::read, file, data, bytes, offset};
+    return submit( &r, 1 );
+  }
+
+  future< size_t > write( io_file file, const void* data, size_t bytes, uint64_t offset )
+  {
+    const io_request r{io_op::write, file, const_cast< void* >( data ), bytes, offset};
+    return submit( &r, 1 );
+  }
+
+  // count blocks at block index first_block of the file
+  template < int N >
+  future< size_t > read_blocks( io_file file, block< N >* blocks, size_t count,
+                                uint64_t first_block )
+  {
+    static_assert( sizeof( block< N > ) == N, "blocks are read as they lie in memory" );
+    return read( file, blocks, count * N, first_block * N );
+  }
+
+  template < int N >
+  future< size_t > write_blocks( io_file file, const block< N >* blocks, size_t count,
+                                 uint64_t first_block )
+  {
+    static_assert( sizeof( block< N > ) == N, "blocks are written as they lie in memory" );
+    return write( file, blocks, count * N, first_block * N );
+  }
+
+  // all count requests as one batch, one future for the lot: the bytes moved by
+  // all of them, or the first failure. waits for room when more than the queue
+  // depth is in flight, except on the reaper, which only it could make room for:
+  // there the rest is queued behind the ring. throws std::logic_error once the
+  // engine is being destroyed.
+  future< size_t > submit( const io_request* requests, size_t count )
+  {
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      check( requests[ix] );
+    }
+
+    std::unique_lock< std::mutex > locker{m_lock};
+    if ( m_stopping )
+    {
+      throw std::logic_error( "block_io: submit while the engine is being destroyed" );
+    }
+
+    auto* batch  = new pending( count );
+    auto  result = batch->done.get_future();
+    if ( count == 0 )
+    {
+      locker.unlock();
+      batch->done.set_value( 0 );
+      delete batch;
+      return result;
+    }
+
+    if ( m_pool )
+    {
+      // posted holding the lock, so the destructor finds them queued
+      for ( size_t ix = 0; ix < count; ++ix )
+      {
+        const io_request r  = requests[ix];
+        const int        fd = m_fds[r.file.slot];
+        m_pool->post( [batch, r, fd] { batch->finish( transfer( r, fd ) ); } );
+      }
+      return result;
+    }
+
+    const bool reaper = std::this_thread::get_id() == m_reaper.get_id();
+    for ( size_t ix = 0; ix < count; )
+    {
+      if ( reaper && ( m_inflight == m_options.queue_depth || !m_backlog.empty() ) )
+      {
+        for ( ; ix < count; ++ix )
+        {
+          m_backlog.emplace_back( requests[ix], batch );
+        }
+        break;
+      }
+      // the backlog first, the reaper sends it ahead of new requests
+      m_space.wait( locker, [this] {
+        return m_inflight < m_options.queue_depth && m_backlog.empty();
+      } );
+
+      const unsigned room = unsigned(
+          std::min< size_t >( count - ix, m_options.queue_depth - m_inflight ) );
+      for ( unsigned k = 0; k < room; ++k )
+      {
+        prepare( *m_ring->next_sqe(), requests[ix + k], batch );
+      }
+      m_inflight += room;
+      m_ring->submit( room );
+      ix += room;
+    }
+    return result;
+  }
+
+  future< size_t > submit( const std::vector< io_request >& requests )
+  {
+    return submit( requests.data(), requests.size() );
+  }
+
+private:
+  // one submit() call, completed when its last request is
+  struct pending
+  {
+    explicit pending( size_t count )
+        : remaining( count )
+    {
+    }
+
+    void finish( int64_t result )
+    {
+      if ( result < 0 )
+      {
+        int none = 0;
+        error.compare_exchange_strong( none, int( -result ) );
+      }
+      else
+      {
+        bytes.fetch_add( size_t( result ), std::memory_order_relaxed );
+      }
+
+      if ( remaining.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+      {
+        if ( int e = error.load() )
+        {
+          done.set_exception( std::make_exception_ptr(
+              std::system_error( e, std::generic_category(), "block_io" ) ) );
+        }
+        else
+        {
+          done.set_value( bytes.load( std::memory_order_relaxed ) );
+        }
+        delete this;
+      }
+    }
+
+    std::atomic< size_t > remaining;
+    std::atomic< size_t > bytes{0};
+    std::atomic< int >    error{0};
+    promise< size_t >     done;
+  };
+
+  static constexpr unsigned fixed_file_slots = 64;
+
+  bool start_ring()
+  {
+    m_ring.reset( new detail::io_ring );
+    if ( !m_ring->setup( std::max( 1u, m_options.queue_depth ) )
+         || !m_ring->supports( {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_READ_FIXED,
+                                IORING_OP_WRITE_FIXED, IORING_OP_NOP} ) )
+    {
+      return false;
+    }
+
+    // the completion ring holds twice the submission ring, so never more in
+    // flight than submission entries means completions never overflow
+    m_options.queue_depth = m_ring->entries();
+
+    // a sparse fixed file table, filled in by add_file
+    std::vector< int > empty( fixed_file_slots, -1 );
+    if ( m_ring->enroll( IORING_REGISTER_FILES, empty.data(), fixed_file_slots ) >= 0 )
+    {
+      m_fixed_slots = fixed_file_slots;
+    }
+
+    m_reaper = std::thread( [this] { reap(); } );
+    return true;
+  }
+
+  void check( const io_request& r )
+  {
+    if ( r.bytes > UINT32_MAX )
+    {
+      throw std::invalid_argument( "block_io: request over 4GiB" );
+    }
+    file_descriptor( r.file );
+  }
+
+  int file_descriptor( io_file file )
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+    if ( file.slot >= m_fds.size() )
+    {
+      throw std::invalid_argument( "block_io: unknown file" );
+    }
+    return m_fds[file.slot];
+  }
+
+  // called holding m_lock
+  void prepare( io_uring_sqe& sqe, const io_request& r, pending* batch )
+  {
+    const uintptr_t at    = reinterpret_cast< uintptr_t >( r.data );
+    int             fixed = -1;
+    for ( size_t ix = 0; ix < m_buffers.size(); ++ix )
+    {
+      const uintptr_t base = reinterpret_cast< uintptr_t >( m_buffers[ix].iov_base );
+      if ( at >= base && at + r.bytes <= base + m_buffers[ix].iov_len )
+      {
+        fixed = int( ix );
+        break;
+      }
+    }
+
+    const bool reading = r.op == io_op::read;
+    if ( fixed >= 0 )
+    {
+      sqe.opcode    = reading ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+      sqe.buf_index = uint16_t( fixed );
+    }
+    else
+    {
+      sqe.opcode = reading ? IORING_OP_READ : IORING_OP_WRITE;
+    }
+
+    if ( m_fixed[r.file.slot] )
+    {
+      sqe.fd = int( r.file.slot );
+      sqe.flags |= IOSQE_FIXED_FILE;
+    }
+    else
+    {
+      sqe.fd = m_fds[r.file.slot];
+    }
+    sqe.addr      = at;
+    sqe.len       = uint32_t( r.bytes );
+    sqe.off       = r.offset;
+    sqe.user_data = reinterpret_cast< uintptr_t >( batch );
+  }
+
+  // called holding m_lock, as many queued requests as there is room for
+  void send_backlog()
+  {
+    const size_t room = std::min( m_backlog.size(), m_options.queue_depth - m_inflight );
+    for ( size_t ix = 0; ix < room; ++ix )
+    {
+      prepare( *m_ring->next_sqe(), m_backlog.front().first, m_backlog.front().second );
+      m_backlog.pop_front();
+    }
+    if ( room > 0 )
+    {
+      m_inflight += room;
+      m_ring->submit( unsigned( room ) );
+    }
+  }
+
+  // the reaper thread. completions are taken off the ring and their slots given
+  // back, to the backlog first, before any promise is kept. after the
+  // destructor's stop it goes on until nothing is in flight or queued: a
+  // submitter already waiting for room may still have sent its requests.
+  void reap()
+  {
+    std::vector< std::pair< pending*, int64_t > > done;
+    auto idle = [this] {
+      std::lock_guard< std::mutex > locker{m_lock};
+      return m_inflight == 0 && m_backlog.empty();
+    };
+    for ( bool stop = false; !stop || !idle(); )
+    {
+      m_ring->wait();
+
+      done.clear();
+      m_ring->drain( [&]( const io_uring_cqe& cqe ) {
+        if ( cqe.user_data == 0 )
+        {
+          stop = true;
+        }
+        else
+        {
+          done.emplace_back( reinterpret_cast< pending* >( cqe.user_data ), cqe.res );
+        }
+      } );
+
+      if ( !done.empty() )
+      {
+        {
+          std::lock_guard< std::mutex > locker{m_lock};
+          m_inflight -= done.size();
+          send_backlog();
+        }
+        m_space.notify_all();
+      }
+      for ( auto& d : done )
+      {
+        d.first->finish( d.second );
+      }
+    }
+  }
+
+  // pread / pwrite until everything moved, the file ended, or it failed
+  static int64_t transfer( const io_request& r, int fd )
+  {
+    char*  data = static_cast< char* >( r.data );
+    size_t done = 0;
+    while ( done < r.bytes )
+    {
+      const ssize_t n = r.op == io_op::read
+                            ? pread( fd, data + done, r.bytes - done, off_t( r.offset + done ) )
+                            : pwrite( fd, data + done, r.bytes - done, off_t( r.offset + done ) );
+      if ( n < 0 )
+      {
+        if ( errno == EINTR )
+        {
+          continue;
+        }
+        return -errno;
+      }
+      if ( n == 0 )
+      {
+        break;
+      }
+      done += size_t( n );
+    }
+    return int64_t( done );
+  }
+
+  block_io_options m_options;
+
+  std::unique_ptr< detail::io_ring > m_ring;
+  std::thread                        m_reaper;
+  unsigned                           m_fixed_slots{0};
+  std::vector< iovec >               m_buffers; // registered, in buf_index order
+  std::vector< bool >                m_fixed;   // per file, in the fixed table
+
+  std::mutex              m_lock; // the submission ring, m_inflight and the tables
+  std::condition_variable m_space;
+  size_t                  m_inflight{0};
+  std::vector< int >      m_fds;
+  bool                    m_stopping{false}; // the destructor has begun
+
+  // submitted from the reaper while the ring was full, sent as completions free
+  // slots. m_inflight is never 0 while there is any.
+  std::deque< std::pair< io_request, pending* > > m_backlog;
+
+  std::unique_ptr< thread_pool > m_pool; // when there is no ring
+}; // block_io
@@ -0,0 +1,193 @@
+// block<4096> streams to and from a 256MiB file under /tmp: a plain pread /
+// pwrite loop on one thread, block_io's thread pool fallback, io_uring, and
+// io_uring with registered buffers and the fixed file table. sequential writes
+// in batches of 64 blocks, then random single block reads 64 at a time, through
+// the page cache and with O_DIRECT. IOPS (in 4k blocks) and GB/s for each.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "block_io.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+using block_type = block< 4096 >;
+
+constexpr size_t file_blocks = 64 * 1024;
+constexpr size_t depth       = 64;
+constexpr size_t reads       = 200000;
+
+const char* const path = "/tmp/block_io_bench.dat";
+
+struct engine
+{
+  std::string      name;
+  block_io_options options;
+  bool             registered;
+};
+
+std::vector< engine > engines()
+{
+  block_io_options threads;
+  threads.use_io_uring = false;
+  threads.threads      = 8;
+  block_io_options ring;
+  ring.queue_depth = depth;
+  return {{"threads", threads, false}, {"io_uring", ring, false}, {"io_uring fixed", ring, true}};
+}
+
+void report( const std::string& name, size_t ops, size_t bytes, clock_type::time_point start )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << ops / elapsed.count() / 1e3 << "K IOPS "
+            << bytes / elapsed.count() / 1e9 << "GB/s" << std::endl;
+}
+
+std::vector< uint64_t > random_blocks( size_t count )
+{
+  std::mt19937_64                           gen( 42 );
+  std::uniform_int_distribution< uint64_t > pick( 0, file_blocks - 1 );
+  std::vector< uint64_t >                   at( count );
+  for ( auto& a : at )
+  {
+    a = pick( gen );
+  }
+  return at;
+}
+
+void sequential_write( const engine& e, int flags )
+{
+  const int fd = ::open( path, O_RDWR | O_CREAT | flags, 0644 );
+  ASSERT_GE( fd, 0 );
+
+  aligned_blocks< block_type > buffer( depth );
+  for ( size_t ix = 0; ix < depth; ++ix )
+  {
+    buffer[ix].fill( uint8_t( ix ) );
+  }
+
+  auto start = clock_type::now();
+  {
+    block_io io( e.options );
+    io_file  f = io.add_file( fd );
+    if ( e.registered )
+    {
+      io.register_buffer( buffer );
+    }
+    for ( size_t at = 0; at < file_blocks; at += depth )
+    {
+      EXPECT_EQ( io.write_blocks( f, buffer.data(), depth, at ).get(),
+                 depth * sizeof( block_type ) );
+    }
+  }
+  fsync( fd );
+  report( e.name + ( flags ? " O_DIRECT" : "" ) + " sequential write", file_blocks,
+          file_blocks * sizeof( block_type ), start );
+  ::close( fd );
+}
+
+void random_read( const engine& e, int flags, size_t count )
+{
+  const int fd = ::open( path, O_RDWR | flags );
+  ASSERT_GE( fd, 0 );
+
+  const auto                   at = random_blocks( count );
+  aligned_blocks< block_type > buffer( depth );
+  std::vector< io_request >    batch( depth );
+
+  block_io io( e.options );
+  io_file  f = io.add_file( fd );
+  if ( e.registered )
+  {
+    io.register_buffer( buffer );
+  }
+
+  auto start = clock_type::now();
+  for ( size_t done = 0; done < count; done += depth )
+  {
+    for ( size_t ix = 0; ix < depth; ++ix )
+    {
+      batch[ix] = io_request{io_op::read, f, buffer[ix].data(), sizeof( block_type ),
+                             at[( done + ix ) % count] * sizeof( block_type )};
+    }
+    EXPECT_EQ( io.submit( batch ).get(), depth * sizeof( block_type ) );
+  }
+  report( e.name + ( flags ? " O_DIRECT" : "" ) + " random read", count,
+          count * sizeof( block_type ), start );
+  ::close( fd );
+}
+
+void sync_loop( int flags, size_t count )
+{
+  const int fd = ::open( path, O_RDWR | O_CREAT | flags, 0644 );
+  ASSERT_GE( fd, 0 );
+  aligned_blocks< block_type > buffer( depth );
+  const std::string            mode = flags ? " O_DIRECT" : "";
+
+  auto start = clock_type::now();
+  for ( size_t at = 0; at < file_blocks; at += depth )
+  {
+    EXPECT_EQ( pwrite( fd, buffer.data(), buffer.bytes(), off_t( at * sizeof( block_type ) ) ),
+               ssize_t( buffer.bytes() ) );
+  }
+  fsync( fd );
+  report( "pwrite loop" + mode + " sequential write", file_blocks,
+          file_blocks * sizeof( block_type ), start );
+
+  const auto at = random_blocks( count );
+  start         = clock_type::now();
+  for ( size_t ix = 0; ix < count; ++ix )
+  {
+    const off_t offset = off_t( at[ix] * sizeof( block_type ) );
+    EXPECT_EQ( pread( fd, buffer.data(), sizeof( block_type ), offset ),
+               ssize_t( sizeof( block_type ) ) );
+  }
+  report( "pread loop" + mode + " random read", count, count * sizeof( block_type ), start );
+  ::close( fd );
+}
+} // namespace
+
+TEST( BlockIoBench, PageCache )
+{
+  sync_loop( 0, reads );
+  for ( const engine& e : engines() )
+  {
+    sequential_write( e, 0 );
+    random_read( e, 0, reads );
+  }
+  unlink( path );
+}
+
+TEST( BlockIoBench, Direct )
+{
+  const int probe = ::open( path, O_RDWR | O_CREAT | O_DIRECT, 0644 );
+  if ( probe < 0 )
+  {
+    std::cout << "O_DIRECT not supported on /tmp, skipped" << std::endl;
+    return;
+  }
+  ::close( probe );
+
+  // fewer reads, these go to the device
+  sync_loop( O_DIRECT, reads / 10 );
+  for ( const engine& e : engines() )
+  {
+    sequential_write( e, O_DIRECT );
+    random_read( e, O_DIRECT, reads / 10 );
+  }
+  unlink( path );
+}
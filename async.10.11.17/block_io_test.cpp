@@ -0,0 +1,355 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "block_io.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using block_type = block< 4096 >;
+
+// a scratch file, removed again
+struct scratch_file
+{
+  explicit scratch_file( int extra_flags = 0 )
+  {
+    char name[] = "/tmp/block_io_test.XXXXXX";
+    fd          = mkstemp( name );
+    path        = name;
+    if ( extra_flags )
+    {
+      ::close( fd );
+      fd = ::open( path.c_str(), O_RDWR | extra_flags );
+    }
+  }
+
+  ~scratch_file()
+  {
+    if ( fd >= 0 )
+    {
+      ::close( fd );
+    }
+    unlink( path.c_str() );
+  }
+
+  int         fd;
+  std::string path;
+};
+
+// io_uring when the kernel has it, and always the thread pool
+std::vector< block_io_options > backends()
+{
+  block_io_options ring;
+  ring.queue_depth = 32;
+  block_io_options threads;
+  threads.use_io_uring = false;
+  threads.threads      = 4;
+  return {ring, threads};
+}
+
+void fill( block_type& b, uint64_t seed )
+{
+  for ( size_t ix = 0; ix < b.size(); ++ix )
+  {
+    b.data()[ix] = uint8_t( seed * 31 + ix * 7 );
+  }
+}
+
+// reads one after another, each submitted from the last one's completion, until
+// the engine refuses one
+struct read_chain
+{
+  block_io&              io;
+  io_file                file;
+  block_type*            into;
+  std::atomic< size_t >& refused;
+
+  void next()
+  {
+    try
+    {
+      io.read( file, into, sizeof( block_type ), 0 ).then( [this]( size_t ) { next(); } );
+    }
+    catch ( const std::logic_error& )
+    {
+      refused.fetch_add( 1 );
+    }
+  }
+};
+} // namespace
+
+TEST( BlockIo, WritesThenReadsBlocks )
+{
+  for ( auto options : backends() )
+  {
+    for ( bool registered : {false, true} )
+    {
+      scratch_file file;
+      block_io     io( options );
+      io_file      f = io.add_file( file.fd );
+
+      aligned_blocks< block_type > out( 64 ), in( 64 );
+      for ( size_t ix = 0; ix < out.size(); ++ix )
+      {
+        fill( out[ix], ix );
+      }
+      if ( registered )
+      {
+        EXPECT_EQ( io.register_buffer( out ), io.backend() == io_backend::io_uring );
+        EXPECT_EQ( io.register_buffer( in ), io.backend() == io_backend::io_uring );
+      }
+
+      EXPECT_EQ( io.write_blocks( f, out.data(), 64, 0 ).get(), 64 * sizeof( block_type ) );
+      EXPECT_EQ( io.read_blocks( f, in.data(), 64, 0 ).get(), 64 * sizeof( block_type ) );
+      EXPECT_EQ( memcmp( in.data(), out.data(), in.bytes() ), 0 );
+
+      // one block from the middle
+      block_type one( block_no_init );
+      EXPECT_EQ( io.read_blocks( f, &one, 1, 17 ).get(), sizeof( block_type ) );
+      EXPECT_TRUE( one == out[17] );
+    }
+  }
+}
+
+TEST( BlockIo, BatchesAndShortReads )
+{
+  for ( auto options : backends() )
+  {
+    scratch_file file;
+    block_io     io( options );
+    io_file      f = io.add_file( file.fd );
+
+    // more requests than the queue is deep, one future for all
+    constexpr size_t             count = 200;
+    aligned_blocks< block_type > blocks( count );
+    std::vector< io_request >    writes;
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      fill( blocks[ix], ix );
+      writes.push_back( io_request{io_op::write, f, blocks[ix].data(), sizeof( block_type ),
+                                   ix * sizeof( block_type )} );
+    }
+    EXPECT_EQ( io.submit( writes ).get(), count * sizeof( block_type ) );
+    EXPECT_EQ( io.submit( nullptr, 0 ).get(), 0u );
+
+    // reading across the end of the file stops there
+    aligned_blocks< block_type > tail( 4 );
+    EXPECT_EQ( io.read_blocks( f, tail.data(), 4, count - 1 ).get(), sizeof( block_type ) );
+    EXPECT_TRUE( tail[0] == blocks[count - 1] );
+    EXPECT_EQ( io.read_blocks( f, tail.data(), 1, count + 10 ).get(), 0u );
+  }
+}
+
+TEST( BlockIo, ErrorsReachTheFuture )
+{
+  for ( auto options : backends() )
+  {
+    block_io io( options );
+
+    // reading from a write only descriptor
+    scratch_file file;
+    int          wronly = ::open( file.path.c_str(), O_WRONLY );
+    io_file      f      = io.add_file( wronly );
+
+    block_type b;
+    auto       fut = io.read_blocks( f, &b, 1, 0 );
+    try
+    {
+      fut.get();
+      ADD_FAILURE() << "read from a write only file succeeded";
+    }
+    catch ( const std::system_error& e )
+    {
+      EXPECT_EQ( e.code().value(), EBADF );
+    }
+    ::close( wronly );
+
+    // a batch with one bad request fails as a whole, the good ones still run
+    io_file                   good = io.add_file( file.fd );
+    std::vector< io_request > mixed{
+        io_request{io_op::write, good, b.data(), b.size(), 0},
+        io_request{io_op::read, f, b.data(), b.size(), 0},
+    };
+    EXPECT_THROW( io.submit( mixed ).get(), std::system_error );
+    EXPECT_EQ( lseek( file.fd, 0, SEEK_END ), off_t( b.size() ) );
+
+    EXPECT_THROW( io.read_blocks( io_file{99}, &b, 1, 0 ), std::invalid_argument );
+  }
+}
+
+TEST( BlockIo, DirectIo )
+{
+  scratch_file probe( O_DIRECT );
+  if ( probe.fd < 0 )
+  {
+    std::cout << "O_DIRECT not supported on /tmp, skipped" << std::endl;
+    return;
+  }
+
+  for ( auto options : backends() )
+  {
+    scratch_file file( O_DIRECT );
+    block_io     io( options );
+    io_file      f = io.add_file( file.fd );
+
+    aligned_blocks< block_type > out( 16 ), in( 16 );
+    for ( size_t ix = 0; ix < out.size(); ++ix )
+    {
+      fill( out[ix], ix + 100 );
+    }
+    io.register_buffer( out );
+
+    EXPECT_EQ( io.write_blocks( f, out.data(), 16, 3 ).get(), 16 * sizeof( block_type ) );
+    EXPECT_EQ( io.read_blocks( f, in.data(), 16, 3 ).get(), 16 * sizeof( block_type ) );
+    EXPECT_EQ( memcmp( in.data(), out.data(), in.bytes() ), 0 );
+  }
+}
+
+TEST( BlockIo, ManySubmitters )
+{
+  for ( auto options : backends() )
+  {
+    options.queue_depth = 8;
+
+    scratch_file file;
+    block_io     io( options );
+    io_file      f = io.add_file( file.fd );
+
+    aligned_blocks< block_type > blocks( 16 );
+    for ( size_t ix = 0; ix < blocks.size(); ++ix )
+    {
+      fill( blocks[ix], ix );
+    }
+    io.write_blocks( f, blocks.data(), blocks.size(), 0 ).get();
+
+    std::atomic< size_t >      good{0};
+    std::vector< std::thread > threads;
+    for ( size_t t = 0; t < 4; ++t )
+    {
+      threads.emplace_back( [&, t] {
+        std::vector< block_type >       in( 500, block_type( block_no_init ) );
+        std::vector< future< size_t > > pending;
+        for ( size_t ix = 0; ix < in.size(); ++ix )
+        {
+          pending.push_back( io.read_blocks( f, &in[ix], 1, ( ix + t ) % 16 ) );
+        }
+        for ( size_t ix = 0; ix < in.size(); ++ix )
+        {
+          if ( pending[ix].get() == sizeof( block_type ) && in[ix] == blocks[( ix + t ) % 16] )
+          {
+            good.fetch_add( 1 );
+          }
+        }
+      } );
+    }
+    for ( auto& t : threads )
+    {
+      t.join();
+    }
+    EXPECT_EQ( good.load(), 2000u );
+  }
+}
+
+// continuations run on the reaper: one that submits more than the queue holds
+// must not wait there for room only the reaper can make
+TEST( BlockIo, ContinuationsSubmitPastTheQueueDepth )
+{
+  for ( auto options : backends() )
+  {
+    options.queue_depth = 8;
+
+    scratch_file file;
+    block_io     io( options );
+    io_file      f = io.add_file( file.fd );
+
+    aligned_blocks< block_type > blocks( 16 );
+    for ( size_t ix = 0; ix < blocks.size(); ++ix )
+    {
+      fill( blocks[ix], ix );
+    }
+    io.write_blocks( f, blocks.data(), blocks.size(), 0 ).get();
+
+    // reads of an empty pipe are still in flight when the chains go on, so
+    // their completions, and the continuations, come from the reaper. the
+    // thread pool reads the file instead: pread has no pipes.
+    int pipe_fds[2];
+    ASSERT_EQ( pipe( pipe_fds ), 0 );
+    const bool ring    = io.backend() == io_backend::io_uring;
+    io_file    trigger = ring ? io.add_file( pipe_fds[0] ) : f;
+
+    // four chains, each then submitting five queues' worth of reads
+    constexpr size_t                          chains = 4, reads = 40;
+    aligned_blocks< block_type >              first( chains ), in( chains * reads );
+    std::vector< future< future< size_t > > > pending;
+    for ( size_t c = 0; c < chains; ++c )
+    {
+      pending.push_back( io.read( trigger, first[c].data(), 1, 0 ).then( [&, c]( size_t ) {
+        std::vector< io_request > batch;
+        for ( size_t ix = 0; ix < reads; ++ix )
+        {
+          batch.push_back( io_request{io_op::read, f, in[c * reads + ix].data(),
+                                      sizeof( block_type ), ( ix % 16 ) * sizeof( block_type )} );
+        }
+        return io.submit( batch );
+      } ) );
+    }
+    ASSERT_EQ( write( pipe_fds[1], "abcd", chains ), ssize_t( chains ) );
+
+    for ( size_t c = 0; c < chains; ++c )
+    {
+      EXPECT_EQ( pending[c].get().get(), reads * sizeof( block_type ) );
+      for ( size_t ix = 0; ix < reads; ++ix )
+      {
+        EXPECT_TRUE( in[c * reads + ix] == blocks[ix % 16] );
+      }
+    }
+    ::close( pipe_fds[0] );
+    ::close( pipe_fds[1] );
+  }
+}
+
+// the destructor stops new submits, and whatever continuations sent before that
+// is still completed: every chain ends with a refusal, none is left in flight
+TEST( BlockIo, DestroyedWhileContinuationsSubmit )
+{
+  for ( auto options : backends() )
+  {
+    scratch_file                 file;
+    aligned_blocks< block_type > in( 4 );
+    fill( in[0], 1 );
+    std::atomic< size_t > refused{0};
+
+    std::vector< read_chain > chains;
+    chains.reserve( in.size() );
+    {
+      block_io io( options );
+      io_file  f = io.add_file( file.fd );
+      io.write_blocks( f, in.data(), 1, 0 ).get();
+
+      for ( size_t c = 0; c < in.size(); ++c )
+      {
+        chains.push_back( read_chain{io, f, &in[c], refused} );
+        chains.back().next();
+      }
+      std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+    }
+    EXPECT_EQ( refused.load(), in.size() );
+  }
+}
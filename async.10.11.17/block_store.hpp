@@ -0,0 +1,349 @@
+#pragma once
+
+// content addressed block store: identical blocks are kept once, keyed by their
+// digest and reference counted.
+//
+// the index is split into stripes by the leading bytes of the digest, each stripe an
+// open addressing table (linear probing, backward shift deletion) behind its own
+// mutex, so inserts and lookups on different stripes never touch the same lock or
+// cache line. digests are computed before any lock is taken. block copies live in
+// per stripe chunked arenas so pointers handed out by find() stay put while the
+// table grows.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "digest.hpp"
+
+template < class BlockType, class Algo = sha256 >
+class block_store
+{
+public:
+  using block_type  = BlockType;
+  using digest_type = typename Algo::digest_type;
+
+  struct statistics
+  {
+    size_t unique_blocks{0};     // copies actually held
+    size_t referenced_blocks{0}; // sum of all reference counts
+    size_t stored_bytes{0};      // unique_blocks * block size
+    size_t logical_bytes{0};     // what the references would cost without dedupe
+    size_t index_bytes{0};       // hash index slots, whether used or not
+    size_t arena_bytes{0};       // block storage reserved, including the free lists
+
+    // logical / stored, 1.0 means nothing was deduplicated
+    double dedupe_ratio() const
+    {
+      return stored_bytes ? double( logical_bytes ) / double( stored_bytes ) : 1.0;
+    }
+
+    size_t saved_bytes() const
+    {
+      return logical_bytes - stored_bytes;
+    }
+  };
+
+  // stripes is rounded up to a power of two
+  explicit block_store( size_t expected_blocks = 1024, size_t stripes = 64 )
+  {
+    size_t n = 1;
+    while ( n < stripes )
+    {
+      n <<= 1;
+    }
+    m_stripe_mask = n - 1;
+    m_stripes.reset( new stripe[n] );
+
+    size_t per_stripe = expected_blocks / n + 1;
+    for ( size_t ix = 0; ix < n; ++ix )
+    {
+      m_stripes[ix].reserve( per_stripe );
+    }
+  }
+
+  block_store( const block_store& ) = delete;
+  block_store& operator=( const block_store& ) = delete;
+
+  // take a reference to b's content, storing a copy if it's the first. returns the
+  // content address and whether a copy was made.
+  std::pair< digest_type, bool > insert( const block_type& b )
+  {
+    digest_type digest = b.template digest< Algo >();
+    return { digest, insert( digest, b ) };
+  }
+
+  // hash count blocks in one batch, then insert them. digests may be null.
+  // returns how many new copies were stored.
+  size_t insert_n( const block_type* blocks, size_t count, digest_type* digests = nullptr )
+  {
+    std::vector< digest_type > local;
+    if ( !digests )
+    {
+      local.resize( count );
+      digests = local.data();
+    }
+
+    digest_n< Algo >( blocks, count, digests );
+
+    size_t added = 0;
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      added += insert( digests[ix], blocks[ix] ) ? 1 : 0;
+    }
+    return added;
+  }
+
+  // the stored copy, or null. stays valid until its last reference is released.
+  const block_type* find( const digest_type& digest ) const
+  {
+    const stripe&                 s = stripe_for( digest );
+    std::lock_guard< std::mutex > locker{s.lock};
+    const entry*                  e = s.lookup( digest );
+    return e ? e->block : nullptr;
+  }
+
+  size_t refcount( const digest_type& digest ) const
+  {
+    const stripe&                 s = stripe_for( digest );
+    std::lock_guard< std::mutex > locker{s.lock};
+    const entry*                  e = s.lookup( digest );
+    return e ? e->refs : 0;
+  }
+
+  // drop one reference, the copy is freed with the last. false if digest isn't stored.
+  bool release( const digest_type& digest )
+  {
+    stripe&                       s = stripe_for( digest );
+    std::lock_guard< std::mutex > locker{s.lock};
+    return s.release( digest );
+  }
+
+  statistics stats() const
+  {
+    statistics out;
+    for ( size_t ix = 0; ix <= m_stripe_mask; ++ix )
+    {
+      const stripe&                 s = m_stripes[ix];
+      std::lock_guard< std::mutex > locker{s.lock};
+      out.unique_blocks += s.size;
+      out.referenced_blocks += s.references;
+      out.index_bytes += s.slots.size() * sizeof( entry );
+      out.arena_bytes += s.chunks.size() * chunk_blocks * sizeof( block_type );
+    }
+    out.stored_bytes  = out.unique_blocks * sizeof( block_type );
+    out.logical_bytes = out.referenced_blocks * sizeof( block_type );
+    return out;
+  }
+
+private:
+  static constexpr size_t chunk_blocks = 256;
+
+  struct entry
+  {
+    digest_type block_digest;
+    block_type* block{nullptr}; // null marks an empty slot
+    size_t      refs{0};
+  };
+
+  // alignas keeps two stripes' locks and counters off the same cache line
+  struct alignas( 64 ) stripe
+  {
+    mutable std::mutex                          lock;
+    std::vector< entry >                        slots;
+    size_t                                      size{0};
+    size_t                                      references{0};
+    std::vector< std::unique_ptr< uint8_t[] > > chunks;
+    std::vector< block_type* >                  free_blocks;
+
+    void reserve( size_t expected )
+    {
+      // keep the load factor under 3/4
+      size_t capacity = 16;
+      while ( capacity * 3 < expected * 4 )
+      {
+        capacity <<= 1;
+      }
+      rehash( capacity );
+    }
+
+    size_t home( const digest_type& digest ) const
+    {
+      // the leading bytes picked the stripe, take the slot from the next ones
+      uint64_t h;
+      memcpy( &h, digest.data() + 8, sizeof( h ) );
+      return h & ( slots.size() - 1 );
+    }
+
+    const entry* lookup( const digest_type& digest ) const
+    {
+      const size_t mask = slots.size() - 1;
+      for ( size_t ix = home( digest );; ix = ( ix + 1 ) & mask )
+      {
+        const entry& e = slots[ix];
+        if ( !e.block )
+        {
+          return nullptr;
+        }
+        if ( e.block_digest == digest )
+        {
+          return &e;
+        }
+      }
+    }
+
+    // returns true when b was copied in, false when an existing copy was referenced
+    bool insert( const digest_type& digest, const block_type& b )
+    {
+      if ( ( size + 1 ) * 4 > slots.size() * 3 )
+      {
+        rehash( slots.size() * 2 );
+      }
+
+      const size_t mask = slots.size() - 1;
+      size_t       ix   = home( digest );
+      for ( ;; ix = ( ix + 1 ) & mask )
+      {
+        entry& e = slots[ix];
+        if ( !e.block )
+        {
+          break;
+        }
+        if ( e.block_digest == digest )
+        {
+          // a weak algorithm (sha1) can be made to collide, don't silently alias
+          if ( !( *e.block == b ) )
+          {
+            throw std::runtime_error( "block_store: digest collision" );
+          }
+          ++e.refs;
+          ++references;
+          return false;
+        }
+      }
+
+      entry& e       = slots[ix];
+      e.block_digest = digest;
+      e.block        = allocate( b );
+      e.refs         = 1;
+      ++size;
+      ++references;
+      return true;
+    }
+
+    bool release( const digest_type& digest )
+    {
+      const size_t mask = slots.size() - 1;
+      size_t       ix   = home( digest );
+      for ( ;; ix = ( ix + 1 ) & mask )
+      {
+        if ( !slots[ix].block )
+        {
+          return false;
+        }
+        if ( slots[ix].block_digest == digest )
+        {
+          break;
+        }
+      }
+
+      --references;
+      if ( --slots[ix].refs > 0 )
+      {
+        return true;
+      }
+
+      free_blocks.push_back( slots[ix].block );
+      slots[ix] = entry{};
+      --size;
+
+      // backward shift: pull later members of the probe run into the hole so
+      // lookups never need tombstones
+      size_t hole = ix;
+      for ( size_t next = ( hole + 1 ) & mask; slots[next].block; next = ( next + 1 ) & mask )
+      {
+        size_t want = home( slots[next].block_digest );
+        // move it if its home is not within (hole, next]
+        if ( ( ( next - want ) & mask ) >= ( ( next - hole ) & mask ) )
+        {
+          slots[hole] = slots[next];
+          slots[next] = entry{};
+          hole        = next;
+        }
+      }
+      return true;
+    }
+
+    void rehash( size_t capacity )
+    {
+      std::vector< entry > old( capacity );
+      old.swap( slots );
+
+      const size_t mask = slots.size() - 1;
+      for ( const auto& e : old )
+      {
+        if ( e.block )
+        {
+          size_t ix = home( e.block_digest );
+          while ( slots[ix].block )
+          {
+            ix = ( ix + 1 ) & mask;
+          }
+          slots[ix] = e;
+        }
+      }
+    }
+
+    block_type* allocate( const block_type& b )
+    {
+      if ( free_blocks.empty() )
+      {
+        // raw storage, every slot is copy constructed before it's handed out
+        chunks.emplace_back( new uint8_t[chunk_blocks * sizeof( block_type )] );
+        auto* base = reinterpret_cast< block_type* >( chunks.back().get() );
+        for ( size_t ix = chunk_blocks; ix > 0; --ix )
+        {
+          free_blocks.push_back( base + ix - 1 );
+        }
+      }
+
+      block_type* slot = free_blocks.back();
+      free_blocks.pop_back();
+      return new ( slot ) block_type( b );
+    }
+  };
+
+  size_t stripe_index( const digest_type& digest ) const
+  {
+    uint64_t h;
+    memcpy( &h, digest.data(), sizeof( h ) );
+    return h & m_stripe_mask;
+  }
+
+  stripe& stripe_for( const digest_type& digest )
+  {
+    return m_stripes[stripe_index( digest )];
+  }
+
+  const stripe& stripe_for( const digest_type& digest ) const
+  {
+    return m_stripes[stripe_index( digest )];
+  }
+
+  bool insert( const digest_type& digest, const block_type& b )
+  {
+    stripe&                       s = stripe_for( digest );
+    std::lock_guard< std::mutex > locker{s.lock};
+    return s.insert( digest, b );
+  }
+
+  std::unique_ptr< stripe[] > m_stripes;
+  size_t                      m_stripe_mask{0};
+}; // block_store
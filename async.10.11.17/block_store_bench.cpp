@@ -0,0 +1,124 @@
+// block_store insert throughput and memory at varying duplicate rates.
+// BLOCK_STORE_BENCH_BLOCKS overrides the default of 10M inserts per rate.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "block_store.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using BlockType = block< 64 >;
+
+size_t bench_blocks()
+{
+  const char* env = getenv( "BLOCK_STORE_BENCH_BLOCKS" );
+  return env ? strtoull( env, nullptr, 10 ) : 10 * 1000 * 1000;
+}
+
+size_t bench_threads()
+{
+  size_t n = std::thread::hardware_concurrency();
+  return n ? n : 1;
+}
+
+uint64_t splitmix64( uint64_t x )
+{
+  x += 0x9e3779b97f4a7c15ull;
+  x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+  x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebull;
+  return x ^ ( x >> 31 );
+}
+
+// block number i of the stream, cycling through `pool` distinct contents
+void make_block( BlockType& b, uint64_t i, uint64_t pool )
+{
+  uint64_t id = splitmix64( i % pool );
+  memcpy( b.data(), &id, sizeof( id ) );
+}
+
+void insert_rate( double duplicate_rate, size_t threads, bool batched )
+{
+  const size_t   total = bench_blocks();
+  const uint64_t pool  = std::max< uint64_t >( 1, uint64_t( total * ( 1.0 - duplicate_rate ) + 0.5 ) );
+
+  block_store< BlockType > store( pool );
+
+  auto worker = [&]( size_t first, size_t last ) {
+    std::vector< BlockType > batch( 1024 );
+    for ( size_t ix = first; ix < last; ix += batch.size() )
+    {
+      size_t n = std::min( batch.size(), last - ix );
+      for ( size_t b = 0; b < n; ++b )
+      {
+        make_block( batch[b], ix + b, pool );
+      }
+      if ( batched )
+      {
+        store.insert_n( batch.data(), n );
+      }
+      else
+      {
+        for ( size_t b = 0; b < n; ++b )
+        {
+          store.insert( batch[b] );
+        }
+      }
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector< std::thread > pool_threads;
+  const size_t               per = total / threads;
+  for ( size_t t = 0; t < threads; ++t )
+  {
+    size_t first = t * per;
+    size_t last  = ( t + 1 == threads ) ? total : first + per;
+    pool_threads.emplace_back( worker, first, last );
+  }
+  for ( auto& t : pool_threads )
+  {
+    t.join();
+  }
+
+  std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+
+  auto         stats = store.stats();
+  const double mib   = 1 << 20;
+  std::cout << "dup=" << std::setw( 4 ) << duplicate_rate * 100 << "% threads=" << threads
+            << ( batched ? " insert_n " : " insert   " ) << size_t( total / elapsed.count() )
+            << " blocks/s, unique=" << stats.unique_blocks << " ratio=" << stats.dedupe_ratio()
+            << " logical=" << stats.logical_bytes / mib << "MiB stored=" << stats.stored_bytes / mib
+            << "MiB saved=" << stats.saved_bytes() / mib << "MiB index=" << stats.index_bytes / mib
+            << "MiB" << std::endl;
+}
+} // namespace
+
+TEST( BlockStoreBench, InsertBatched )
+{
+  for ( double rate : {0.0, 0.5, 0.9, 0.99} )
+  {
+    insert_rate( rate, 1, true );
+    if ( bench_threads() > 1 )
+    {
+      insert_rate( rate, bench_threads(), true );
+    }
+  }
+}
+
+TEST( BlockStoreBench, InsertOneAtATime )
+{
+  insert_rate( 0.9, 1, false );
+}
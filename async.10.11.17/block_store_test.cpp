@@ -0,0 +1,209 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "block_factory.hpp"
+#include "block_store.hpp"
+#include "digest.hpp"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using BlockType = block< 256 >;
+
+BlockType numbered_block( uint64_t id )
+{
+  BlockType b;
+  memcpy( b.data(), &id, sizeof( id ) );
+  return b;
+}
+
+// a deliberately terrible digest, collides whenever the first byte matches
+struct first_byte_digest
+{
+  using digest_type = std::array< uint8_t, 16 >;
+
+  static digest_type hash( const void* data, size_t )
+  {
+    digest_type d{};
+    d[0] = *static_cast< const uint8_t* >( data );
+    return d;
+  }
+
+  static void hash_many( const uint8_t* const* data, size_t len, size_t count, digest_type* out )
+  {
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      out[ix] = hash( data[ix], len );
+    }
+  }
+};
+} // namespace
+
+TEST( BlockStore, Deduplicates )
+{
+  block_store< BlockType > store;
+
+  auto a = numbered_block( 1 );
+  auto b = numbered_block( 2 );
+
+  auto first  = store.insert( a );
+  auto second = store.insert( a );
+  auto third  = store.insert( b );
+
+  EXPECT_TRUE( first.second );
+  EXPECT_FALSE( second.second );
+  EXPECT_TRUE( third.second );
+  EXPECT_TRUE( first.first == second.first );
+  EXPECT_TRUE( first.first == a.digest< sha256 >() );
+
+  EXPECT_EQ( store.refcount( first.first ), 2u );
+  EXPECT_EQ( store.refcount( third.first ), 1u );
+
+  const BlockType* stored = store.find( first.first );
+  ASSERT_NE( stored, nullptr );
+  EXPECT_TRUE( *stored == a );
+
+  auto stats = store.stats();
+  EXPECT_EQ( stats.unique_blocks, 2u );
+  EXPECT_EQ( stats.referenced_blocks, 3u );
+  EXPECT_EQ( stats.stored_bytes, 2 * sizeof( BlockType ) );
+  EXPECT_EQ( stats.saved_bytes(), sizeof( BlockType ) );
+  EXPECT_DOUBLE_EQ( stats.dedupe_ratio(), 1.5 );
+}
+
+TEST( BlockStore, ReleaseFreesLastReference )
+{
+  // single stripe so both blocks share one arena
+  block_store< BlockType > store( 16, 1 );
+
+  auto a      = numbered_block( 7 );
+  auto digest = store.insert( a ).first;
+  store.insert( a );
+
+  EXPECT_TRUE( store.release( digest ) );
+  EXPECT_NE( store.find( digest ), nullptr );
+  EXPECT_TRUE( store.release( digest ) );
+  EXPECT_EQ( store.find( digest ), nullptr );
+  EXPECT_FALSE( store.release( digest ) );
+  EXPECT_EQ( store.stats().unique_blocks, 0u );
+
+  // the freed copy is reused rather than growing the arena
+  auto arena = store.stats().arena_bytes;
+  store.insert( numbered_block( 8 ) );
+  EXPECT_EQ( store.stats().arena_bytes, arena );
+}
+
+TEST( BlockStore, GrowAndDeleteKeepsIndexConsistent )
+{
+  // one stripe and a tiny initial table: lots of probing, rehashing and shifting
+  block_store< BlockType > store( 1, 1 );
+
+  constexpr uint64_t                 count = 5000;
+  std::vector< sha256::digest_type > digests;
+  for ( uint64_t id = 0; id < count; ++id )
+  {
+    digests.push_back( store.insert( numbered_block( id ) ).first );
+  }
+
+  std::vector< uint64_t > order( count );
+  for ( uint64_t id = 0; id < count; ++id )
+  {
+    order[id] = id;
+  }
+  std::shuffle( order.begin(), order.end(), std::mt19937( 42 ) );
+
+  std::vector< bool > released( count, false );
+  for ( size_t ix = 0; ix < count / 2; ++ix )
+  {
+    EXPECT_TRUE( store.release( digests[order[ix]] ) );
+    released[order[ix]] = true;
+  }
+
+  for ( uint64_t id = 0; id < count; ++id )
+  {
+    const BlockType* b = store.find( digests[id] );
+    if ( released[id] )
+    {
+      EXPECT_EQ( b, nullptr ) << id;
+    }
+    else
+    {
+      ASSERT_NE( b, nullptr ) << id;
+      EXPECT_TRUE( *b == numbered_block( id ) );
+    }
+  }
+  EXPECT_EQ( store.stats().unique_blocks, count - count / 2 );
+}
+
+TEST( BlockStore, InsertN )
+{
+  block_store< BlockType > store;
+
+  // 64 random blocks, each repeated four times
+  auto                     unique = block_factory< BlockType, op_random_fill >::create_n( 64 );
+  std::vector< BlockType > blocks;
+  for ( int rep = 0; rep < 4; ++rep )
+  {
+    blocks.insert( blocks.end(), unique.begin(), unique.end() );
+  }
+
+  std::vector< sha256::digest_type > digests( blocks.size() );
+  EXPECT_EQ( store.insert_n( blocks.data(), blocks.size(), digests.data() ), 64u );
+
+  for ( size_t ix = 0; ix < blocks.size(); ++ix )
+  {
+    EXPECT_TRUE( digests[ix] == blocks[ix].digest< sha256 >() );
+    EXPECT_EQ( store.refcount( digests[ix] ), 4u );
+  }
+  EXPECT_DOUBLE_EQ( store.stats().dedupe_ratio(), 4.0 );
+}
+
+TEST( BlockStore, ConcurrentInsert )
+{
+  block_store< BlockType > store( 1024, 8 );
+
+  // every thread inserts the same 1000 blocks
+  constexpr int              threads = 4;
+  constexpr uint64_t         count   = 1000;
+  std::vector< std::thread > pool;
+  for ( int t = 0; t < threads; ++t )
+  {
+    pool.emplace_back( [&] {
+      for ( uint64_t id = 0; id < count; ++id )
+      {
+        store.insert( numbered_block( id ) );
+      }
+    } );
+  }
+  for ( auto& t : pool )
+  {
+    t.join();
+  }
+
+  auto stats = store.stats();
+  EXPECT_EQ( stats.unique_blocks, count );
+  EXPECT_EQ( stats.referenced_blocks, count * threads );
+  for ( uint64_t id = 0; id < count; ++id )
+  {
+    EXPECT_EQ( store.refcount( numbered_block( id ).digest< sha256 >() ), size_t( threads ) );
+  }
+}
+
+TEST( BlockStore, DetectsDigestCollision )
+{
+  block_store< BlockType, first_byte_digest > store;
+
+  BlockType a( 0x11 );
+  BlockType b( 0x11 );
+  b.back() = 0x22;
+
+  store.insert( a );
+  EXPECT_THROW( store.insert( b ), std::runtime_error );
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+// CRC-32C (Castagnoli, the iSCSI / ext4 / SSE4.2 polynomial), after Crypto++'s
+// CRC32C in lib/cryptopp/crc.cpp and crc-simd.cpp, without the HashTransformation
+// plumbing. same shape as digest.hpp: a one shot hash() and a hash_many() over
+// equal sized messages, the engine picked at runtime:
+//   - SSE4.2 crc32 instructions when the cpu has them, 8 bytes a step. the
+//     instruction has a latency of three and a throughput of one, so hash_many
+//     runs three messages side by side to keep it busy
+//   - a slicing-by-8 table walk everywhere else (Crypto++ walks one byte at a time)
+// the engines are public so tests and benchmarks can pin one.
+
+#include <immintrin.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace detail
+{
+inline bool cpu_has_sse42()
+{
+  static const bool supported = __builtin_cpu_supports( "sse4.2" );
+  return supported;
+}
+
+// table[k][b]: the crc of byte b followed by k zero bytes, reflected 0x82f63b78
+struct crc32c_tables
+{
+  uint32_t table[8][256];
+
+  constexpr crc32c_tables()
+      : table()
+  {
+    for ( uint32_t b = 0; b < 256; ++b )
+    {
+      uint32_t c = b;
+      for ( int bit = 0; bit < 8; ++bit )
+      {
+        c = c & 1 ? ( c >> 1 ) ^ 0x82f63b78 : c >> 1;
+      }
+      table[0][b] = c;
+    }
+    for ( uint32_t b = 0; b < 256; ++b )
+    {
+      for ( int k = 1; k < 8; ++k )
+      {
+        table[k][b] = ( table[k - 1][b] >> 8 ) ^ table[0][table[k - 1][b] & 0xff];
+      }
+    }
+  }
+};
+
+constexpr crc32c_tables crc32c_table{};
+} // namespace detail
+
+struct crc32c
+{
+  using digest_type = uint32_t;
+
+  // raw register updates: crc in, crc out, no pre or post inversion
+  static uint32_t update_generic( uint32_t crc, const uint8_t* data, size_t len )
+  {
+    const auto& t = detail::crc32c_table.table;
+    for ( ; len >= 8; len -= 8, data += 8 )
+    {
+      uint64_t word;
+      memcpy( &word, data, sizeof( word ) );
+      word ^= crc;
+      crc = t[7][word & 0xff] ^ t[6][( word >> 8 ) & 0xff] ^ t[5][( word >> 16 ) & 0xff]
+            ^ t[4][( word >> 24 ) & 0xff] ^ t[3][( word >> 32 ) & 0xff]
+            ^ t[2][( word >> 40 ) & 0xff] ^ t[1][( word >> 48 ) & 0xff] ^ t[0][word >> 56];
+    }
+    for ( ; len > 0; --len, ++data )
+    {
+      crc = t[0][( crc ^ *data ) & 0xff] ^ ( crc >> 8 );
+    }
+    return crc;
+  }
+
+  __attribute__( ( target( "sse4.2" ) ) ) static uint32_t
+  update_sse42( uint32_t crc, const uint8_t* data, size_t len )
+  {
+    uint64_t c = crc;
+    for ( ; len >= 8; len -= 8, data += 8 )
+    {
+      uint64_t word;
+      memcpy( &word, data, sizeof( word ) );
+      c = _mm_crc32_u64( c, word );
+    }
+    crc = uint32_t( c );
+    for ( ; len > 0; --len, ++data )
+    {
+      crc = _mm_crc32_u8( crc, *data );
+    }
+    return crc;
+  }
+
+  // three messages of len bytes in lockstep, three independent dependency chains
+  __attribute__( ( target( "sse4.2" ) ) ) static void
+  update3_sse42( const uint8_t* const* data, size_t len, uint32_t* out )
+  {
+    const uint8_t* a  = data[0];
+    const uint8_t* b  = data[1];
+    const uint8_t* c  = data[2];
+    uint64_t       ca = ~0u, cb = ~0u, cc = ~0u;
+    size_t         ix = 0;
+    for ( ; ix + 8 <= len; ix += 8 )
+    {
+      uint64_t wa, wb, wc;
+      memcpy( &wa, a + ix, 8 );
+      memcpy( &wb, b + ix, 8 );
+      memcpy( &wc, c + ix, 8 );
+      ca = _mm_crc32_u64( ca, wa );
+      cb = _mm_crc32_u64( cb, wb );
+      cc = _mm_crc32_u64( cc, wc );
+    }
+    out[0] = ~update_sse42( uint32_t( ca ), a + ix, len - ix );
+    out[1] = ~update_sse42( uint32_t( cb ), b + ix, len - ix );
+    out[2] = ~update_sse42( uint32_t( cc ), c + ix, len - ix );
+  }
+
+  static uint32_t update( uint32_t crc, const void* data, size_t len )
+  {
+    auto* bytes = static_cast< const uint8_t* >( data );
+    return detail::cpu_has_sse42() ? update_sse42( crc, bytes, len )
+                                   : update_generic( crc, bytes, len );
+  }
+
+  static digest_type hash( const void* data, size_t len )
+  {
+    return ~update( ~0u, data, len );
+  }
+
+  // count messages of len bytes each
+  static void hash_many( const uint8_t* const* data, size_t len, size_t count, digest_type* out )
+  {
+    size_t ix = 0;
+    if ( detail::cpu_has_sse42() )
+    {
+      for ( ; ix + 3 <= count; ix += 3 )
+      {
+        update3_sse42( data + ix, len, out + ix );
+      }
+    }
+    for ( ; ix < count; ++ix )
+    {
+      out[ix] = hash( data[ix], len );
+    }
+  }
+}; // crc32c
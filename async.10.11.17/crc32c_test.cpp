@@ -0,0 +1,94 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "crc32c.hpp"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+std::vector< uint8_t > random_bytes( size_t count, uint64_t seed )
+{
+  std::mt19937_64        gen( seed );
+  std::vector< uint8_t > bytes( count );
+  for ( auto& b : bytes )
+  {
+    b = uint8_t( gen() );
+  }
+  return bytes;
+}
+} // namespace
+
+TEST( Crc32c, KnownVectors )
+{
+  // RFC 3720 B.4 and the usual check value
+  const std::string check = "123456789";
+  EXPECT_EQ( crc32c::hash( check.data(), check.size() ), 0xe3069283u );
+  EXPECT_EQ( crc32c::hash( "", 0 ), 0u );
+
+  std::vector< uint8_t > zeros( 32, 0 ), ones( 32, 0xff ), up( 32 );
+  for ( size_t ix = 0; ix < up.size(); ++ix )
+  {
+    up[ix] = uint8_t( ix );
+  }
+  EXPECT_EQ( crc32c::hash( zeros.data(), zeros.size() ), 0x8a9136aau );
+  EXPECT_EQ( crc32c::hash( ones.data(), ones.size() ), 0x62a8ab43u );
+  EXPECT_EQ( crc32c::hash( up.data(), up.size() ), 0x46dd794eu );
+}
+
+TEST( Crc32c, EnginesAgree )
+{
+  const auto bytes = random_bytes( 5000, 1 );
+  for ( size_t len : {0, 1, 7, 8, 9, 63, 64, 65, 4096, 4999} )
+  {
+    for ( size_t offset : {0, 1, 3} )
+    {
+      const uint8_t* p       = bytes.data() + offset;
+      const uint32_t generic = ~crc32c::update_generic( ~0u, p, len );
+      EXPECT_EQ( crc32c::hash( p, len ), generic ) << len << " at " << offset;
+      if ( detail::cpu_has_sse42() )
+      {
+        EXPECT_EQ( ~crc32c::update_sse42( ~0u, p, len ), generic ) << len << " at " << offset;
+      }
+    }
+  }
+}
+
+TEST( Crc32c, Incremental )
+{
+  const auto     bytes = random_bytes( 1000, 2 );
+  const uint32_t whole = crc32c::hash( bytes.data(), bytes.size() );
+
+  uint32_t crc = ~0u;
+  crc          = crc32c::update( crc, bytes.data(), 333 );
+  crc          = crc32c::update( crc, bytes.data() + 333, 667 );
+  EXPECT_EQ( ~crc, whole );
+}
+
+TEST( Crc32c, HashMany )
+{
+  // counts around the three way interleave
+  for ( size_t count : {1, 2, 3, 4, 5, 6, 7, 64} )
+  {
+    for ( size_t len : {13, 4096} )
+    {
+      const auto                    bytes = random_bytes( count * len, count + len );
+      std::vector< const uint8_t* > data;
+      for ( size_t ix = 0; ix < count; ++ix )
+      {
+        data.push_back( bytes.data() + ix * len );
+      }
+      std::vector< uint32_t > out( count );
+      crc32c::hash_many( data.data(), len, count, out.data() );
+      for ( size_t ix = 0; ix < count; ++ix )
+      {
+        EXPECT_EQ( out[ix], crc32c::hash( data[ix], len ) ) << ix << " of " << count;
+      }
+    }
+  }
+}
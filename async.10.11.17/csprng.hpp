@@ -0,0 +1,224 @@
+#pragma once
+
+// ChaCha20 (RFC 7539) keystream generator and a fast-key-erasure DRBG on top of it.
+// The DRBG seeds itself from getrandom(2), rekeys from its own output after every
+// request (so a captured state can't be used to recover earlier output) and pulls
+// fresh kernel entropy every reseed_interval bytes or when it notices a fork.
+
+#include <sys/random.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+class chacha20
+{
+public:
+  static constexpr size_t key_size   = 32;
+  static constexpr size_t nonce_size = 12;
+  static constexpr size_t block_size = 64;
+
+  chacha20( const uint8_t* key, const uint8_t* nonce, uint32_t counter = 0 )
+  {
+    rekey( key, nonce, counter );
+  }
+
+  ~chacha20()
+  {
+    wipe( m_state.data(), sizeof( m_state ) );
+  }
+
+  chacha20( const chacha20& ) = delete;
+  chacha20& operator=( const chacha20& ) = delete;
+
+  void rekey( const uint8_t* key, const uint8_t* nonce, uint32_t counter = 0 )
+  {
+    // "expand 32-byte k"
+    m_state[0] = 0x61707865;
+    m_state[1] = 0x3320646e;
+    m_state[2] = 0x79622d32;
+    m_state[3] = 0x6b206574;
+    for ( int ix = 0; ix < 8; ++ix )
+    {
+      m_state[4 + ix] = load32( key + ix * 4 );
+    }
+    m_state[12] = counter;
+    for ( int ix = 0; ix < 3; ++ix )
+    {
+      m_state[13 + ix] = load32( nonce + ix * 4 );
+    }
+  }
+
+  // write nblocks * block_size bytes of keystream to out and advance the counter
+  void keystream( uint8_t* out, size_t nblocks )
+  {
+    for ( size_t n = 0; n < nblocks; ++n, out += block_size )
+    {
+      uint32_t x[16];
+      memcpy( x, m_state.data(), sizeof( x ) );
+
+      for ( int round = 0; round < 10; ++round )
+      {
+        // column round
+        quarter_round( x[0], x[4], x[8], x[12] );
+        quarter_round( x[1], x[5], x[9], x[13] );
+        quarter_round( x[2], x[6], x[10], x[14] );
+        quarter_round( x[3], x[7], x[11], x[15] );
+        // diagonal round
+        quarter_round( x[0], x[5], x[10], x[15] );
+        quarter_round( x[1], x[6], x[11], x[12] );
+        quarter_round( x[2], x[7], x[8], x[13] );
+        quarter_round( x[3], x[4], x[9], x[14] );
+      }
+
+      for ( int ix = 0; ix < 16; ++ix )
+      {
+        store32( out + ix * 4, x[ix] + m_state[ix] );
+      }
+      ++m_state[12];
+    }
+  }
+
+  // zero memory in a way the optimizer is not allowed to drop
+  static void wipe( void* ptr, size_t len )
+  {
+    memset( ptr, 0, len );
+    __asm__ __volatile__( "" : : "r"( ptr ) : "memory" );
+  }
+
+private:
+  static uint32_t rotl( uint32_t v, int n )
+  {
+    return ( v << n ) | ( v >> ( 32 - n ) );
+  }
+
+  static void quarter_round( uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d )
+  {
+    a += b;
+    d = rotl( d ^ a, 16 );
+    c += d;
+    b = rotl( b ^ c, 12 );
+    a += b;
+    d = rotl( d ^ a, 8 );
+    c += d;
+    b = rotl( b ^ c, 7 );
+  }
+
+  // the cipher is defined little endian, so is every machine we build on
+  static uint32_t load32( const uint8_t* p )
+  {
+    uint32_t v;
+    memcpy( &v, p, sizeof( v ) );
+    return v;
+  }
+
+  static void store32( uint8_t* p, uint32_t v )
+  {
+    memcpy( p, &v, sizeof( v ) );
+  }
+
+  std::array< uint32_t, 16 > m_state;
+}; // chacha20
+
+class chacha20_drbg
+{
+public:
+  // bytes handed out between pulls from the kernel
+  static constexpr uint64_t default_reseed_interval = 1ull << 30;
+
+  explicit chacha20_drbg( uint64_t reseed_interval = default_reseed_interval )
+      : m_cipher( zero_seed().data(), zero_seed().data() )
+      , m_reseed_interval( reseed_interval )
+  {
+    reseed();
+  }
+
+  // deterministic instance for tests, never touches the kernel
+  chacha20_drbg( const uint8_t* key, const uint8_t* nonce )
+      : m_cipher( key, nonce )
+      , m_reseed_interval( 0 )
+      , m_pid( getpid() )
+  {
+  }
+
+  chacha20_drbg( const chacha20_drbg& ) = delete;
+  chacha20_drbg& operator=( const chacha20_drbg& ) = delete;
+
+  // pull a fresh key and nonce from getrandom(2)
+  void reseed()
+  {
+    uint8_t seed[chacha20::key_size + chacha20::nonce_size];
+    fill_from_kernel( seed, sizeof( seed ) );
+    m_cipher.rekey( seed, seed + chacha20::key_size );
+    chacha20::wipe( seed, sizeof( seed ) );
+
+    m_generated = 0;
+    m_pid       = getpid();
+  }
+
+  void generate( void* dest, size_t len )
+  {
+    // a forked child must not replay the parent's stream
+    if ( ( m_reseed_interval != 0 && m_generated >= m_reseed_interval ) || m_pid != getpid() )
+    {
+      reseed();
+    }
+
+    auto*        out    = static_cast< uint8_t* >( dest );
+    const size_t blocks = len / chacha20::block_size;
+    const size_t tail   = len % chacha20::block_size;
+
+    m_cipher.keystream( out, blocks );
+
+    // one more block covers the tail and the next key, fast key erasure style
+    uint8_t scratch[2 * chacha20::block_size];
+    m_cipher.keystream( scratch, 2 );
+    memcpy( out + blocks * chacha20::block_size, scratch, tail );
+    m_cipher.rekey( scratch + chacha20::block_size,
+                    scratch + chacha20::block_size + chacha20::key_size );
+    chacha20::wipe( scratch, sizeof( scratch ) );
+
+    m_generated += len;
+  }
+
+  // one generator per thread, nothing shared so no contention between fillers
+  static chacha20_drbg& local()
+  {
+    thread_local chacha20_drbg instance;
+    return instance;
+  }
+
+  static void fill_from_kernel( uint8_t* buf, size_t len )
+  {
+    while ( len > 0 )
+    {
+      ssize_t got = getrandom( buf, len, 0 );
+      if ( got < 0 )
+      {
+        if ( errno == EINTR )
+        {
+          continue;
+        }
+        throw std::system_error( errno, std::generic_category(), "getrandom" );
+      }
+      buf += got;
+      len -= static_cast< size_t >( got );
+    }
+  }
+
+private:
+  static const std::array< uint8_t, chacha20::key_size >& zero_seed()
+  {
+    static const std::array< uint8_t, chacha20::key_size > seed{};
+    return seed;
+  }
+
+  chacha20 m_cipher;
+  uint64_t m_reseed_interval;
+  uint64_t m_generated{0};
+  pid_t    m_pid{0};
+}; // chacha20_drbg
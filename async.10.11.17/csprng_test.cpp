@@ -0,0 +1,110 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "csprng.hpp"
+
+#include <array>
+#include <vector>
+// clang-format on
+
+namespace
+{
+std::array< uint8_t, 32 > sequential_key()
+{
+  std::array< uint8_t, 32 > key;
+  for ( size_t ix = 0; ix < key.size(); ++ix )
+  {
+    key[ix] = static_cast< uint8_t >( ix );
+  }
+  return key;
+}
+} // namespace
+
+// RFC 7539 appendix A.1, test vector #1
+TEST( ChaCha20, ZeroKeyVector )
+{
+  std::array< uint8_t, 32 > key{};
+  std::array< uint8_t, 12 > nonce{};
+  chacha20                  cipher( key.data(), nonce.data() );
+
+  block< 64 > out;
+  cipher.keystream( out.data(), 1 );
+
+  EXPECT_EQ( out.str(),
+             "76b8e0ada0f13d90405d6ae55386bd28bdd219b8a08ded1aa836efcc8b770dc7"
+             "da41597c5157488d7724e03fb8d84a376a43b8f41518a11cc387b669b2ee6586" );
+}
+
+// RFC 7539 section 2.3.2, the block function test
+TEST( ChaCha20, BlockFunctionVector )
+{
+  auto                      key   = sequential_key();
+  std::array< uint8_t, 12 > nonce = {0, 0, 0, 0x09, 0, 0, 0, 0x4a, 0, 0, 0, 0};
+  chacha20                  cipher( key.data(), nonce.data(), 1 );
+
+  block< 64 > out;
+  cipher.keystream( out.data(), 1 );
+
+  EXPECT_EQ( out.str(),
+             "10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c4e"
+             "d2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a2503c4e" );
+}
+
+TEST( ChaCha20Drbg, DeterministicWhenSeeded )
+{
+  auto                      key = sequential_key();
+  std::array< uint8_t, 12 > nonce{};
+
+  chacha20_drbg a( key.data(), nonce.data() );
+  chacha20_drbg b( key.data(), nonce.data() );
+
+  // odd sizes exercise the partial block path
+  for ( size_t len : {1, 63, 64, 65, 4096, 4099} )
+  {
+    std::vector< uint8_t > lhs( len ), rhs( len );
+    a.generate( lhs.data(), len );
+    b.generate( rhs.data(), len );
+    EXPECT_EQ( lhs, rhs );
+  }
+}
+
+TEST( ChaCha20Drbg, RekeysBetweenRequests )
+{
+  auto                      key = sequential_key();
+  std::array< uint8_t, 12 > nonce{};
+  chacha20_drbg             drbg( key.data(), nonce.data() );
+
+  block< 128 > first, second;
+  drbg.generate( first.data(), first.size() );
+  drbg.generate( second.data(), second.size() );
+  EXPECT_TRUE( first != second );
+
+  // the second request must not simply continue the raw keystream
+  chacha20     cipher( key.data(), nonce.data() );
+  block< 256 > raw;
+  cipher.keystream( raw.data(), 4 );
+  EXPECT_NE( 0, memcmp( second.data(), raw.data() + 128, second.size() ) );
+}
+
+TEST( ChaCha20Drbg, KernelSeededInstancesDiffer )
+{
+  chacha20_drbg a, b;
+  block< 64 >   lhs, rhs;
+  a.generate( lhs.data(), lhs.size() );
+  b.generate( rhs.data(), rhs.size() );
+  EXPECT_TRUE( lhs != rhs );
+  EXPECT_FALSE( lhs.zero() );
+}
+
+TEST( ChaCha20Drbg, ReseedInterval )
+{
+  chacha20_drbg drbg( 256 );
+  block< 512 >  b;
+  for ( int ix = 0; ix < 4; ++ix )
+  {
+    drbg.generate( b.data(), b.size() );
+    EXPECT_FALSE( b.zero() );
+  }
+}
@@ -24,19 +24,29 @@
 #include "sha.h"
 #endif
 
+#include "async.hpp"
 #include "block.hpp"
 #include "block_factory.hpp"
+#include "digest.hpp"
+#include "fan_out.hpp"
+#include "pipeline.hpp"
+#include "stopwatch.hpp"
+#include "task.hpp"
+#include "thread_pool.hpp"
+#include "timer_queue.hpp"
+#include "topology.hpp"
 
 #include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <future>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <set>
 #include <string>
 #include <type_traits>
 #include <functional>
-#include <deque>
+#include <thread>
 // clang-format on
 
 using namespace std::chrono_literals;
@@ -46,91 +56,6 @@ using namespace std::chrono_literals;
 template < typename T >
 class ShowType;
 
-// Returns a future where a a new thread is launched to execute the task asynchronously
-template < typename Function, typename... Args >
-auto make_async_future( Function&& func, Args&&... args )
-{
-  return std::async( std::launch::async, func, std::forward< Args >( args )... );
-};
-
-// Returns a future where a the task is executed on the calling thread the first time its result is
-// requested (lazy evaluation)
-template < typename Function, typename... Args >
-auto make_deferred_future( Function&& func, Args&&... args )
-{
-  return std::async( std::launch::deferred, func, std::forward< Args >( args )... );
-};
-
-// scope based timer
-class StopWatch
-{
-public:
-  StopWatch()
-      : mStart( std::chrono::high_resolution_clock::time_point{} )
-      , mEnd( std::chrono::high_resolution_clock::time_point{} )
-      , mStopBit( 0 )
-  {
-    start();
-  }
-
-  ~StopWatch()
-  {
-    // if we were stopped once we're not printing this again
-    if ( mStopBit.load() == 0 )
-    {
-      mEnd = std::chrono::high_resolution_clock::now();
-      std::chrono::duration< double, std::milli > elapsed = mEnd - mStart;
-      std::cout << "(elapsed time=" << elapsed.count() << "ms)" << std::endl;
-    }
-  }
-
-  void start()
-  {
-    mStart = std::chrono::high_resolution_clock::now();
-  }
-
-  void reset()
-  {
-    mStart   = std::chrono::high_resolution_clock::time_point{};
-    mEnd     = std::chrono::high_resolution_clock::time_point{};
-    mStopBit = 0;
-  }
-
-  // don't update the endtime, just return the elapsed time string
-  std::string split() const
-  {
-    auto split = std::chrono::high_resolution_clock::now();
-    std::chrono::duration< double, std::milli > elapsed = split - mStart;
-
-    std::stringstream ss;
-    ss << "(split time=" << elapsed.count() << "ms)";
-    return ss.str();
-  }
-
-  // stop the clock and return the elapsed time string
-  std::string stop()
-  {
-    mEnd = std::chrono::high_resolution_clock::now();
-    mStopBit.store( 1 );
-
-    std::chrono::duration< double, std::milli > elapsed = mEnd - mStart;
-    std::stringstream ss;
-    ss << "(split time=" << elapsed.count() << "ms)";
-    return ss.str();
-  }
-
-  // always return the split time in this context
-  friend std::ostream& operator<<( std::ostream& os, const StopWatch& rhs )
-  {
-    os << rhs.split();
-    return os;
-  }
-
-private:
-  std::chrono::high_resolution_clock::time_point mStart, mEnd;
-  std::atomic< int >                             mStopBit;
-}; // StopWatch
-
 TEST( Example, WaitForIt )
 {
   auto delay = 2s;
@@ -153,6 +78,33 @@ TEST( Example, WaitForIt )
     std::cout << "async launch, " << watch.stop() << std::endl;
   }
 
+  // same thing on a long lived worker, no thread is started for it
+  {
+    thread_pool executor( 1 );
+    StopWatch   watch;
+
+    std::future< void > fut = make_async_future( executor, waiter );
+
+    fut.get();
+
+    std::cout << "pooled launch, " << watch.stop() << std::endl;
+  }
+
+  // coroutine: the wait is a timer, no thread sleeps through it
+  {
+    timer_queue timers;
+    StopWatch   watch;
+
+    auto co_waiter = [&]() -> task< void > {
+      co_await ::delay( timers, delay );
+      std::cout << "hello!!!" << std::endl;
+    };
+
+    sync_wait( co_waiter() );
+
+    std::cout << "coroutine timer, " << watch.stop() << std::endl;
+  }
+
   {
     StopWatch watch;
 
@@ -181,27 +133,10 @@ TEST( Example, WaitForIt )
 // example inspired by Bo Qian and packaged based thread pool
 // https://www.youtube.com/watch?v=FfbZfBk-3rI
 // http://roar11.com/2016/01/a-platform-independent-thread-pool-using-c14/
-std::deque< std::packaged_task< std::string() > > workq;
-std::mutex                                        workq_lock;
-std::condition_variable                           workq_cv;
-
+// the hand rolled deque + mutex + condvar worker now lives on as thread_pool
 TEST( Example, PackagedTask )
 {
-
-  // lambda was angry about capturing workq by reference...
-  auto package_worker = [] {
-    std::packaged_task< std::string() > t;
-
-    {
-      std::unique_lock< std::mutex > locker{workq_lock};
-      workq_cv.wait( locker, []() { return !workq.empty(); } );
-      t = std::move( workq.front() );
-      workq.pop_front();
-    }
-    t();
-  };
-
-  std::thread t1( package_worker );
+  thread_pool pool( 1 );
   auto        delay = 2s;
 
   auto return_waiter = [&]() -> std::string {
@@ -214,55 +149,37 @@ TEST( Example, PackagedTask )
   // get a *handle* to our future value. Does not block
   std::future< std::string > fu = task.get_future();
 
-  // add our trivial worker to the workq
-  {
-    std::lock_guard< std::mutex > locker{workq_lock};
-    workq.push_back( std::move( task ) );
-  }
-  workq_cv.notify_one();
+  // hand the task to a worker
+  pool.post( std::move( task ) );
 
   // block until result is ready
   auto result = fu.get();
   EXPECT_TRUE( result == "hello!!!" );
 
   std::cout << "(packaged_task) we got " << result << std::endl;
-  t1.join();
+
+  // or let the pool do the packaging
+  auto direct = pool.submit( []( std::string who ) { return "hello " + who; }, "pool" );
+  EXPECT_TRUE( direct.get() == "hello pool" );
 }
 
 
-#if 0
 // hash a string
 std::string SHA1Hash( std::string source )
 {
-  CryptoPP::SHA1 sha1;
-
-  std::string hash;
-
-  CryptoPP::StringSource(
-      source, true, new CryptoPP::HashFilter(
-                        sha1, new CryptoPP::HexEncoder( new CryptoPP::StringSink( hash ) ) ) );
-  std::transform(hash.begin(), hash.end(), hash.begin(), ::tolower);
-  return hash;
+  return digest_str( sha1::hash( source.data(), source.size() ) );
 }
 
 // hash a buffer
 std::string SHA1Hash( const unsigned char* source, size_t size )
 {
-  CryptoPP::SHA1 sha1;
-
-  std::string hash;
-
-  CryptoPP::ArraySource(
-      source, size, true, new CryptoPP::HashFilter(
-                        sha1, new CryptoPP::HexEncoder( new CryptoPP::StringSink( hash ) ) ) );
-  std::transform(hash.begin(), hash.end(), hash.begin(), ::tolower);
-  return hash;
+  return digest_str( sha1::hash( source, size ) );
 }
 
 template < int Size >
 std::string SHA1Hash( const block< Size >& source )
 {
-  return SHA1Hash( source.data(), source.size() );
+  return digest_str( source.template digest< sha1 >() );
 }
 
 TEST( Example, Hashing )
@@ -287,8 +204,15 @@ TEST( Example, Hashing )
     EXPECT_TRUE( digest == "1ceaf73df40e531df3bfb26b4fb7cd95fb7bff1d" );
     std::cout << digest << std::endl;
   }
+
+  // same thing as a block, raw digest without the hex round trip
+  {
+    block< 4096 > source;
+
+    EXPECT_TRUE( SHA1Hash( source ) == "1ceaf73df40e531df3bfb26b4fb7cd95fb7bff1d" );
+    EXPECT_TRUE( source.digest< sha1 >() == sha1::hash( source.data(), source.size() ) );
+  }
 }
-#endif
 
 TEST( Example, FanOut )
 {
@@ -298,82 +222,102 @@ TEST( Example, FanOut )
 //  using RandomBlockFactory = block_factory< BlockType, op_random_fill >;
   using storage_type       = int;
 
-  // write back our results
+  // write back our results, each worker straight into its own piece, no lock
   std::vector< storage_type > results( capacity );
-  std::mutex                  results_lock;
 
   std::cout << "main vector size " << results.size() << std::endl;
 
-  auto worker
-      = [&]( long long seed, const size_t segment_begin, const size_t segment_end, const size_t segment_size ) {
+  auto worker = [&]( const size_t part, storage_type* segment_begin, storage_type* segment_end ) {
 
 //          printf( "before calling pthread_create getpid: %d getpthread_self: %lu tid:%lu\n",
 //                  getpid(), pthread_self(), syscall( SYS_gettid ) );
 
-          // local storage
-          std::vector< storage_type > slice( segment_size );
-
-          (void) seed;
+    auto seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    seed += part;
+    (void) seed;
 #if 0
-          std::mt19937 mt_rand(seed);
-          std::generate(slice.begin(), slice.end(), [&]() {return mt_rand();});
+    std::mt19937 mt_rand(seed);
+    std::generate(segment_begin, segment_end, [&]() {return mt_rand();});
 #endif
 
-          // fill our local slice
-          for ( unsigned k = 0; k < slice.size(); ++k )
-          {
-            slice[k]   = k;
-            //slice[k] = SHA1Hash(RandomBlockFactory::create());
-          }
-          // merge back our results under lock
+    // fill our piece in place
+    for ( auto it = segment_begin; it != segment_end; ++it )
+    {
+      *it = storage_type( it - segment_begin );
+      //*it = SHA1Hash(RandomBlockFactory::create());
+    }
+  }; // end lambda
 
-          std::unique_lock< decltype( results_lock ) > locker( results_lock );
+  // one piece per worker of the shared pool. fan_out cuts the vector on cache line
+  // boundaries and spreads the remainder when capacity doesn't divide evenly.
+  const size_t cpu_max = default_executor().size();
 
-          std::cout << "writeback (locked) segment start " << segment_begin << " and end "
-                    << segment_end << std::endl;
+  const cpu_topology& topology = cpu_topology::system();
+  std::cout << "running on " << cpu_max << " workers, machine has " << topology.cpus().size()
+            << " cpus on " << topology.cores().size() << " cores, "
+            << topology.cache_domains().size() << " L3 domains, " << topology.nodes().size()
+            << " numa nodes" << std::endl;
 
-          for ( const auto& value : slice )
-          {
-            for ( auto index = segment_begin; index < segment_end; ++index )
-            {
-              results[index] = value;
-            }
-          }
+  StopWatch watch;
 
-        }; // end lambda
+  // one wait for the lot
+  fan_out( default_executor(), results.data(), results.data() + results.size(), cpu_max, worker )
+      .get();
 
-  // for each cpu, determine which range a thread is responsible for a range
-  // and launch an async operation to do the job
-  // XXX zero check
-  size_t cpu_max = std::thread::hardware_concurrency();
+  std::cout << "fanout fill " << watch.stop() << std::endl;
 
-  std::cout << "running on " << cpu_max << " processors" << std::endl;
+  auto bounds = fan_out_bounds( results.data(), results.size(), cpu_max );
+  for ( size_t part = 0; part < cpu_max; ++part )
+  {
+    std::cout << "segment " << part << " [" << bounds[part] << ", " << bounds[part + 1] << ")"
+              << std::endl;
+    for ( size_t ix = bounds[part]; ix < bounds[part + 1]; ++ix )
+    {
+      ASSERT_EQ( results[ix], storage_type( ix - bounds[part] ) );
+    }
+  }
+}
 
-  const size_t segment_size = results.size() / cpu_max;
-  std::cout << "segment size " << segment_size << std::endl;
+// the FanOut body as stages: create blocks, hash them, drop repeats, count.
+// each stage gets its own threads and a bounded queue in front, so creating,
+// hashing and deduplicating run at the same time.
+TEST( Example, Pipeline )
+{
+  using BlockType          = block< 2048 >;
+  using RandomBlockFactory = block_factory< BlockType, op_random_fill >;
+  using BlockPtr           = std::unique_ptr< BlockType >;
 
-  std::vector< std::future< void > > FanOut;
-  StopWatch                          watch;
+  constexpr int count = 1000;
 
-  for ( size_t cpu_index = 0; cpu_index <= ( cpu_max - 1 ); ++cpu_index )
-  {
-    // determine where to copy our results in the main vector;
-    const size_t segment_begin = cpu_index * segment_size;
-    const size_t segment_end   = ( ( cpu_index + 1 ) * segment_size ) - 1;
+  pipeline                p( 16, 64 );
+  std::atomic< int >      created{0};
+  std::set< std::string > seen;
+  int                     unique = 0;
 
-    auto seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-    seed += cpu_index;
-    //std::cout << "seed " << seed << std::endl;
-
-    // launch a future
-    FanOut.emplace_back( make_async_future( worker, seed, segment_begin, segment_end, segment_size ) );
-  }
+  auto& blocks = p.source< BlockPtr >( "create", 2, [&]( auto& emit ) {
+    if ( created.fetch_add( 1 ) >= count )
+    {
+      return false;
+    }
+    emit( std::make_unique< BlockType >( RandomBlockFactory::create() ) );
+    return true;
+  } );
+  auto& digests = p.stage< std::string >( "hash", blocks, 2, []( BlockPtr& b, auto& emit ) {
+    emit( SHA1Hash( *b ) );
+  } );
+  auto& fresh = p.stage< std::string >( "dedupe", digests, 1, [&]( std::string& d, auto& emit ) {
+    if ( seen.insert( d ).second )
+    {
+      emit( std::move( d ) );
+    }
+  } );
+  p.sink( "count", fresh, 1, [&]( std::string& ) { ++unique; } );
 
-  // block on results
-  for ( auto& f : FanOut )
-  {
-    f.get();
-  }
+  StopWatch watch;
+  p.run();
+  std::cout << "pipeline " << watch.stop() << std::endl;
+  p.report( std::cout );
 
-  std::cout << "fanout fill " << watch.stop() << std::endl;
+  // random 2k blocks don't repeat
+  EXPECT_EQ( unique, count );
 }
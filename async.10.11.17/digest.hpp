@@ -0,0 +1,707 @@
+#pragma once
+
+// raw SHA-1 and SHA-256 digests for blocks, no filter/string pipeline.
+//
+// each algorithm is a tag type with a one shot hash() and a hash_many() that
+// takes any number of equal sized messages. both pick an engine at runtime:
+//   - SHA-NI when the cpu has it; hash_many for SHA-256 runs two messages
+//     through the sha256rnds2 pipeline at once to hide its latency
+//   - otherwise SHA-256 hash_many transposes 8 messages into AVX2 lanes
+//   - plain C++ everywhere else
+// the engines are public so tests and benchmarks can pin one.
+
+#include <immintrin.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "hex.hpp"
+
+namespace detail
+{
+inline uint32_t load_be32( const uint8_t* p )
+{
+  uint32_t v;
+  memcpy( &v, p, sizeof( v ) );
+  return __builtin_bswap32( v );
+}
+
+inline void store_be32( uint8_t* p, uint32_t v )
+{
+  v = __builtin_bswap32( v );
+  memcpy( p, &v, sizeof( v ) );
+}
+
+inline uint32_t rotl32( uint32_t v, int n )
+{
+  return ( v << n ) | ( v >> ( 32 - n ) );
+}
+
+inline uint32_t rotr32( uint32_t v, int n )
+{
+  return ( v >> n ) | ( v << ( 32 - n ) );
+}
+
+// the merkle-damgard tail shared by both algorithms: 0x80, zeros, bit length.
+// fills one or two 64 byte blocks and returns how many.
+inline size_t md_pad( const uint8_t* data, size_t len, uint8_t ( &tail )[128] )
+{
+  const size_t rem = len % 64;
+  memset( tail, 0, sizeof( tail ) );
+  memcpy( tail, data + len - rem, rem );
+  tail[rem] = 0x80;
+
+  const size_t   blocks = rem < 56 ? 1 : 2;
+  const uint64_t bits   = static_cast< uint64_t >( len ) * 8;
+  store_be32( tail + blocks * 64 - 8, static_cast< uint32_t >( bits >> 32 ) );
+  store_be32( tail + blocks * 64 - 4, static_cast< uint32_t >( bits ) );
+  return blocks;
+}
+
+inline bool cpu_has_sha()
+{
+  static const bool supported = [] {
+    // CPUID.(EAX=07H, ECX=0):EBX.SHA[bit 29]
+    unsigned int eax, ebx, ecx, edx;
+    __asm__( "cpuid" : "=a"( eax ), "=b"( ebx ), "=c"( ecx ), "=d"( edx ) : "a"( 7 ), "c"( 0 ) );
+    return ( ebx & ( 1u << 29 ) ) != 0 && __builtin_cpu_supports( "sse4.1" );
+  }();
+  return supported;
+}
+
+inline bool cpu_has_avx2()
+{
+  static const bool supported = __builtin_cpu_supports( "avx2" );
+  return supported;
+}
+
+alignas( 16 ) constexpr uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+} // namespace detail
+
+struct sha1
+{
+  static constexpr size_t digest_size = 20;
+  using digest_type                   = std::array< uint8_t, digest_size >;
+  using state_type                    = std::array< uint32_t, 5 >;
+
+  static state_type initial_state()
+  {
+    return {{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0}};
+  }
+
+  static void compress_generic( uint32_t* state, const uint8_t* data, size_t nblocks )
+  {
+    using namespace detail;
+
+    for ( ; nblocks > 0; --nblocks, data += 64 )
+    {
+      uint32_t w[80];
+      for ( int t = 0; t < 16; ++t )
+      {
+        w[t] = load_be32( data + t * 4 );
+      }
+      for ( int t = 16; t < 80; ++t )
+      {
+        w[t] = rotl32( w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1 );
+      }
+
+      uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+      for ( int t = 0; t < 80; ++t )
+      {
+        uint32_t f, k;
+        if ( t < 20 )
+        {
+          f = ( b & c ) | ( ~b & d );
+          k = 0x5a827999;
+        }
+        else if ( t < 40 )
+        {
+          f = b ^ c ^ d;
+          k = 0x6ed9eba1;
+        }
+        else if ( t < 60 )
+        {
+          f = ( b & c ) | ( b & d ) | ( c & d );
+          k = 0x8f1bbcdc;
+        }
+        else
+        {
+          f = b ^ c ^ d;
+          k = 0xca62c1d6;
+        }
+
+        uint32_t tmp = rotl32( a, 5 ) + f + e + k + w[t];
+        e            = d;
+        d            = c;
+        c            = rotl32( b, 30 );
+        b            = a;
+        a            = tmp;
+      }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+    }
+  }
+
+  // 20 groups of four rounds; the message schedule rotates through four registers
+  __attribute__( ( target( "sha,sse4.1" ) ) ) static void
+  compress_shani( uint32_t* state, const uint8_t* data, size_t nblocks )
+  {
+    const __m128i mask = _mm_set_epi64x( 0x0001020304050607ull, 0x08090a0b0c0d0e0full );
+
+    __m128i abcd = _mm_loadu_si128( reinterpret_cast< __m128i* >( state ) );
+    abcd         = _mm_shuffle_epi32( abcd, 0x1b );
+    __m128i e0   = _mm_set_epi32( state[4], 0, 0, 0 );
+    __m128i e1;
+
+    for ( ; nblocks > 0; --nblocks, data += 64 )
+    {
+      const __m128i abcd_save = abcd;
+      const __m128i e0_save   = e0;
+      __m128i       msg[4];
+
+#pragma GCC unroll 20
+      for ( int g = 0; g < 20; ++g )
+      {
+        __m128i& w = msg[g % 4];
+        if ( g < 4 )
+        {
+          w = _mm_shuffle_epi8(
+              _mm_loadu_si128( reinterpret_cast< const __m128i* >( data + g * 16 ) ), mask );
+        }
+
+        // e alternates between the two registers every group
+        __m128i& e_in  = ( g % 2 == 0 ) ? e0 : e1;
+        __m128i& e_out = ( g % 2 == 0 ) ? e1 : e0;
+
+        e_in  = ( g == 0 ) ? _mm_add_epi32( e_in, w ) : _mm_sha1nexte_epu32( e_in, w );
+        e_out = abcd;
+
+        if ( g >= 3 && g <= 18 )
+        {
+          msg[( g + 1 ) % 4] = _mm_sha1msg2_epu32( msg[( g + 1 ) % 4], w );
+        }
+
+        switch ( g / 5 )
+        {
+        case 0:
+          abcd = _mm_sha1rnds4_epu32( abcd, e_in, 0 );
+          break;
+        case 1:
+          abcd = _mm_sha1rnds4_epu32( abcd, e_in, 1 );
+          break;
+        case 2:
+          abcd = _mm_sha1rnds4_epu32( abcd, e_in, 2 );
+          break;
+        default:
+          abcd = _mm_sha1rnds4_epu32( abcd, e_in, 3 );
+          break;
+        }
+
+        if ( g >= 1 && g <= 16 )
+        {
+          msg[( g + 3 ) % 4] = _mm_sha1msg1_epu32( msg[( g + 3 ) % 4], w );
+        }
+        if ( g >= 2 && g <= 17 )
+        {
+          msg[( g + 2 ) % 4] = _mm_xor_si128( msg[( g + 2 ) % 4], w );
+        }
+      }
+
+      e0   = _mm_sha1nexte_epu32( e0, e0_save );
+      abcd = _mm_add_epi32( abcd, abcd_save );
+    }
+
+    _mm_storeu_si128( reinterpret_cast< __m128i* >( state ), _mm_shuffle_epi32( abcd, 0x1b ) );
+    state[4] = static_cast< uint32_t >( _mm_extract_epi32( e0, 3 ) );
+  }
+
+  static void compress( uint32_t* state, const uint8_t* data, size_t nblocks )
+  {
+    if ( detail::cpu_has_sha() )
+    {
+      compress_shani( state, data, nblocks );
+    }
+    else
+    {
+      compress_generic( state, data, nblocks );
+    }
+  }
+
+  static digest_type finish( const state_type& state )
+  {
+    digest_type out;
+    for ( size_t ix = 0; ix < state.size(); ++ix )
+    {
+      detail::store_be32( out.data() + ix * 4, state[ix] );
+    }
+    return out;
+  }
+
+  static digest_type hash( const void* data, size_t len )
+  {
+    auto* bytes = static_cast< const uint8_t* >( data );
+    auto  state = initial_state();
+
+    compress( state.data(), bytes, len / 64 );
+
+    uint8_t tail[128];
+    compress( state.data(), tail, detail::md_pad( bytes, len, tail ) );
+    return finish( state );
+  }
+
+  // count messages of len bytes each
+  static void hash_many( const uint8_t* const* data, size_t len, size_t count, digest_type* out )
+  {
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      out[ix] = hash( data[ix], len );
+    }
+  }
+}; // sha1
+
+struct sha256
+{
+  static constexpr size_t digest_size = 32;
+  using digest_type                   = std::array< uint8_t, digest_size >;
+  using state_type                    = std::array< uint32_t, 8 >;
+
+  static state_type initial_state()
+  {
+    return {{0x6a09e667,
+             0xbb67ae85,
+             0x3c6ef372,
+             0xa54ff53a,
+             0x510e527f,
+             0x9b05688c,
+             0x1f83d9ab,
+             0x5be0cd19}};
+  }
+
+  static void compress_generic( uint32_t* state, const uint8_t* data, size_t nblocks )
+  {
+    using namespace detail;
+
+    for ( ; nblocks > 0; --nblocks, data += 64 )
+    {
+      uint32_t w[64];
+      for ( int t = 0; t < 16; ++t )
+      {
+        w[t] = load_be32( data + t * 4 );
+      }
+      for ( int t = 16; t < 64; ++t )
+      {
+        uint32_t s0 = rotr32( w[t - 15], 7 ) ^ rotr32( w[t - 15], 18 ) ^ ( w[t - 15] >> 3 );
+        uint32_t s1 = rotr32( w[t - 2], 17 ) ^ rotr32( w[t - 2], 19 ) ^ ( w[t - 2] >> 10 );
+        w[t]        = w[t - 16] + s0 + w[t - 7] + s1;
+      }
+
+      uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+      uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+      for ( int t = 0; t < 64; ++t )
+      {
+        uint32_t S1  = rotr32( e, 6 ) ^ rotr32( e, 11 ) ^ rotr32( e, 25 );
+        uint32_t ch  = ( e & f ) ^ ( ~e & g );
+        uint32_t t1  = h + S1 + ch + sha256_k[t] + w[t];
+        uint32_t S0  = rotr32( a, 2 ) ^ rotr32( a, 13 ) ^ rotr32( a, 22 );
+        uint32_t maj = ( a & b ) ^ ( a & c ) ^ ( b & c );
+        uint32_t t2  = S0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+      }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+      state[5] += f;
+      state[6] += g;
+      state[7] += h;
+    }
+  }
+
+  // Lanes independent messages (1 or 2) in lock step, nblocks from each. the
+  // sha256rnds2 latency is long enough that a second stream is close to free.
+  template < int Lanes >
+  __attribute__( ( target( "sha,sse4.1" ) ) ) static void
+  compress_shani_lanes( uint32_t* const* state, const uint8_t* const* data, size_t nblocks )
+  {
+    const __m128i mask = _mm_set_epi64x( 0x0c0d0e0f08090a0bull, 0x0405060700010203ull );
+
+    // the instructions want the state as ABEF / CDGH
+    __m128i abef[Lanes], cdgh[Lanes];
+    for ( int l = 0; l < Lanes; ++l )
+    {
+      __m128i tmp = _mm_shuffle_epi32( _mm_loadu_si128( reinterpret_cast< __m128i* >( state[l] ) ),
+                                       0xb1 ); // CDAB
+      cdgh[l]     = _mm_shuffle_epi32(
+          _mm_loadu_si128( reinterpret_cast< __m128i* >( state[l] + 4 ) ), 0x1b ); // EFGH
+      abef[l] = _mm_alignr_epi8( tmp, cdgh[l], 8 );
+      cdgh[l] = _mm_blend_epi16( cdgh[l], tmp, 0xf0 );
+    }
+
+    for ( size_t block = 0; block < nblocks; ++block )
+    {
+      __m128i abef_save[Lanes], cdgh_save[Lanes];
+      __m128i msg[Lanes][4];
+      for ( int l = 0; l < Lanes; ++l )
+      {
+        abef_save[l] = abef[l];
+        cdgh_save[l] = cdgh[l];
+      }
+
+#pragma GCC unroll 16
+      for ( int g = 0; g < 16; ++g )
+      {
+        const __m128i k
+            = _mm_load_si128( reinterpret_cast< const __m128i* >( detail::sha256_k + g * 4 ) );
+
+#pragma GCC unroll 2
+        for ( int l = 0; l < Lanes; ++l )
+        {
+          __m128i* m = msg[l];
+          if ( g < 4 )
+          {
+            m[g] = _mm_shuffle_epi8(
+                _mm_loadu_si128(
+                    reinterpret_cast< const __m128i* >( data[l] + block * 64 + g * 16 ) ),
+                mask );
+          }
+
+          __m128i wk = _mm_add_epi32( m[g % 4], k );
+          cdgh[l]    = _mm_sha256rnds2_epu32( cdgh[l], abef[l], wk );
+
+          if ( g >= 3 && g <= 14 )
+          {
+            __m128i& next = m[( g + 1 ) % 4];
+            next = _mm_add_epi32( next, _mm_alignr_epi8( m[g % 4], m[( g + 3 ) % 4], 4 ) );
+            next = _mm_sha256msg2_epu32( next, m[g % 4] );
+          }
+
+          wk      = _mm_shuffle_epi32( wk, 0x0e );
+          abef[l] = _mm_sha256rnds2_epu32( abef[l], cdgh[l], wk );
+
+          if ( g >= 1 && g <= 12 )
+          {
+            m[( g + 3 ) % 4] = _mm_sha256msg1_epu32( m[( g + 3 ) % 4], m[g % 4] );
+          }
+        }
+      }
+
+      for ( int l = 0; l < Lanes; ++l )
+      {
+        abef[l] = _mm_add_epi32( abef[l], abef_save[l] );
+        cdgh[l] = _mm_add_epi32( cdgh[l], cdgh_save[l] );
+      }
+    }
+
+    for ( int l = 0; l < Lanes; ++l )
+    {
+      __m128i tmp  = _mm_shuffle_epi32( abef[l], 0x1b ); // FEBA
+      __m128i dchg = _mm_shuffle_epi32( cdgh[l], 0xb1 );
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( state[l] ),
+                        _mm_blend_epi16( tmp, dchg, 0xf0 ) ); // DCBA
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( state[l] + 4 ),
+                        _mm_alignr_epi8( dchg, tmp, 8 ) ); // HGFE
+    }
+  }
+
+  static void compress_shani( uint32_t* state, const uint8_t* data, size_t nblocks )
+  {
+    compress_shani_lanes< 1 >( &state, &data, nblocks );
+  }
+
+  // eight messages at once, one per 32 bit lane of a ymm register
+  __attribute__( ( target( "avx2" ) ) ) static void
+  compress_avx2_x8( uint32_t* const* state, const uint8_t* const* data, size_t nblocks )
+  {
+    // transposed state: s[i] holds word i of all eight messages
+    __m256i s[8];
+    for ( int ix = 0; ix < 8; ++ix )
+    {
+      s[ix] = _mm256_setr_epi32( state[0][ix],
+                                 state[1][ix],
+                                 state[2][ix],
+                                 state[3][ix],
+                                 state[4][ix],
+                                 state[5][ix],
+                                 state[6][ix],
+                                 state[7][ix] );
+    }
+
+    const __m256i bswap = _mm256_setr_epi8( 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 );
+
+    for ( size_t block = 0; block < nblocks; ++block )
+    {
+      __m256i w[64];
+
+      // two 8x8 transposes of 32 bit words turn eight message blocks into w[0..15]
+      for ( int half = 0; half < 2; ++half )
+      {
+        __m256i r[8];
+        for ( int l = 0; l < 8; ++l )
+        {
+          r[l] = _mm256_loadu_si256(
+              reinterpret_cast< const __m256i* >( data[l] + block * 64 + half * 32 ) );
+        }
+
+        __m256i t0 = _mm256_unpacklo_epi32( r[0], r[1] );
+        __m256i t1 = _mm256_unpackhi_epi32( r[0], r[1] );
+        __m256i t2 = _mm256_unpacklo_epi32( r[2], r[3] );
+        __m256i t3 = _mm256_unpackhi_epi32( r[2], r[3] );
+        __m256i t4 = _mm256_unpacklo_epi32( r[4], r[5] );
+        __m256i t5 = _mm256_unpackhi_epi32( r[4], r[5] );
+        __m256i t6 = _mm256_unpacklo_epi32( r[6], r[7] );
+        __m256i t7 = _mm256_unpackhi_epi32( r[6], r[7] );
+
+        __m256i u0 = _mm256_unpacklo_epi64( t0, t2 );
+        __m256i u1 = _mm256_unpackhi_epi64( t0, t2 );
+        __m256i u2 = _mm256_unpacklo_epi64( t1, t3 );
+        __m256i u3 = _mm256_unpackhi_epi64( t1, t3 );
+        __m256i u4 = _mm256_unpacklo_epi64( t4, t6 );
+        __m256i u5 = _mm256_unpackhi_epi64( t4, t6 );
+        __m256i u6 = _mm256_unpacklo_epi64( t5, t7 );
+        __m256i u7 = _mm256_unpackhi_epi64( t5, t7 );
+
+        __m256i* out = w + half * 8;
+        out[0]       = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u0, u4, 0x20 ), bswap );
+        out[1]       = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u1, u5, 0x20 ), bswap );
+        out[2]       = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u2, u6, 0x20 ), bswap );
+        out[3]       = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u3, u7, 0x20 ), bswap );
+        out[4]       = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u0, u4, 0x31 ), bswap );
+        out[5]       = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u1, u5, 0x31 ), bswap );
+        out[6]       = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u2, u6, 0x31 ), bswap );
+        out[7]       = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u3, u7, 0x31 ), bswap );
+      }
+
+      for ( int t = 16; t < 64; ++t )
+      {
+        __m256i s0 = _mm256_xor_si256(
+            _mm256_xor_si256( ror< 7 >( w[t - 15] ), ror< 18 >( w[t - 15] ) ),
+            _mm256_srli_epi32( w[t - 15], 3 ) );
+        __m256i s1 = _mm256_xor_si256(
+            _mm256_xor_si256( ror< 17 >( w[t - 2] ), ror< 19 >( w[t - 2] ) ),
+            _mm256_srli_epi32( w[t - 2], 10 ) );
+        w[t] = _mm256_add_epi32( _mm256_add_epi32( w[t - 16], s0 ),
+                                 _mm256_add_epi32( w[t - 7], s1 ) );
+      }
+
+      __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+      __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+      for ( int t = 0; t < 64; ++t )
+      {
+        __m256i S1 = _mm256_xor_si256( _mm256_xor_si256( ror< 6 >( e ), ror< 11 >( e ) ),
+                                       ror< 25 >( e ) );
+        __m256i ch = _mm256_xor_si256( _mm256_and_si256( e, f ), _mm256_andnot_si256( e, g ) );
+        __m256i kw = _mm256_add_epi32( _mm256_set1_epi32( detail::sha256_k[t] ), w[t] );
+        __m256i t1 = _mm256_add_epi32( _mm256_add_epi32( h, S1 ), _mm256_add_epi32( ch, kw ) );
+        __m256i S0 = _mm256_xor_si256( _mm256_xor_si256( ror< 2 >( a ), ror< 13 >( a ) ),
+                                       ror< 22 >( a ) );
+        __m256i maj = _mm256_or_si256( _mm256_and_si256( a, b ),
+                                       _mm256_and_si256( c, _mm256_or_si256( a, b ) ) );
+        __m256i t2  = _mm256_add_epi32( S0, maj );
+
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32( d, t1 );
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32( t1, t2 );
+      }
+
+      s[0] = _mm256_add_epi32( s[0], a );
+      s[1] = _mm256_add_epi32( s[1], b );
+      s[2] = _mm256_add_epi32( s[2], c );
+      s[3] = _mm256_add_epi32( s[3], d );
+      s[4] = _mm256_add_epi32( s[4], e );
+      s[5] = _mm256_add_epi32( s[5], f );
+      s[6] = _mm256_add_epi32( s[6], g );
+      s[7] = _mm256_add_epi32( s[7], h );
+    }
+
+    for ( int ix = 0; ix < 8; ++ix )
+    {
+      alignas( 32 ) uint32_t lanes[8];
+      _mm256_store_si256( reinterpret_cast< __m256i* >( lanes ), s[ix] );
+      for ( int l = 0; l < 8; ++l )
+      {
+        state[l][ix] = lanes[l];
+      }
+    }
+  }
+
+  static void compress( uint32_t* state, const uint8_t* data, size_t nblocks )
+  {
+    if ( detail::cpu_has_sha() )
+    {
+      compress_shani( state, data, nblocks );
+    }
+    else
+    {
+      compress_generic( state, data, nblocks );
+    }
+  }
+
+  static digest_type finish( const state_type& state )
+  {
+    digest_type out;
+    for ( size_t ix = 0; ix < state.size(); ++ix )
+    {
+      detail::store_be32( out.data() + ix * 4, state[ix] );
+    }
+    return out;
+  }
+
+  static digest_type hash( const void* data, size_t len )
+  {
+    auto* bytes = static_cast< const uint8_t* >( data );
+    auto  state = initial_state();
+
+    compress( state.data(), bytes, len / 64 );
+
+    uint8_t tail[128];
+    compress( state.data(), tail, detail::md_pad( bytes, len, tail ) );
+    return finish( state );
+  }
+
+  enum class engine
+  {
+    automatic,
+    generic,
+    shani,
+    avx2
+  };
+
+  // count messages of len bytes each
+  static void hash_many( const uint8_t* const* data,
+                         size_t                len,
+                         size_t                count,
+                         digest_type*          out,
+                         engine                use = engine::automatic )
+  {
+    if ( use == engine::automatic )
+    {
+      use = detail::cpu_has_sha() ? engine::shani
+                                  : detail::cpu_has_avx2() ? engine::avx2 : engine::generic;
+    }
+
+    switch ( use )
+    {
+    case engine::shani:
+      hash_lanes< 2 >( data, len, count, out, compress_shani_lanes< 2 > );
+      break;
+    case engine::avx2:
+      hash_lanes< 8 >( data, len, count, out, compress_avx2_x8 );
+      break;
+    default:
+      hash_lanes< 1 >(
+          data, len, count, out, []( uint32_t* const* s, const uint8_t* const* d, size_t n ) {
+            compress_generic( s[0], d[0], n );
+          } );
+      break;
+    }
+  }
+
+private:
+  template < int N >
+  __attribute__( ( target( "avx2" ) ) ) static __m256i ror( __m256i v )
+  {
+    return _mm256_or_si256( _mm256_srli_epi32( v, N ), _mm256_slli_epi32( v, 32 - N ) );
+  }
+
+  // run messages through a Lanes wide compressor in groups, the stragglers one
+  // at a time through the scalar/SHA-NI path
+  template < int Lanes, class Compress >
+  static void hash_lanes( const uint8_t* const* data,
+                          size_t                len,
+                          size_t                count,
+                          digest_type*          out,
+                          Compress&&            compress_lanes )
+  {
+    size_t ix = 0;
+    for ( ; ix + Lanes <= count; ix += Lanes )
+    {
+      state_type     state[Lanes];
+      uint32_t*      states[Lanes];
+      uint8_t        tails[Lanes][128];
+      const uint8_t* tail_ptrs[Lanes];
+      size_t         tail_blocks = 0;
+
+      for ( int l = 0; l < Lanes; ++l )
+      {
+        state[l]     = initial_state();
+        states[l]    = state[l].data();
+        tail_blocks  = detail::md_pad( data[ix + l], len, tails[l] );
+        tail_ptrs[l] = tails[l];
+      }
+
+      // equal lengths means equal block counts and identical padding layout
+      compress_lanes( states, data + ix, len / 64 );
+      compress_lanes( states, tail_ptrs, tail_blocks );
+
+      for ( int l = 0; l < Lanes; ++l )
+      {
+        out[ix + l] = finish( state[l] );
+      }
+    }
+
+    for ( ; ix < count; ++ix )
+    {
+      out[ix] = hash( data[ix], len );
+    }
+  }
+}; // sha256
+
+// hash count equal sized blocks, the batched engines take over from here
+template < class Algo, class BlockType >
+void digest_n( const BlockType* blocks, size_t count, typename Algo::digest_type* out )
+{
+  // stage the pointers a few at a time so nothing gets allocated
+  const uint8_t* ptrs[64];
+  while ( count > 0 )
+  {
+    size_t n = count < 64 ? count : 64;
+    for ( size_t ix = 0; ix < n; ++ix )
+    {
+      ptrs[ix] = blocks[ix].data();
+    }
+    Algo::hash_many( ptrs, blocks->size(), n, out );
+
+    blocks += n;
+    out += n;
+    count -= n;
+  }
+}
+
+template < size_t N >
+std::string digest_str( const std::array< uint8_t, N >& digest )
+{
+  std::string out( N * 2, '0' );
+  hex_encode( digest.data(), N, &out[0] );
+  return out;
+}
@@ -0,0 +1,87 @@
+// blocks per second through each digest engine, 512 byte to 64 KiB blocks
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "block_factory.hpp"
+#include "digest.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+template < class BlockType, class Function >
+void digest_rate( const std::string& name, size_t count, Function&& func )
+{
+  auto start = std::chrono::steady_clock::now();
+  func();
+  std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << std::setw( 8 ) << std::left << BlockType::m_bytes << std::setw( 28 ) << name
+            << std::setw( 12 ) << std::right << size_t( count / elapsed.count() ) << " blocks/s "
+            << count * BlockType::m_bytes / elapsed.count() / ( 1 << 20 ) << " MiB/s"
+            << std::endl;
+}
+
+template < int Size >
+void digest_engines( size_t count )
+{
+  using BlockType = block< Size >;
+  auto blocks     = block_factory< BlockType, op_random_fill >::create_n( count );
+
+  std::vector< const uint8_t* > ptrs;
+  for ( const auto& b : blocks )
+  {
+    ptrs.push_back( b.data() );
+  }
+
+  std::vector< sha1::digest_type >   out1( count );
+  std::vector< sha256::digest_type > out256( count );
+
+  digest_rate< BlockType >( "sha1 digest<>()", count, [&] {
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      out1[ix] = blocks[ix].template digest< sha1 >();
+    }
+  } );
+  digest_rate< BlockType >( "sha256 generic", count, [&] {
+    sha256::hash_many( ptrs.data(), Size, count, out256.data(), sha256::engine::generic );
+  } );
+  if ( detail::cpu_has_avx2() )
+  {
+    digest_rate< BlockType >( "sha256 avx2 x8", count, [&] {
+      sha256::hash_many( ptrs.data(), Size, count, out256.data(), sha256::engine::avx2 );
+    } );
+  }
+  if ( detail::cpu_has_sha() )
+  {
+    digest_rate< BlockType >( "sha256 digest<>() (sha-ni)", count, [&] {
+      for ( size_t ix = 0; ix < count; ++ix )
+      {
+        out256[ix] = blocks[ix].template digest< sha256 >();
+      }
+    } );
+    digest_rate< BlockType >( "sha256 sha-ni x2", count, [&] {
+      sha256::hash_many( ptrs.data(), Size, count, out256.data(), sha256::engine::shani );
+    } );
+  }
+  digest_rate< BlockType >( "sha256 digest_n", count, [&] {
+    digest_n< sha256 >( blocks.data(), count, out256.data() );
+  } );
+}
+} // namespace
+
+TEST( DigestBench, Engines )
+{
+  digest_engines< 512 >( 64 * 1024 );
+  digest_engines< 4096 >( 8 * 1024 );
+  digest_engines< 16384 >( 2 * 1024 );
+  digest_engines< 65536 >( 512 );
+}
@@ -0,0 +1,164 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "block_factory.hpp"
+#include "digest.hpp"
+
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+template < class Algo >
+std::string hex_digest( const std::string& message )
+{
+  return digest_str( Algo::hash( message.data(), message.size() ) );
+}
+
+std::vector< uint8_t > pattern( size_t len, unsigned seed )
+{
+  std::vector< uint8_t > bytes( len );
+  for ( size_t ix = 0; ix < len; ++ix )
+  {
+    bytes[ix] = static_cast< uint8_t >( ix * 31 + seed * 7 + ( ix >> 8 ) );
+  }
+  return bytes;
+}
+
+// one shot hash of a message through a single compressor
+template < class Algo, class Compress >
+typename Algo::digest_type hash_with( const std::vector< uint8_t >& msg, Compress compress )
+{
+  auto state = Algo::initial_state();
+  compress( state.data(), msg.data(), msg.size() / 64 );
+
+  uint8_t tail[128];
+  compress( state.data(), tail, detail::md_pad( msg.data(), msg.size(), tail ) );
+  return Algo::finish( state );
+}
+
+const char* const two_block_message = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+} // namespace
+
+TEST( Digest, Sha1Vectors )
+{
+  EXPECT_EQ( hex_digest< sha1 >( "" ), "da39a3ee5e6b4b0d3255bfef95601890afd80709" );
+  EXPECT_EQ( hex_digest< sha1 >( "abc" ), "a9993e364706816aba3e25717850c26c9cd0d89d" );
+  // echo -n "hello" | sha1sum
+  EXPECT_EQ( hex_digest< sha1 >( "hello" ), "aaf4c61ddcc5e8a2dabede0f3b482cd9aea9434d" );
+  EXPECT_EQ( hex_digest< sha1 >( two_block_message ), "84983e441c3bd26ebaae4aa1f95129e5e54670f1" );
+}
+
+TEST( Digest, Sha256Vectors )
+{
+  EXPECT_EQ( hex_digest< sha256 >( "" ),
+             "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" );
+  EXPECT_EQ( hex_digest< sha256 >( "abc" ),
+             "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" );
+  EXPECT_EQ( hex_digest< sha256 >( two_block_message ),
+             "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" );
+}
+
+TEST( Digest, BlockDigest )
+{
+  // dd if=/dev/zero bs=4096 count=1 | sha1sum
+  block< 4096 > zero;
+  EXPECT_EQ( digest_str( zero.digest< sha1 >() ), "1ceaf73df40e531df3bfb26b4fb7cd95fb7bff1d" );
+  EXPECT_EQ( digest_str( zero.digest< sha256 >() ),
+             "ad7facb2586fc6e966c004d7d1d16b024f5805ff7cb47c7a85dabd8b48892ca7" );
+}
+
+TEST( Digest, Sha1EnginesAgree )
+{
+  for ( size_t len = 0; len <= 300; ++len )
+  {
+    auto msg      = pattern( len, 1 );
+    auto expected = hash_with< sha1 >( msg, sha1::compress_generic );
+    EXPECT_TRUE( sha1::hash( msg.data(), len ) == expected ) << "len " << len;
+
+    if ( detail::cpu_has_sha() )
+    {
+      EXPECT_TRUE( hash_with< sha1 >( msg, sha1::compress_shani ) == expected ) << "len " << len;
+    }
+  }
+}
+
+TEST( Digest, Sha256EnginesAgree )
+{
+  for ( size_t len = 0; len <= 300; ++len )
+  {
+    auto msg      = pattern( len, 2 );
+    auto expected = hash_with< sha256 >( msg, sha256::compress_generic );
+    EXPECT_TRUE( sha256::hash( msg.data(), len ) == expected ) << "len " << len;
+
+    if ( detail::cpu_has_sha() )
+    {
+      EXPECT_TRUE( hash_with< sha256 >( msg, sha256::compress_shani ) == expected )
+          << "len " << len;
+    }
+  }
+}
+
+TEST( Digest, Sha256HashManyEngines )
+{
+  std::vector< sha256::engine > engines{sha256::engine::automatic, sha256::engine::generic};
+  if ( detail::cpu_has_sha() )
+  {
+    engines.push_back( sha256::engine::shani );
+  }
+  if ( detail::cpu_has_avx2() )
+  {
+    engines.push_back( sha256::engine::avx2 );
+  }
+
+  // counts that leave stragglers after the 2 and 8 wide groups, lengths around the padding edges
+  for ( size_t len : {0, 1, 55, 56, 64, 119, 120, 512} )
+  {
+    for ( size_t count : {1, 2, 3, 8, 9, 17} )
+    {
+      std::vector< std::vector< uint8_t > > messages;
+      std::vector< const uint8_t* >         ptrs;
+      for ( size_t ix = 0; ix < count; ++ix )
+      {
+        messages.push_back( pattern( len, static_cast< unsigned >( ix ) ) );
+      }
+      for ( auto& m : messages )
+      {
+        ptrs.push_back( m.data() );
+      }
+
+      for ( auto use : engines )
+      {
+        std::vector< sha256::digest_type > out( count );
+        sha256::hash_many( ptrs.data(), len, count, out.data(), use );
+        for ( size_t ix = 0; ix < count; ++ix )
+        {
+          EXPECT_TRUE( out[ix] == sha256::hash( messages[ix].data(), len ) )
+              << "len " << len << " count " << count << " message " << ix << " engine "
+              << static_cast< int >( use );
+        }
+      }
+    }
+  }
+}
+
+TEST( Digest, DigestN )
+{
+  using BlockType = block< 512 >;
+  auto blocks     = block_factory< BlockType, op_random_fill >::create_n( 100 );
+
+  std::vector< sha256::digest_type > out256( blocks.size() );
+  digest_n< sha256 >( blocks.data(), blocks.size(), out256.data() );
+
+  std::vector< sha1::digest_type > out1( blocks.size() );
+  digest_n< sha1 >( blocks.data(), blocks.size(), out1.data() );
+
+  for ( size_t ix = 0; ix < blocks.size(); ++ix )
+  {
+    EXPECT_TRUE( out256[ix] == blocks[ix].digest< sha256 >() );
+    EXPECT_TRUE( out1[ix] == blocks[ix].digest< sha1 >() );
+  }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+// fan-out / fan-in over a contiguous output array. the array is cut into disjoint
+// pieces, one task per piece writes its own piece in place, and a counter brings
+// the results back together: no shared lock, no merge copy. piece boundaries are
+// snapped to cache lines so two workers never write the same line, and the
+// remainder is spread over the pieces rather than dumped on the last one.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "future.hpp"
+#include "thread_pool.hpp"
+
+constexpr size_t fan_out_cache_line = 64;
+
+// parts + 1 element offsets into [first, first + count). pieces differ by at most
+// one cache line, some may be empty when count is small.
+template < class T >
+std::vector< size_t > fan_out_bounds( const T* first, size_t count, size_t parts )
+{
+  parts = std::max< size_t >( 1, parts );
+
+  // snapping only works when elements tile the lines exactly
+  size_t per_line = 1;
+  size_t head     = 0;
+  size_t misalign = reinterpret_cast< uintptr_t >( first ) % fan_out_cache_line;
+  if ( fan_out_cache_line % sizeof( T ) == 0 && misalign % sizeof( T ) == 0 )
+  {
+    per_line = fan_out_cache_line / sizeof( T );
+    head     = ( fan_out_cache_line - misalign ) % fan_out_cache_line / sizeof( T );
+    head     = std::min( count, head );
+  }
+
+  // whole lines after the unaligned head, dealt out as evenly as they go
+  const size_t lines = ( count - head + per_line - 1 ) / per_line;
+
+  std::vector< size_t > bounds( parts + 1 );
+  bounds[0]     = 0;
+  bounds[parts] = count;
+  for ( size_t ix = 1; ix < parts; ++ix )
+  {
+    bounds[ix] = std::min( count, head + ( ix * lines / parts ) * per_line );
+  }
+  return bounds;
+}
+
+// run fn(part, piece_first, piece_last) for each of parts pieces of [first, last)
+// on pool, parts = 0 means one per worker. fn is shared by every piece, so it is
+// called concurrently. the future completes when every piece is done, with the
+// first exception thrown if any were.
+template < class T, class F >
+future< void > fan_out( thread_pool& pool, T* first, T* last, size_t parts, F fn )
+{
+  if ( parts == 0 )
+  {
+    parts = pool.size();
+  }
+  const auto bounds = fan_out_bounds( first, size_t( last - first ), parts );
+
+  struct fan_in
+  {
+    explicit fan_in( F f )
+        : fn( std::move( f ) )
+    {
+    }
+
+    void finish()
+    {
+      if ( remaining.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+      {
+        if ( error )
+        {
+          done.set_exception( error );
+        }
+        else
+        {
+          done.set_value();
+        }
+      }
+    }
+
+    F                     fn;
+    std::atomic< size_t > remaining{1}; // held by the caller until every piece is posted
+    std::mutex            error_lock;   // only taken when a piece throws
+    std::exception_ptr    error;
+    promise< void >       done;
+  };
+
+  auto in     = std::make_shared< fan_in >( std::move( fn ) );
+  auto result = in->done.get_future();
+
+  for ( size_t part = 0; part < parts; ++part )
+  {
+    T* piece_first = first + bounds[part];
+    T* piece_last  = first + bounds[part + 1];
+    if ( piece_first == piece_last )
+    {
+      continue;
+    }
+
+    in->remaining.fetch_add( 1, std::memory_order_relaxed );
+    pool.post( [in, part, piece_first, piece_last] {
+      try
+      {
+        in->fn( part, piece_first, piece_last );
+      }
+      catch ( ... )
+      {
+        std::lock_guard< std::mutex > locker{in->error_lock};
+        if ( !in->error )
+        {
+          in->error = std::current_exception();
+        }
+      }
+      in->finish();
+    } );
+  }
+  in->finish();
+  return result;
+}
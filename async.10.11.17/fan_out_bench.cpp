@@ -0,0 +1,134 @@
+// the FanOut example's fill: build a local slice and merge it under one global
+// lock, against fan_out writing each piece in place. 1 worker up to one per cpu,
+// and the physical core count. fan_out runs with workers left to the scheduler,
+// pinned one per physical core (SMT siblings only once the cores run out) and
+// kept inside one L3 domain each.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "bench.hpp"
+#include "fan_out.hpp"
+#include "thread_pool.hpp"
+#include "topology.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+size_t cpus()
+{
+  size_t n = std::thread::hardware_concurrency();
+  return n ? n : 1;
+}
+
+std::vector< size_t > thread_counts()
+{
+  std::vector< size_t > counts;
+  for ( size_t n = 1; n < cpus(); n *= 2 )
+  {
+    counts.push_back( n );
+  }
+  counts.push_back( cpus() );
+  counts.push_back( cpu_topology::system().cores().size() );
+  std::sort( counts.begin(), counts.end() );
+  counts.erase( std::unique( counts.begin(), counts.end() ), counts.end() );
+  return counts;
+}
+
+// a few ns of work per element so the fill is compute bound
+uint64_t element( uint64_t x )
+{
+  x += 0x9e3779b97f4a7c15ull;
+  x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+  x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebull;
+  return x ^ ( x >> 31 );
+}
+
+// the demo as it was, with the quadratic write back fixed: fill a slice, then
+// copy it out holding results_lock
+void locked_merge( std::vector< uint64_t >& results, size_t threads )
+{
+  thread_pool pool( threads );
+  std::mutex  results_lock;
+
+  auto start = clock_type::now();
+
+  const size_t                       segment_size = results.size() / threads;
+  std::vector< std::future< void > > futs;
+  for ( size_t cpu_index = 0; cpu_index < threads; ++cpu_index )
+  {
+    const size_t segment_begin = cpu_index * segment_size;
+    const size_t segment_end
+        = cpu_index + 1 == threads ? results.size() : segment_begin + segment_size;
+
+    futs.push_back( pool.submit( [&, segment_begin, segment_end] {
+      std::vector< uint64_t > slice( segment_end - segment_begin );
+      for ( size_t k = 0; k < slice.size(); ++k )
+      {
+        slice[k] = element( segment_begin + k );
+      }
+
+      std::lock_guard< std::mutex > locker{results_lock};
+      std::copy( slice.begin(), slice.end(), results.begin() + segment_begin );
+    } ) );
+  }
+  for ( auto& f : futs )
+  {
+    f.get();
+  }
+
+  bench::report( "locked merge", threads, double( results.size() ), "elements", start );
+}
+
+void in_place( std::vector< uint64_t >& results, size_t threads, placement where,
+               const std::string& name )
+{
+  thread_pool pool( threads, where );
+
+  auto start = clock_type::now();
+
+  fan_out( pool, results.data(), results.data() + results.size(), threads,
+           [&]( size_t, uint64_t* first, uint64_t* last ) {
+             for ( uint64_t* it = first; it != last; ++it )
+             {
+               *it = element( it - results.data() );
+             }
+           } )
+      .get();
+
+  bench::report( name, threads, double( results.size() ), "elements", start );
+}
+} // namespace
+
+TEST( FanOutBench, Fill )
+{
+  std::vector< uint64_t > results( 32 * 1024 * 1024 + 3 );
+
+  for ( size_t threads : thread_counts() )
+  {
+    locked_merge( results, threads );
+    uint64_t check = results[results.size() / 2];
+
+    in_place( results, threads, placement::none, "fan_out" );
+    EXPECT_EQ( results[results.size() / 2], check );
+
+    in_place( results, threads, placement::per_core, "fan_out per_core" );
+    EXPECT_EQ( results[results.size() / 2], check );
+
+    in_place( results, threads, placement::per_cache, "fan_out per_cache" );
+    EXPECT_EQ( results[results.size() / 2], check );
+  }
+}
@@ -0,0 +1,124 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "fan_out.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+// clang-format on
+
+namespace
+{
+// every boundary between two non empty pieces sits on a cache line
+template < class T >
+void expect_line_aligned( const T* first, const std::vector< size_t >& bounds )
+{
+  for ( size_t ix = 1; ix + 1 < bounds.size(); ++ix )
+  {
+    if ( bounds[ix] != 0 && bounds[ix] != bounds.back() )
+    {
+      auto addr = reinterpret_cast< uintptr_t >( first + bounds[ix] );
+      EXPECT_EQ( addr % fan_out_cache_line, 0u ) << "boundary " << ix;
+    }
+  }
+}
+} // namespace
+
+TEST( FanOut, BoundsCoverEverythingOnLines )
+{
+  std::vector< int > data( 64 * 1024 + 7 );
+
+  // an odd start too, so the first piece has a head before the first line
+  for ( int* first : {data.data(), data.data() + 3} )
+  {
+    for ( size_t parts : {1u, 2u, 3u, 7u, 8u, 64u} )
+    {
+      size_t count  = data.size() - ( first - data.data() );
+      auto   bounds = fan_out_bounds( first, count, parts );
+
+      ASSERT_EQ( bounds.size(), parts + 1 );
+      EXPECT_EQ( bounds.front(), 0u );
+      EXPECT_EQ( bounds.back(), count );
+      EXPECT_TRUE( std::is_sorted( bounds.begin(), bounds.end() ) );
+      expect_line_aligned( first, bounds );
+
+      // the remainder is spread: pieces differ by a line plus the head at most
+      size_t smallest = count, largest = 0;
+      for ( size_t ix = 0; ix < parts; ++ix )
+      {
+        smallest = std::min( smallest, bounds[ix + 1] - bounds[ix] );
+        largest  = std::max( largest, bounds[ix + 1] - bounds[ix] );
+      }
+      EXPECT_LE( largest - smallest, 2 * fan_out_cache_line / sizeof( int ) );
+    }
+  }
+}
+
+TEST( FanOut, MoreWorkersThanLines )
+{
+  std::vector< char > data( 100 );
+  auto                bounds = fan_out_bounds( data.data(), data.size(), 16 );
+  EXPECT_EQ( bounds.back(), 100u );
+  EXPECT_TRUE( std::is_sorted( bounds.begin(), bounds.end() ) );
+
+  // odd sized elements can't tile a line, they split anywhere
+  struct odd
+  {
+    char bytes[3];
+  };
+  std::vector< odd > odds( 10 );
+  auto               odd_bounds = fan_out_bounds( odds.data(), odds.size(), 4 );
+  EXPECT_EQ( odd_bounds, ( std::vector< size_t >{0, 2, 5, 7, 10} ) );
+}
+
+TEST( FanOut, EveryElementWrittenOnce )
+{
+  thread_pool pool( 4 );
+
+  // capacity not divisible by the part count
+  std::vector< int >             results( 64 * 1024 + 13, -1 );
+  std::vector< std::atomic_int > pieces( 7 );
+
+  fan_out( pool, results.data(), results.data() + results.size(), 7,
+           [&]( size_t part, int* first, int* last ) {
+             pieces[part].fetch_add( 1 );
+             for ( int* it = first; it != last; ++it )
+             {
+               *it = int( it - results.data() );
+             }
+           } )
+      .get();
+
+  for ( size_t ix = 0; ix < results.size(); ++ix )
+  {
+    ASSERT_EQ( results[ix], int( ix ) );
+  }
+  for ( auto& p : pieces )
+  {
+    EXPECT_EQ( p.load(), 1 );
+  }
+}
+
+TEST( FanOut, ExceptionReachesFuture )
+{
+  thread_pool        pool( 2 );
+  std::vector< int > results( 4096 );
+
+  auto f = fan_out( pool, results.data(), results.data() + results.size(), 0,
+                    []( size_t part, int*, int* ) {
+                      if ( part == 1 )
+                      {
+                        throw std::runtime_error( "piece failed" );
+                      }
+                    } );
+  EXPECT_THROW( f.get(), std::runtime_error );
+
+  // empty input completes straight away
+  auto empty = fan_out( pool, results.data(), results.data(), 4, []( size_t, int*, int* ) {} );
+  empty.get();
+}
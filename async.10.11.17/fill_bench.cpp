@@ -0,0 +1,135 @@
+// throughput of the block fill policies, single threaded and with one filler per cpu
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "bench.hpp"
+#include "block.hpp"
+#include "block_factory.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using bench::clock_type;
+using bench::cpus;
+using BlockType = block< 4096 >;
+
+template < template < class > class FillPolicy >
+void fill_throughput( const std::string& name, size_t threads, size_t blocks_per_thread )
+{
+  using Factory = block_factory< BlockType, FillPolicy >;
+
+  auto worker = [&] {
+    BlockType b;
+    for ( size_t ix = 0; ix < blocks_per_thread; ++ix )
+    {
+      Factory::fill_policy_type::fill( b );
+    }
+    // keep the fill from being optimized away
+    volatile auto sink = b.front();
+    (void) sink;
+  };
+
+  auto start = clock_type::now();
+
+  std::vector< std::thread > pool;
+  for ( size_t t = 0; t < threads; ++t )
+  {
+    pool.emplace_back( worker );
+  }
+  for ( auto& t : pool )
+  {
+    t.join();
+  }
+
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+
+  double bytes = double( threads * blocks_per_thread * BlockType::m_bytes );
+  std::cout << name << " threads=" << threads << " " << bytes / elapsed.count() / ( 1 << 20 )
+            << " MiB/s" << std::endl;
+}
+} // namespace
+
+TEST( FillBench, Zero )
+{
+  fill_throughput< op_zero_fill >( "zero", 1, 64 * 1024 );
+  fill_throughput< op_zero_fill >( "zero", cpus(), 64 * 1024 );
+}
+
+TEST( FillBench, Random )
+{
+  fill_throughput< op_random_fill >( "mt19937", 1, 512 );
+  fill_throughput< op_random_fill >( "mt19937", cpus(), 512 );
+}
+
+TEST( FillBench, SecureRandom )
+{
+  fill_throughput< op_secure_random_fill >( "chacha20", 1, 8 * 1024 );
+  fill_throughput< op_secure_random_fill >( "chacha20", cpus(), 8 * 1024 );
+}
+
+namespace
+{
+// the FanOut shape: 64K blocks of 2K, one create() at a time vs in one batch
+template < template < class > class FillPolicy >
+void batch_throughput( const std::string& name, size_t count )
+{
+  using BatchBlockType = block< 2048 >;
+  using Factory        = block_factory< BatchBlockType, FillPolicy >;
+
+  auto report = [&]( const std::string& how, clock_type::time_point start ) {
+    std::chrono::duration< double > elapsed = clock_type::now() - start;
+    double bytes = double( count * sizeof( BatchBlockType ) );
+    std::cout << name << " " << how << " blocks=" << count << " "
+              << bytes / elapsed.count() / ( 1 << 20 ) << " MiB/s" << std::endl;
+  };
+
+  {
+    auto                          start = clock_type::now();
+    std::vector< BatchBlockType > blocks;
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      blocks.push_back( Factory::create() );
+    }
+    report( "create() loop", start );
+  }
+
+  {
+    auto start  = clock_type::now();
+    auto blocks = Factory::create_n( count );
+    report( "create_n", start );
+  }
+
+  {
+    auto start  = clock_type::now();
+    auto blocks = Factory::create_n( count, cpus() );
+    report( "create_n threaded", start );
+  }
+}
+} // namespace
+
+TEST( FillBench, BatchZero )
+{
+  // below and above block_stream_threshold
+  batch_throughput< op_zero_fill >( "zero", 2 * 1024 );
+  batch_throughput< op_zero_fill >( "zero", 64 * 1024 );
+}
+
+TEST( FillBench, BatchRandom )
+{
+  batch_throughput< op_random_fill >( "mt19937", 2 * 1024 );
+  batch_throughput< op_random_fill >( "mt19937", 8 * 1024 );
+}
+
+TEST( FillBench, BatchSecureRandom )
+{
+  batch_throughput< op_secure_random_fill >( "chacha20", 2 * 1024 );
+  batch_throughput< op_secure_random_fill >( "chacha20", 64 * 1024 );
+}
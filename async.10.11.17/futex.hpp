@@ -0,0 +1,30 @@
+#pragma once
+
+// thin wrappers over the linux futex syscall: sleep while a 32 bit word still
+// holds the value you saw, wake sleepers after changing it. process private.
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+namespace detail
+{
+inline void futex_wait( std::atomic< uint32_t >* word, uint32_t expected )
+{
+  syscall( SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0 );
+}
+
+inline void futex_wake( std::atomic< uint32_t >* word, int count )
+{
+  syscall( SYS_futex, word, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0 );
+}
+
+inline void futex_wake_all( std::atomic< uint32_t >* word )
+{
+  futex_wake( word, INT_MAX );
+}
+} // namespace detail
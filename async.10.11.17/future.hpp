@@ -0,0 +1,768 @@
+#pragma once
+
+// promise / future pair with continuations. future<T>::then() chains work onto a
+// result instead of parking a thread in get(), when_all() and when_any() combine
+// futures the same way.
+//
+// the shared state is one allocation: the value, an exception_ptr, a single
+// continuation slot and one atomic word of flags. completing it is an atomic
+// fetch_or plus running the continuation, if any. only a thread that actually
+// blocks in wait()/get() costs anything more, it sleeps on the flag word with a
+// futex, so there is no mutex or condition variable per result.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "futex.hpp"
+#include "thread_pool.hpp"
+
+template < class T >
+class future;
+
+template < class T >
+class promise;
+
+namespace detail
+{
+struct unit
+{
+};
+
+// what the shared state holds for a future<T>
+template < class T >
+using stored_t = std::conditional_t< std::is_void< T >::value, unit, T >;
+
+template < class T >
+class future_state
+{
+public:
+  future_state()                      = default;
+  future_state( const future_state& ) = delete;
+  future_state& operator=( const future_state& ) = delete;
+
+  ~future_state()
+  {
+    if ( m_has_value )
+    {
+      value().~stored_t< T >();
+    }
+    // set but never run: the producer went away without completing
+    delete m_callback.load( std::memory_order_relaxed );
+  }
+
+  void add_ref()
+  {
+    m_refs.fetch_add( 1, std::memory_order_relaxed );
+  }
+
+  void release()
+  {
+    if ( m_refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+    {
+      delete this;
+    }
+  }
+
+  template < class... Args >
+  void set_value( Args&&... args )
+  {
+    new ( &m_storage ) stored_t< T >( std::forward< Args >( args )... );
+    m_has_value = true;
+    publish();
+  }
+
+  void set_exception( std::exception_ptr error )
+  {
+    m_error = std::move( error );
+    publish();
+  }
+
+  // run cb once the state is ready, right here if it already is. one per state.
+  void on_ready( std::unique_ptr< pool_task > cb )
+  {
+    m_callback.store( cb.release(), std::memory_order_relaxed );
+    if ( m_flags.fetch_or( chained, std::memory_order_acq_rel ) & ready )
+    {
+      run_callback();
+    }
+  }
+
+  // takes back the callback on_ready() installed if it has not been started,
+  // which leaves the state free to be chained again. once publish() has seen it
+  // the callback can no longer be stopped: this waits until it has left the
+  // slot and returns null.
+  std::unique_ptr< pool_task > detach()
+  {
+    uint32_t flags = m_flags.load( std::memory_order_acquire );
+    while ( !( flags & ready ) )
+    {
+      if ( m_flags.compare_exchange_weak( flags, flags & ~chained, std::memory_order_acq_rel ) )
+      {
+        return std::unique_ptr< pool_task >(
+            m_callback.exchange( nullptr, std::memory_order_acquire ) );
+      }
+    }
+    while ( m_callback.load( std::memory_order_acquire ) )
+    {
+      std::this_thread::yield();
+    }
+    return nullptr;
+  }
+
+  void wait()
+  {
+    if ( is_ready() )
+    {
+      return;
+    }
+    uint32_t flags = m_flags.fetch_or( waiting, std::memory_order_acq_rel ) | waiting;
+    while ( !( flags & ready ) )
+    {
+      futex_wait( &m_flags, flags );
+      flags = m_flags.load( std::memory_order_acquire );
+    }
+  }
+
+  bool is_ready() const
+  {
+    return m_flags.load( std::memory_order_acquire ) & ready;
+  }
+
+  bool has_error() const
+  {
+    return m_error != nullptr;
+  }
+
+  const std::exception_ptr& error() const
+  {
+    return m_error;
+  }
+
+  stored_t< T >& value()
+  {
+    return *reinterpret_cast< stored_t< T >* >( &m_storage );
+  }
+
+private:
+  enum : uint32_t
+  {
+    ready   = 1,
+    chained = 2, // m_callback is set
+    waiting = 4, // someone is asleep on m_flags
+  };
+
+  void publish()
+  {
+    uint32_t prev = m_flags.fetch_or( ready, std::memory_order_acq_rel );
+    if ( prev & waiting )
+    {
+      futex_wake_all( &m_flags );
+    }
+    if ( prev & chained )
+    {
+      run_callback();
+    }
+  }
+
+  void run_callback()
+  {
+    std::unique_ptr< pool_task > cb( m_callback.exchange( nullptr, std::memory_order_acq_rel ) );
+    cb->run();
+  }
+
+  std::atomic< uint32_t >   m_flags{0};
+  std::atomic< uint32_t >   m_refs{2}; // one promise, one future
+  bool                      m_has_value{false};
+  std::exception_ptr        m_error;
+  std::atomic< pool_task* > m_callback{nullptr};
+
+  typename std::aligned_storage< sizeof( stored_t< T > ), alignof( stored_t< T > ) >::type
+      m_storage;
+}; // future_state
+
+// moves the result out of a ready state, rethrowing a stored exception
+template < class T >
+struct take_value
+{
+  static T from( future_state< T >& s )
+  {
+    if ( s.has_error() )
+    {
+      std::rethrow_exception( s.error() );
+    }
+    return std::move( s.value() );
+  }
+};
+
+template <>
+struct take_value< void >
+{
+  static void from( future_state< void >& s )
+  {
+    if ( s.has_error() )
+    {
+      std::rethrow_exception( s.error() );
+    }
+  }
+};
+
+// call f with the antecedent's value (none for void), complete p (a promise<R>)
+// with the result
+template < class R >
+struct fulfil
+{
+  template < class Promise, class F, class... Args >
+  static void run( Promise& p, F& f, Args&&... args )
+  {
+    try
+    {
+      p.set_value( f( std::forward< Args >( args )... ) );
+    }
+    catch ( ... )
+    {
+      p.set_exception( std::current_exception() );
+    }
+  }
+};
+
+template <>
+struct fulfil< void >
+{
+  template < class Promise, class F, class... Args >
+  static void run( Promise& p, F& f, Args&&... args )
+  {
+    try
+    {
+      f( std::forward< Args >( args )... );
+      p.set_value();
+    }
+    catch ( ... )
+    {
+      p.set_exception( std::current_exception() );
+    }
+  }
+};
+
+template < class F, class T >
+struct continuation_result
+{
+  using type = decltype( std::declval< F& >()( std::declval< T >() ) );
+};
+
+template < class F >
+struct continuation_result< F, void >
+{
+  using type = decltype( std::declval< F& >()() );
+};
+
+template < class F, class T >
+using continuation_result_t = typename continuation_result< F, T >::type;
+
+template < class R, class F, class T >
+void continue_with( promise< R >& p, F& f, future_state< T >& s, std::false_type /* void T */ )
+{
+  fulfil< R >::run( p, f, std::move( s.value() ) );
+}
+
+template < class R, class F, class T >
+void continue_with( promise< R >& p, F& f, future_state< T >&, std::true_type /* void T */ )
+{
+  fulfil< R >::run( p, f );
+}
+
+struct future_access
+{
+  template < class T >
+  static future_state< T >* state( future< T >& f )
+  {
+    return f.m_state;
+  }
+};
+} // namespace detail
+
+template < class T >
+class future
+{
+public:
+  using value_type = T;
+
+  future() = default;
+
+  future( future&& other ) noexcept
+      : m_state( other.m_state )
+  {
+    other.m_state = nullptr;
+  }
+
+  future& operator=( future&& other ) noexcept
+  {
+    if ( this != &other )
+    {
+      reset();
+      m_state       = other.m_state;
+      other.m_state = nullptr;
+    }
+    return *this;
+  }
+
+  future( const future& ) = delete;
+  future& operator=( const future& ) = delete;
+
+  ~future()
+  {
+    reset();
+  }
+
+  bool valid() const
+  {
+    return m_state != nullptr;
+  }
+
+  bool is_ready() const
+  {
+    check();
+    return m_state->is_ready();
+  }
+
+  void wait() const
+  {
+    check();
+    m_state->wait();
+  }
+
+  // block until ready and take the result, leaves the future invalid
+  T get()
+  {
+    check();
+    m_state->wait();
+    std::unique_ptr< detail::future_state< T >, state_release > hold( m_state );
+    m_state = nullptr;
+    return detail::take_value< T >::from( *hold );
+  }
+
+  // f(value) runs on whichever thread completes this future, or right here if it
+  // already has. an exception, stored or thrown by f, carries on down the chain.
+  // leaves this future invalid.
+  template < class F >
+  future< detail::continuation_result_t< std::decay_t< F >, T > > then( F&& f )
+  {
+    return chain( nullptr, std::forward< F >( f ) );
+  }
+
+  // same, but f is posted to executor instead of running inline
+  template < class F >
+  future< detail::continuation_result_t< std::decay_t< F >, T > > then( thread_pool& executor,
+                                                                        F&& f )
+  {
+    return chain( &executor, std::forward< F >( f ) );
+  }
+
+private:
+  friend class promise< T >;
+  friend struct detail::future_access;
+
+  struct state_release
+  {
+    void operator()( detail::future_state< T >* s ) const
+    {
+      s->release();
+    }
+  };
+
+  explicit future( detail::future_state< T >* state )
+      : m_state( state )
+  {
+  }
+
+  void check() const
+  {
+    if ( !m_state )
+    {
+      throw std::future_error( std::future_errc::no_state );
+    }
+  }
+
+  void reset()
+  {
+    if ( m_state )
+    {
+      m_state->release();
+      m_state = nullptr;
+    }
+  }
+
+  template < class F >
+  future< detail::continuation_result_t< std::decay_t< F >, T > > chain( thread_pool* executor,
+                                                                         F&&          f )
+  {
+    using result_type = detail::continuation_result_t< std::decay_t< F >, T >;
+
+    check();
+    promise< result_type > next;
+    auto                   fut = next.get_future();
+
+    // the continuation takes over our reference to the state
+    std::unique_ptr< detail::future_state< T >, state_release > hold( m_state );
+    m_state = nullptr;
+
+    auto* state = hold.get();
+    auto  step  = [hold = std::move( hold ),
+                 next = std::move( next ),
+                 fn   = std::decay_t< F >( std::forward< F >( f ) )]() mutable {
+      if ( hold->has_error() )
+      {
+        next.set_exception( hold->error() );
+        return;
+      }
+      detail::continue_with( next, fn, *hold, std::is_void< T >{} );
+    };
+
+    if ( executor )
+    {
+      auto hop = [executor, step = std::move( step )]() mutable {
+        try
+        {
+          executor->post( std::move( step ) );
+        }
+        catch ( const std::runtime_error& )
+        {
+          // pool shut down: step dies unrun and the chain sees broken_promise
+        }
+      };
+      state->on_ready( make_callback( std::move( hop ) ) );
+    }
+    else
+    {
+      state->on_ready( make_callback( std::move( step ) ) );
+    }
+    return fut;
+  }
+
+  template < class F >
+  static std::unique_ptr< detail::pool_task > make_callback( F&& f )
+  {
+    return std::unique_ptr< detail::pool_task >(
+        new detail::pool_task_impl< std::decay_t< F > >( std::forward< F >( f ) ) );
+  }
+
+  detail::future_state< T >* m_state{nullptr};
+}; // future
+
+template < class T >
+class promise
+{
+public:
+  promise()
+      : m_state( new detail::future_state< T > )
+  {
+  }
+
+  promise( promise&& other ) noexcept
+      : m_state( other.m_state )
+      , m_retrieved( other.m_retrieved )
+      , m_satisfied( other.m_satisfied )
+  {
+    other.m_state = nullptr;
+  }
+
+  promise& operator=( promise&& other ) noexcept
+  {
+    if ( this != &other )
+    {
+      abandon();
+      m_state       = other.m_state;
+      m_retrieved   = other.m_retrieved;
+      m_satisfied   = other.m_satisfied;
+      other.m_state = nullptr;
+    }
+    return *this;
+  }
+
+  promise( const promise& ) = delete;
+  promise& operator=( const promise& ) = delete;
+
+  // an unsatisfied promise going away completes its future with broken_promise
+  ~promise()
+  {
+    abandon();
+  }
+
+  future< T > get_future()
+  {
+    check();
+    if ( m_retrieved )
+    {
+      throw std::future_error( std::future_errc::future_already_retrieved );
+    }
+    m_retrieved = true;
+    return future< T >( m_state );
+  }
+
+  template < class... Args >
+  void set_value( Args&&... args )
+  {
+    satisfy();
+    try
+    {
+      m_state->set_value( std::forward< Args >( args )... );
+    }
+    catch ( ... )
+    {
+      // the value's constructor threw, nothing was published: the promise is
+      // left unsatisfied, for set_exception, as std::promise does
+      m_satisfied = false;
+      throw;
+    }
+  }
+
+  void set_exception( std::exception_ptr error )
+  {
+    satisfy();
+    m_state->set_exception( std::move( error ) );
+  }
+
+private:
+  void check() const
+  {
+    if ( !m_state )
+    {
+      throw std::future_error( std::future_errc::no_state );
+    }
+  }
+
+  void satisfy()
+  {
+    check();
+    if ( m_satisfied )
+    {
+      throw std::future_error( std::future_errc::promise_already_satisfied );
+    }
+    m_satisfied = true;
+  }
+
+  void abandon()
+  {
+    if ( !m_state )
+    {
+      return;
+    }
+    if ( !m_satisfied )
+    {
+      m_satisfied = true;
+      m_state->set_exception(
+          std::make_exception_ptr( std::future_error( std::future_errc::broken_promise ) ) );
+    }
+    if ( !m_retrieved )
+    {
+      m_state->release(); // the future's reference nobody claimed
+    }
+    m_state->release();
+    m_state = nullptr;
+  }
+
+  detail::future_state< T >* m_state;
+  bool                       m_retrieved{false};
+  bool                       m_satisfied{false};
+}; // promise
+
+// a future that's already complete
+template < class T >
+future< std::decay_t< T > > make_ready_future( T&& value )
+{
+  promise< std::decay_t< T > > p;
+  auto                         f = p.get_future();
+  p.set_value( std::forward< T >( value ) );
+  return f;
+}
+
+inline future< void > make_ready_future()
+{
+  promise< void > p;
+  auto            f = p.get_future();
+  p.set_value();
+  return f;
+}
+
+namespace detail
+{
+// gathers the results once every input is ready, the first failure by position wins
+template < class T >
+struct collect_all
+{
+  using result_type = std::vector< T >;
+
+  static void run( promise< result_type >& p, std::vector< future< T > >& inputs )
+  {
+    try
+    {
+      result_type out;
+      out.reserve( inputs.size() );
+      for ( auto& f : inputs )
+      {
+        out.push_back( f.get() );
+      }
+      p.set_value( std::move( out ) );
+    }
+    catch ( ... )
+    {
+      p.set_exception( std::current_exception() );
+    }
+  }
+};
+
+template <>
+struct collect_all< void >
+{
+  using result_type = void;
+
+  static void run( promise< void >& p, std::vector< future< void > >& inputs )
+  {
+    try
+    {
+      for ( auto& f : inputs )
+      {
+        f.get();
+      }
+      p.set_value();
+    }
+    catch ( ... )
+    {
+      p.set_exception( std::current_exception() );
+    }
+  }
+};
+} // namespace detail
+
+// ready when every input is. future<vector<T>> in input order, future<void> for void
+// inputs. if any input failed the result fails with the first failure by position.
+template < class T >
+future< typename detail::collect_all< T >::result_type >
+when_all( std::vector< future< T > > inputs )
+{
+  using result_type = typename detail::collect_all< T >::result_type;
+
+  struct gather
+  {
+    std::vector< future< T > > inputs;
+    std::atomic< size_t >      remaining;
+    promise< result_type >     done;
+  };
+
+  auto g = std::make_shared< gather >();
+  g->inputs = std::move( inputs );
+  g->remaining.store( g->inputs.size() + 1 ); // +1 until every callback is installed
+  auto result = g->done.get_future();
+
+  auto arrive = [g] {
+    if ( g->remaining.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+    {
+      detail::collect_all< T >::run( g->done, g->inputs );
+    }
+  };
+
+  for ( auto& f : g->inputs )
+  {
+    auto* state = detail::future_access::state( f );
+    if ( !state )
+    {
+      throw std::future_error( std::future_errc::no_state );
+    }
+    state->on_ready( std::unique_ptr< detail::pool_task >(
+        new detail::pool_task_impl< decltype( arrive ) >( arrive ) ) );
+  }
+  arrive();
+  return result;
+}
+
+template < class T >
+struct when_any_result
+{
+  size_t                     index; // the first input to complete
+  std::vector< future< T > > futures;
+};
+
+// ready as soon as one input is, successfully or not. every input comes back in
+// the result, futures[index] is ready and the rest may still be running. the
+// losers carry no callback of ours by then, they can be chained or raced again.
+template < class T >
+future< when_any_result< T > > when_any( std::vector< future< T > > inputs )
+{
+  struct race
+  {
+    std::vector< future< T > >                inputs;
+    std::vector< detail::future_state< T >* > states;
+    std::atomic< bool >                       won{false};
+    size_t                                    index{0};
+    std::atomic< int >                        gate{2}; // a winner, every callback installed
+    promise< when_any_result< T > >           done;
+
+    // the second of the two hands the inputs over, taking our callbacks off the
+    // losers first
+    void arrive()
+    {
+      if ( gate.fetch_sub( 1, std::memory_order_acq_rel ) != 1 )
+      {
+        return;
+      }
+      for ( size_t ix = 0; ix < states.size(); ++ix )
+      {
+        if ( ix != index && states[ix]->detach() )
+        {
+          states[ix]->release(); // the detached callback's reference
+        }
+      }
+      done.set_value( when_any_result< T >{index, std::move( inputs )} );
+    }
+  };
+
+  auto r = std::make_shared< race >();
+  r->inputs = std::move( inputs );
+  auto result = r->done.get_future();
+
+  if ( r->inputs.empty() )
+  {
+    r->done.set_value( when_any_result< T >{size_t( -1 ), {}} );
+    return result;
+  }
+
+  // callbacks still running after the hand-over work from the states, and keep
+  // each alive until they have run
+  for ( auto& f : r->inputs )
+  {
+    auto* state = detail::future_access::state( f );
+    if ( !state )
+    {
+      throw std::future_error( std::future_errc::no_state );
+    }
+    r->states.push_back( state );
+  }
+
+  for ( size_t ix = 0; ix < r->states.size(); ++ix )
+  {
+    auto* state = r->states[ix];
+    state->add_ref();
+
+    auto finish = [r, ix, state] {
+      if ( !r->won.exchange( true, std::memory_order_acq_rel ) )
+      {
+        r->index = ix;
+        r->arrive();
+      }
+      state->release();
+    };
+    state->on_ready( std::unique_ptr< detail::pool_task >(
+        new detail::pool_task_impl< decltype( finish ) >( std::move( finish ) ) ) );
+  }
+  r->arrive();
+  return result;
+}
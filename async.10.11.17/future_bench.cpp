@@ -0,0 +1,96 @@
+// cost of the future.hpp shared state against std::promise/std::future, and a
+// fan-in done with when_all() vs parking on each std::future in turn
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "async.hpp"
+#include "future.hpp"
+#include "thread_pool.hpp"
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+void report( const std::string& name, size_t ops, clock_type::time_point start )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << elapsed.count() * 1e9 / ops << " ns/op" << std::endl;
+}
+
+// make a pair, set it, get it: no contention, just the shared state
+template < template < class > class Promise >
+void round_trip( const std::string& name, size_t count )
+{
+  auto   start = clock_type::now();
+  size_t sum   = 0;
+  for ( size_t ix = 0; ix < count; ++ix )
+  {
+    Promise< size_t > p;
+    auto              f = p.get_future();
+    p.set_value( ix );
+    sum += f.get();
+  }
+  EXPECT_EQ( sum, count * ( count - 1 ) / 2 );
+  report( name, count, start );
+}
+} // namespace
+
+TEST( FutureBench, RoundTrip )
+{
+  round_trip< std::promise >( "std::promise set+get", 1000000 );
+  round_trip< promise >( "promise set+get", 1000000 );
+}
+
+TEST( FutureBench, FanIn )
+{
+  constexpr size_t tasks = 100000;
+  thread_pool      pool;
+
+  {
+    auto start = clock_type::now();
+
+    std::vector< std::future< size_t > > futs;
+    futs.reserve( tasks );
+    for ( size_t ix = 0; ix < tasks; ++ix )
+    {
+      futs.push_back( make_async_future( pool, [ix] { return ix; } ) );
+    }
+    size_t sum = 0;
+    for ( auto& f : futs )
+    {
+      sum += f.get();
+    }
+    EXPECT_EQ( sum, tasks * ( tasks - 1 ) / 2 );
+    report( "std::future get() each", tasks, start );
+  }
+
+  {
+    auto start = clock_type::now();
+
+    std::vector< future< size_t > > futs;
+    futs.reserve( tasks );
+    for ( size_t ix = 0; ix < tasks; ++ix )
+    {
+      futs.push_back( make_continuable_future( pool, [ix] { return ix; } ) );
+    }
+    auto sum = when_all( std::move( futs ) ).then( []( std::vector< size_t > values ) {
+      size_t total = 0;
+      for ( auto v : values )
+      {
+        total += v;
+      }
+      return total;
+    } );
+    EXPECT_EQ( sum.get(), tasks * ( tasks - 1 ) / 2 );
+    report( "when_all().then()", tasks, start );
+  }
+}
@@ -0,0 +1,290 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "async.hpp"
+#include "future.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+using namespace std::chrono_literals;
+
+TEST( Future, GetBlocksUntilSet )
+{
+  promise< std::string > p;
+  auto                   f = p.get_future();
+  EXPECT_FALSE( f.is_ready() );
+
+  std::thread producer( [&] {
+    std::this_thread::sleep_for( 20ms );
+    p.set_value( "hello" );
+  } );
+
+  EXPECT_EQ( f.get(), "hello" );
+  EXPECT_FALSE( f.valid() );
+  producer.join();
+}
+
+TEST( Future, StdErrors )
+{
+  promise< int > p;
+  auto           f = p.get_future();
+  EXPECT_THROW( p.get_future(), std::future_error );
+
+  p.set_value( 1 );
+  EXPECT_THROW( p.set_value( 2 ), std::future_error );
+  EXPECT_EQ( f.get(), 1 );
+  EXPECT_THROW( f.get(), std::future_error );
+
+  future< int > broken;
+  {
+    promise< int > dropped;
+    broken = dropped.get_future();
+  }
+  try
+  {
+    broken.get();
+    FAIL();
+  }
+  catch ( const std::future_error& e )
+  {
+    EXPECT_EQ( e.code(), std::future_errc::broken_promise );
+  }
+}
+
+// copies fail, and with no move constructor so do moves
+struct fragile
+{
+  fragile() = default;
+  fragile( const fragile& )
+  {
+    throw std::runtime_error( "copy" );
+  }
+};
+
+TEST( Future, ValueThatFailsToConstruct )
+{
+  promise< fragile > p;
+  auto               f = p.get_future();
+  const fragile      v;
+  EXPECT_THROW( p.set_value( v ), std::runtime_error );
+  EXPECT_FALSE( f.is_ready() );
+
+  // nothing was stored, the promise can still fail the future
+  p.set_exception( std::make_exception_ptr( std::logic_error( "instead" ) ) );
+  EXPECT_THROW( f.get(), std::logic_error );
+
+  // made on a pool worker, where it used to take the process down
+  thread_pool pool( 2 );
+  auto        made = make_continuable_future( pool, [] { return fragile(); } );
+  EXPECT_THROW( made.get(), std::runtime_error );
+
+  auto chained = make_ready_future( 1 ).then( []( int ) { return fragile(); } );
+  EXPECT_THROW( chained.get(), std::runtime_error );
+}
+
+TEST( Future, ThenChainsInline )
+{
+  promise< int > p;
+
+  auto f = p.get_future()
+               .then( []( int v ) { return v * 2; } )
+               .then( []( int v ) { return std::to_string( v ); } )
+               .then( []( std::string s ) { EXPECT_EQ( s, "42" ); } )
+               .then( [] { return 7; } );
+
+  EXPECT_FALSE( f.is_ready() );
+  p.set_value( 21 );
+  EXPECT_TRUE( f.is_ready() );
+  EXPECT_EQ( f.get(), 7 );
+
+  // attached after the fact runs right away
+  auto late = make_ready_future( 3 ).then( []( int v ) { return v + 1; } );
+  EXPECT_TRUE( late.is_ready() );
+  EXPECT_EQ( late.get(), 4 );
+}
+
+TEST( Future, ExceptionSkipsContinuations )
+{
+  promise< int > p;
+  bool           called = false;
+
+  auto f = p.get_future()
+               .then( [&]( int v ) {
+                 called = true;
+                 return v;
+               } )
+               .then( []( int ) -> int { throw std::logic_error( "unreached" ); } );
+
+  p.set_exception( std::make_exception_ptr( std::runtime_error( "boom" ) ) );
+  EXPECT_THROW( f.get(), std::runtime_error );
+  EXPECT_FALSE( called );
+
+  // and one thrown by a continuation goes on down too
+  auto g = make_ready_future( 1 ).then( []( int ) -> int { throw std::logic_error( "no" ); } );
+  EXPECT_THROW( g.get(), std::logic_error );
+}
+
+TEST( Future, ThenOnExecutor )
+{
+  thread_pool     pool( 2 );
+  promise< void > p;
+
+  auto f = p.get_future().then( pool, [&pool] { return pool.on_worker(); } );
+  p.set_value();
+  EXPECT_TRUE( f.get() );
+
+  // a move only value travels down the chain
+  auto make  = [] { return std::unique_ptr< int >( new int( 5 ) ); };
+  auto owned = make_continuable_future( pool, make ).then(
+      pool, []( std::unique_ptr< int > v ) { return *v * 2; } );
+  EXPECT_EQ( owned.get(), 10 );
+}
+
+TEST( Future, WhenAllInOrder )
+{
+  thread_pool pool( 3 );
+
+  std::vector< future< int > > inputs;
+  for ( int ix = 0; ix < 100; ++ix )
+  {
+    inputs.push_back( make_continuable_future( pool, [ix] {
+      std::this_thread::sleep_for( std::chrono::microseconds( ( 100 - ix ) * 10 ) );
+      return ix;
+    } ) );
+  }
+
+  auto all = when_all( std::move( inputs ) ).then( []( std::vector< int > values ) {
+    for ( int ix = 0; ix < 100; ++ix )
+    {
+      EXPECT_EQ( values[ix], ix );
+    }
+    return values.size();
+  } );
+  EXPECT_EQ( all.get(), 100u );
+
+  std::vector< future< void > > none;
+  when_all( std::move( none ) ).get();
+}
+
+TEST( Future, WhenAllFailsWithFirstByPosition )
+{
+  std::vector< promise< void > > ps( 3 );
+  std::vector< future< void > >  inputs;
+  for ( auto& p : ps )
+  {
+    inputs.push_back( p.get_future() );
+  }
+
+  auto all = when_all( std::move( inputs ) );
+  ps[2].set_exception( std::make_exception_ptr( std::logic_error( "third" ) ) );
+  ps[0].set_value();
+  EXPECT_FALSE( all.is_ready() );
+  ps[1].set_exception( std::make_exception_ptr( std::runtime_error( "second" ) ) );
+
+  EXPECT_THROW( all.get(), std::runtime_error );
+}
+
+TEST( Future, WhenAnyTakesTheFirst )
+{
+  std::vector< promise< std::string > > ps( 3 );
+  std::vector< future< std::string > >  inputs;
+  for ( auto& p : ps )
+  {
+    inputs.push_back( p.get_future() );
+  }
+
+  auto any = when_any( std::move( inputs ) );
+  EXPECT_FALSE( any.is_ready() );
+
+  ps[1].set_value( "middle" );
+  auto result = any.get();
+  EXPECT_EQ( result.index, 1u );
+  ASSERT_EQ( result.futures.size(), 3u );
+  EXPECT_EQ( result.futures[1].get(), "middle" );
+
+  // the losers still complete normally
+  EXPECT_FALSE( result.futures[0].is_ready() );
+  ps[0].set_value( "first" );
+  ps[2].set_value( "last" );
+  EXPECT_EQ( result.futures[0].get(), "first" );
+  EXPECT_EQ( result.futures[2].get(), "last" );
+}
+
+TEST( Future, WhenAnyLosersChainAgain )
+{
+  std::vector< promise< int > > ps( 3 );
+  std::vector< future< int > >  inputs;
+  for ( auto& p : ps )
+  {
+    inputs.push_back( p.get_future() );
+  }
+
+  ps[1].set_value( 1 );
+  auto first = when_any( std::move( inputs ) ).get();
+  EXPECT_EQ( first.index, 1u );
+
+  // the two losers raced again, then the last one chained with then()
+  std::vector< future< int > > rest;
+  rest.push_back( std::move( first.futures[0] ) );
+  rest.push_back( std::move( first.futures[2] ) );
+  auto second = when_any( std::move( rest ) );
+  ps[2].set_value( 2 );
+  auto result = second.get();
+  EXPECT_EQ( result.index, 1u );
+  EXPECT_EQ( result.futures[1].get(), 2 );
+
+  auto last = result.futures[0].then( []( int v ) { return v * 10; } );
+  ps[0].set_value( 3 );
+  EXPECT_EQ( last.get(), 30 );
+}
+
+// losers completing while the winner hands them over, then raced again until
+// none is left
+TEST( Future, WhenAnyReracesUntilDone )
+{
+  thread_pool pool( 4 );
+  for ( int round = 0; round < 200; ++round )
+  {
+    std::vector< future< int > > pending;
+    for ( int ix = 0; ix < 8; ++ix )
+    {
+      pending.push_back( make_continuable_future( pool, [ix] { return ix; } ) );
+    }
+
+    int sum = 0;
+    while ( !pending.empty() )
+    {
+      auto any = when_any( std::move( pending ) ).get();
+      sum += any.futures[any.index].get();
+      any.futures.erase( any.futures.begin() + std::ptrdiff_t( any.index ) );
+      pending = std::move( any.futures );
+    }
+    ASSERT_EQ( sum, 28 );
+  }
+}
+
+TEST( Future, ManyChainsRace )
+{
+  thread_pool           pool( 4 );
+  std::atomic< size_t > sum{0};
+
+  std::vector< future< void > > chains;
+  for ( size_t ix = 0; ix < 10000; ++ix )
+  {
+    chains.push_back( make_continuable_future( pool, [ix] { return ix; } )
+                          .then( pool, []( size_t v ) { return v + 1; } )
+                          .then( [&sum]( size_t v ) { sum.fetch_add( v ); } ) );
+  }
+  when_all( std::move( chains ) ).get();
+
+  EXPECT_EQ( sum.load(), size_t( 10000 ) * 10001 / 2 );
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+// lower case hex encoding and decoding without iostreams. the encoders write
+// straight into a caller provided buffer of 2 * len chars (no terminator) or
+// through an output iterator. hex_encode picks the pshufb version when the cpu
+// has SSSE3 and falls back to a 512 byte pair table otherwise.
+
+#include <tmmintrin.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace detail
+{
+// "00" "01" ... "ff" back to back
+inline const char* hex_pairs()
+{
+  static const std::array< char, 512 > table = [] {
+    const char              digits[] = "0123456789abcdef";
+    std::array< char, 512 > t{};
+    for ( int ix = 0; ix < 256; ++ix )
+    {
+      t[ix * 2]     = digits[ix >> 4];
+      t[ix * 2 + 1] = digits[ix & 0x0f];
+    }
+    return t;
+  }();
+  return table.data();
+}
+
+// nibble value of a hex digit either case, -1 for anything else
+inline const int8_t* hex_nibbles()
+{
+  static const std::array< int8_t, 256 > table = [] {
+    std::array< int8_t, 256 > t;
+    t.fill( -1 );
+    for ( int ix = 0; ix < 10; ++ix )
+    {
+      t['0' + ix] = static_cast< int8_t >( ix );
+    }
+    for ( int ix = 0; ix < 6; ++ix )
+    {
+      t['a' + ix] = static_cast< int8_t >( 10 + ix );
+      t['A' + ix] = static_cast< int8_t >( 10 + ix );
+    }
+    return t;
+  }();
+  return table.data();
+}
+} // namespace detail
+
+inline char* hex_encode_table( const uint8_t* src, size_t len, char* out )
+{
+  const char* pairs = detail::hex_pairs();
+  for ( size_t ix = 0; ix < len; ++ix, out += 2 )
+  {
+    memcpy( out, pairs + src[ix] * 2, 2 );
+  }
+  return out;
+}
+
+// 16 bytes in, 32 chars out per iteration: split the nibbles, look each one up
+// in a 16 entry digit table with pshufb and interleave them back
+__attribute__( ( target( "ssse3" ) ) ) inline char*
+hex_encode_ssse3( const uint8_t* src, size_t len, char* out )
+{
+  const __m128i digits = _mm_setr_epi8(
+      '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' );
+  const __m128i low_nibble = _mm_set1_epi8( 0x0f );
+
+  for ( ; len >= 16; len -= 16, src += 16, out += 32 )
+  {
+    __m128i in = _mm_loadu_si128( reinterpret_cast< const __m128i* >( src ) );
+    __m128i hi = _mm_shuffle_epi8( digits, _mm_and_si128( _mm_srli_epi16( in, 4 ), low_nibble ) );
+    __m128i lo = _mm_shuffle_epi8( digits, _mm_and_si128( in, low_nibble ) );
+
+    _mm_storeu_si128( reinterpret_cast< __m128i* >( out ), _mm_unpacklo_epi8( hi, lo ) );
+    _mm_storeu_si128( reinterpret_cast< __m128i* >( out + 16 ), _mm_unpackhi_epi8( hi, lo ) );
+  }
+
+  return hex_encode_table( src, len, out );
+}
+
+inline bool hex_has_ssse3()
+{
+  static const bool supported = __builtin_cpu_supports( "ssse3" );
+  return supported;
+}
+
+// returns one past the last char written
+inline char* hex_encode( const uint8_t* src, size_t len, char* out )
+{
+  return hex_has_ssse3() ? hex_encode_ssse3( src, len, out ) : hex_encode_table( src, len, out );
+}
+
+template < class OutputIt >
+OutputIt hex_encode( const uint8_t* src, size_t len, OutputIt out )
+{
+  // encode a chunk at a time so the iterator only ever sees a plain copy
+  char buf[256];
+  while ( len > 0 )
+  {
+    size_t n = std::min( len, sizeof( buf ) / 2 );
+    hex_encode( src, n, buf );
+    out = std::copy( buf, buf + n * 2, out );
+    src += n;
+    len -= n;
+  }
+  return out;
+}
+
+// len hex digits into len / 2 bytes. false on an odd length or a non hex digit,
+// in which case out holds whatever was decoded before the bad digit
+inline bool hex_decode( const char* src, size_t len, uint8_t* out )
+{
+  if ( len % 2 != 0 )
+  {
+    return false;
+  }
+
+  const int8_t* nibbles = detail::hex_nibbles();
+  for ( size_t ix = 0; ix < len; ix += 2 )
+  {
+    int hi = nibbles[static_cast< uint8_t >( src[ix] )];
+    int lo = nibbles[static_cast< uint8_t >( src[ix + 1] )];
+    if ( ( hi | lo ) < 0 )
+    {
+      return false;
+    }
+    *out++ = static_cast< uint8_t >( ( hi << 4 ) | lo );
+  }
+  return true;
+}
@@ -0,0 +1,120 @@
+// hex encoding a 4 KiB block: the old iostream formatting vs the table and pshufb encoders
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "block_factory.hpp"
+#include "hex.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using BlockType = block< 4096 >;
+
+template < class Function >
+void hex_throughput( const std::string& name, size_t iterations, Function&& func )
+{
+  auto start = std::chrono::steady_clock::now();
+  for ( size_t ix = 0; ix < iterations; ++ix )
+  {
+    func();
+  }
+  std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << std::setw( 24 ) << std::left << name << " "
+            << elapsed.count() * 1e9 / iterations << " ns/block "
+            << iterations * BlockType::m_bytes / elapsed.count() / ( 1 << 20 ) << " MiB/s"
+            << std::endl;
+}
+
+std::string stringstream_str( const BlockType& b )
+{
+  std::stringstream ss;
+  for ( auto ix = b.cbegin(); ix != b.cend(); ++ix )
+  {
+    ss << std::hex << std::setfill( '0' ) << std::setw( 2 )
+       << ( static_cast< unsigned int >( *ix ) & 0x000000FF );
+  }
+  return ss.str();
+}
+
+std::string stringstream_hexdump( const BlockType& b )
+{
+  std::stringstream os;
+  int               skip = 0;
+  for ( auto ix = b.cbegin(); ix != b.cend(); ++ix )
+  {
+    os << std::hex << std::setfill( '0' ) << std::setw( 2 )
+       << ( static_cast< unsigned int >( *ix ) & 0x000000FF ) << " ";
+    ++skip;
+    if ( skip % 8 == 0 )
+    {
+      os << "  ";
+    }
+    if ( skip % 16 == 0 )
+    {
+      os << "\n";
+    }
+  }
+  return os.str();
+}
+} // namespace
+
+TEST( HexBench, Encode4K )
+{
+  auto        b = block_factory< BlockType, op_secure_random_fill >::create();
+  std::string out( b.size() * 2, '\0' );
+  size_t      sink = 0;
+
+  hex_throughput( "stringstream str()", 2000, [&] { sink += stringstream_str( b ).size(); } );
+  hex_throughput( "block::str()", 200000, [&] { sink += b.str().size(); } );
+  hex_throughput( "hex_encode_table", 200000, [&] {
+    hex_encode_table( b.data(), b.size(), &out[0] );
+    sink += out[0];
+  } );
+  if ( hex_has_ssse3() )
+  {
+    hex_throughput( "hex_encode_ssse3", 200000, [&] {
+      hex_encode_ssse3( b.data(), b.size(), &out[0] );
+      sink += out[0];
+    } );
+  }
+
+  EXPECT_NE( sink, 0u );
+}
+
+TEST( HexBench, Hexdump4K )
+{
+  auto   b    = block_factory< BlockType, op_secure_random_fill >::create();
+  size_t sink = 0;
+
+  hex_throughput(
+      "stringstream hexdump()", 2000, [&] { sink += stringstream_hexdump( b ).size(); } );
+  hex_throughput( "block::hexdump()", 100000, [&] { sink += b.hexdump().size(); } );
+
+  EXPECT_NE( sink, 0u );
+}
+
+TEST( HexBench, Decode4K )
+{
+  auto        b   = block_factory< BlockType, op_secure_random_fill >::create();
+  std::string hex = b.str();
+  BlockType   out;
+  bool        ok = true;
+
+  hex_throughput( "hex_decode", 100000, [&] {
+    ok &= hex_decode( hex.data(), hex.size(), out.data() );
+  } );
+
+  EXPECT_TRUE( ok );
+  EXPECT_TRUE( out == b );
+}
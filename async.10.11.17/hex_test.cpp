@@ -0,0 +1,166 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "block.hpp"
+#include "hex.hpp"
+
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+// the iostream formatting block::str() and block::hexdump() used to do
+std::string reference_str( const uint8_t* src, size_t len )
+{
+  std::stringstream ss;
+  for ( size_t ix = 0; ix < len; ++ix )
+  {
+    ss << std::hex << std::setfill( '0' ) << std::setw( 2 )
+       << static_cast< unsigned int >( src[ix] );
+  }
+  return ss.str();
+}
+
+std::string reference_hexdump( const uint8_t* src, size_t len )
+{
+  std::stringstream os;
+  int               skip = 0;
+  for ( size_t ix = 0; ix < len; ++ix )
+  {
+    os << std::hex << std::setfill( '0' ) << std::setw( 2 )
+       << static_cast< unsigned int >( src[ix] ) << " ";
+    ++skip;
+    if ( skip % 8 == 0 )
+    {
+      os << "  ";
+    }
+    if ( skip % 16 == 0 )
+    {
+      os << "\n";
+    }
+  }
+  return os.str();
+}
+
+std::vector< uint8_t > every_byte( size_t len )
+{
+  std::vector< uint8_t > bytes( len );
+  for ( size_t ix = 0; ix < len; ++ix )
+  {
+    bytes[ix] = static_cast< uint8_t >( ix * 7 + 3 );
+  }
+  return bytes;
+}
+
+template < int Size >
+block< Size > pattern_block()
+{
+  block< Size > b;
+  auto          bytes = every_byte( Size );
+  memcpy( b.data(), bytes.data(), Size );
+  return b;
+}
+} // namespace
+
+TEST( Hex, EncodeKnown )
+{
+  const uint8_t bytes[] = {0x00, 0x01, 0x7f, 0x80, 0xab, 0xff};
+  char          out[12];
+  EXPECT_EQ( hex_encode( bytes, sizeof( bytes ), out ), out + 12 );
+  EXPECT_EQ( std::string( out, 12 ), "00017f80abff" );
+}
+
+TEST( Hex, EncodersAgree )
+{
+  // every length around the 16 byte SIMD stride
+  for ( size_t len = 0; len <= 100; ++len )
+  {
+    auto        bytes    = every_byte( len );
+    std::string expected = reference_str( bytes.data(), len );
+
+    std::string table( len * 2, '?' );
+    hex_encode_table( bytes.data(), len, &table[0] );
+    EXPECT_EQ( table, expected );
+
+    if ( hex_has_ssse3() )
+    {
+      std::string simd( len * 2, '?' );
+      hex_encode_ssse3( bytes.data(), len, &simd[0] );
+      EXPECT_EQ( simd, expected );
+    }
+  }
+}
+
+TEST( Hex, EncodeOutputIterator )
+{
+  auto        bytes = every_byte( 1000 );
+  std::string out;
+  hex_encode( bytes.data(), bytes.size(), std::back_inserter( out ) );
+  EXPECT_EQ( out, reference_str( bytes.data(), bytes.size() ) );
+}
+
+TEST( Hex, DecodeRoundTrip )
+{
+  auto        bytes = every_byte( 257 );
+  std::string hex( bytes.size() * 2, '\0' );
+  hex_encode( bytes.data(), bytes.size(), &hex[0] );
+
+  std::vector< uint8_t > decoded( bytes.size() );
+  EXPECT_TRUE( hex_decode( hex.data(), hex.size(), decoded.data() ) );
+  EXPECT_EQ( decoded, bytes );
+}
+
+TEST( Hex, DecodeUpperCase )
+{
+  uint8_t out[4];
+  EXPECT_TRUE( hex_decode( "DEADbeef", 8, out ) );
+  EXPECT_EQ( out[0], 0xde );
+  EXPECT_EQ( out[1], 0xad );
+  EXPECT_EQ( out[2], 0xbe );
+  EXPECT_EQ( out[3], 0xef );
+}
+
+TEST( Hex, DecodeRejects )
+{
+  uint8_t out[4];
+  EXPECT_FALSE( hex_decode( "abc", 3, out ) );
+  EXPECT_FALSE( hex_decode( "zz00", 4, out ) );
+  EXPECT_FALSE( hex_decode( "00 1", 4, out ) );
+  EXPECT_FALSE( hex_decode( "0g", 2, out ) );
+  EXPECT_TRUE( hex_decode( "", 0, out ) );
+}
+
+TEST( Hex, BlockStr )
+{
+  auto b = pattern_block< 4096 >();
+  EXPECT_EQ( b.str(), reference_str( b.data(), b.size() ) );
+
+  block< 3 > small( 0xa5 );
+  EXPECT_EQ( small.str(), "a5a5a5" );
+
+  std::stringstream ss;
+  ss << b;
+  EXPECT_EQ( ss.str(), b.str() );
+
+  std::string out;
+  b.str( std::back_inserter( out ) );
+  EXPECT_EQ( out, b.str() );
+}
+
+TEST( Hex, BlockHexdump )
+{
+  auto full = pattern_block< 64 >();
+  EXPECT_EQ( full.hexdump(), reference_hexdump( full.data(), full.size() ) );
+
+  // partial last line
+  auto ragged = pattern_block< 27 >();
+  EXPECT_EQ( ragged.hexdump(), reference_hexdump( ragged.data(), ragged.size() ) );
+
+  auto tiny = pattern_block< 5 >();
+  EXPECT_EQ( tiny.hexdump(), reference_hexdump( tiny.data(), tiny.size() ) );
+}
@@ -0,0 +1,443 @@
+#pragma once
+
+// bounded multi producer, multi consumer queue on a power of two ring, after
+// Dmitry Vyukov's design. every cell carries a sequence number saying whose turn
+// it is: producers claim cells with one CAS on the tail, consumers with one CAS
+// on the head, and the two cursors live on their own cache lines, so pushes and
+// pops never meet on a lock. batch calls claim a run of cells with a single CAS.
+//
+// the blocking calls spin briefly, then sleep on a futex. a sleeper is only woken
+// when someone is actually parked, the fast path never enters the kernel.
+// close() ends the stream: pushes fail from then on, pops drain what is left and
+// then fail.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "futex.hpp"
+
+template < class T >
+class mpmc_queue
+{
+public:
+  // capacity is rounded up to a power of two, at least 2
+  explicit mpmc_queue( size_t capacity )
+  {
+    size_t size = 2;
+    while ( size < capacity )
+    {
+      size *= 2;
+    }
+    m_mask = size - 1;
+    m_cells.reset( new cell[size] );
+    for ( size_t ix = 0; ix < size; ++ix )
+    {
+      m_cells[ix].seq.store( ix, std::memory_order_relaxed );
+    }
+  }
+
+  mpmc_queue( const mpmc_queue& ) = delete;
+  mpmc_queue& operator=( const mpmc_queue& ) = delete;
+
+  // whatever was never popped is destroyed, nobody may be using the queue
+  ~mpmc_queue()
+  {
+    const size_t tail = m_tail.load( std::memory_order_relaxed );
+    for ( size_t pos = m_head.load( std::memory_order_relaxed ); pos != tail; ++pos )
+    {
+      cell& c = m_cells[pos & m_mask];
+      if ( c.seq.load( std::memory_order_relaxed ) == pos + 1 )
+      {
+        c.value()->~T();
+      }
+    }
+  }
+
+  size_t capacity() const
+  {
+    return m_mask + 1;
+  }
+
+  // exact only when nobody is pushing or popping
+  size_t size() const
+  {
+    const size_t head = m_head.load( std::memory_order_relaxed );
+    const size_t tail = m_tail.load( std::memory_order_relaxed );
+    return tail > head ? std::min( tail - head, capacity() ) : 0;
+  }
+
+  // false if full or closed, v is left alone then
+  template < class U >
+  bool try_push( U&& v )
+  {
+    if ( m_closed.load( std::memory_order_relaxed ) )
+    {
+      return false;
+    }
+
+    size_t pos = m_tail.load( std::memory_order_relaxed );
+    cell*  c;
+    for ( ;; )
+    {
+      c = &m_cells[pos & m_mask];
+      const intptr_t diff
+          = intptr_t( c->seq.load( std::memory_order_acquire ) ) - intptr_t( pos );
+      if ( diff == 0 )
+      {
+        if ( m_tail.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+        {
+          break;
+        }
+      }
+      else if ( diff < 0 )
+      {
+        return false; // the consumer of the last lap is not done with it
+      }
+      else
+      {
+        pos = m_tail.load( std::memory_order_relaxed );
+      }
+    }
+
+    new ( c->value() ) T( std::forward< U >( v ) );
+    c->seq.store( pos + 1, std::memory_order_release );
+    wake( m_not_empty, 1 );
+    return true;
+  }
+
+  // false if empty
+  bool try_pop( T& out )
+  {
+    size_t pos = m_head.load( std::memory_order_relaxed );
+    cell*  c;
+    for ( ;; )
+    {
+      c = &m_cells[pos & m_mask];
+      const intptr_t diff
+          = intptr_t( c->seq.load( std::memory_order_acquire ) ) - intptr_t( pos + 1 );
+      if ( diff == 0 )
+      {
+        if ( m_head.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+        {
+          break;
+        }
+      }
+      else if ( diff < 0 )
+      {
+        return false;
+      }
+      else
+      {
+        pos = m_head.load( std::memory_order_relaxed );
+      }
+    }
+
+    take( *c, pos, out );
+    wake( m_not_full, 1 );
+    return true;
+  }
+
+  // up to count values moved from first onwards, as one run. returns how many.
+  template < class It >
+  size_t try_push_batch( It first, size_t count )
+  {
+    if ( m_closed.load( std::memory_order_relaxed ) || count == 0 )
+    {
+      return 0;
+    }
+
+    size_t pos;
+    size_t n;
+    if ( !claim( m_tail, 0, std::min( count, capacity() ), pos, n ) )
+    {
+      return 0;
+    }
+
+    for ( size_t ix = 0; ix < n; ++ix, ++first )
+    {
+      // the end of the run was free, so consumers have claimed everything
+      // before it and are at most finishing their copies
+      cell& c = m_cells[( pos + ix ) & m_mask];
+      spin_until( c, pos + ix );
+      new ( c.value() ) T( std::move( *first ) );
+      c.seq.store( pos + ix + 1, std::memory_order_release );
+    }
+    wake( m_not_empty, int( n ) );
+    return n;
+  }
+
+  // up to max values, moved to out as one run. returns how many.
+  template < class Out >
+  size_t try_pop_batch( Out out, size_t max )
+  {
+    return pop_run( out, max, nullptr );
+  }
+
+  // the same, and depth set to how many values the queue held when the run was
+  // claimed, the run included
+  template < class Out >
+  size_t try_pop_batch( Out out, size_t max, size_t& depth )
+  {
+    return pop_run( out, max, &depth );
+  }
+
+  // wait for room. false, with v untouched, once the queue is closed.
+  template < class U >
+  bool push( U&& v )
+  {
+    return await( m_not_full, [&] { return try_push( std::forward< U >( v ) ); } );
+  }
+
+  // wait for a value. false once the queue is closed and empty.
+  bool pop( T& out )
+  {
+    return await( m_not_empty, [&] { return try_pop( out ); } );
+  }
+
+  // push all count values, waiting for room as needed. fewer only if closed.
+  template < class It >
+  size_t push_batch( It first, size_t count )
+  {
+    size_t done = 0;
+    while ( done < count )
+    {
+      size_t n = 0;
+      if ( !await( m_not_full, [&] {
+             n = try_push_batch( first, count - done );
+             return n > 0;
+           } ) )
+      {
+        break;
+      }
+      std::advance( first, n );
+      done += n;
+    }
+    return done;
+  }
+
+  // wait for at least one value, take up to max. 0 once closed and empty.
+  template < class Out >
+  size_t pop_batch( Out out, size_t max )
+  {
+    size_t n = 0;
+    await( m_not_empty, [&] {
+      n = try_pop_batch( out, max );
+      return n > 0 || max == 0;
+    } );
+    return n;
+  }
+
+  // the same, with depth as try_pop_batch sets it for the run taken
+  template < class Out >
+  size_t pop_batch( Out out, size_t max, size_t& depth )
+  {
+    size_t n = 0;
+    await( m_not_empty, [&] {
+      n = try_pop_batch( out, max, depth );
+      return n > 0 || max == 0;
+    } );
+    return n;
+  }
+
+  // fail pushes from now on and wake everyone waiting. pushes racing close may
+  // or may not get in.
+  void close()
+  {
+    m_closed.store( true );
+    for ( parking* p : {&m_not_empty, &m_not_full} )
+    {
+      p->epoch.fetch_add( 1, std::memory_order_release );
+      detail::futex_wake_all( &p->epoch );
+    }
+  }
+
+  bool closed() const
+  {
+    return m_closed.load( std::memory_order_acquire );
+  }
+
+private:
+  struct cell
+  {
+    using storage_type = typename std::aligned_storage< sizeof( T ), alignof( T ) >::type;
+
+    std::atomic< size_t > seq;
+    storage_type          storage;
+
+    T* value()
+    {
+      return std::launder( reinterpret_cast< T* >( &storage ) );
+    }
+  };
+
+  // threads asleep waiting for one side, and the word they sleep on
+  struct alignas( 64 ) parking
+  {
+    std::atomic< uint32_t > epoch{0};
+    std::atomic< uint32_t > waiters{0};
+  };
+
+  static constexpr unsigned spin_limit = 16;
+
+  // try_pop_batch, reading the tail for depth only when asked to
+  template < class Out >
+  size_t pop_run( Out out, size_t max, size_t* depth )
+  {
+    if ( max == 0 )
+    {
+      return 0;
+    }
+
+    size_t pos;
+    size_t n;
+    if ( !claim( m_head, 1, std::min( max, capacity() ), pos, n ) )
+    {
+      return 0;
+    }
+    if ( depth )
+    {
+      // other consumers may free cells, and producers refill them, between the
+      // claim and this load
+      *depth = std::min( m_tail.load( std::memory_order_relaxed ) - pos, capacity() );
+    }
+
+    for ( size_t ix = 0; ix < n; ++ix, ++out )
+    {
+      // likewise producers have claimed everything up to the published end
+      cell& c = m_cells[( pos + ix ) & m_mask];
+      spin_until( c, pos + ix + 1 );
+      *out = std::move( *c.value() );
+      c.value()->~T();
+      c.seq.store( pos + ix + capacity(), std::memory_order_release );
+    }
+    wake( m_not_full, int( n ) );
+    return n;
+  }
+
+  // claim a run of up to want cells at cursor. a cell is ours when its sequence
+  // is its position plus ready (0 free for producers, 1 published for consumers).
+  bool claim( std::atomic< size_t >& cursor, size_t ready, size_t want, size_t& pos, size_t& n )
+  {
+    pos = cursor.load( std::memory_order_relaxed );
+    for ( ;; )
+    {
+      // a run is ours as soon as its last cell is: binary search for the longest,
+      // exact when nobody else is moving
+      n          = 0;
+      size_t top = want;
+      while ( n < top )
+      {
+        const size_t mid = ( n + top + 1 ) / 2;
+        if ( m_cells[( pos + mid - 1 ) & m_mask].seq.load( std::memory_order_acquire )
+             == pos + mid - 1 + ready )
+        {
+          n = mid;
+        }
+        else
+        {
+          top = mid - 1;
+        }
+      }
+
+      if ( n == 0 )
+      {
+        const intptr_t diff
+            = intptr_t( m_cells[pos & m_mask].seq.load( std::memory_order_acquire ) )
+              - intptr_t( pos + ready );
+        if ( diff < 0 )
+        {
+          return false; // full, or empty for consumers
+        }
+        pos = cursor.load( std::memory_order_relaxed );
+        continue;
+      }
+
+      if ( cursor.compare_exchange_weak( pos, pos + n, std::memory_order_relaxed ) )
+      {
+        return true;
+      }
+    }
+  }
+
+  void spin_until( cell& c, size_t seq )
+  {
+    while ( c.seq.load( std::memory_order_acquire ) != seq )
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  void take( cell& c, size_t pos, T& out )
+  {
+    out = std::move( *c.value() );
+    c.value()->~T();
+    c.seq.store( pos + capacity(), std::memory_order_release );
+  }
+
+  // after publishing: the fence orders our cell store before the waiter check,
+  // pairing with the fence in await()
+  void wake( parking& p, int count )
+  {
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if ( p.waiters.load( std::memory_order_relaxed ) > 0 )
+    {
+      p.epoch.fetch_add( 1, std::memory_order_release );
+      detail::futex_wake( &p.epoch, count );
+    }
+  }
+
+  template < class Attempt >
+  bool await( parking& p, Attempt&& attempt )
+  {
+    for ( unsigned spin = 0;; ++spin )
+    {
+      if ( attempt() )
+      {
+        return true;
+      }
+      if ( closed() )
+      {
+        return attempt(); // pops still drain
+      }
+      if ( spin < spin_limit )
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      // announce ourselves before the last look, so a publisher that misses
+      // our attempt sees us and bumps the epoch we are about to sleep on
+      p.waiters.fetch_add( 1, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      const uint32_t epoch = p.epoch.load( std::memory_order_acquire );
+
+      const bool got = attempt();
+      if ( !got && !closed() )
+      {
+        detail::futex_wait( &p.epoch, epoch );
+      }
+      p.waiters.fetch_sub( 1, std::memory_order_relaxed );
+      if ( got )
+      {
+        return true;
+      }
+    }
+  }
+
+  size_t                    m_mask;
+  std::unique_ptr< cell[] > m_cells;
+
+  alignas( 64 ) std::atomic< size_t > m_tail{0}; // producers
+  alignas( 64 ) std::atomic< size_t > m_head{0}; // consumers
+  alignas( 64 ) std::atomic< bool > m_closed{false};
+  parking m_not_empty;
+  parking m_not_full;
+}; // mpmc_queue
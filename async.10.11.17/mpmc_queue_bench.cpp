@@ -0,0 +1,246 @@
+// producer / consumer hand-off through mpmc_queue against the demo's old workq
+// pattern, a deque under one mutex with condition variables, bounded the same.
+// 1:1, N:1 and N:M, single items and batches of 32. every item carries its push
+// time, so the consumers also measure how long items sat in the queue.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "mpmc_queue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+constexpr size_t capacity = 1024;
+constexpr size_t batch    = 32;
+
+// the workq pattern with a bound, so a fast producer waits like it would on the ring
+template < class T >
+class locked_queue
+{
+public:
+  bool push( T v )
+  {
+    std::unique_lock< std::mutex > locker{m_lock};
+    m_not_full.wait( locker, [this] { return m_closed || m_queue.size() < capacity; } );
+    if ( m_closed )
+    {
+      return false;
+    }
+    m_queue.push_back( v );
+    locker.unlock();
+    m_not_empty.notify_one();
+    return true;
+  }
+
+  bool pop( T& out )
+  {
+    std::unique_lock< std::mutex > locker{m_lock};
+    m_not_empty.wait( locker, [this] { return m_closed || !m_queue.empty(); } );
+    if ( m_queue.empty() )
+    {
+      return false;
+    }
+    out = m_queue.front();
+    m_queue.pop_front();
+    locker.unlock();
+    m_not_full.notify_one();
+    return true;
+  }
+
+  void close()
+  {
+    {
+      std::lock_guard< std::mutex > locker{m_lock};
+      m_closed = true;
+    }
+    m_not_empty.notify_all();
+    m_not_full.notify_all();
+  }
+
+private:
+  std::mutex              m_lock;
+  std::condition_variable m_not_empty;
+  std::condition_variable m_not_full;
+  std::deque< T >         m_queue;
+  bool                    m_closed{false};
+};
+
+uint64_t now_ns()
+{
+  return std::chrono::duration_cast< std::chrono::nanoseconds >(
+             clock_type::now().time_since_epoch() )
+      .count();
+}
+
+struct ring_single
+{
+  mpmc_queue< uint64_t > q{capacity};
+
+  void produce( size_t count )
+  {
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      q.push( now_ns() );
+    }
+  }
+
+  template < class Sink >
+  void consume( Sink&& sink )
+  {
+    uint64_t v;
+    while ( q.pop( v ) )
+    {
+      sink( v );
+    }
+  }
+};
+
+struct ring_batch
+{
+  mpmc_queue< uint64_t > q{capacity};
+
+  void produce( size_t count )
+  {
+    uint64_t stamps[batch];
+    for ( size_t ix = 0; ix < count; ix += batch )
+    {
+      const size_t n = std::min( batch, count - ix );
+      std::fill( stamps, stamps + n, now_ns() );
+      q.push_batch( stamps, n );
+    }
+  }
+
+  template < class Sink >
+  void consume( Sink&& sink )
+  {
+    uint64_t stamps[batch];
+    while ( size_t n = q.pop_batch( stamps, batch ) )
+    {
+      std::for_each( stamps, stamps + n, sink );
+    }
+  }
+};
+
+struct locked
+{
+  locked_queue< uint64_t > q;
+
+  void produce( size_t count )
+  {
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      q.push( now_ns() );
+    }
+  }
+
+  template < class Sink >
+  void consume( Sink&& sink )
+  {
+    uint64_t v;
+    while ( q.pop( v ) )
+    {
+      sink( v );
+    }
+  }
+};
+
+template < class Queue >
+void run( const std::string& name, size_t producers, size_t consumers, size_t per_producer )
+{
+  Queue queue;
+
+  // one sample in 64 keeps the latency vectors small
+  std::vector< std::vector< uint64_t > > latencies( consumers );
+  std::vector< size_t >                  received( consumers );
+
+  auto start = clock_type::now();
+
+  std::vector< std::thread > sinks;
+  for ( size_t c = 0; c < consumers; ++c )
+  {
+    sinks.emplace_back( [&, c] {
+      size_t n = 0;
+      queue.consume( [&]( uint64_t stamp ) {
+        if ( n++ % 64 == 0 )
+        {
+          latencies[c].push_back( now_ns() - stamp );
+        }
+      } );
+      received[c] = n;
+    } );
+  }
+
+  std::vector< std::thread > sources;
+  for ( size_t p = 0; p < producers; ++p )
+  {
+    sources.emplace_back( [&] { queue.produce( per_producer ); } );
+  }
+  for ( auto& t : sources )
+  {
+    t.join();
+  }
+  queue.q.close();
+  for ( auto& t : sinks )
+  {
+    t.join();
+  }
+
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+
+  size_t                  total = 0;
+  std::vector< uint64_t > all;
+  for ( size_t c = 0; c < consumers; ++c )
+  {
+    total += received[c];
+    all.insert( all.end(), latencies[c].begin(), latencies[c].end() );
+  }
+  EXPECT_EQ( total, producers * per_producer );
+
+  std::sort( all.begin(), all.end() );
+  std::cout << name << " " << producers << ":" << consumers << " "
+            << total / elapsed.count() / 1e6 << "M items/s, in queue p50 "
+            << all[all.size() / 2] / 1000.0 << "us p99 " << all[all.size() * 99 / 100] / 1000.0
+            << "us" << std::endl;
+}
+
+template < class Queue >
+void run_mixes( const std::string& name )
+{
+  constexpr size_t items = 2000000;
+
+  run< Queue >( name, 1, 1, items );
+  run< Queue >( name, 4, 1, items / 4 );
+  run< Queue >( name, 4, 4, items / 4 );
+}
+} // namespace
+
+TEST( MpmcQueueBench, MutexDeque )
+{
+  run_mixes< locked >( "mutex+deque" );
+}
+
+TEST( MpmcQueueBench, Ring )
+{
+  run_mixes< ring_single >( "mpmc_queue" );
+}
+
+TEST( MpmcQueueBench, RingBatches )
+{
+  run_mixes< ring_batch >( "mpmc_queue batch=32" );
+}
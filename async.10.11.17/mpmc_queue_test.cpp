@@ -0,0 +1,205 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "mpmc_queue.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+TEST( MpmcQueue, FifoFullAndEmpty )
+{
+  mpmc_queue< int > q( 5 );
+  EXPECT_EQ( q.capacity(), 8u );
+
+  int out = -1;
+  EXPECT_FALSE( q.try_pop( out ) );
+
+  // several laps round the ring
+  for ( int lap = 0; lap < 3; ++lap )
+  {
+    for ( int ix = 0; ix < 8; ++ix )
+    {
+      EXPECT_TRUE( q.try_push( lap * 8 + ix ) );
+    }
+    EXPECT_FALSE( q.try_push( 99 ) );
+    EXPECT_EQ( q.size(), 8u );
+
+    for ( int ix = 0; ix < 8; ++ix )
+    {
+      ASSERT_TRUE( q.try_pop( out ) );
+      EXPECT_EQ( out, lap * 8 + ix );
+    }
+    EXPECT_FALSE( q.try_pop( out ) );
+    EXPECT_EQ( q.size(), 0u );
+  }
+}
+
+TEST( MpmcQueue, MoveOnlyAndLeftoversDestroyed )
+{
+  auto tracker = std::make_shared< int >( 0 );
+  {
+    mpmc_queue< std::shared_ptr< int > > q( 4 );
+    q.push( tracker );
+    q.push( tracker );
+    q.push( tracker );
+
+    std::shared_ptr< int > out;
+    ASSERT_TRUE( q.pop( out ) );
+    EXPECT_EQ( tracker.use_count(), 4 ); // ours, out and two queued
+  } // the queued two destroyed with the queue
+  EXPECT_EQ( tracker.use_count(), 1 );
+
+  mpmc_queue< std::unique_ptr< std::string > > q( 2 );
+  auto                                         hello = std::make_unique< std::string >( "hi" );
+  EXPECT_TRUE( q.try_push( std::move( hello ) ) );
+  EXPECT_TRUE( q.try_push( std::make_unique< std::string >( "there" ) ) );
+
+  // a failed push leaves the value where it was
+  auto extra = std::make_unique< std::string >( "extra" );
+  EXPECT_FALSE( q.try_push( std::move( extra ) ) );
+  ASSERT_TRUE( extra );
+
+  std::unique_ptr< std::string > out;
+  ASSERT_TRUE( q.try_pop( out ) );
+  EXPECT_EQ( *out, "hi" );
+}
+
+TEST( MpmcQueue, Batches )
+{
+  mpmc_queue< int > q( 16 );
+
+  std::vector< int > in( 40 );
+  std::iota( in.begin(), in.end(), 0 );
+
+  // more than fits: takes what there is room for
+  EXPECT_EQ( q.try_push_batch( in.begin(), in.size() ), 16u );
+  EXPECT_EQ( q.try_push_batch( in.begin(), 1 ), 0u );
+
+  // depth: what the queue held as the run was taken, the run included
+  std::vector< int > out;
+  size_t             depth = 0;
+  EXPECT_EQ( q.try_pop_batch( std::back_inserter( out ), 5, depth ), 5u );
+  EXPECT_EQ( depth, 16u );
+  EXPECT_EQ( q.try_push_batch( in.begin() + 16, 3 ), 3u );
+  EXPECT_EQ( q.pop_batch( std::back_inserter( out ), 100, depth ), 14u );
+  EXPECT_EQ( depth, 14u );
+  EXPECT_EQ( q.try_pop_batch( std::back_inserter( out ), 100 ), 0u );
+
+  std::vector< int > expected( in.begin(), in.begin() + 19 );
+  EXPECT_EQ( out, expected );
+}
+
+TEST( MpmcQueue, CloseDrainsThenFails )
+{
+  mpmc_queue< int > q( 4 );
+  q.push( 1 );
+  q.push( 2 );
+  q.close();
+
+  EXPECT_TRUE( q.closed() );
+  EXPECT_FALSE( q.push( 3 ) );
+  EXPECT_FALSE( q.try_push( 3 ) );
+
+  int out = 0;
+  EXPECT_TRUE( q.pop( out ) );
+  EXPECT_EQ( out, 1 );
+  std::vector< int > rest;
+  EXPECT_EQ( q.pop_batch( std::back_inserter( rest ), 8 ), 1u );
+  EXPECT_FALSE( q.pop( out ) );
+  EXPECT_EQ( q.pop_batch( std::back_inserter( rest ), 8 ), 0u );
+
+  // close wakes a consumer already asleep
+  mpmc_queue< int > idle( 4 );
+  std::thread       consumer( [&] { EXPECT_FALSE( idle.pop( out ) ); } );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+  idle.close();
+  consumer.join();
+}
+
+// producers and consumers in every mix, through a queue much smaller than the
+// traffic so both sides park. every value arrives exactly once.
+TEST( MpmcQueue, ManyProducersManyConsumers )
+{
+  constexpr uint64_t per_producer = 20000;
+
+  for ( auto mix : {std::make_pair( 1, 1 ), std::make_pair( 4, 1 ), std::make_pair( 1, 4 ),
+                    std::make_pair( 4, 4 )} )
+  {
+    const int producers = mix.first;
+    const int consumers = mix.second;
+
+    mpmc_queue< uint64_t >  q( 64 );
+    std::atomic< uint64_t > sum{0};
+    std::atomic< uint64_t > count{0};
+
+    std::vector< std::thread > threads;
+    for ( int c = 0; c < consumers; ++c )
+    {
+      // half the consumers take batches
+      threads.emplace_back( [&, c] {
+        uint64_t local_sum = 0, local_count = 0;
+        if ( c % 2 )
+        {
+          std::vector< uint64_t > got;
+          while ( q.pop_batch( std::back_inserter( got ), 16 ) )
+          {
+          }
+          local_sum   = std::accumulate( got.begin(), got.end(), uint64_t( 0 ) );
+          local_count = got.size();
+        }
+        else
+        {
+          uint64_t v;
+          while ( q.pop( v ) )
+          {
+            local_sum += v;
+            ++local_count;
+          }
+        }
+        sum.fetch_add( local_sum );
+        count.fetch_add( local_count );
+      } );
+    }
+
+    std::vector< std::thread > pushers;
+    for ( int p = 0; p < producers; ++p )
+    {
+      pushers.emplace_back( [&, p] {
+        std::vector< uint64_t > values( per_producer );
+        std::iota( values.begin(), values.end(), p * per_producer + 1 );
+        if ( p % 2 )
+        {
+          EXPECT_EQ( q.push_batch( values.begin(), values.size() ), values.size() );
+        }
+        else
+        {
+          for ( uint64_t v : values )
+          {
+            EXPECT_TRUE( q.push( v ) );
+          }
+        }
+      } );
+    }
+    for ( auto& t : pushers )
+    {
+      t.join();
+    }
+    q.close();
+    for ( auto& t : threads )
+    {
+      t.join();
+    }
+
+    const uint64_t n = producers * per_producer;
+    EXPECT_EQ( count.load(), n ) << producers << ":" << consumers;
+    EXPECT_EQ( sum.load(), n * ( n + 1 ) / 2 ) << producers << ":" << consumers;
+  }
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+// data parallel loops over an index range on a thread_pool. the caller takes part
+// and returns once every index has been visited, so the loop body may capture
+// locals by reference. the range is handed out in chunks of at least grain
+// indices, the chunking picks how:
+//
+//   fixed    one contiguous part per participant, part k posted to worker k so
+//            repeated loops over the same data find it in the same cache. a part
+//            nobody has started yet is picked up by whoever finishes first.
+//   dynamic  grain sized chunks from a shared cursor, for uneven costs.
+//   guided   chunks shrinking with what is left, down to grain: few grabs while
+//            the range is large, fine balancing at the end.
+//
+//   parallel_for( pool, 0, n, 1024, []( size_t first, size_t last ) { ... } );
+//   auto sum = parallel_reduce( pool, 0, n, 1024, 0.0,
+//                               []( size_t first, size_t last, double acc ) { ... },
+//                               std::plus<>{} );
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "future.hpp"
+#include "thread_pool.hpp"
+
+enum class chunking
+{
+  fixed,
+  dynamic,
+  guided
+};
+
+namespace detail
+{
+// one loop's shared state. helpers hold it by shared_ptr: one that starts after
+// the work is gone finds nothing to claim and never touches the body, which
+// lives on the caller's stack.
+class parallel_loop
+{
+public:
+  parallel_loop( thread_pool& pool, size_t count, size_t grain, chunking policy )
+      : m_count( count )
+      , m_policy( policy )
+  {
+    const size_t self  = pool.worker_index();
+    size_t       total = pool.size() + ( self == pool.size() ? 1 : 0 );
+
+    // grain 0 picks one giving each participant about eight chunks
+    m_grain        = grain ? grain : std::max< size_t >( 1, count / ( 8 * total ) );
+    m_chunks       = ( count + m_grain - 1 ) / m_grain;
+    m_participants = std::max< size_t >( 1, std::min( total, m_chunks ) );
+    m_self         = std::min( self, m_participants - 1 );
+
+    if ( m_policy == chunking::fixed )
+    {
+      m_claimed.reset( new std::atomic< bool >[m_participants] );
+      for ( size_t ix = 0; ix < m_participants; ++ix )
+      {
+        m_claimed[ix].store( false, std::memory_order_relaxed );
+      }
+    }
+    m_remaining.store( count, std::memory_order_relaxed );
+  }
+
+  size_t participants() const
+  {
+    return m_participants;
+  }
+
+  // the caller's participant number, the rest are posted to the worker of the same
+  // number
+  size_t self() const
+  {
+    return m_self;
+  }
+
+  // fixed chunking reduces per part, whoever ran it, the others per participant
+  size_t slots() const
+  {
+    return m_participants;
+  }
+
+  template < class Body >
+  void bind( Body& body )
+  {
+    m_body = &body;
+    m_call = []( void* b, size_t slot, size_t first, size_t last ) {
+      ( *static_cast< Body* >( b ) )( slot, first, last );
+    };
+  }
+
+  // everything participant can claim, once per participant
+  void run( size_t participant )
+  {
+    if ( m_policy == chunking::fixed )
+    {
+      for ( size_t ix = 0; ix < m_participants; ++ix )
+      {
+        const size_t part = ( participant + ix ) % m_participants;
+        if ( !m_claimed[part].load( std::memory_order_relaxed )
+             && !m_claimed[part].exchange( true, std::memory_order_acquire ) )
+        {
+          execute( part, bound( part ), bound( part + 1 ) );
+        }
+      }
+      return;
+    }
+
+    size_t first;
+    size_t last;
+    while ( claim( first, last ) )
+    {
+      execute( participant, first, last );
+    }
+  }
+
+  future< void > get_future()
+  {
+    return m_done.get_future();
+  }
+
+private:
+  size_t bound( size_t part ) const
+  {
+    return std::min( m_count, part * m_chunks / m_participants * m_grain );
+  }
+
+  bool claim( size_t& first, size_t& last )
+  {
+    if ( m_policy == chunking::dynamic )
+    {
+      first = m_next.fetch_add( m_grain, std::memory_order_relaxed );
+      if ( first >= m_count )
+      {
+        return false;
+      }
+      last = std::min( m_count, first + m_grain );
+      return true;
+    }
+
+    first = m_next.load( std::memory_order_relaxed );
+    do
+    {
+      if ( first >= m_count )
+      {
+        return false;
+      }
+      // whole grains, so only the final chunk can come up short
+      const size_t left   = m_count - first;
+      const size_t grains = std::max< size_t >( 1, left / ( 2 * m_participants * m_grain ) );
+      last                = first + std::min( left, grains * m_grain );
+    } while ( !m_next.compare_exchange_weak( first, last, std::memory_order_relaxed ) );
+    return true;
+  }
+
+  void execute( size_t slot, size_t first, size_t last )
+  {
+    if ( first == last )
+    {
+      return;
+    }
+
+    // after a throw the remaining chunks are only counted off
+    if ( !m_failed.load( std::memory_order_relaxed ) )
+    {
+      try
+      {
+        m_call( m_body, slot, first, last );
+      }
+      catch ( ... )
+      {
+        std::lock_guard< std::mutex > locker{m_error_lock};
+        if ( !m_error )
+        {
+          m_error = std::current_exception();
+        }
+        m_failed.store( true, std::memory_order_relaxed );
+      }
+    }
+
+    const size_t done = last - first;
+    if ( m_remaining.fetch_sub( done, std::memory_order_acq_rel ) == done )
+    {
+      if ( m_error )
+      {
+        m_done.set_exception( m_error );
+      }
+      else
+      {
+        m_done.set_value();
+      }
+    }
+  }
+
+  size_t   m_count;
+  size_t   m_grain{1};
+  size_t   m_chunks{0};
+  size_t   m_participants{1};
+  size_t   m_self{0};
+  chunking m_policy;
+
+  void* m_body{nullptr};
+  void ( *m_call )( void*, size_t, size_t, size_t ){nullptr};
+
+  std::unique_ptr< std::atomic< bool >[] > m_claimed; // fixed parts taken
+  alignas( 64 ) std::atomic< size_t > m_next{0};      // dynamic and guided cursor
+  alignas( 64 ) std::atomic< size_t > m_remaining;    // indices not yet done
+  std::atomic< bool > m_failed{false};
+  std::mutex          m_error_lock;
+  std::exception_ptr  m_error;
+  promise< void >     m_done;
+};
+
+// post the helpers, take part, wait for the stragglers
+template < class Body >
+void parallel_run( thread_pool& pool, const std::shared_ptr< parallel_loop >& loop, Body& body )
+{
+  loop->bind( body );
+  auto done = loop->get_future();
+
+  for ( size_t ix = 0; ix < loop->participants(); ++ix )
+  {
+    if ( ix == loop->self() )
+    {
+      continue;
+    }
+    try
+    {
+      pool.post_to( ix, [loop, ix] { loop->run( ix ); } );
+    }
+    catch ( ... )
+    {
+      // a pool that will not take helpers leaves more for the caller
+      break;
+    }
+  }
+
+  loop->run( loop->self() );
+  done.get();
+}
+
+template < class T >
+struct alignas( 64 ) reduce_slot
+{
+  T value;
+};
+} // namespace detail
+
+// fn( first, last ) over chunks covering [first, last), concurrently. rethrows the
+// first exception a chunk threw, chunks not yet started when it did are skipped.
+template < class F >
+void parallel_for( thread_pool& pool, size_t first, size_t last, size_t grain, F&& fn,
+                   chunking policy = chunking::guided )
+{
+  if ( last <= first )
+  {
+    return;
+  }
+
+  auto loop = std::make_shared< detail::parallel_loop >( pool, last - first, grain, policy );
+  auto body = [&fn, first]( size_t, size_t lo, size_t hi ) { fn( first + lo, first + hi ); };
+  detail::parallel_run( pool, loop, body );
+}
+
+// fold [first, last) with reduce( first, last, acc ) -> acc per chunk, starting
+// every participant from identity, then join the partials with combine. combine
+// must be associative; with fixed chunking partials are joined in index order,
+// otherwise it must be commutative as well.
+template < class T, class Reduce, class Combine >
+T parallel_reduce( thread_pool& pool, size_t first, size_t last, size_t grain, T identity,
+                   Reduce&& reduce, Combine&& combine, chunking policy = chunking::guided )
+{
+  if ( last <= first )
+  {
+    return identity;
+  }
+
+  auto loop = std::make_shared< detail::parallel_loop >( pool, last - first, grain, policy );
+
+  std::vector< detail::reduce_slot< T > > partials( loop->slots(),
+                                                    detail::reduce_slot< T >{identity} );
+  auto body = [&]( size_t slot, size_t lo, size_t hi ) {
+    partials[slot].value = reduce( first + lo, first + hi, std::move( partials[slot].value ) );
+  };
+  detail::parallel_run( pool, loop, body );
+
+  T result = std::move( identity );
+  for ( auto& partial : partials )
+  {
+    result = combine( std::move( result ), std::move( partial.value ) );
+  }
+  return result;
+}
@@ -0,0 +1,145 @@
+// parallel_for's three chunkings against the FanOut example's hand rolled split
+// (one equal segment per thread, a future each), with every element costing the
+// same and with the cost piled onto the last tenth of the range. 1 worker up to
+// one per cpu; parallel_reduce summing the same work at the end.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "bench.hpp"
+#include "parallel.hpp"
+#include "thread_pool.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using bench::clock_type;
+using bench::thread_counts;
+
+uint64_t mix( uint64_t x )
+{
+  x += 0x9e3779b97f4a7c15ull;
+  x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+  x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebull;
+  return x ^ ( x >> 31 );
+}
+
+// rounds of mixing per element: flat, or 1 everywhere but 64 in the last tenth
+struct cost_model
+{
+  const char* name;
+  size_t      count;
+  bool        skewed;
+
+  uint64_t element( size_t ix ) const
+  {
+    size_t   rounds = skewed && ix >= count - count / 10 ? 64 : 1;
+    uint64_t x      = ix;
+    for ( size_t r = 0; r < rounds; ++r )
+    {
+      x = mix( x );
+    }
+    return x;
+  }
+};
+
+void report( const std::string& name, const cost_model& cost, size_t threads,
+             clock_type::time_point start )
+{
+  bench::report( cost.name + ( " " + name ), threads, double( cost.count ), "elements", start );
+}
+
+// the example's split: equal segments, the remainder on the last one
+void hand_rolled( thread_pool& pool, std::vector< uint64_t >& out, const cost_model& cost )
+{
+  const size_t                       threads      = pool.size();
+  const size_t                       segment_size = out.size() / threads;
+  std::vector< std::future< void > > futs;
+  for ( size_t cpu_index = 0; cpu_index < threads; ++cpu_index )
+  {
+    const size_t segment_begin = cpu_index * segment_size;
+    const size_t segment_end
+        = cpu_index + 1 == threads ? out.size() : segment_begin + segment_size;
+
+    futs.push_back( pool.submit( [&, segment_begin, segment_end] {
+      for ( size_t ix = segment_begin; ix < segment_end; ++ix )
+      {
+        out[ix] = cost.element( ix );
+      }
+    } ) );
+  }
+  for ( auto& f : futs )
+  {
+    f.get();
+  }
+}
+
+void run_all( const cost_model& cost )
+{
+  std::vector< uint64_t > out( cost.count );
+
+  const std::pair< const char*, chunking > policies[]
+      = {{"parallel_for fixed", chunking::fixed},
+         {"parallel_for dynamic", chunking::dynamic},
+         {"parallel_for guided", chunking::guided}};
+
+  for ( size_t threads : thread_counts() )
+  {
+    thread_pool pool( threads );
+
+    auto start = clock_type::now();
+    hand_rolled( pool, out, cost );
+    report( "hand rolled", cost, threads, start );
+    const uint64_t check = out[out.size() - 1];
+
+    for ( auto& policy : policies )
+    {
+      out.back() = 0;
+      start      = clock_type::now();
+      parallel_for( pool, 0, out.size(), 4096,
+                    [&]( size_t first, size_t last ) {
+                      for ( size_t ix = first; ix < last; ++ix )
+                      {
+                        out[ix] = cost.element( ix );
+                      }
+                    },
+                    policy.second );
+      report( policy.first, cost, threads, start );
+      EXPECT_EQ( out.back(), check );
+    }
+
+    start    = clock_type::now();
+    auto sum = parallel_reduce( pool, 0, out.size(), 4096, uint64_t( 0 ),
+                                [&]( size_t first, size_t last, uint64_t acc ) {
+                                  for ( size_t ix = first; ix < last; ++ix )
+                                  {
+                                    acc += cost.element( ix );
+                                  }
+                                  return acc;
+                                },
+                                std::plus<>{} );
+    report( "parallel_reduce guided", cost, threads, start );
+    EXPECT_NE( sum, 0u );
+  }
+}
+} // namespace
+
+TEST( ParallelBench, UniformCost )
+{
+  run_all( cost_model{"uniform", 16 * 1024 * 1024, false} );
+}
+
+TEST( ParallelBench, SkewedCost )
+{
+  run_all( cost_model{"skewed", 4 * 1024 * 1024, true} );
+}
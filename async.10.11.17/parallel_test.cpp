@@ -0,0 +1,199 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "parallel.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+const chunking all_policies[] = {chunking::fixed, chunking::dynamic, chunking::guided};
+} // namespace
+
+TEST( ParallelFor, EveryIndexVisitedOnce )
+{
+  thread_pool pool( 4 );
+
+  for ( chunking policy : all_policies )
+  {
+    for ( size_t grain : {0u, 1u, 7u, 1000u, 100000u} )
+    {
+      // an offset range whose size is not a multiple of anything
+      std::vector< std::atomic< int > > hits( 10007 );
+      parallel_for( pool, 100, 100 + hits.size(), grain,
+                    [&]( size_t first, size_t last ) {
+                      ASSERT_LT( first, last );
+                      ASSERT_GE( first, 100u );
+                      for ( size_t ix = first; ix < last; ++ix )
+                      {
+                        hits[ix - 100].fetch_add( 1 );
+                      }
+                    },
+                    policy );
+
+      for ( auto& h : hits )
+      {
+        ASSERT_EQ( h.load(), 1 ) << "policy " << int( policy ) << " grain " << grain;
+      }
+    }
+  }
+
+  // nothing to do, no call
+  parallel_for( pool, 5, 5, 1, []( size_t, size_t ) { FAIL(); } );
+}
+
+TEST( ParallelFor, ChunksRespectGrain )
+{
+  thread_pool pool( 3 );
+
+  for ( chunking policy : all_policies )
+  {
+    std::atomic< size_t > small{0};
+    parallel_for( pool, 0, 64 * 1000, 1000,
+                  [&]( size_t first, size_t last ) {
+                    if ( last - first < 1000 )
+                    {
+                      small.fetch_add( 1 );
+                    }
+                  },
+                  policy );
+    // the range is a whole number of grains, only fixed parts may straddle
+    EXPECT_EQ( small.load(), 0u ) << int( policy );
+  }
+}
+
+TEST( ParallelFor, FixedPartsStayOnTheirWorker )
+{
+  thread_pool pool( 4 );
+
+  // called from a worker, the caller is one of four participants. every part
+  // waits for the other three to start, so none can be taken over and each must
+  // run on the worker of its own number.
+  pool.submit( [&] {
+        for ( int round = 0; round < 20; ++round )
+        {
+          std::vector< size_t > seen( 4, pool.size() );
+          std::atomic< size_t > started{0};
+          parallel_for( pool, 0, 4, 1,
+                        [&]( size_t first, size_t ) {
+                          started.fetch_add( 1 );
+                          while ( started.load() < 4 )
+                          {
+                            std::this_thread::yield();
+                          }
+                          seen[first] = pool.worker_index();
+                        },
+                        chunking::fixed );
+
+          EXPECT_EQ( seen, ( std::vector< size_t >{0, 1, 2, 3} ) );
+        }
+      } )
+      .get();
+}
+
+TEST( ParallelFor, NestedLoopsFinish )
+{
+  thread_pool           pool( 2 );
+  std::atomic< size_t > total{0};
+
+  for ( chunking policy : all_policies )
+  {
+    parallel_for( pool, 0, 16, 1,
+                  [&]( size_t first, size_t last ) {
+                    for ( size_t ix = first; ix < last; ++ix )
+                    {
+                      parallel_for( pool, 0, 1000, 10,
+                                    [&]( size_t lo, size_t hi ) { total.fetch_add( hi - lo ); },
+                                    policy );
+                    }
+                  },
+                  policy );
+  }
+  EXPECT_EQ( total.load(), 3u * 16 * 1000 );
+}
+
+TEST( ParallelFor, ExceptionReachesCaller )
+{
+  thread_pool pool( 2 );
+
+  for ( chunking policy : all_policies )
+  {
+    auto throwing = [&] {
+      parallel_for( pool, 0, 1000, 10,
+                    []( size_t first, size_t last ) {
+                      if ( first <= 500 && 500 < last )
+                      {
+                        throw std::runtime_error( "chunk failed" );
+                      }
+                    },
+                    policy );
+    };
+    EXPECT_THROW( throwing(), std::runtime_error );
+  }
+
+  // a stopped pool just means the caller does it all
+  pool.shutdown();
+  std::atomic< size_t > visited{0};
+  parallel_for( pool, 0, 1000, 10,
+                [&]( size_t first, size_t last ) { visited.fetch_add( last - first ); } );
+  EXPECT_EQ( visited.load(), 1000u );
+}
+
+TEST( ParallelReduce, SumsMatch )
+{
+  thread_pool pool( 4 );
+
+  const uint64_t n        = 1000003;
+  const uint64_t expected = n * ( n - 1 ) / 2;
+
+  for ( chunking policy : all_policies )
+  {
+    for ( size_t grain : {0u, 1u, 4096u} )
+    {
+      auto sum = parallel_reduce( pool, 0, n, grain, uint64_t( 0 ),
+                                  []( size_t first, size_t last, uint64_t acc ) {
+                                    for ( size_t ix = first; ix < last; ++ix )
+                                    {
+                                      acc += ix;
+                                    }
+                                    return acc;
+                                  },
+                                  std::plus<>{}, policy );
+      EXPECT_EQ( sum, expected ) << int( policy ) << " " << grain;
+    }
+  }
+
+  // an empty range is just the identity
+  auto keep = []( size_t, size_t, int acc ) { return acc; };
+  EXPECT_EQ( parallel_reduce( pool, 3, 3, 1, 42, keep, std::plus<>{} ), 42 );
+}
+
+TEST( ParallelReduce, FixedJoinsInIndexOrder )
+{
+  thread_pool pool( 4 );
+
+  // concatenation is associative but not commutative
+  auto digits = parallel_reduce( pool, 0, 10, 1, std::vector< size_t >{},
+                                 []( size_t first, size_t last, std::vector< size_t > acc ) {
+                                   for ( size_t ix = first; ix < last; ++ix )
+                                   {
+                                     acc.push_back( ix );
+                                   }
+                                   return acc;
+                                 },
+                                 []( std::vector< size_t > a, std::vector< size_t > b ) {
+                                   a.insert( a.end(), b.begin(), b.end() );
+                                   return a;
+                                 },
+                                 chunking::fixed );
+
+  EXPECT_EQ( digits, ( std::vector< size_t >{0, 1, 2, 3, 4, 5, 6, 7, 8, 9} ) );
+}
@@ -0,0 +1,570 @@
+#pragma once
+
+// staged producer / consumer pipelines. every stage runs on its own threads, as
+// many as its degree of parallelism, and hands its output to the next stage
+// through a bounded mpmc_queue. items travel in batches: a stage takes up to
+// batch items at once and its emitter pushes them on a batch at a time, so the
+// queues are touched once per batch rather than once per item. a full queue
+// blocks the stage feeding it, which is the backpressure: a slow stage throttles
+// everything upstream instead of letting memory grow.
+//
+//   pipeline p;
+//   auto& blocks  = p.source< block_ptr >( "generate", 2, []( auto& emit ) { ...; return more; } );
+//   auto& digests = p.stage< digest >( "hash", blocks, 4, []( block_ptr& b, auto& emit ) { ... } );
+//   p.sink( "store", digests, 1, []( digest& d ) { ... } );
+//   p.run();
+//   p.report( std::cout );
+//
+// when a source returns false its workers are done; once all of a stage's
+// workers are done its output queue is closed, and the stages below drain it
+// and finish in turn.
+//
+// run( token ) or start( token ) tie the pipeline to a stop_token, cancel() stops
+// it by hand. a stop ends the run early: sources are not called again, every
+// queue is closed so nobody stays blocked on one, and stages drop what they take
+// off their input from then on instead of processing it.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mpmc_queue.hpp"
+#include "stop_token.hpp"
+
+struct stage_stats
+{
+  std::string name;
+  size_t      workers{0};
+  uint64_t    items_in{0};
+  uint64_t    items_out{0};
+  double      seconds{0};         // first worker start to last worker finish
+  double      busy_seconds{0};    // inside the stage function, summed over workers
+  double      starved_seconds{0}; // waiting for input
+  double      blocked_seconds{0}; // waiting for room downstream, the backpressure
+  double      queue_mean{0};      // input queue occupancy seen at each take
+  size_t      queue_max{0};
+  size_t      queue_capacity{0};
+
+  // what the stage handled per second, out for sources and in for the rest
+  double items_per_second() const
+  {
+    return seconds > 0 ? ( queue_capacity ? items_in : items_out ) / seconds : 0;
+  }
+
+  friend std::ostream& operator<<( std::ostream& os, const stage_stats& s )
+  {
+    os << std::left << std::setw( 12 ) << s.name << std::right << " x" << s.workers << " "
+       << std::setw( 10 ) << s.items_in << " in " << std::setw( 10 ) << s.items_out << " out "
+       << std::fixed << std::setprecision( 1 ) << std::setw( 10 ) << s.items_per_second() / 1e3
+       << "K/s  busy " << std::setw( 7 ) << s.busy_seconds * 1e3 << "ms starved " << std::setw( 7 )
+       << s.starved_seconds * 1e3 << "ms blocked " << std::setw( 7 ) << s.blocked_seconds * 1e3
+       << "ms";
+    if ( s.queue_capacity )
+    {
+      os << "  queue mean " << s.queue_mean << " max " << s.queue_max << "/" << s.queue_capacity;
+    }
+    return os << std::defaultfloat;
+  }
+};
+
+namespace detail
+{
+using pipeline_clock = std::chrono::steady_clock;
+
+inline uint64_t elapsed_ns( pipeline_clock::time_point since )
+{
+  return std::chrono::duration_cast< std::chrono::nanoseconds >( pipeline_clock::now() - since )
+      .count();
+}
+
+// what a stage function hands its output to. buffers a batch, then pushes it
+// downstream in one go, blocking while the queue is full.
+template < class Out >
+class stage_emitter
+{
+public:
+  stage_emitter( mpmc_queue< Out >& out, size_t batch )
+      : m_out( out )
+      , m_batch( batch )
+  {
+    m_buffer.reserve( batch );
+  }
+
+  template < class U >
+  void operator()( U&& v )
+  {
+    m_buffer.emplace_back( std::forward< U >( v ) );
+    if ( m_buffer.size() >= m_batch )
+    {
+      flush();
+    }
+  }
+
+  void flush()
+  {
+    if ( m_buffer.empty() )
+    {
+      return;
+    }
+    auto start = pipeline_clock::now();
+    m_emitted += m_out.push_batch( m_buffer.begin(), m_buffer.size() );
+    m_blocked_ns += elapsed_ns( start );
+    m_buffer.clear();
+  }
+
+  uint64_t emitted() const
+  {
+    return m_emitted;
+  }
+
+  uint64_t blocked_ns() const
+  {
+    return m_blocked_ns;
+  }
+
+private:
+  mpmc_queue< Out >& m_out;
+  size_t             m_batch;
+  std::vector< Out > m_buffer;
+  uint64_t           m_emitted{0};
+  uint64_t           m_blocked_ns{0};
+};
+
+class pipeline_stage
+{
+public:
+  pipeline_stage( std::string name, size_t workers, size_t capacity )
+      : m_name( std::move( name ) )
+      , m_workers( std::max< size_t >( 1, workers ) )
+      , m_capacity( capacity )
+  {
+  }
+
+  virtual ~pipeline_stage() = default;
+
+  void start( stop_token stop )
+  {
+    m_stop  = std::move( stop );
+    m_start = pipeline_clock::now();
+    m_running.store( m_workers );
+    for ( size_t ix = 0; ix < m_workers; ++ix )
+    {
+      m_threads.emplace_back( [this] {
+        work();
+        if ( m_running.fetch_sub( 1 ) == 1 )
+        {
+          m_finish_ns.store( elapsed_ns( m_start ) );
+          close_output();
+        }
+      } );
+    }
+  }
+
+  // ends the stream below this stage early, on cancellation
+  void close()
+  {
+    close_output();
+  }
+
+  void join()
+  {
+    for ( auto& t : m_threads )
+    {
+      t.join();
+    }
+    m_threads.clear();
+  }
+
+  // live while running, final once joined
+  stage_stats stats() const
+  {
+    stage_stats s;
+    s.name            = m_name;
+    s.workers         = m_workers;
+    s.items_in        = m_items_in.load( std::memory_order_relaxed );
+    s.items_out       = m_items_out.load( std::memory_order_relaxed );
+    s.busy_seconds    = m_busy_ns.load( std::memory_order_relaxed ) / 1e9;
+    s.starved_seconds = m_starved_ns.load( std::memory_order_relaxed ) / 1e9;
+    s.blocked_seconds = m_blocked_ns.load( std::memory_order_relaxed ) / 1e9;
+    s.queue_capacity  = m_capacity;
+    s.queue_max       = m_queue_max.load( std::memory_order_relaxed );
+
+    const uint64_t samples = m_queue_samples.load( std::memory_order_relaxed );
+    s.queue_mean = samples ? double( m_queue_sum.load( std::memory_order_relaxed ) ) / samples : 0;
+
+    const uint64_t finish = m_finish_ns.load();
+    s.seconds             = ( finish ? finish : elapsed_ns( m_start ) ) / 1e9;
+    return s;
+  }
+
+protected:
+  // one worker's whole run
+  virtual void work() = 0;
+
+  // after the last worker, so the next stage sees the end of the stream
+  virtual void close_output() = 0;
+
+  bool stopping() const
+  {
+    return m_stop.stop_requested();
+  }
+
+  // a worker's counters, folded in once per batch
+  void account( uint64_t in, uint64_t out, uint64_t busy, uint64_t starved, uint64_t blocked )
+  {
+    m_items_in.fetch_add( in, std::memory_order_relaxed );
+    m_items_out.fetch_add( out, std::memory_order_relaxed );
+    m_busy_ns.fetch_add( busy, std::memory_order_relaxed );
+    m_starved_ns.fetch_add( starved, std::memory_order_relaxed );
+    m_blocked_ns.fetch_add( blocked, std::memory_order_relaxed );
+  }
+
+  void sample_queue( size_t occupancy )
+  {
+    m_queue_sum.fetch_add( occupancy, std::memory_order_relaxed );
+    m_queue_samples.fetch_add( 1, std::memory_order_relaxed );
+
+    size_t seen = m_queue_max.load( std::memory_order_relaxed );
+    while ( occupancy > seen
+            && !m_queue_max.compare_exchange_weak( seen, occupancy, std::memory_order_relaxed ) )
+    {
+    }
+  }
+
+private:
+  std::string                m_name;
+  size_t                     m_workers;
+  size_t                     m_capacity; // of the input queue, 0 for sources
+  std::vector< std::thread > m_threads;
+  std::atomic< size_t >      m_running{0};
+  stop_token                 m_stop;
+
+  pipeline_clock::time_point m_start;
+  std::atomic< uint64_t >    m_finish_ns{0};
+
+  std::atomic< uint64_t > m_items_in{0};
+  std::atomic< uint64_t > m_items_out{0};
+  std::atomic< uint64_t > m_busy_ns{0};
+  std::atomic< uint64_t > m_starved_ns{0};
+  std::atomic< uint64_t > m_blocked_ns{0};
+  std::atomic< uint64_t > m_queue_sum{0};
+  std::atomic< uint64_t > m_queue_samples{0};
+  std::atomic< size_t >   m_queue_max{0};
+};
+
+// bool fn( emit ), called until it returns false
+template < class Out, class F >
+class source_stage : public pipeline_stage
+{
+public:
+  source_stage( std::string name, size_t workers, size_t batch, mpmc_queue< Out >& out, F fn )
+      : pipeline_stage( std::move( name ), workers, 0 )
+      , m_batch( batch )
+      , m_out( out )
+      , m_fn( std::move( fn ) )
+  {
+  }
+
+private:
+  void work() override
+  {
+    stage_emitter< Out > emit( m_out, m_batch );
+
+    bool more = true;
+    while ( more )
+    {
+      const uint64_t emitted = emit.emitted();
+      const uint64_t blocked = emit.blocked_ns();
+      auto           start   = pipeline_clock::now();
+
+      // a batch worth of calls between accounting
+      for ( size_t ix = 0; ix < m_batch && more; ++ix )
+      {
+        more = !stopping() && m_fn( emit );
+      }
+      if ( !more )
+      {
+        emit.flush();
+      }
+
+      const uint64_t waited = emit.blocked_ns() - blocked;
+      account( 0, emit.emitted() - emitted, elapsed_ns( start ) - waited, 0, waited );
+    }
+  }
+
+  void close_output() override
+  {
+    m_out.close();
+  }
+
+  size_t             m_batch;
+  mpmc_queue< Out >& m_out;
+  F                  m_fn;
+};
+
+// takes batches off in, hands them to call( first, last, emit ) or, for sinks,
+// call( first, last ). Out = void is a sink.
+template < class In, class Out, class Call >
+class transform_stage : public pipeline_stage
+{
+public:
+  transform_stage( std::string name, size_t workers, size_t batch, mpmc_queue< In >& in,
+                   mpmc_queue< Out >* out, Call call )
+      : pipeline_stage( std::move( name ), workers, in.capacity() )
+      , m_batch( batch )
+      , m_in( in )
+      , m_out( out )
+      , m_call( std::move( call ) )
+  {
+  }
+
+private:
+  void work() override
+  {
+    std::vector< In > items;
+    items.reserve( m_batch );
+
+    if constexpr ( std::is_void< Out >::value )
+    {
+      for ( ;; )
+      {
+        auto           start   = pipeline_clock::now();
+        const uint64_t starved = take( items );
+        if ( items.empty() || stopping() )
+        {
+          break;
+        }
+        m_call( items.data(), items.data() + items.size() );
+        account( items.size(), 0, elapsed_ns( start ) - starved, starved, 0 );
+      }
+    }
+    else
+    {
+      stage_emitter< Out > emit( *m_out, m_batch );
+      for ( ;; )
+      {
+        auto           start   = pipeline_clock::now();
+        const uint64_t starved = take( items );
+        if ( items.empty() || stopping() )
+        {
+          emit.flush();
+          break;
+        }
+
+        const uint64_t emitted = emit.emitted();
+        const uint64_t blocked = emit.blocked_ns();
+        m_call( items.data(), items.data() + items.size(), emit );
+        emit.flush();
+
+        const uint64_t waited = emit.blocked_ns() - blocked;
+        account( items.size(), emit.emitted() - emitted, elapsed_ns( start ) - starved - waited,
+                 starved, waited );
+      }
+    }
+  }
+
+  // the next batch into items, returns the ns spent waiting for it
+  uint64_t take( std::vector< In >& items )
+  {
+    items.clear();
+    auto start = pipeline_clock::now();
+    size_t depth = 0;
+    m_in.pop_batch( std::back_inserter( items ), m_batch, depth );
+    const uint64_t waited = elapsed_ns( start );
+    if ( !items.empty() )
+    {
+      // occupancy as the pop found it, our batch included
+      sample_queue( depth );
+    }
+    return waited;
+  }
+
+  void close_output() override
+  {
+    if constexpr ( !std::is_void< Out >::value )
+    {
+      m_out->close();
+    }
+  }
+
+  size_t             m_batch;
+  mpmc_queue< In >&  m_in;
+  mpmc_queue< Out >* m_out;
+  Call               m_call;
+};
+} // namespace detail
+
+class pipeline
+{
+public:
+  // batch: items per queue operation. capacity: of every queue between stages.
+  explicit pipeline( size_t batch = 32, size_t capacity = 1024 )
+      : m_batch( std::max< size_t >( 1, batch ) )
+      , m_capacity( std::max( capacity, 2 * m_batch ) )
+  {
+  }
+
+  pipeline( const pipeline& ) = delete;
+  pipeline& operator=( const pipeline& ) = delete;
+
+  ~pipeline()
+  {
+    wait();
+  }
+
+  // workers threads calling bool fn( emit ) until it returns false, emit( v )
+  // passes v on
+  template < class Out, class F >
+  mpmc_queue< Out >& source( std::string name, size_t workers, F fn )
+  {
+    auto& out = make_queue< Out >();
+    add( new detail::source_stage< Out, F >( std::move( name ), workers, m_batch, out,
+                                             std::move( fn ) ) );
+    return out;
+  }
+
+  // fn( In& item, emit ) for every item of in, emitting any number of outputs
+  template < class Out, class In, class F >
+  mpmc_queue< Out >& stage( std::string name, mpmc_queue< In >& in, size_t workers, F fn )
+  {
+    auto call = [fn]( In* first, In* last, detail::stage_emitter< Out >& emit ) mutable {
+      for ( ; first != last; ++first )
+      {
+        fn( *first, emit );
+      }
+    };
+    return batch_stage< Out >( std::move( name ), in, workers, std::move( call ) );
+  }
+
+  // fn( In* first, In* last, emit ) per batch taken off in, for stages that
+  // gain from seeing several items at once
+  template < class Out, class In, class F >
+  mpmc_queue< Out >& batch_stage( std::string name, mpmc_queue< In >& in, size_t workers, F fn )
+  {
+    auto& out = make_queue< Out >();
+    add( new detail::transform_stage< In, Out, F >( std::move( name ), workers, m_batch, in, &out,
+                                                    std::move( fn ) ) );
+    return out;
+  }
+
+  // fn( In& item ) for every item of in, the end of the line
+  template < class In, class F >
+  void sink( std::string name, mpmc_queue< In >& in, size_t workers, F fn )
+  {
+    auto call = [fn]( In* first, In* last ) mutable {
+      for ( ; first != last; ++first )
+      {
+        fn( *first );
+      }
+    };
+    add( new detail::transform_stage< In, void, decltype( call ) >(
+        std::move( name ), workers, m_batch, in, nullptr, std::move( call ) ) );
+  }
+
+  // stopping token (a default one never stops) cancels the run
+  void start( stop_token token = {} )
+  {
+    m_started = true;
+    m_on_cancel.emplace( m_cancel.get_token(), [this] {
+      for ( auto& s : m_stages )
+      {
+        s->close();
+      }
+    } );
+    m_on_stop.emplace( token, [this] { cancel(); } );
+    for ( auto& s : m_stages )
+    {
+      s->start( m_cancel.get_token() );
+    }
+  }
+
+  // until every stage has drained and finished
+  void wait()
+  {
+    for ( auto& s : m_stages )
+    {
+      s->join();
+    }
+  }
+
+  void run( stop_token token = {} )
+  {
+    start( std::move( token ) );
+    wait();
+  }
+
+  // from any thread, wait() still has to follow
+  void cancel()
+  {
+    m_cancel.request_stop();
+  }
+
+  bool cancelled() const
+  {
+    return m_cancel.stop_requested();
+  }
+
+  // in the order the stages were added
+  std::vector< stage_stats > stats() const
+  {
+    std::vector< stage_stats > all;
+    for ( auto& s : m_stages )
+    {
+      all.push_back( s->stats() );
+    }
+    return all;
+  }
+
+  void report( std::ostream& os ) const
+  {
+    for ( auto& s : stats() )
+    {
+      os << s << "\n";
+    }
+    os.flush();
+  }
+
+private:
+  template < class T >
+  mpmc_queue< T >& make_queue()
+  {
+    auto q = std::make_shared< mpmc_queue< T > >( m_capacity );
+    m_queues.push_back( q );
+    return *q;
+  }
+
+  void add( detail::pipeline_stage* stage )
+  {
+    std::unique_ptr< detail::pipeline_stage > owned( stage );
+    if ( m_started )
+    {
+      throw std::logic_error( "pipeline: stages must be added before start()" );
+    }
+    m_stages.push_back( std::move( owned ) );
+  }
+
+  size_t m_batch;
+  size_t m_capacity;
+  bool   m_started{false};
+
+  // queues first, so the stages using them are destroyed before them
+  std::vector< std::shared_ptr< void > >                   m_queues;
+  std::vector< std::unique_ptr< detail::pipeline_stage > > m_stages;
+
+  // after the stages, the callbacks reach into them and go first
+  stop_source                                               m_cancel;
+  std::optional< stop_callback< std::function< void() > > > m_on_cancel;
+  std::optional< stop_callback< std::function< void() > > > m_on_stop;
+};
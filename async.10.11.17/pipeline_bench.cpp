@@ -0,0 +1,158 @@
+// generate -> hash -> dedupe -> sink over 4k blocks, a quarter of them repeats.
+// the serial loop is the demo's way, every step inline in one body; the pipeline
+// runs the steps as stages joined by bounded queues, so generating, hashing and
+// deduplicating overlap, with the per stage report after each run.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "bench.hpp"
+#include "block.hpp"
+#include "digest.hpp"
+#include "pipeline.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using bench::clock_type;
+using bench::cpus;
+using block_type = block< 4096 >;
+using block_ptr  = std::unique_ptr< block_type >;
+
+constexpr uint64_t total    = 100000;
+constexpr uint64_t distinct = total * 3 / 4;
+
+// block id's bytes depend only on id % distinct, so later ids repeat earlier ones
+block_ptr generate( uint64_t id )
+{
+  auto            b = std::make_unique< block_type >( block_no_init );
+  std::mt19937_64 gen( id % distinct );
+  for ( size_t ix = 0; ix < b->size(); ix += sizeof( uint64_t ) )
+  {
+    uint64_t word = gen();
+    memcpy( b->data() + ix, &word, sizeof( word ) );
+  }
+  return b;
+}
+
+struct digest_hash
+{
+  size_t operator()( const sha1::digest_type& d ) const
+  {
+    size_t h;
+    memcpy( &h, d.data(), sizeof( h ) );
+    return h;
+  }
+};
+
+using digest_set = std::unordered_set< sha1::digest_type, digest_hash >;
+
+void report( const std::string& name, clock_type::time_point start, size_t unique )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << elapsed.count() * 1000 << "ms " << total / elapsed.count() / 1e3
+            << "K blocks/s " << total * sizeof( block_type ) / elapsed.count() / 1e9 << "GB/s, "
+            << unique << " unique" << std::endl;
+}
+
+void run_pipeline( size_t generators, size_t hashers )
+{
+  pipeline                p( 32, 256 );
+  std::atomic< uint64_t > next{0};
+  digest_set              seen;
+  size_t                  unique = 0;
+
+  auto& blocks = p.source< block_ptr >( "generate", generators, [&]( auto& emit ) {
+    uint64_t id = next.fetch_add( 1 );
+    if ( id >= total )
+    {
+      return false;
+    }
+    emit( generate( id ) );
+    return true;
+  } );
+
+  // the whole batch through hash_many, the multi buffer engines want several
+  auto& digests = p.batch_stage< sha1::digest_type >(
+      "hash", blocks, hashers, []( block_ptr* first, block_ptr* last, auto& emit ) {
+        const uint8_t*    ptrs[64];
+        sha1::digest_type out[64];
+        while ( first != last )
+        {
+          const size_t n = std::min< size_t >( 64, last - first );
+          for ( size_t ix = 0; ix < n; ++ix )
+          {
+            ptrs[ix] = first[ix]->data();
+          }
+          sha1::hash_many( ptrs, sizeof( block_type ), n, out );
+          for ( size_t ix = 0; ix < n; ++ix )
+          {
+            emit( out[ix] );
+          }
+          first += n;
+        }
+      } );
+
+  // one worker owns the set
+  auto& fresh = p.stage< sha1::digest_type >(
+      "dedupe", digests, 1, [&]( sha1::digest_type& d, auto& emit ) {
+        if ( seen.insert( d ).second )
+        {
+          emit( d );
+        }
+      } );
+
+  p.sink( "sink", fresh, 1, [&]( sha1::digest_type& ) { ++unique; } );
+
+  auto start = clock_type::now();
+  p.run();
+  report( "pipeline generate=" + std::to_string( generators ) + " hash="
+              + std::to_string( hashers ),
+          start, unique );
+  p.report( std::cout );
+
+  EXPECT_EQ( unique, distinct );
+}
+} // namespace
+
+TEST( PipelineBench, Serial )
+{
+  digest_set seen;
+  size_t     unique = 0;
+
+  auto start = clock_type::now();
+  for ( uint64_t id = 0; id < total; ++id )
+  {
+    auto b = generate( id );
+    if ( seen.insert( sha1::hash( b->data(), b->size() ) ).second )
+    {
+      ++unique;
+    }
+  }
+  report( "serial", start, unique );
+
+  EXPECT_EQ( unique, distinct );
+}
+
+TEST( PipelineBench, Stages )
+{
+  run_pipeline( 1, 1 );
+  if ( cpus() > 2 )
+  {
+    run_pipeline( cpus() / 2, cpus() / 2 );
+  }
+}
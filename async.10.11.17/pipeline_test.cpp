@@ -0,0 +1,245 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "pipeline.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+// clang-format on
+
+using namespace std::chrono_literals;
+
+namespace
+{
+// hands out 0 .. count-1 to however many source workers call it
+struct counter_source
+{
+  explicit counter_source( uint64_t n )
+      : next( std::make_shared< std::atomic< uint64_t > >( 0 ) )
+      , count( n )
+  {
+  }
+
+  std::shared_ptr< std::atomic< uint64_t > > next;
+  uint64_t                                   count;
+
+  template < class Emit >
+  bool operator()( Emit& emit )
+  {
+    uint64_t v = next->fetch_add( 1 );
+    if ( v >= count )
+    {
+      return false;
+    }
+    emit( v );
+    return true;
+  }
+};
+} // namespace
+
+TEST( Pipeline, MapFilterFanOutSink )
+{
+  constexpr uint64_t count = 100000;
+
+  pipeline                p( 16, 64 );
+  std::atomic< uint64_t > sum{0};
+  std::atomic< uint64_t > sunk{0};
+
+  auto& numbers = p.source< uint64_t >( "count", 2, counter_source( count ) );
+  auto& squares = p.stage< uint64_t >( "square", numbers, 3,
+                                       []( uint64_t& v, auto& emit ) { emit( v * v ); } );
+  // keep the even squares, twice each
+  auto& evens = p.stage< uint64_t >( "even", squares, 2, []( uint64_t& v, auto& emit ) {
+    if ( v % 2 == 0 )
+    {
+      emit( v );
+      emit( v );
+    }
+  } );
+  p.sink( "sum", evens, 2, [&]( uint64_t& v ) {
+    sum.fetch_add( v );
+    sunk.fetch_add( 1 );
+  } );
+  p.run();
+
+  uint64_t expected = 0;
+  for ( uint64_t v = 0; v < count; v += 2 )
+  {
+    expected += 2 * v * v;
+  }
+  EXPECT_EQ( sum.load(), expected );
+  EXPECT_EQ( sunk.load(), count );
+
+  auto stats = p.stats();
+  ASSERT_EQ( stats.size(), 4u );
+  EXPECT_EQ( stats[0].name, "count" );
+  EXPECT_EQ( stats[0].workers, 2u );
+  EXPECT_EQ( stats[0].items_out, count );
+  EXPECT_EQ( stats[1].items_in, count );
+  EXPECT_EQ( stats[1].items_out, count );
+  EXPECT_EQ( stats[2].items_in, count );
+  EXPECT_EQ( stats[2].items_out, count );
+  EXPECT_EQ( stats[3].items_in, count );
+  for ( size_t ix = 1; ix < stats.size(); ++ix )
+  {
+    EXPECT_EQ( stats[ix].queue_capacity, 64u );
+    EXPECT_LE( stats[ix].queue_max, 64u );
+    EXPECT_GT( stats[ix].seconds, 0 );
+  }
+
+  std::ostringstream report;
+  p.report( report );
+  EXPECT_NE( report.str().find( "square" ), std::string::npos );
+}
+
+// a slow sink behind a small queue: the source has to wait, memory doesn't grow
+TEST( Pipeline, BackpressureBlocksTheSource )
+{
+  pipeline p( 4, 8 );
+  size_t   got = 0;
+
+  auto& numbers = p.source< uint64_t >( "count", 1, counter_source( 200 ) );
+  p.sink( "slow", numbers, 1, [&]( uint64_t& ) {
+    std::this_thread::sleep_for( 100us );
+    ++got;
+  } );
+  p.run();
+
+  EXPECT_EQ( got, 200u );
+  auto stats = p.stats();
+  EXPECT_GT( stats[0].blocked_seconds, 0.005 );
+  EXPECT_LE( stats[1].queue_max, 8u );
+  EXPECT_GT( stats[1].queue_mean, 1.0 ); // mostly full
+}
+
+TEST( Pipeline, BatchStageSeesBatches )
+{
+  pipeline           p( 32, 256 );
+  std::mutex         lock;
+  std::set< size_t > sizes;
+  std::vector< int > seen;
+
+  auto& numbers = p.source< int >( "one", 1, [n = 0]( auto& emit ) mutable {
+    emit( n++ );
+    return n < 1000;
+  } );
+  auto doubler = [&]( int* first, int* last, auto& emit ) {
+    {
+      std::lock_guard< std::mutex > locker{lock};
+      sizes.insert( last - first );
+    }
+    for ( ; first != last; ++first )
+    {
+      emit( *first * 2 );
+    }
+  };
+  auto& doubled = p.batch_stage< int >( "double", numbers, 1, doubler );
+  p.sink( "collect", doubled, 1, [&]( int& v ) { seen.push_back( v ); } );
+  p.run();
+
+  // one of each worker, so order survives
+  ASSERT_EQ( seen.size(), 1000u );
+  for ( int ix = 0; ix < 1000; ++ix )
+  {
+    ASSERT_EQ( seen[ix], ix * 2 );
+  }
+  EXPECT_LE( *sizes.rbegin(), 32u );
+  EXPECT_GE( *sizes.begin(), 1u );
+}
+
+TEST( Pipeline, MoveOnlyItemsAndLateStagesThrow )
+{
+  pipeline p;
+  size_t   total = 0;
+
+  auto& boxes = p.source< std::unique_ptr< int > >( "box", 1, [n = 0]( auto& emit ) mutable {
+    emit( std::make_unique< int >( n++ ) );
+    return n < 100;
+  } );
+  p.sink( "unbox", boxes, 1, [&]( std::unique_ptr< int >& v ) { total += *v; } );
+  p.start();
+
+  auto late = [&] { p.sink( "late", boxes, 1, []( std::unique_ptr< int >& ) {} ); };
+  EXPECT_THROW( late(), std::logic_error );
+
+  p.wait();
+  EXPECT_EQ( total, 99u * 100 / 2 );
+}
+
+TEST( Pipeline, StopTokenEndsAnEndlessRun )
+{
+  pipeline              p( 8, 16 );
+  std::atomic< size_t > sunk{0};
+
+  auto forever = [n = uint64_t( 0 )]( auto& emit ) mutable {
+    emit( n++ );
+    return true;
+  };
+  auto& numbers = p.source< uint64_t >( "forever", 1, forever );
+  auto& doubled = p.stage< uint64_t >( "double", numbers, 2,
+                                       []( uint64_t& v, auto& emit ) { emit( v * 2 ); } );
+  p.sink( "slow", doubled, 1, [&]( uint64_t& ) {
+    std::this_thread::sleep_for( 10us );
+    sunk.fetch_add( 1 );
+  } );
+
+  // the source outruns the sink, everything upstream is blocked on full queues
+  stop_source source;
+  std::thread stopper( [&] {
+    while ( sunk.load() < 1000 )
+    {
+      std::this_thread::yield();
+    }
+    source.request_stop();
+  } );
+  p.run( source.get_token() );
+  stopper.join();
+
+  EXPECT_TRUE( p.cancelled() );
+  EXPECT_GE( sunk.load(), 1000u );
+  // at most the batch the sink had in hand went through after the stop
+  EXPECT_LE( sunk.load(), 1000u + 8 );
+}
+
+TEST( Pipeline, CancelBeforeAndDuring )
+{
+  size_t called = 0;
+  {
+    stop_source source;
+    source.request_stop();
+
+    pipeline p;
+    auto&    numbers = p.source< int >( "never", 1, [&]( auto& ) { return ++called < 10; } );
+    p.sink( "none", numbers, 1, []( int& ) {} );
+    p.run( source.get_token() );
+    EXPECT_TRUE( p.cancelled() );
+  }
+  EXPECT_EQ( called, 0u );
+
+  // cancel() from a stage of the pipeline itself
+  pipeline p( 4, 8 );
+  size_t   seen    = 0;
+  auto&    numbers = p.source< int >( "count", 1, [n = 0]( auto& emit ) mutable {
+    emit( n++ );
+    return true;
+  } );
+  p.sink( "first ten", numbers, 1, [&]( int& ) {
+    if ( ++seen == 10 )
+    {
+      p.cancel();
+    }
+  } );
+  p.run();
+  EXPECT_TRUE( p.cancelled() );
+  EXPECT_GE( seen, 10u );
+  EXPECT_LT( seen, 14u );
+}
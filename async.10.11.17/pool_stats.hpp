@@ -0,0 +1,249 @@
+#pragma once
+
+// what a thread_pool's workers have been doing, for telling a saturated pool
+// from an idle one in production.
+//
+//   pool_stats s = pool.stats();
+//   s.report( std::cout );                      // one line per worker
+//   stats_reporter dump( pool, std::clog, 10s ); // the same every 10s
+//
+// every counter belongs to one worker and only that worker writes it, a plain
+// relaxed load and store with no locked instruction on the task path. a reset
+// records where the counts stood and later snapshots subtract that, so no count
+// is ever stored from another thread. busy time is the time since the last
+// reset the worker was not parked, so nothing is timed per task. the wait and
+// run histograms time one task in stats_sample_every, wrapped with a timestamp
+// when it is queued: enough for percentiles, cheap enough to leave on.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "stopwatch.hpp"
+
+// one task in this many gets its queue wait and run time recorded
+constexpr uint32_t stats_sample_every = 256;
+
+// one worker at the moment pool.stats() looked
+struct worker_stats
+{
+  uint64_t executed{0};   // tasks run, cancelled ones included
+  uint64_t steals{0};     // tasks it took from another worker's deque
+  uint64_t parks{0};      // times it went to sleep for lack of work
+  size_t   high_water{0}; // deepest its own deque has been
+
+  std::chrono::nanoseconds busy{0}; // not parked
+  std::chrono::nanoseconds idle{0}; // parked
+
+  // sampled tasks, in tsc_clock ticks: queued to started, started to finished
+  histogram_snapshot wait;
+  histogram_snapshot run;
+
+  // busy / ( busy + idle ), 0 before any time has passed
+  double busy_fraction() const
+  {
+    const auto total = busy + idle;
+    return total.count() > 0 ? double( busy.count() ) / double( total.count() ) : 0.0;
+  }
+};
+
+struct pool_stats
+{
+  std::vector< worker_stats > workers;
+  size_t                      inject_high_water{0}; // deepest the shared queue has been
+
+  uint64_t executed() const
+  {
+    uint64_t n = 0;
+    for ( auto& w : workers )
+    {
+      n += w.executed;
+    }
+    return n;
+  }
+
+  uint64_t steals() const
+  {
+    uint64_t n = 0;
+    for ( auto& w : workers )
+    {
+      n += w.steals;
+    }
+    return n;
+  }
+
+  // a line per worker: counts, busy percentage, p50 / p99 of wait and run in ns
+  void report( std::ostream& os ) const
+  {
+    os << "pool: workers=" << workers.size() << " executed=" << executed()
+       << " steals=" << steals() << " inject_high_water=" << inject_high_water << "\n";
+    for ( size_t ix = 0; ix < workers.size(); ++ix )
+    {
+      const worker_stats& w = workers[ix];
+      os << "  worker " << ix << ": executed=" << w.executed << " steals=" << w.steals
+         << " parks=" << w.parks << " high_water=" << w.high_water
+         << " busy=" << unsigned( w.busy_fraction() * 100 + 0.5 ) << "%";
+      if ( w.wait.count() > 0 )
+      {
+        os << " wait p50=" << tsc_clock::to_ns( w.wait.percentile( 0.5 ) )
+           << "ns p99=" << tsc_clock::to_ns( w.wait.percentile( 0.99 ) )
+           << "ns run p50=" << tsc_clock::to_ns( w.run.percentile( 0.5 ) )
+           << "ns p99=" << tsc_clock::to_ns( w.run.percentile( 0.99 ) ) << "ns";
+      }
+      os << "\n";
+    }
+    os.flush();
+  }
+};
+
+namespace detail
+{
+// single writer: a load and a store, no read-modify-write
+inline void bump( std::atomic< uint64_t >& counter, uint64_t by = 1 )
+{
+  counter.store( counter.load( std::memory_order_relaxed ) + by, std::memory_order_relaxed );
+}
+
+// a worker's live counters, written by that worker only
+struct alignas( 64 ) worker_counters
+{
+  std::atomic< uint64_t > executed{0};
+  std::atomic< uint64_t > steals{0};
+  std::atomic< uint64_t > parks{0};
+  std::atomic< uint64_t > high_water{0};
+  std::atomic< uint64_t > idle{0};         // ticks parked, finished parks only
+  std::atomic< uint64_t > parked_since{0}; // ticks, 0 while awake
+  latency_histogram       wait;
+  latency_histogram       run;
+
+  void deepest( uint64_t depth )
+  {
+    if ( depth > high_water.load( std::memory_order_relaxed ) )
+    {
+      high_water.store( depth, std::memory_order_relaxed );
+    }
+  }
+
+  void park_begin( uint64_t now )
+  {
+    bump( parks );
+    parked_since.store( now, std::memory_order_relaxed );
+  }
+
+  void park_end( uint64_t now )
+  {
+    const uint64_t since = parked_since.load( std::memory_order_relaxed );
+    bump( idle, now > since ? now - since : 0 );
+    parked_since.store( 0, std::memory_order_relaxed );
+  }
+
+  // the counts as reset() found them, what snapshot() subtracts. only touched
+  // under the pool's stats lock, never by the worker.
+  struct baseline
+  {
+    uint64_t executed{0};
+    uint64_t steals{0};
+    uint64_t parks{0};
+    uint64_t idle{0};
+  } base;
+
+  // counters are still being written meanwhile, each value is one of the values
+  // it went through but they need not agree with each other
+  worker_stats snapshot( uint64_t started, uint64_t now ) const
+  {
+    worker_stats s;
+    s.executed   = executed.load( std::memory_order_relaxed ) - base.executed;
+    s.steals     = steals.load( std::memory_order_relaxed ) - base.steals;
+    s.parks      = parks.load( std::memory_order_relaxed ) - base.parks;
+    s.high_water = size_t( high_water.load( std::memory_order_relaxed ) );
+
+    // a park in progress counts from the reset at the earliest
+    uint64_t       idle_ticks = idle.load( std::memory_order_relaxed ) - base.idle;
+    const uint64_t parked     = parked_since.load( std::memory_order_relaxed );
+    if ( parked != 0 && now > parked )
+    {
+      idle_ticks += now - std::max( parked, started );
+    }
+    const uint64_t total = now > started ? now - started : 0;
+    idle_ticks           = std::min( idle_ticks, total );
+
+    s.idle = std::chrono::nanoseconds( tsc_clock::to_ns( idle_ticks ) );
+    s.busy = std::chrono::nanoseconds( tsc_clock::to_ns( total - idle_ticks ) );
+    s.wait = wait.snapshot();
+    s.run  = run.snapshot();
+    return s;
+  }
+
+  // counts start again from where they stand now. the high-water mark and the
+  // histograms are cleared outright: a worker racing the clear can only put back
+  // a depth it has just seen, and the histograms count with fetch_add, so neither
+  // brings back what came before. not atomic as a whole, like
+  // latency_histogram::reset.
+  void reset()
+  {
+    base.executed = executed.load( std::memory_order_relaxed );
+    base.steals   = steals.load( std::memory_order_relaxed );
+    base.parks    = parks.load( std::memory_order_relaxed );
+    base.idle     = idle.load( std::memory_order_relaxed );
+    high_water.store( 0, std::memory_order_relaxed );
+    wait.reset();
+    run.reset();
+  }
+};
+
+// true for one call in stats_sample_every on the same counter
+inline bool sample_now( uint32_t& queued )
+{
+  if ( ++queued < stats_sample_every )
+  {
+    return false;
+  }
+  queued = 0;
+  return true;
+}
+} // namespace detail
+
+// reports a pool's stats to os every period from a thread of its own, until
+// destroyed. the pool has to outlive it.
+class stats_reporter
+{
+public:
+  template < class Pool, class Rep, class Period >
+  stats_reporter( const Pool& pool, std::ostream& os, std::chrono::duration< Rep, Period > period )
+      : m_thread( [this, &pool, &os, period] {
+        std::unique_lock< std::mutex > locker{m_lock};
+        while ( !m_cv.wait_for( locker, period, [this] { return m_stop; } ) )
+        {
+          pool.stats().report( os );
+        }
+      } )
+  {
+  }
+
+  stats_reporter( const stats_reporter& ) = delete;
+  stats_reporter& operator=( const stats_reporter& ) = delete;
+
+  ~stats_reporter()
+  {
+    {
+      std::lock_guard< std::mutex > locker{m_lock};
+      m_stop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+  }
+
+private:
+  std::mutex              m_lock;
+  std::condition_variable m_cv;
+  bool                    m_stop{false};
+  std::thread             m_thread; // last, started once the rest is built
+}; // stats_reporter
@@ -0,0 +1,248 @@
+#pragma once
+
+// cooperative cancellation, shaped after C++20's std::stop_source / stop_token /
+// stop_callback for the C++17 parts of the tree.
+//
+//   stop_source source;
+//   auto fut = make_async_future( pool, source.get_token(), []( const stop_token& t ) {
+//     while ( !t.stop_requested() ) { ... }
+//   } );
+//   cancel_after( timers, source, 50ms );   // or source.request_stop() by hand
+//
+// stop_requested() is one acquire load, cheap enough for inner loops. callbacks
+// registered on a token run exactly once, on the thread calling request_stop(),
+// or right away if the stop came first. a stop_callback's destructor unhooks it,
+// waiting if it is running on another thread at that moment, so the callback may
+// touch whatever it was registered for until then. a default constructed token
+// never stops and costs nothing to register with.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// what a future holds when its task was cancelled before it ran
+class operation_cancelled : public std::runtime_error
+{
+public:
+  operation_cancelled()
+      : std::runtime_error( "operation cancelled" )
+  {
+  }
+};
+
+namespace detail
+{
+struct stop_callback_node
+{
+  stop_callback_node* prev = this;
+  stop_callback_node* next = this;
+  void ( *invoke )( stop_callback_node* ){nullptr};
+  std::atomic< bool > done{false}; // set once invoke returned
+
+  bool linked() const
+  {
+    return next != this;
+  }
+
+  void unlink()
+  {
+    prev->next = next;
+    next->prev = prev;
+    prev = next = this;
+  }
+};
+
+struct stop_state
+{
+  bool stop_requested() const
+  {
+    return m_stopped.load( std::memory_order_acquire );
+  }
+
+  bool request_stop()
+  {
+    std::unique_lock< std::mutex > locker{m_lock};
+    if ( m_stopped.load( std::memory_order_relaxed ) )
+    {
+      return false;
+    }
+    m_stopped.store( true, std::memory_order_release );
+    m_stopping = std::this_thread::get_id();
+
+    while ( m_callbacks.linked() )
+    {
+      stop_callback_node* node = m_callbacks.next;
+      node->unlink();
+      m_running = node;
+      locker.unlock();
+      node->invoke( node );
+      locker.lock();
+      // cleared when the callback destroyed itself, node is gone then
+      if ( m_running == node )
+      {
+        node->done.store( true, std::memory_order_release );
+      }
+      m_running = nullptr;
+    }
+    return true;
+  }
+
+  // false if the stop already happened, the caller runs the callback itself
+  bool add( stop_callback_node* node )
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+    if ( m_stopped.load( std::memory_order_relaxed ) )
+    {
+      return false;
+    }
+    node->prev             = m_callbacks.prev;
+    node->next             = &m_callbacks;
+    m_callbacks.prev->next = node;
+    m_callbacks.prev       = node;
+    return true;
+  }
+
+  void remove( stop_callback_node* node )
+  {
+    std::unique_lock< std::mutex > locker{m_lock};
+    if ( node->linked() )
+    {
+      node->unlink();
+      return;
+    }
+    if ( m_running != node )
+    {
+      return;
+    }
+    if ( m_stopping == std::this_thread::get_id() )
+    {
+      // from inside its own callback
+      m_running = nullptr;
+      return;
+    }
+    locker.unlock();
+    while ( !node->done.load( std::memory_order_acquire ) )
+    {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  std::atomic< bool > m_stopped{false};
+  std::mutex          m_lock;
+  stop_callback_node  m_callbacks; // sentinel
+  stop_callback_node* m_running{nullptr};
+  std::thread::id     m_stopping;
+};
+} // namespace detail
+
+class stop_token
+{
+public:
+  stop_token() = default;
+
+  bool stop_requested() const
+  {
+    return m_state && m_state->stop_requested();
+  }
+
+  // false for a token no source will ever stop
+  bool stop_possible() const
+  {
+    return m_state != nullptr;
+  }
+
+private:
+  friend class stop_source;
+  template < class F >
+  friend class stop_callback;
+
+  explicit stop_token( std::shared_ptr< detail::stop_state > state )
+      : m_state( std::move( state ) )
+  {
+  }
+
+  std::shared_ptr< detail::stop_state > m_state;
+}; // stop_token
+
+class stop_source
+{
+public:
+  stop_source()
+      : m_state( std::make_shared< detail::stop_state >() )
+  {
+  }
+
+  stop_token get_token() const
+  {
+    return stop_token( m_state );
+  }
+
+  // true for the call that made the stop happen
+  bool request_stop()
+  {
+    return m_state->request_stop();
+  }
+
+  bool stop_requested() const
+  {
+    return m_state->stop_requested();
+  }
+
+private:
+  std::shared_ptr< detail::stop_state > m_state;
+}; // stop_source
+
+// calls fn() once when token is stopped, unless destroyed first
+template < class F >
+class stop_callback : private detail::stop_callback_node
+{
+public:
+  template < class U >
+  stop_callback( const stop_token& token, U&& fn )
+      : m_fn( std::forward< U >( fn ) )
+  {
+    invoke = []( detail::stop_callback_node* node ) {
+      static_cast< stop_callback* >( node )->m_fn();
+    };
+    if ( token.m_state && !token.m_state->add( this ) )
+    {
+      m_fn();
+    }
+    else
+    {
+      m_state = token.m_state;
+    }
+  }
+
+  stop_callback( const stop_callback& ) = delete;
+  stop_callback& operator=( const stop_callback& ) = delete;
+
+  ~stop_callback()
+  {
+    if ( m_state )
+    {
+      m_state->remove( this );
+    }
+  }
+
+private:
+  F                                     m_fn;
+  std::shared_ptr< detail::stop_state > m_state;
+}; // stop_callback
+
+template < class F >
+stop_callback( const stop_token&, F ) -> stop_callback< F >;
+
+// request_stop() on source once d has passed. returns whatever the timers'
+// schedule_after does, a timer_wheel's handle cancels the deadline again.
+template < class Timers, class Rep, class Period >
+auto cancel_after( Timers& timers, stop_source source, std::chrono::duration< Rep, Period > d )
+{
+  return timers.schedule_after( d, [source]() mutable { source.request_stop(); } );
+}
@@ -0,0 +1,138 @@
+// what cancellation costs. a tight summing loop polling stop_requested() on every
+// iteration and on every 64th against not polling at all, then thread_pool submit
+// with and without a token, and stopping 200000 tasks while they are still queued.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "stop_token.hpp"
+#include "thread_pool.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+constexpr uint64_t iterations = 200000000;
+constexpr size_t   tasks      = 200000;
+
+void report( const std::string& name, double ops, clock_type::time_point start )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << ops / elapsed.count() / 1e6 << "M/s" << std::endl;
+}
+
+// the stride is a template argument so the check folds away entirely for 0
+template < uint64_t Stride >
+uint64_t sum( const stop_token& token, uint64_t n )
+{
+  uint64_t total = 0;
+  for ( uint64_t ix = 0; ix < n; ++ix )
+  {
+    if ( Stride != 0 && ix % ( Stride ? Stride : 1 ) == 0 && token.stop_requested() )
+    {
+      break;
+    }
+    total += ix ^ ( total >> 3 );
+  }
+  return total;
+}
+} // namespace
+
+TEST( StopTokenBench, PollingInALoop )
+{
+  stop_source source;
+  stop_token  token = source.get_token();
+
+  auto start = clock_type::now();
+  auto plain = sum< 0 >( token, iterations );
+  report( "no check", iterations, start );
+
+  start      = clock_type::now();
+  auto every = sum< 1 >( token, iterations );
+  report( "check every iteration", iterations, start );
+
+  start        = clock_type::now();
+  auto every64 = sum< 64 >( token, iterations );
+  report( "check every 64", iterations, start );
+
+  EXPECT_EQ( plain, every );
+  EXPECT_EQ( plain, every64 );
+}
+
+TEST( StopTokenBench, SubmitAndCancel )
+{
+  thread_pool pool;
+  stop_source source;
+
+  std::vector< std::future< size_t > > futures;
+  futures.reserve( tasks );
+
+  auto start = clock_type::now();
+  for ( size_t ix = 0; ix < tasks; ++ix )
+  {
+    futures.push_back( pool.submit( [ix] { return ix; } ) );
+  }
+  for ( auto& f : futures )
+  {
+    f.get();
+  }
+  report( "submit", tasks, start );
+
+  futures.clear();
+  start = clock_type::now();
+  for ( size_t ix = 0; ix < tasks; ++ix )
+  {
+    futures.push_back( pool.submit( source.get_token(), [ix] { return ix; } ) );
+  }
+  for ( auto& f : futures )
+  {
+    f.get();
+  }
+  report( "submit with token", tasks, start );
+
+  // hold every worker so the tasks stay queued, then stop them all at once
+  std::promise< void >       release;
+  std::shared_future< void > gate = release.get_future().share();
+  for ( size_t ix = 0; ix < pool.size(); ++ix )
+  {
+    pool.post( [gate] { gate.wait(); } );
+  }
+  futures.clear();
+  for ( size_t ix = 0; ix < tasks; ++ix )
+  {
+    futures.push_back( pool.submit( source.get_token(), [ix] { return ix; } ) );
+  }
+
+  start = clock_type::now();
+  source.request_stop();
+  report( "request_stop over queued tasks", tasks, start );
+
+  // the workers still take every one off the deques, to find it empty
+  start = clock_type::now();
+  release.set_value();
+  pool.shutdown();
+  report( "skipping the cancelled tasks", tasks, start );
+
+  size_t cancelled = 0;
+  for ( auto& f : futures )
+  {
+    try
+    {
+      f.get();
+    }
+    catch ( const operation_cancelled& )
+    {
+      ++cancelled;
+    }
+  }
+  EXPECT_EQ( cancelled, tasks );
+}
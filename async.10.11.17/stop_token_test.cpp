@@ -0,0 +1,143 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "stop_token.hpp"
+#include "timer_queue.hpp"
+#include "timer_wheel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+// clang-format on
+
+using namespace std::chrono_literals;
+
+TEST( StopToken, SourceAndToken )
+{
+  stop_token never;
+  EXPECT_FALSE( never.stop_possible() );
+  EXPECT_FALSE( never.stop_requested() );
+
+  stop_source source;
+  stop_token  token = source.get_token();
+  EXPECT_TRUE( token.stop_possible() );
+  EXPECT_FALSE( token.stop_requested() );
+
+  EXPECT_TRUE( source.request_stop() );
+  EXPECT_FALSE( source.request_stop() );
+  EXPECT_TRUE( token.stop_requested() );
+  EXPECT_TRUE( source.get_token().stop_requested() );
+
+  // copies share the state
+  stop_source copy = source;
+  EXPECT_TRUE( copy.stop_requested() );
+}
+
+TEST( StopToken, CallbacksRunOnce )
+{
+  stop_source source;
+  int         a = 0, b = 0, c = 0;
+
+  stop_callback first( source.get_token(), [&] { ++a; } );
+  {
+    stop_callback gone( source.get_token(), [&] { ++c; } );
+  }
+  stop_callback second( source.get_token(), [&] { ++b; } );
+  stop_callback none( stop_token(), [&] { ++c; } );
+
+  source.request_stop();
+  source.request_stop();
+  EXPECT_EQ( a, 1 );
+  EXPECT_EQ( b, 1 );
+  EXPECT_EQ( c, 0 );
+
+  // registered after the stop, runs in the constructor
+  stop_callback late( source.get_token(), [&] { ++c; } );
+  EXPECT_EQ( c, 1 );
+}
+
+TEST( StopToken, DestructorWaitsForARunningCallback )
+{
+  stop_source         source;
+  std::atomic< bool > entered{false}, finished{false};
+
+  auto cb = std::make_unique< stop_callback< std::function< void() > > >(
+      source.get_token(), [&] {
+        entered = true;
+        std::this_thread::sleep_for( 50ms );
+        finished = true;
+      } );
+
+  std::thread stopper( [&] { source.request_stop(); } );
+  while ( !entered )
+  {
+    std::this_thread::yield();
+  }
+  cb.reset();
+  EXPECT_TRUE( finished.load() );
+  stopper.join();
+}
+
+TEST( StopToken, CallbackMayDestroyItself )
+{
+  using callback = stop_callback< std::function< void() > >;
+
+  stop_source                 source;
+  std::unique_ptr< callback > self;
+  int                         after = 0;
+
+  self.reset( new callback( source.get_token(), [&] { self.reset(); } ) );
+  stop_callback next( source.get_token(), [&] { ++after; } );
+
+  source.request_stop();
+  EXPECT_EQ( self, nullptr );
+  EXPECT_EQ( after, 1 );
+}
+
+TEST( StopToken, ManyThreadsRegisterWhileStopping )
+{
+  stop_source                source;
+  std::atomic< int >         ran{0};
+  std::vector< std::thread > threads;
+  for ( int t = 0; t < 4; ++t )
+  {
+    threads.emplace_back( [&] {
+      for ( int ix = 0; ix < 1000; ++ix )
+      {
+        stop_callback cb( source.get_token(), [&] { ran += 1; } );
+      }
+    } );
+  }
+  std::this_thread::sleep_for( 1ms );
+  source.request_stop();
+  for ( auto& t : threads )
+  {
+    t.join();
+  }
+  // callbacks alive at the stop ran once, later ones at construction
+  EXPECT_LE( ran.load(), 4000 );
+  stop_callback last( source.get_token(), [&] { ran += 1; } );
+  EXPECT_GE( ran.load(), 1 );
+}
+
+TEST( StopToken, Deadlines )
+{
+  timer_wheel wheel;
+  timer_queue queue;
+
+  stop_source by_wheel, by_queue, called_off;
+  cancel_after( wheel, by_wheel, 20ms );
+  cancel_after( queue, by_queue, 20ms );
+  timer_handle deadline = cancel_after( wheel, called_off, 20ms );
+  EXPECT_TRUE( deadline.cancel() );
+
+  EXPECT_FALSE( by_wheel.stop_requested() );
+  std::this_thread::sleep_for( 100ms );
+  EXPECT_TRUE( by_wheel.stop_requested() );
+  EXPECT_TRUE( by_queue.stop_requested() );
+  EXPECT_FALSE( called_off.stop_requested() );
+}
@@ -0,0 +1,477 @@
+#pragma once
+
+// timing for hot paths. measuring is a pair of timestamp counter reads and one
+// relaxed atomic add into a histogram bucket; converting to nanoseconds, finding
+// percentiles and printing all happen later, when somebody asks for a report.
+//
+//   static latency_histogram& hashing = timing_scopes::global().scope( "hash" );
+//   {
+//     scoped_timer timed( hashing );
+//     ...
+//   }
+//   timing_scopes::global().report( std::cout ); // p50 p99 p999 max per scope
+//
+// tsc_clock reads the cpu's timestamp counter when it is invariant (constant
+// rate, ticking through sleep states), calibrated once against steady_clock.
+// elsewhere it falls back to steady_clock, with ticks being nanoseconds.
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <cpuid.h>
+#include <x86intrin.h>
+#define ASYNC_HAS_TSC 1
+#else
+#define ASYNC_HAS_TSC 0
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class tsc_clock
+{
+public:
+  // raw ticks, cheap and not ordered against surrounding instructions
+  static uint64_t now()
+  {
+#if ASYNC_HAS_TSC
+    if ( calibration().invariant )
+    {
+      return __rdtsc();
+    }
+#endif
+    return steady_ns();
+  }
+
+  // for the end of a measured region: waits for everything before it to finish
+  static uint64_t now_ordered()
+  {
+#if ASYNC_HAS_TSC
+    if ( calibration().invariant )
+    {
+      unsigned aux;
+      return __rdtscp( &aux );
+    }
+#endif
+    return steady_ns();
+  }
+
+  static uint64_t to_ns( uint64_t ticks )
+  {
+    return uint64_t( ( unsigned __int128 )ticks * calibration().ns_per_tick_q32 >> 32 );
+  }
+
+  static double ticks_per_ns()
+  {
+    return 4294967296.0 / calibration().ns_per_tick_q32;
+  }
+
+  // true when ticks come from the timestamp counter
+  static bool uses_tsc()
+  {
+    return calibration().invariant;
+  }
+
+private:
+  struct calibrated
+  {
+    bool     invariant{false};
+    uint64_t ns_per_tick_q32{uint64_t( 1 ) << 32}; // 32.32 fixed point
+  };
+
+  static uint64_t steady_ns()
+  {
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+               std::chrono::steady_clock::now().time_since_epoch() )
+        .count();
+  }
+
+  // once per process, spins for a few milliseconds
+  static const calibrated& calibration()
+  {
+    static const calibrated c = calibrate();
+    return c;
+  }
+
+#if ASYNC_HAS_TSC
+  // steady_clock and the counter at one instant: the counter is read on both
+  // sides of the clock, the tightest of a few tries wins, so being preempted in
+  // the middle of a sample does not skew the rate
+  static void sample( uint64_t& ns, uint64_t& ticks )
+  {
+    uint64_t best = ~uint64_t( 0 );
+    for ( int attempt = 0; attempt < 8; ++attempt )
+    {
+      const uint64_t before = __rdtsc();
+      const uint64_t now    = steady_ns();
+      const uint64_t after  = __rdtsc();
+      if ( after - before < best )
+      {
+        best  = after - before;
+        ns    = now;
+        ticks = before + ( after - before ) / 2;
+      }
+    }
+  }
+#endif
+
+  static calibrated calibrate()
+  {
+    calibrated c;
+#if ASYNC_HAS_TSC
+    unsigned eax, ebx, ecx, edx;
+    if ( !__get_cpuid( 0x80000007, &eax, &ebx, &ecx, &edx ) || !( edx & ( 1u << 8 ) ) )
+    {
+      return c;
+    }
+
+    uint64_t ns0 = 0, t0 = 0, ns1 = 0, t1 = 0;
+    sample( ns0, t0 );
+    while ( steady_ns() - ns0 < 5000000 )
+    {
+    }
+    sample( ns1, t1 );
+    if ( t1 <= t0 )
+    {
+      return c;
+    }
+
+    c.invariant       = true;
+    c.ns_per_tick_q32 = uint64_t( double( ns1 - ns0 ) / double( t1 - t0 ) * 4294967296.0 );
+#endif
+    return c;
+  }
+};
+
+// what a latency_histogram held at one moment, for reporting
+class histogram_snapshot
+{
+public:
+  histogram_snapshot() = default;
+
+  histogram_snapshot( std::vector< uint64_t > counts, uint64_t max )
+      : m_counts( std::move( counts ) )
+      , m_max( max )
+  {
+    for ( uint64_t c : m_counts )
+    {
+      m_total += c;
+    }
+  }
+
+  uint64_t count() const
+  {
+    return m_total;
+  }
+
+  uint64_t max() const
+  {
+    return m_max;
+  }
+
+  // the value q of the recorded values are at or below, q in [0, 1]. bucketed,
+  // so within 1/32 of the truth, and never above max().
+  uint64_t percentile( double q ) const;
+
+  uint64_t mean() const;
+
+private:
+  std::vector< uint64_t > m_counts;
+  uint64_t                m_total{0};
+  uint64_t                m_max{0};
+};
+
+// HDR style log linear histogram over the whole uint64 range: values below 64
+// exactly, every power of two above that in 32 steps, so any value lands in a
+// bucket no wider than 1/32 of it. recording is lock free, one relaxed add.
+class latency_histogram
+{
+public:
+  static constexpr unsigned sub_bits = 5;
+  static constexpr unsigned sub_size = 1u << sub_bits;
+  static constexpr size_t   buckets  = ( 64 - sub_bits + 1 ) * sub_size;
+
+  latency_histogram()
+  {
+    for ( auto& c : m_counts )
+    {
+      c.store( 0, std::memory_order_relaxed );
+    }
+  }
+
+  latency_histogram( const latency_histogram& ) = delete;
+  latency_histogram& operator=( const latency_histogram& ) = delete;
+
+  void record( uint64_t value )
+  {
+    m_counts[bucket_of( value )].fetch_add( 1, std::memory_order_relaxed );
+
+    uint64_t seen = m_max.load( std::memory_order_relaxed );
+    while ( value > seen
+            && !m_max.compare_exchange_weak( seen, value, std::memory_order_relaxed ) )
+    {
+    }
+  }
+
+  // not atomic as a whole: records racing the copy may or may not show
+  histogram_snapshot snapshot() const
+  {
+    std::vector< uint64_t > counts( buckets );
+    for ( size_t ix = 0; ix < buckets; ++ix )
+    {
+      counts[ix] = m_counts[ix].load( std::memory_order_relaxed );
+    }
+    return histogram_snapshot( std::move( counts ), m_max.load( std::memory_order_relaxed ) );
+  }
+
+  void reset()
+  {
+    for ( auto& c : m_counts )
+    {
+      c.store( 0, std::memory_order_relaxed );
+    }
+    m_max.store( 0, std::memory_order_relaxed );
+  }
+
+  static size_t bucket_of( uint64_t value )
+  {
+    if ( value < 2 * sub_size )
+    {
+      return size_t( value );
+    }
+    const unsigned msb   = 63 - __builtin_clzll( value );
+    const unsigned shift = msb - sub_bits;
+    return ( shift + 1 ) * sub_size + size_t( value >> shift ) - sub_size;
+  }
+
+  // smallest and largest value landing in bucket
+  static uint64_t bucket_low( size_t bucket )
+  {
+    if ( bucket < 2 * sub_size )
+    {
+      return bucket;
+    }
+    const unsigned shift = unsigned( bucket / sub_size ) - 1;
+    return uint64_t( bucket % sub_size + sub_size ) << shift;
+  }
+
+  static uint64_t bucket_high( size_t bucket )
+  {
+    if ( bucket < 2 * sub_size )
+    {
+      return bucket;
+    }
+    const unsigned shift = unsigned( bucket / sub_size ) - 1;
+    return bucket_low( bucket ) + ( ( uint64_t( 1 ) << shift ) - 1 );
+  }
+
+private:
+  std::atomic< uint64_t > m_counts[buckets];
+  std::atomic< uint64_t > m_max{0};
+};
+
+inline uint64_t histogram_snapshot::percentile( double q ) const
+{
+  if ( m_total == 0 )
+  {
+    return 0;
+  }
+
+  const uint64_t rank = std::max< uint64_t >( 1, uint64_t( q * m_total + 0.5 ) );
+  uint64_t       seen = 0;
+  for ( size_t ix = 0; ix < m_counts.size(); ++ix )
+  {
+    seen += m_counts[ix];
+    if ( seen >= rank )
+    {
+      return std::min( latency_histogram::bucket_high( ix ), m_max );
+    }
+  }
+  return m_max;
+}
+
+inline uint64_t histogram_snapshot::mean() const
+{
+  if ( m_total == 0 )
+  {
+    return 0;
+  }
+
+  // bucket midpoints
+  double sum = 0;
+  for ( size_t ix = 0; ix < m_counts.size(); ++ix )
+  {
+    if ( m_counts[ix] )
+    {
+      const double mid
+          = ( latency_histogram::bucket_low( ix ) + latency_histogram::bucket_high( ix ) ) / 2.0;
+      sum += mid * m_counts[ix];
+    }
+  }
+  return uint64_t( sum / m_total );
+}
+
+// records the ticks between construction and destruction
+class scoped_timer
+{
+public:
+  explicit scoped_timer( latency_histogram& into )
+      : m_into( into )
+      , m_start( tsc_clock::now() )
+  {
+  }
+
+  scoped_timer( const scoped_timer& ) = delete;
+  scoped_timer& operator=( const scoped_timer& ) = delete;
+
+  ~scoped_timer()
+  {
+    m_into.record( tsc_clock::now_ordered() - m_start );
+  }
+
+private:
+  latency_histogram& m_into;
+  uint64_t           m_start;
+};
+
+// named histograms, registered once and then used by reference. histograms live
+// as long as the registry and never move.
+class timing_scopes
+{
+public:
+  static timing_scopes& global()
+  {
+    static timing_scopes scopes;
+    return scopes;
+  }
+
+  // the histogram for name, made on first use. takes a lock, look it up once and
+  // keep the reference.
+  latency_histogram& scope( const std::string& name )
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+    auto&                         slot = m_scopes[name];
+    if ( !slot )
+    {
+      slot.reset( new latency_histogram );
+    }
+    return *slot;
+  }
+
+  // name and snapshot of every scope, in name order. values are ticks.
+  std::vector< std::pair< std::string, histogram_snapshot > > snapshot() const
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+
+    std::vector< std::pair< std::string, histogram_snapshot > > all;
+    for ( auto& entry : m_scopes )
+    {
+      all.emplace_back( entry.first, entry.second->snapshot() );
+    }
+    return all;
+  }
+
+  // one line per scope with samples: count, p50, p99, p999 and max in ns
+  void report( std::ostream& os ) const
+  {
+    for ( auto& entry : snapshot() )
+    {
+      const histogram_snapshot& s = entry.second;
+      if ( s.count() == 0 )
+      {
+        continue;
+      }
+      os << entry.first << ": n=" << s.count() << " p50=" << tsc_clock::to_ns( s.percentile( 0.5 ) )
+         << "ns p99=" << tsc_clock::to_ns( s.percentile( 0.99 ) )
+         << "ns p999=" << tsc_clock::to_ns( s.percentile( 0.999 ) )
+         << "ns max=" << tsc_clock::to_ns( s.max() ) << "ns\n";
+    }
+    os.flush();
+  }
+
+  void reset()
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+    for ( auto& entry : m_scopes )
+    {
+      entry.second->reset();
+    }
+  }
+
+private:
+  mutable std::mutex                                          m_lock;
+  std::map< std::string, std::unique_ptr< latency_histogram > > m_scopes;
+};
+
+// a span of elapsed time, printed as "(split time=1.5ms)"
+struct elapsed_time
+{
+  uint64_t ns;
+
+  double ms() const
+  {
+    return ns / 1e6;
+  }
+
+  friend std::ostream& operator<<( std::ostream& os, const elapsed_time& e )
+  {
+    return os << "(split time=" << e.ms() << "ms)";
+  }
+};
+
+// wall clock timing for the edges of a program: tsc_clock underneath, nothing
+// formatted until the result is printed, nothing printed unless asked
+class StopWatch
+{
+public:
+  StopWatch()
+  {
+    start();
+  }
+
+  void start()
+  {
+    m_start   = tsc_clock::now();
+    m_stopped = false;
+  }
+
+  // time since start, the clock keeps running
+  elapsed_time split() const
+  {
+    const uint64_t end = m_stopped ? m_end : tsc_clock::now_ordered();
+    return elapsed_time{tsc_clock::to_ns( end - m_start )};
+  }
+
+  // freeze the clock, later splits return the same
+  elapsed_time stop()
+  {
+    m_end     = tsc_clock::now_ordered();
+    m_stopped = true;
+    return split();
+  }
+
+  // record the time since start into h and start over, for repeated laps
+  void lap( latency_histogram& h )
+  {
+    const uint64_t now = tsc_clock::now_ordered();
+    h.record( now - m_start );
+    m_start = now;
+  }
+
+  friend std::ostream& operator<<( std::ostream& os, const StopWatch& rhs )
+  {
+    return os << rhs.split();
+  }
+
+private:
+  uint64_t m_start{0};
+  uint64_t m_end{0};
+  bool     m_stopped{false};
+};
@@ -0,0 +1,112 @@
+// what it costs to time a region. the demo's old StopWatch read
+// high_resolution_clock and formatted a string per split; steady_clock into the
+// histogram is the portable floor; scoped_timer is two timestamp counter reads
+// and one bucket add. all around an empty body, so the number is pure overhead.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "stopwatch.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+constexpr size_t iterations = 10000000;
+
+template < class Body >
+void per_call( const std::string& name, size_t count, Body&& body )
+{
+  auto start = clock_type::now();
+  for ( size_t ix = 0; ix < count; ++ix )
+  {
+    body();
+  }
+  std::chrono::duration< double, std::nano > elapsed = clock_type::now() - start;
+  std::cout << name << " " << elapsed.count() / count << "ns per timed region" << std::endl;
+}
+
+// what StopWatch::split() used to do
+std::string old_split( std::chrono::high_resolution_clock::time_point start )
+{
+  std::chrono::duration< double, std::milli > elapsed
+      = std::chrono::high_resolution_clock::now() - start;
+  std::stringstream ss;
+  ss << "(split time=" << elapsed.count() << "ms)";
+  return ss.str();
+}
+} // namespace
+
+TEST( StopWatchBench, Overhead )
+{
+  std::cout << "tsc " << ( tsc_clock::uses_tsc() ? "in use, " : "unusable, " )
+            << tsc_clock::ticks_per_ns() << " ticks/ns" << std::endl;
+
+  size_t chars = 0;
+  per_call( "old StopWatch split", iterations / 20, [&] {
+    auto start = std::chrono::high_resolution_clock::now();
+    chars += old_split( start ).size();
+  } );
+  EXPECT_GT( chars, 0u );
+
+  latency_histogram steady;
+  per_call( "steady_clock + histogram", iterations, [&] {
+    auto start = clock_type::now();
+    steady.record( ( clock_type::now() - start ).count() );
+  } );
+
+  latency_histogram& scoped = timing_scopes::global().scope( "bench.scoped_timer" );
+  per_call( "scoped_timer", iterations, [&] { scoped_timer timed( scoped ); } );
+
+  latency_histogram raw;
+  per_call( "tsc_clock::now pair + record", iterations, [&] {
+    const uint64_t start = tsc_clock::now();
+    raw.record( tsc_clock::now() - start );
+  } );
+
+  EXPECT_EQ( scoped.snapshot().count(), iterations );
+  timing_scopes::global().report( std::cout );
+}
+
+// every thread timing into the same histogram, the worst case for the counters
+TEST( StopWatchBench, SharedScope )
+{
+  for ( size_t threads : {1u, 2u, 4u} )
+  {
+    latency_histogram          shared;
+    std::vector< std::thread > workers;
+
+    auto start = clock_type::now();
+    for ( size_t t = 0; t < threads; ++t )
+    {
+      workers.emplace_back( [&] {
+        for ( size_t ix = 0; ix < iterations / threads; ++ix )
+        {
+          scoped_timer timed( shared );
+        }
+      } );
+    }
+    for ( auto& w : workers )
+    {
+      w.join();
+    }
+    std::chrono::duration< double, std::nano > elapsed = clock_type::now() - start;
+
+    auto s = shared.snapshot();
+    EXPECT_EQ( s.count(), iterations / threads * threads );
+    std::cout << threads << " threads " << elapsed.count() / s.count()
+              << "ns per timed region, p50 " << tsc_clock::to_ns( s.percentile( 0.5 ) )
+              << "ns p99 " << tsc_clock::to_ns( s.percentile( 0.99 ) ) << "ns p999 "
+              << tsc_clock::to_ns( s.percentile( 0.999 ) ) << "ns" << std::endl;
+  }
+}
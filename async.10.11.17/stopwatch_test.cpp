@@ -0,0 +1,197 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "stopwatch.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+using namespace std::chrono_literals;
+
+TEST( LatencyHistogram, BucketsCoverTheirValues )
+{
+  // exact below 64
+  for ( uint64_t v = 0; v < 64; ++v )
+  {
+    EXPECT_EQ( latency_histogram::bucket_of( v ), v );
+  }
+
+  // above, every value sits in a bucket whose range holds it and is at most 1/32
+  // of it wide, up to the top of the range
+  std::vector< uint64_t > values;
+  for ( uint64_t v = 64; v < 100000; v = v * 17 / 16 + 1 )
+  {
+    values.push_back( v );
+  }
+  for ( unsigned bit = 7; bit < 64; ++bit )
+  {
+    values.push_back( ( uint64_t( 1 ) << bit ) - 1 );
+    values.push_back( uint64_t( 1 ) << bit );
+    values.push_back( ( uint64_t( 1 ) << bit ) + 1 );
+  }
+  values.push_back( ~uint64_t( 0 ) );
+
+  for ( uint64_t v : values )
+  {
+    const size_t b = latency_histogram::bucket_of( v );
+    ASSERT_LT( b, latency_histogram::buckets );
+    EXPECT_LE( latency_histogram::bucket_low( b ), v );
+    EXPECT_GE( latency_histogram::bucket_high( b ), v );
+    EXPECT_LE( latency_histogram::bucket_high( b ) - latency_histogram::bucket_low( b ), v / 32 );
+  }
+
+  // and the buckets tile the range without gaps
+  for ( size_t b = 1; b < latency_histogram::buckets; ++b )
+  {
+    EXPECT_EQ( latency_histogram::bucket_low( b ), latency_histogram::bucket_high( b - 1 ) + 1 );
+  }
+  EXPECT_EQ( latency_histogram::bucket_high( latency_histogram::buckets - 1 ), ~uint64_t( 0 ) );
+}
+
+TEST( LatencyHistogram, Percentiles )
+{
+  latency_histogram h;
+  EXPECT_EQ( h.snapshot().count(), 0u );
+  EXPECT_EQ( h.snapshot().percentile( 0.99 ), 0u );
+
+  // 1..10000, each once
+  for ( uint64_t v = 1; v <= 10000; ++v )
+  {
+    h.record( v );
+  }
+
+  auto s = h.snapshot();
+  EXPECT_EQ( s.count(), 10000u );
+  EXPECT_EQ( s.max(), 10000u );
+  EXPECT_EQ( s.percentile( 1.0 ), 10000u );
+  EXPECT_NEAR( double( s.percentile( 0.5 ) ), 5000, 5000 / 32.0 );
+  EXPECT_NEAR( double( s.percentile( 0.99 ) ), 9900, 9900 / 32.0 );
+  EXPECT_NEAR( double( s.percentile( 0.999 ) ), 9990, 9990 / 32.0 );
+  EXPECT_NEAR( double( s.mean() ), 5000, 5000 / 32.0 );
+
+  // one outlier shows in max and p999 of a small sample, not in p50
+  latency_histogram tail;
+  for ( int ix = 0; ix < 999; ++ix )
+  {
+    tail.record( 10 );
+  }
+  tail.record( 1000000 );
+  auto t = tail.snapshot();
+  EXPECT_EQ( t.percentile( 0.5 ), 10u );
+  EXPECT_EQ( t.percentile( 0.99 ), 10u );
+  EXPECT_EQ( t.max(), 1000000u );
+
+  tail.reset();
+  EXPECT_EQ( tail.snapshot().count(), 0u );
+  EXPECT_EQ( tail.snapshot().max(), 0u );
+}
+
+TEST( LatencyHistogram, ConcurrentRecordsAllCount )
+{
+  latency_histogram h;
+
+  constexpr uint64_t         per_thread = 100000;
+  std::vector< std::thread > threads;
+  for ( uint64_t t = 0; t < 4; ++t )
+  {
+    threads.emplace_back( [&h, t] {
+      for ( uint64_t ix = 0; ix < per_thread; ++ix )
+      {
+        h.record( ix % 100 + t * 1000 );
+      }
+    } );
+  }
+  for ( auto& t : threads )
+  {
+    t.join();
+  }
+
+  auto s = h.snapshot();
+  EXPECT_EQ( s.count(), 4 * per_thread );
+  EXPECT_EQ( s.max(), 3099u );
+}
+
+TEST( TscClock, TicksConvertToWallTime )
+{
+  tsc_clock::now(); // calibrates, outside the timed span
+
+  const auto     wall0 = std::chrono::steady_clock::now();
+  const uint64_t t0    = tsc_clock::now();
+  std::this_thread::sleep_for( 50ms );
+  const uint64_t t1    = tsc_clock::now_ordered();
+  const auto     wall1 = std::chrono::steady_clock::now();
+
+  const double wall = std::chrono::duration< double, std::nano >( wall1 - wall0 ).count();
+  EXPECT_GT( t1, t0 );
+  EXPECT_NEAR( double( tsc_clock::to_ns( t1 - t0 ) ), wall, wall * 0.02 );
+  EXPECT_GT( tsc_clock::ticks_per_ns(), 0.0 );
+  if ( !tsc_clock::uses_tsc() )
+  {
+    EXPECT_EQ( tsc_clock::to_ns( 12345 ), 12345u );
+  }
+}
+
+TEST( TimingScopes, NamedScopesCollectAndReport )
+{
+  timing_scopes scopes;
+
+  latency_histogram& sleepy = scopes.scope( "sleepy" );
+  EXPECT_EQ( &scopes.scope( "sleepy" ), &sleepy );
+  latency_histogram& idle = scopes.scope( "idle" );
+  EXPECT_NE( &idle, &sleepy );
+
+  for ( int ix = 0; ix < 5; ++ix )
+  {
+    scoped_timer timed( sleepy );
+    std::this_thread::sleep_for( 2ms );
+  }
+
+  auto all = scopes.snapshot();
+  ASSERT_EQ( all.size(), 2u );
+  EXPECT_EQ( all[0].first, "idle" );
+  EXPECT_EQ( all[0].second.count(), 0u );
+  EXPECT_EQ( all[1].first, "sleepy" );
+  EXPECT_EQ( all[1].second.count(), 5u );
+  EXPECT_GE( tsc_clock::to_ns( all[1].second.percentile( 0.5 ) ), 1900000u );
+
+  // only scopes with samples are reported
+  std::ostringstream os;
+  scopes.report( os );
+  EXPECT_EQ( os.str().find( "idle" ), std::string::npos );
+  EXPECT_EQ( os.str().find( "sleepy: n=5 p50=" ), 0u );
+  EXPECT_NE( os.str().find( "p999=" ), std::string::npos );
+
+  scopes.reset();
+  EXPECT_EQ( sleepy.snapshot().count(), 0u );
+}
+
+TEST( StopWatch, SplitsStopsAndLaps )
+{
+  StopWatch watch;
+  std::this_thread::sleep_for( 10ms );
+  EXPECT_GE( watch.split().ns, 9000000u );
+
+  auto stopped = watch.stop();
+  std::this_thread::sleep_for( 5ms );
+  EXPECT_EQ( watch.split().ns, stopped.ns );
+
+  std::ostringstream os;
+  os << elapsed_time{1500000};
+  EXPECT_EQ( os.str(), "(split time=1.5ms)" );
+
+  latency_histogram laps;
+  watch.start();
+  for ( int ix = 0; ix < 3; ++ix )
+  {
+    std::this_thread::sleep_for( 1ms );
+    watch.lap( laps );
+  }
+  EXPECT_EQ( laps.snapshot().count(), 3u );
+  EXPECT_GE( tsc_clock::to_ns( laps.snapshot().percentile( 0.0 ) ), 900000u );
+}
@@ -0,0 +1,395 @@
+#pragma once
+
+// c++20 coroutines over thread_pool and timer_queue, so waiting never parks a
+// thread. task<T> is lazy: nothing runs until it is awaited or started, and a
+// finished task resumes whoever awaited it by symmetric transfer.
+//
+//   co_await schedule( pool );         continue on one of pool's workers
+//   co_await delay( timers, 2s );      suspend, resumed by the timer thread
+//   co_await delay( timers, 2s, pool ) same, resumed on pool
+//   co_await std::move( fut )          a future.hpp future, resumed where it completes
+//   start( t ) / start( pool, t )      run a task, its result as a future.hpp future
+//   sync_wait( t )                     start( t ).get()
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "future.hpp"
+#include "thread_pool.hpp"
+#include "timer_queue.hpp"
+
+template < class T = void >
+class task;
+
+namespace detail
+{
+struct task_final_awaiter
+{
+  bool await_ready() noexcept
+  {
+    return false;
+  }
+
+  template < class Promise >
+  std::coroutine_handle<> await_suspend( std::coroutine_handle< Promise > done ) noexcept
+  {
+    auto next = done.promise().continuation;
+    return next ? next : std::noop_coroutine();
+  }
+
+  void await_resume() noexcept
+  {
+  }
+};
+
+struct task_promise_base
+{
+  std::suspend_always initial_suspend() noexcept
+  {
+    return {};
+  }
+
+  task_final_awaiter final_suspend() noexcept
+  {
+    return {};
+  }
+
+  void unhandled_exception() noexcept
+  {
+    error = std::current_exception();
+  }
+
+  std::coroutine_handle<> continuation;
+  std::exception_ptr      error;
+};
+
+template < class T >
+struct task_promise : task_promise_base
+{
+  task< T > get_return_object() noexcept;
+
+  template < class U >
+  void return_value( U&& v )
+  {
+    value.emplace( std::forward< U >( v ) );
+  }
+
+  T result()
+  {
+    if ( error )
+    {
+      std::rethrow_exception( error );
+    }
+    return std::move( *value );
+  }
+
+  std::optional< T > value;
+};
+
+template <>
+struct task_promise< void > : task_promise_base
+{
+  task< void > get_return_object() noexcept;
+
+  void return_void() noexcept
+  {
+  }
+
+  void result()
+  {
+    if ( error )
+    {
+      std::rethrow_exception( error );
+    }
+  }
+};
+} // namespace detail
+
+template < class T >
+class [[nodiscard]] task
+{
+public:
+  using promise_type = detail::task_promise< T >;
+  using handle_type  = std::coroutine_handle< promise_type >;
+
+  task( task&& other ) noexcept
+      : m_handle( std::exchange( other.m_handle, {} ) )
+  {
+  }
+
+  task& operator=( task&& other ) noexcept
+  {
+    if ( this != &other )
+    {
+      if ( m_handle )
+      {
+        m_handle.destroy();
+      }
+      m_handle = std::exchange( other.m_handle, {} );
+    }
+    return *this;
+  }
+
+  task( const task& ) = delete;
+  task& operator=( const task& ) = delete;
+
+  ~task()
+  {
+    if ( m_handle )
+    {
+      m_handle.destroy();
+    }
+  }
+
+  bool done() const
+  {
+    return !m_handle || m_handle.done();
+  }
+
+  // starts the task; the awaiting coroutine resumes when it finishes, with its
+  // result or its exception
+  auto operator co_await() const noexcept
+  {
+    struct awaiter
+    {
+      handle_type handle;
+
+      bool await_ready() noexcept
+      {
+        return !handle || handle.done();
+      }
+
+      std::coroutine_handle<> await_suspend( std::coroutine_handle<> awaiting ) noexcept
+      {
+        handle.promise().continuation = awaiting;
+        return handle;
+      }
+
+      T await_resume()
+      {
+        return handle.promise().result();
+      }
+    };
+    return awaiter{m_handle};
+  }
+
+private:
+  friend promise_type;
+
+  explicit task( handle_type handle ) noexcept
+      : m_handle( handle )
+  {
+  }
+
+  handle_type m_handle;
+}; // task
+
+namespace detail
+{
+template < class T >
+task< T > task_promise< T >::get_return_object() noexcept
+{
+  return task< T >( std::coroutine_handle< task_promise< T > >::from_promise( *this ) );
+}
+
+inline task< void > task_promise< void >::get_return_object() noexcept
+{
+  return task< void >( std::coroutine_handle< task_promise< void > >::from_promise( *this ) );
+}
+
+// starts immediately and frees itself when done, nobody awaits it
+struct detached_task
+{
+  struct promise_type
+  {
+    detached_task get_return_object() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never initial_suspend() noexcept
+    {
+      return {};
+    }
+
+    std::suspend_never final_suspend() noexcept
+    {
+      return {};
+    }
+
+    void return_void() noexcept
+    {
+    }
+
+    void unhandled_exception() noexcept
+    {
+      std::terminate();
+    }
+  };
+};
+
+struct schedule_awaiter
+{
+  thread_pool& pool;
+
+  bool await_ready() noexcept
+  {
+    return false;
+  }
+
+  // throws, into the coroutine, if the pool has shut down
+  void await_suspend( std::coroutine_handle<> h )
+  {
+    pool.post( [h] { h.resume(); } );
+  }
+
+  void await_resume() noexcept
+  {
+  }
+};
+
+template < class Timers >
+struct delay_awaiter
+{
+  Timers&                               timers;
+  typename Timers::clock_type::duration length;
+  thread_pool*                          pool;
+
+  bool await_ready() noexcept
+  {
+    return length.count() <= 0;
+  }
+
+  void await_suspend( std::coroutine_handle<> h )
+  {
+    thread_pool* target = pool;
+    timers.schedule_after( length, [h, target] {
+      if ( target )
+      {
+        target->post( [h] { h.resume(); } );
+      }
+      else
+      {
+        h.resume();
+      }
+    } );
+  }
+
+  void await_resume() noexcept
+  {
+  }
+};
+
+template < class T >
+struct future_awaiter
+{
+  future< T > fut;
+
+  bool await_ready()
+  {
+    return fut.is_ready();
+  }
+
+  void await_suspend( std::coroutine_handle<> h )
+  {
+    auto resume = [h] { h.resume(); };
+    future_access::state( fut )->on_ready( std::unique_ptr< pool_task >(
+        new pool_task_impl< decltype( resume ) >( std::move( resume ) ) ) );
+  }
+
+  // ready by now, so this only moves the value out or rethrows
+  T await_resume()
+  {
+    return fut.get();
+  }
+};
+
+template < class T >
+detached_task drive( task< T > work, promise< T > done, thread_pool* pool )
+{
+  try
+  {
+    if ( pool )
+    {
+      co_await schedule_awaiter{*pool};
+    }
+
+    if constexpr ( std::is_void_v< T > )
+    {
+      co_await work;
+      done.set_value();
+    }
+    else
+    {
+      done.set_value( co_await work );
+    }
+  }
+  catch ( ... )
+  {
+    done.set_exception( std::current_exception() );
+  }
+}
+} // namespace detail
+
+// continue the awaiting coroutine on one of pool's workers
+inline detail::schedule_awaiter schedule( thread_pool& pool )
+{
+  return {pool};
+}
+
+// suspend for d without holding a thread. resumed on the timer thread, which
+// should only be used to hop elsewhere or for very short work, or on pool.
+template < class Timers, class Rep, class Period >
+detail::delay_awaiter< Timers > delay( Timers& timers, std::chrono::duration< Rep, Period > d,
+                                       thread_pool* pool = nullptr )
+{
+  using duration = typename Timers::clock_type::duration;
+  return {timers, std::chrono::duration_cast< duration >( d ), pool};
+}
+
+template < class Timers, class Rep, class Period >
+detail::delay_awaiter< Timers > delay( Timers& timers, std::chrono::duration< Rep, Period > d,
+                                       thread_pool& pool )
+{
+  return delay( timers, d, &pool );
+}
+
+// suspend until f completes, resumed on the thread that completes it (or right
+// away if it already has). takes the result, or rethrows what f holds.
+template < class T >
+detail::future_awaiter< T > operator co_await( future< T >&& f )
+{
+  return {std::move( f )};
+}
+
+// run t on the calling thread up to its first suspension, the future completes
+// with its result
+template < class T >
+future< T > start( task< T > t )
+{
+  promise< T > p;
+  auto         f = p.get_future();
+  detail::drive( std::move( t ), std::move( p ), nullptr );
+  return f;
+}
+
+// run t on pool from the start
+template < class T >
+future< T > start( thread_pool& pool, task< T > t )
+{
+  promise< T > p;
+  auto         f = p.get_future();
+  detail::drive( std::move( t ), std::move( p ), &pool );
+  return f;
+}
+
+// block the calling thread until t finishes, for the edges of a program and tests
+template < class T >
+T sync_wait( task< T > t )
+{
+  return start( std::move( t ) ).get();
+}
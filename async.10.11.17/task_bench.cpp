@@ -0,0 +1,136 @@
+// coroutine switch costs: awaiting a task that completes inline, hopping onto a
+// pool worker and back, against two threads handing a token back and forth
+// through a mutex and condition variable
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "task.hpp"
+#include "thread_pool.hpp"
+#include "timer_queue.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+using namespace std::chrono_literals;
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+void report( const std::string& name, size_t switches, clock_type::time_point start )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << elapsed.count() * 1e9 / switches << " ns/switch" << std::endl;
+}
+
+task< size_t > leaf( size_t ix )
+{
+  co_return ix;
+}
+
+task< size_t > await_leaves( size_t count )
+{
+  size_t sum = 0;
+  for ( size_t ix = 0; ix < count; ++ix )
+  {
+    sum += co_await leaf( ix );
+  }
+  co_return sum;
+}
+
+// every iteration leaves the current worker and is resumed from the pool's queue
+task< void > hop( thread_pool& pool, size_t count )
+{
+  for ( size_t ix = 0; ix < count; ++ix )
+  {
+    co_await schedule( pool );
+  }
+}
+} // namespace
+
+TEST( TaskBench, AwaitInline )
+{
+  constexpr size_t count = 10000000;
+
+  auto start = clock_type::now();
+  EXPECT_EQ( sync_wait( await_leaves( count ) ), count * ( count - 1 ) / 2 );
+  // into the leaf and back out again
+  report( "co_await ready task", count * 2, start );
+}
+
+TEST( TaskBench, ScheduleHop )
+{
+  constexpr size_t count = 1000000;
+  thread_pool      pool( 1 );
+
+  auto start = clock_type::now();
+  sync_wait( hop( pool, count ) );
+  report( "co_await schedule(pool)", count, start );
+}
+
+TEST( TaskBench, ThreadPingPong )
+{
+  constexpr size_t count = 100000;
+
+  std::mutex              lock;
+  std::condition_variable cv;
+  bool                    ping = true;
+
+  auto start = clock_type::now();
+
+  std::thread other( [&] {
+    for ( size_t ix = 0; ix < count; ++ix )
+    {
+      std::unique_lock< std::mutex > locker{lock};
+      cv.wait( locker, [&] { return !ping; } );
+      ping = true;
+      cv.notify_one();
+    }
+  } );
+
+  for ( size_t ix = 0; ix < count; ++ix )
+  {
+    std::unique_lock< std::mutex > locker{lock};
+    ping = false;
+    cv.notify_one();
+    cv.wait( locker, [&] { return ping; } );
+  }
+  other.join();
+
+  // one round trip is two switches
+  report( "thread condvar ping-pong", count * 2, start );
+}
+
+TEST( TaskBench, TimerWakeups )
+{
+  constexpr size_t count = 100000;
+
+  timer_queue timers;
+  thread_pool pool( 1 );
+
+  auto sleeper = [&]( size_t ix ) -> task< void > {
+    co_await delay( timers, std::chrono::milliseconds( 10 + ix % 100 ), pool );
+  };
+
+  auto begin = clock_type::now();
+
+  std::vector< future< void > > all;
+  all.reserve( count );
+  for ( size_t ix = 0; ix < count; ++ix )
+  {
+    all.push_back( start( pool, sleeper( ix ) ) );
+  }
+  when_all( std::move( all ) ).get();
+
+  std::chrono::duration< double, std::milli > elapsed = clock_type::now() - begin;
+  std::cout << count << " concurrent 10-110ms sleeps on 1 worker + timer thread: "
+            << elapsed.count() << "ms" << std::endl;
+}
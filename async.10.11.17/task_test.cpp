@@ -0,0 +1,222 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "task.hpp"
+#include "thread_pool.hpp"
+#include "timer_queue.hpp"
+#include "timer_wheel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+using namespace std::chrono_literals;
+
+namespace
+{
+task< int > answer()
+{
+  co_return 42;
+}
+
+task< int > twice( task< int > inner )
+{
+  int v = co_await inner;
+  co_return v * 2;
+}
+
+task< void > fail()
+{
+  throw std::runtime_error( "boom" );
+  co_return;
+}
+} // namespace
+
+TEST( TimerQueue, FiresInDeadlineOrder )
+{
+  timer_queue          timers;
+  std::mutex           lock;
+  std::vector< int >   order;
+  std::promise< void > done;
+
+  auto record = [&]( int id ) {
+    return [&, id] {
+      std::lock_guard< std::mutex > locker{lock};
+      order.push_back( id );
+      if ( order.size() == 4 )
+      {
+        done.set_value();
+      }
+    };
+  };
+
+  timers.schedule_after( 30ms, record( 3 ) );
+  timers.schedule_after( 10ms, record( 1 ) );
+  timers.schedule_after( 20ms, record( 2 ) );
+  timers.schedule_after( 20ms, record( 22 ) ); // same deadline, scheduled later
+
+  done.get_future().get();
+  EXPECT_EQ( order, ( std::vector< int >{1, 2, 22, 3} ) );
+  EXPECT_EQ( timers.pending(), 0u );
+}
+
+TEST( Task, IsLazy )
+{
+  bool ran  = false;
+  auto body = [&]() -> task< void > {
+    ran = true;
+    co_return;
+  };
+
+  auto t = body();
+  EXPECT_FALSE( ran );
+  sync_wait( std::move( t ) );
+  EXPECT_TRUE( ran );
+}
+
+TEST( Task, AwaitsAndPropagates )
+{
+  EXPECT_EQ( sync_wait( twice( answer() ) ), 84 );
+  EXPECT_THROW( sync_wait( fail() ), std::runtime_error );
+}
+
+TEST( Task, ScheduleHopsOntoPool )
+{
+  thread_pool pool( 2 );
+
+  auto body = [&]() -> task< bool > {
+    bool before = pool.on_worker();
+    co_await schedule( pool );
+    co_return !before && pool.on_worker();
+  };
+  EXPECT_TRUE( sync_wait( body() ) );
+
+  auto f = start( pool, answer() );
+  EXPECT_EQ( f.get(), 42 );
+}
+
+// WaitForIt without a thread sleeping through the delay
+TEST( Task, WaitForIt )
+{
+  timer_queue timers;
+  thread_pool pool( 1 );
+
+  auto waiter = [&]() -> task< std::string > {
+    co_await delay( timers, 200ms, pool );
+    co_return "hello!!!";
+  };
+
+  auto start_time = std::chrono::steady_clock::now();
+  EXPECT_EQ( sync_wait( waiter() ), "hello!!!" );
+  EXPECT_GE( std::chrono::steady_clock::now() - start_time, 200ms );
+}
+
+// the same awaiter on a timer_wheel
+TEST( Task, DelayOnATimerWheel )
+{
+  timer_wheel timers;
+  thread_pool pool( 1 );
+
+  auto waiter = [&]() -> task< bool > {
+    co_await delay( timers, 20ms, pool );
+    co_return pool.on_worker();
+  };
+
+  auto start_time = std::chrono::steady_clock::now();
+  EXPECT_TRUE( sync_wait( waiter() ) );
+  EXPECT_GE( std::chrono::steady_clock::now() - start_time, 20ms );
+}
+
+// PackagedTask: hand a computation to a worker, get the result back
+TEST( Task, PackagedTask )
+{
+  timer_queue timers;
+  thread_pool pool( 1 );
+
+  auto return_waiter = [&]() -> task< std::string > {
+    co_await delay( timers, 50ms );
+    co_return "hello!!!";
+  };
+
+  future< std::string > fu = start( pool, return_waiter() );
+  EXPECT_EQ( fu.get(), "hello!!!" );
+}
+
+TEST( Task, ThousandsOfWaitsOnAFewThreads )
+{
+  constexpr size_t count = 10000;
+
+  timer_queue timers;
+  thread_pool pool( 2 );
+
+  std::mutex                  lock;
+  std::set< std::thread::id > threads;
+  std::atomic< size_t >       finished{0};
+
+  auto sleeper = [&]( int ms ) -> task< void > {
+    co_await delay( timers, std::chrono::milliseconds( ms ), pool );
+    {
+      std::lock_guard< std::mutex > locker{lock};
+      threads.insert( std::this_thread::get_id() );
+    }
+    finished.fetch_add( 1 );
+  };
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  std::vector< future< void > > all;
+  for ( size_t ix = 0; ix < count; ++ix )
+  {
+    all.push_back( start( pool, sleeper( 100 + int( ix % 50 ) ) ) );
+  }
+  when_all( std::move( all ) ).get();
+
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+  EXPECT_EQ( finished.load(), count );
+  EXPECT_LE( threads.size(), 2u );
+  // run one after another they'd take over 1000s
+  EXPECT_LT( elapsed, 5s );
+}
+
+TEST( Task, AwaitsFutures )
+{
+  thread_pool pool( 1 );
+
+  auto add = [&]( future< int > a, future< int > b ) -> task< int > {
+    int x = co_await std::move( a );
+    int y = co_await std::move( b );
+    co_return x + y;
+  };
+
+  // one ready, one completed later from the pool
+  promise< int > later;
+  auto           sum = start( add( make_ready_future( 1 ), later.get_future() ) );
+  EXPECT_FALSE( sum.is_ready() );
+  pool.post( [&] { later.set_value( 41 ); } );
+  EXPECT_EQ( sum.get(), 42 );
+
+  // a stored exception comes out of the co_await
+  auto rethrows = [&]( future< void > f ) -> task< std::string > {
+    try
+    {
+      co_await std::move( f );
+    }
+    catch ( const std::runtime_error& e )
+    {
+      co_return e.what();
+    }
+    co_return "no throw";
+  };
+  promise< void > broken;
+  auto            what = start( rethrows( broken.get_future() ) );
+  broken.set_exception( std::make_exception_ptr( std::runtime_error( "boom" ) ) );
+  EXPECT_EQ( what.get(), "boom" );
+}
@@ -0,0 +1,858 @@
+#pragma once
+
+// work stealing thread pool. every worker owns a chase-lev deque: it pushes and
+// pops its own end newest first, which keeps freshly spawned work hot in its
+// cache, while idle workers steal the oldest tasks from the other end. tasks
+// submitted from outside the pool go through a shared injection queue. a worker
+// that finds nothing anywhere parks on a condition variable until work shows up.
+// stats() tells what each worker has been doing, see pool_stats.hpp.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "pool_stats.hpp"
+#include "stop_token.hpp"
+#include "topology.hpp"
+
+// single owner, many thief deque of plain values (task pointers here).
+// Chase and Lev, "Dynamic Circular Work-Stealing Deque", with the memory orderings
+// from Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+// push() and pop() belong to the owning thread, steal() may be called from any.
+template < class T >
+class chase_lev_deque
+{
+  static_assert( std::is_trivially_copyable< T >::value, "chase_lev_deque holds plain values" );
+
+public:
+  // capacity is rounded up to a power of two, the deque grows past it as needed
+  explicit chase_lev_deque( size_t capacity = 256 )
+  {
+    size_t n = 1;
+    while ( n < capacity )
+    {
+      n <<= 1;
+    }
+    m_rings.emplace_back( new ring( n ) );
+    m_ring.store( m_rings.back().get(), std::memory_order_relaxed );
+  }
+
+  chase_lev_deque( const chase_lev_deque& ) = delete;
+  chase_lev_deque& operator=( const chase_lev_deque& ) = delete;
+
+  // returns the depth after the push, as of the last steal push() saw
+  size_t push( T value )
+  {
+    int64_t b = m_bottom.load( std::memory_order_relaxed );
+    int64_t t = m_top.load( std::memory_order_acquire );
+    ring*   r = m_ring.load( std::memory_order_relaxed );
+    if ( b - t > int64_t( r->mask ) )
+    {
+      r = grow( r, t, b );
+    }
+    r->put( b, value );
+    std::atomic_thread_fence( std::memory_order_release );
+    m_bottom.store( b + 1, std::memory_order_relaxed );
+    return size_t( b + 1 - t );
+  }
+
+  // newest first. false when empty or when a thief won the race for the last value
+  bool pop( T& out )
+  {
+    int64_t b = m_bottom.load( std::memory_order_relaxed ) - 1;
+    ring*   r = m_ring.load( std::memory_order_relaxed );
+    m_bottom.store( b, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    int64_t t = m_top.load( std::memory_order_relaxed );
+
+    if ( t > b )
+    {
+      m_bottom.store( b + 1, std::memory_order_relaxed );
+      return false;
+    }
+
+    out = r->get( b );
+    if ( t < b )
+    {
+      return true;
+    }
+
+    // the last value, thieves may be going for it too
+    bool won = m_top.compare_exchange_strong(
+        t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+    m_bottom.store( b + 1, std::memory_order_relaxed );
+    return won;
+  }
+
+  // oldest first. false when empty or when another thread got there first
+  bool steal( T& out )
+  {
+    int64_t t = m_top.load( std::memory_order_acquire );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    int64_t b = m_bottom.load( std::memory_order_acquire );
+    if ( t >= b )
+    {
+      return false;
+    }
+
+    ring* r     = m_ring.load( std::memory_order_acquire );
+    T     value = r->get( t );
+    if ( !m_top.compare_exchange_strong(
+             t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+    {
+      return false;
+    }
+    out = value;
+    return true;
+  }
+
+  // a snapshot, only exact when nobody else is touching the deque
+  size_t size() const
+  {
+    int64_t b = m_bottom.load( std::memory_order_relaxed );
+    int64_t t = m_top.load( std::memory_order_relaxed );
+    return b > t ? size_t( b - t ) : 0;
+  }
+
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+private:
+  struct ring
+  {
+    explicit ring( size_t capacity )
+        : mask( capacity - 1 )
+        , slots( new std::atomic< T >[capacity] )
+    {
+    }
+
+    T get( int64_t ix ) const
+    {
+      return slots[ix & mask].load( std::memory_order_relaxed );
+    }
+
+    void put( int64_t ix, T value )
+    {
+      slots[ix & mask].store( value, std::memory_order_relaxed );
+    }
+
+    size_t                                mask;
+    std::unique_ptr< std::atomic< T >[] > slots;
+  };
+
+  ring* grow( ring* old, int64_t top, int64_t bottom )
+  {
+    m_rings.emplace_back( new ring( ( old->mask + 1 ) * 2 ) );
+    ring* r = m_rings.back().get();
+    for ( int64_t ix = top; ix < bottom; ++ix )
+    {
+      r->put( ix, old->get( ix ) );
+    }
+    m_ring.store( r, std::memory_order_release );
+    return r;
+  }
+
+  // thieves hammer top, keep it off the owner's line
+  alignas( 64 ) std::atomic< int64_t > m_top{0};
+  alignas( 64 ) std::atomic< int64_t > m_bottom{0};
+  std::atomic< ring* > m_ring{nullptr};
+
+  // outgrown rings stay alive with the deque, a thief may still be reading one
+  std::vector< std::unique_ptr< ring > > m_rings;
+}; // chase_lev_deque
+
+namespace detail
+{
+struct pool_task
+{
+  virtual ~pool_task() = default;
+  virtual void run()   = 0;
+};
+
+template < class F >
+struct pool_task_impl : pool_task
+{
+  template < class U >
+  explicit pool_task_impl( U&& f )
+      : fn( std::forward< U >( f ) )
+  {
+  }
+
+  void run() override
+  {
+    fn();
+  }
+
+  F fn;
+};
+
+// the worker running a task, for the stats of the sampled ones
+inline worker_counters*& current_counters()
+{
+  static thread_local worker_counters* counters = nullptr;
+  return counters;
+}
+
+// one sampled task in stats_sample_every, wrapped as it is queued so the rest
+// carry no timestamp
+class timed_task : public pool_task
+{
+public:
+  explicit timed_task( std::unique_ptr< pool_task > task )
+      : m_task( std::move( task ) )
+      , m_queued( tsc_clock::now() )
+  {
+  }
+
+  void run() override
+  {
+    const uint64_t started = tsc_clock::now();
+    m_task->run();
+    const uint64_t finished = tsc_clock::now_ordered();
+    if ( worker_counters* stats = current_counters() )
+    {
+      stats->wait.record( started > m_queued ? started - m_queued : 0 );
+      stats->run.record( finished > started ? finished - started : 0 );
+    }
+  }
+
+private:
+  std::unique_ptr< pool_task > m_task;
+  uint64_t                     m_queued;
+};
+
+// tasks the calling thread queued from outside the pool since its last
+// sampled one. workers keep their own count, off thread-local storage.
+inline uint32_t& outside_queued()
+{
+  static thread_local uint32_t queued = 0;
+  return queued;
+}
+
+// queued counts the tasks of one worker, or of one thread outside the pool
+inline void sample( std::unique_ptr< pool_task >& task, uint32_t& queued )
+{
+  if ( sample_now( queued ) )
+  {
+    task.reset( new timed_task( std::move( task ) ) );
+  }
+}
+
+// call f with the bound arguments moved out, the pool invokes every task once
+template < class F, class Tuple, size_t... I >
+auto apply_moved( F& f, Tuple& args, std::index_sequence< I... > )
+    -> decltype( f( std::move( std::get< I >( args ) )... ) )
+{
+  return f( std::move( std::get< I >( args ) )... );
+}
+
+// the same with the token in front, for functions that take one
+template < class F, class... Args >
+constexpr bool takes_token = std::is_invocable< F&, const stop_token&, Args... >::value;
+
+template < class F, class Tuple, size_t... I >
+decltype( auto ) apply_moved( F& f, const stop_token& token, Tuple& args,
+                              std::index_sequence< I... > )
+{
+  if constexpr ( takes_token< F, std::tuple_element_t< I, Tuple >... > )
+  {
+    return f( token, std::move( std::get< I >( args ) )... );
+  }
+  else
+  {
+    return f( std::move( std::get< I >( args ) )... );
+  }
+}
+
+template < class F, class... Args >
+using token_call_result_t =
+    decltype( apply_moved( std::declval< std::decay_t< F >& >(), std::declval< stop_token& >(),
+                           std::declval< std::tuple< std::decay_t< Args >... >& >(),
+                           std::index_sequence_for< Args... >{} ) );
+
+// run( token ) or cancel(), whichever claims the job first; the other is a no-op.
+// a stop while queued cancels from the stopping thread and frees the job there,
+// the worker that reaches the empty task later just discards it.
+template < class Job >
+class cancellable_task : public pool_task
+{
+public:
+  cancellable_task( stop_token token, Job job )
+      : m_token( std::move( token ) )
+      , m_job( std::move( job ) )
+  {
+    m_on_stop.emplace( m_token, canceller{this} );
+  }
+
+  void run() override
+  {
+    if ( claim() )
+    {
+      m_on_stop.reset();
+      m_job->run( m_token );
+    }
+  }
+
+private:
+  struct canceller
+  {
+    cancellable_task* self;
+
+    void operator()() const
+    {
+      if ( self->claim() )
+      {
+        self->m_job->cancel();
+        self->m_job.reset();
+      }
+    }
+  };
+
+  bool claim()
+  {
+    return !m_claimed.exchange( true, std::memory_order_acq_rel );
+  }
+
+  stop_token                                  m_token;
+  std::atomic< bool >                         m_claimed{false};
+  std::optional< Job >                        m_job;
+  std::optional< stop_callback< canceller > > m_on_stop; // last, unhooked first
+};
+
+// completes a promise (std:: or future.hpp) with call( token ), or with
+// operation_cancelled
+template < class Promise, class Call >
+struct promise_job
+{
+  Promise promise;
+  Call    call;
+
+  void run( const stop_token& token )
+  {
+    try
+    {
+      if constexpr ( std::is_void< decltype( call( token ) ) >::value )
+      {
+        call( token );
+        promise.set_value();
+      }
+      else
+      {
+        promise.set_value( call( token ) );
+      }
+    }
+    catch ( ... )
+    {
+      promise.set_exception( std::current_exception() );
+    }
+  }
+
+  void cancel()
+  {
+    promise.set_exception( std::make_exception_ptr( operation_cancelled() ) );
+  }
+};
+
+// f( args... ) later, with the token in front if f takes one
+template < class F, class... Args >
+auto bind_with_token( F&& f, Args&&... args )
+{
+  return [fn    = std::decay_t< F >( std::forward< F >( f ) ),
+          bound = std::make_tuple( std::forward< Args >( args )... )](
+             const stop_token& token ) mutable -> decltype( auto ) {
+    return apply_moved( fn, token, bound, std::index_sequence_for< Args... >{} );
+  };
+}
+
+template < class F >
+struct skip_on_cancel
+{
+  F fn;
+
+  void run( const stop_token& token )
+  {
+    fn( token );
+  }
+
+  void cancel()
+  {
+  }
+};
+} // namespace detail
+
+class thread_pool
+{
+public:
+  // threads = 0 means one per cpu
+  explicit thread_pool( size_t threads = 0 )
+  {
+    if ( threads == 0 )
+    {
+      threads = std::max< size_t >( 1, std::thread::hardware_concurrency() );
+    }
+    start( threads );
+  }
+
+  // workers pinned where topology says, threads = 0 means the placement's
+  // natural count (one per core for per_core, one per cpu otherwise). a worker
+  // the kernel will not pin runs unpinned.
+  thread_pool( size_t threads, placement where,
+               const cpu_topology& topology = cpu_topology::system() )
+  {
+    if ( threads == 0 )
+    {
+      threads = std::max< size_t >( 1, topology.natural_workers( where ) );
+    }
+    m_affinity = topology.place( where, threads );
+    start( threads );
+  }
+
+  thread_pool( const thread_pool& ) = delete;
+  thread_pool& operator=( const thread_pool& ) = delete;
+
+  ~thread_pool()
+  {
+    shutdown();
+  }
+
+  size_t size() const
+  {
+    return m_queues.size();
+  }
+
+  // run f(args...) on the pool. the arguments are moved in and handed to f as
+  // rvalues, the future carries the result or whatever f threw.
+  template < class F, class... Args >
+  auto submit( F&& f, Args&&... args )
+      -> std::future< decltype( std::declval< std::decay_t< F >& >()(
+          std::declval< std::decay_t< Args > >()... ) ) >
+  {
+    using result_type = decltype(
+        std::declval< std::decay_t< F >& >()( std::declval< std::decay_t< Args > >()... ) );
+
+    std::packaged_task< result_type() > task(
+        [fn = std::decay_t< F >( std::forward< F >( f ) ),
+         bound = std::make_tuple( std::forward< Args >( args )... )]() mutable -> result_type {
+          return detail::apply_moved( fn, bound, std::index_sequence_for< Args... >{} );
+        } );
+
+    auto fut = task.get_future();
+    post( std::move( task ) );
+    return fut;
+  }
+
+  // submit, but cancellable through token: a stop before a worker takes the task
+  // up completes the future with operation_cancelled at once, and f never runs.
+  // f is handed the token first if it takes one, to stop early once running.
+  template < class F, class... Args >
+  auto submit( stop_token token, F&& f, Args&&... args )
+      -> std::future< detail::token_call_result_t< F, Args... > >
+  {
+    using result_type = detail::token_call_result_t< F, Args... >;
+
+    auto call = detail::bind_with_token( std::forward< F >( f ), std::forward< Args >( args )... );
+    using job_type = detail::promise_job< std::promise< result_type >, decltype( call ) >;
+
+    job_type job{std::promise< result_type >(), std::move( call )};
+    auto     fut = job.promise.get_future();
+    post_job( std::move( token ), std::move( job ) );
+    return fut;
+  }
+
+  // fire and forget, no future to allocate. like a std::thread body, an exception
+  // escaping f terminates the program.
+  template < class F >
+  void post( F&& f )
+  {
+    using task_type = detail::pool_task_impl< std::decay_t< F > >;
+    enqueue( std::unique_ptr< detail::pool_task >( new task_type( std::forward< F >( f ) ) ) );
+  }
+
+  // post, skipped if token is stopped before a worker gets to it. f is handed
+  // the token if it takes one.
+  template < class F >
+  void post( stop_token token, F&& f )
+  {
+    auto call = detail::bind_with_token( std::forward< F >( f ) );
+    post_job( std::move( token ), detail::skip_on_cancel< decltype( call ) >{std::move( call )} );
+  }
+
+  // the general form: job.run( token ) on a worker, or job.cancel() right away on
+  // the thread stopping token while the job is still queued, exactly one of the
+  // two. the job is destroyed as soon as it is cancelled.
+  template < class Job >
+  void post_job( stop_token token, Job job )
+  {
+    enqueue( std::unique_ptr< detail::pool_task >(
+        new detail::cancellable_task< Job >( std::move( token ), std::move( job ) ) ) );
+  }
+
+  // like post, but only worker runs f: it sits in that worker's mailbox, which
+  // nobody steals from. for work that should stay on one cache, at the price of
+  // waiting for that worker if it is busy. worker is taken modulo size().
+  template < class F >
+  void post_to( size_t worker, F&& f )
+  {
+    using task_type = detail::pool_task_impl< std::decay_t< F > >;
+    mail( worker % size(),
+          std::unique_ptr< detail::pool_task >( new task_type( std::forward< F >( f ) ) ) );
+  }
+
+  // stop taking work from outside, run everything already queued (including
+  // whatever those tasks submit) and join the workers. called by the destructor.
+  void shutdown()
+  {
+    {
+      // both locks: a submit that saw m_stop clear has its task counted before a
+      // worker can decide the pool is drained
+      std::lock_guard< std::mutex > inject_locker{m_inject_lock};
+      std::lock_guard< std::mutex > park_locker{m_park_lock};
+      if ( m_stop.exchange( true ) && m_workers.empty() )
+      {
+        return;
+      }
+    }
+    m_park_cv.notify_all();
+
+    for ( auto& worker : m_workers )
+    {
+      if ( worker.joinable() )
+      {
+        worker.join();
+      }
+    }
+    m_workers.clear();
+  }
+
+  // true on one of this pool's workers
+  bool on_worker() const
+  {
+    return context().pool == this;
+  }
+
+  // the calling worker's index, size() off the pool
+  size_t worker_index() const
+  {
+    return on_worker() ? context().index : size();
+  }
+
+  // the cpus worker was placed on, empty when it was left to the scheduler
+  std::vector< unsigned > worker_cpus( size_t worker ) const
+  {
+    return worker < m_affinity.size() ? m_affinity[worker] : std::vector< unsigned >{};
+  }
+
+  // what every worker did since the pool started or reset_stats(), callable
+  // from any thread while the pool runs
+  pool_stats stats() const
+  {
+    pool_stats s;
+    {
+      std::lock_guard< std::mutex > locker{m_stats_lock};
+      const uint64_t                now     = tsc_clock::now();
+      const uint64_t                started = m_stats_since.load( std::memory_order_relaxed );
+      for ( auto& q : m_queues )
+      {
+        s.workers.push_back( q->stats.snapshot( started, now ) );
+      }
+    }
+    std::lock_guard< std::mutex > locker{m_inject_lock};
+    s.inject_high_water = m_inject_high_water;
+    return s;
+  }
+
+  // start counting afresh. tasks running meanwhile may land on either side,
+  // none is lost or counted twice.
+  void reset_stats()
+  {
+    {
+      std::lock_guard< std::mutex > locker{m_stats_lock};
+      for ( auto& q : m_queues )
+      {
+        q->stats.reset();
+      }
+      m_stats_since.store( tsc_clock::now(), std::memory_order_relaxed );
+    }
+    std::lock_guard< std::mutex > locker{m_inject_lock};
+    m_inject_high_water = 0;
+  }
+
+private:
+  struct worker_queue
+  {
+    explicit worker_queue( size_t index )
+        : rng( 0x9e3779b97f4a7c15ull * ( index + 1 ) )
+    {
+    }
+
+    chase_lev_deque< detail::pool_task* > deque;
+    uint64_t                              rng; // victim picking, owner only
+
+    std::mutex                       mailbox_lock;
+    std::deque< detail::pool_task* > mailbox; // post_to, never stolen
+    std::atomic< size_t >            mailbox_size{0};
+
+    detail::worker_counters stats;  // written by this worker only
+    uint32_t                queued{0}; // tasks it queued since the last sampled one
+  };
+
+  struct worker_context
+  {
+    const thread_pool* pool{nullptr};
+    size_t             index{0};
+  };
+
+  static worker_context& context()
+  {
+    static thread_local worker_context ctx;
+    return ctx;
+  }
+
+  void enqueue( std::unique_ptr< detail::pool_task > task )
+  {
+    const worker_context& ctx = context();
+    if ( ctx.pool == this )
+    {
+      // spawned from a task: onto our own deque, others will steal it if idle
+      worker_queue& mine = *m_queues[ctx.index];
+      detail::sample( task, mine.queued );
+      m_queued.fetch_add( 1 );
+      mine.stats.deepest( mine.deque.push( task.release() ) );
+    }
+    else
+    {
+      detail::sample( task, detail::outside_queued() );
+      std::lock_guard< std::mutex > locker{m_inject_lock};
+      if ( m_stop.load() )
+      {
+        throw std::runtime_error( "thread_pool: submit after shutdown" );
+      }
+      m_queued.fetch_add( 1 );
+      m_inject.push_back( task.release() );
+      m_inject_size.store( m_inject.size(), std::memory_order_relaxed );
+      m_inject_high_water = std::max( m_inject_high_water, m_inject.size() );
+    }
+
+    // pairs with the sleeper count bump in park(), one side always sees the other
+    if ( m_sleepers.load() > 0 )
+    {
+      std::lock_guard< std::mutex > locker{m_park_lock};
+      m_park_cv.notify_one();
+    }
+  }
+
+  void mail( size_t worker, std::unique_ptr< detail::pool_task > task )
+  {
+    worker_queue& target = *m_queues[worker];
+    if ( on_worker() )
+    {
+      detail::sample( task, m_queues[context().index]->queued );
+      // counted before looking at m_stop: either the target sees the count and
+      // stays up, or we see the stop and keep the task ourselves
+      m_queued.fetch_add( 1 );
+      if ( m_stop.load() )
+      {
+        m_queues[context().index]->deque.push( task.release() );
+        return;
+      }
+      m_mailed.fetch_add( 1 );
+      std::lock_guard< std::mutex > locker{target.mailbox_lock};
+      target.mailbox.push_back( task.release() );
+      target.mailbox_size.fetch_add( 1 );
+    }
+    else
+    {
+      detail::sample( task, detail::outside_queued() );
+      std::lock_guard< std::mutex > inject_locker{m_inject_lock};
+      if ( m_stop.load() )
+      {
+        throw std::runtime_error( "thread_pool: submit after shutdown" );
+      }
+      // queued before mailed, see stealable()
+      m_queued.fetch_add( 1 );
+      m_mailed.fetch_add( 1 );
+      std::lock_guard< std::mutex > locker{target.mailbox_lock};
+      target.mailbox.push_back( task.release() );
+      target.mailbox_size.fetch_add( 1 );
+    }
+
+    // any sleeper might be the wrong one
+    if ( m_sleepers.load() > 0 )
+    {
+      std::lock_guard< std::mutex > locker{m_park_lock};
+      m_park_cv.notify_all();
+    }
+  }
+
+  // tasks some other worker could take. mailed is read first and bumped after
+  // queued, so a concurrent post_to can only make this overcount, never hide
+  // stealable work from a worker about to park.
+  size_t stealable() const
+  {
+    const size_t mailed = m_mailed.load();
+    const size_t queued = m_queued.load();
+    return queued > mailed ? queued - mailed : 0;
+  }
+
+  bool take( size_t self, detail::pool_task*& out )
+  {
+    worker_queue& mine = *m_queues[self];
+    if ( mine.mailbox_size.load( std::memory_order_relaxed ) > 0 )
+    {
+      std::lock_guard< std::mutex > locker{mine.mailbox_lock};
+      if ( !mine.mailbox.empty() )
+      {
+        out = mine.mailbox.front();
+        mine.mailbox.pop_front();
+        mine.mailbox_size.fetch_sub( 1 );
+        m_mailed.fetch_sub( 1 ); // before the caller drops m_queued
+        return true;
+      }
+    }
+
+    if ( mine.deque.pop( out ) )
+    {
+      return true;
+    }
+
+    if ( m_inject_size.load( std::memory_order_relaxed ) > 0 )
+    {
+      std::lock_guard< std::mutex > locker{m_inject_lock};
+      if ( !m_inject.empty() )
+      {
+        out = m_inject.front();
+        m_inject.pop_front();
+        m_inject_size.store( m_inject.size(), std::memory_order_relaxed );
+        return true;
+      }
+    }
+
+    // xorshift, a random first victim keeps thieves from piling onto worker 0
+    mine.rng ^= mine.rng << 13;
+    mine.rng ^= mine.rng >> 7;
+    mine.rng ^= mine.rng << 17;
+
+    const size_t n = m_queues.size();
+    for ( size_t ix = 0, victim = mine.rng % n; ix < n; ++ix, victim = ( victim + 1 ) % n )
+    {
+      if ( victim != self && m_queues[victim]->deque.steal( out ) )
+      {
+        detail::bump( mine.stats.steals );
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // false once the pool is stopping and drained. mail for other workers is not
+  // a reason to wake, but does keep everyone alive until it has run.
+  bool park( size_t self )
+  {
+    worker_queue&                  mine = *m_queues[self];
+    std::unique_lock< std::mutex > locker{m_park_lock};
+    m_sleepers.fetch_add( 1 );
+    auto wake = [&] {
+      return stealable() > 0 || mine.mailbox_size.load() > 0
+             || ( m_stop.load() && m_queued.load() == 0 );
+    };
+    if ( !wake() )
+    {
+      mine.stats.park_begin( tsc_clock::now() );
+      m_park_cv.wait( locker, wake );
+      mine.stats.park_end( tsc_clock::now() );
+    }
+    m_sleepers.fetch_sub( 1 );
+    return !m_stop.load() || m_queued.load() > 0;
+  }
+
+  void start( size_t threads )
+  {
+    m_stats_since.store( tsc_clock::now(), std::memory_order_relaxed );
+    m_queues.reserve( threads );
+    for ( size_t ix = 0; ix < threads; ++ix )
+    {
+      m_queues.emplace_back( new worker_queue( ix ) );
+    }
+
+    m_workers.reserve( threads );
+    for ( size_t ix = 0; ix < threads; ++ix )
+    {
+      m_workers.emplace_back( [this, ix] { run( ix ); } );
+    }
+  }
+
+  void run( size_t self )
+  {
+    detail::worker_counters& stats = m_queues[self]->stats;
+    context()                      = worker_context{this, self};
+    detail::current_counters()     = &stats;
+    if ( self < m_affinity.size() && !m_affinity[self].empty() )
+    {
+      detail::pin_current_thread( m_affinity[self] );
+    }
+
+    for ( ;; )
+    {
+      detail::pool_task* task = nullptr;
+      if ( take( self, task ) )
+      {
+        // the last task of a stopping pool releases workers parked behind mail
+        if ( m_queued.fetch_sub( 1 ) == 1 && m_stop.load() )
+        {
+          std::lock_guard< std::mutex > locker{m_park_lock};
+          m_park_cv.notify_all();
+        }
+        std::unique_ptr< detail::pool_task >( task )->run();
+        detail::bump( stats.executed );
+        continue;
+      }
+
+      // queued but not found yet means a push or a steal is in flight, look again
+      if ( stealable() > 0 )
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      if ( !park( self ) )
+      {
+        return;
+      }
+    }
+  }
+
+  std::vector< std::unique_ptr< worker_queue > > m_queues;
+  std::vector< std::thread >                     m_workers;
+  std::vector< std::vector< unsigned > >         m_affinity; // per worker, empty if unpinned
+
+  mutable std::mutex               m_inject_lock;
+  std::deque< detail::pool_task* > m_inject;
+  std::atomic< size_t >            m_inject_size{0};
+  size_t                           m_inject_high_water{0}; // under m_inject_lock
+  mutable std::mutex               m_stats_lock;           // stats() against reset_stats()
+  std::atomic< uint64_t >          m_stats_since{0};       // tsc_clock ticks
+
+  // tasks pushed anywhere and not yet taken, bumped before the push lands.
+  // m_mailed is the part of that sitting in mailboxes.
+  alignas( 64 ) std::atomic< size_t > m_queued{0};
+  std::atomic< size_t >   m_mailed{0};
+  std::atomic< size_t >   m_sleepers{0};
+  std::atomic< bool >     m_stop{false};
+  std::mutex              m_park_lock;
+  std::condition_variable m_park_cv;
+}; // thread_pool
@@ -0,0 +1,209 @@
+// task throughput of thread_pool against the single mutex + deque + condvar queue
+// from the PackagedTask example, from one worker up to one per cpu. then the
+// pool's own stats after a run, and the cost of taking them.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "bench.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using bench::clock_type;
+using bench::cpus;
+using bench::thread_counts;
+
+// the demo's global workq grown into a pool: every submit and every take goes
+// through the one lock
+class mutex_deque_pool
+{
+public:
+  explicit mutex_deque_pool( size_t threads )
+  {
+    for ( size_t ix = 0; ix < threads; ++ix )
+    {
+      m_workers.emplace_back( [this] { run(); } );
+    }
+  }
+
+  ~mutex_deque_pool()
+  {
+    {
+      std::lock_guard< std::mutex > locker{m_lock};
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    for ( auto& worker : m_workers )
+    {
+      worker.join();
+    }
+  }
+
+  template < class F >
+  auto submit( F&& f ) -> std::future< decltype( f() ) >
+  {
+    using task_type = std::packaged_task< decltype( f() )() >;
+
+    auto task = std::make_shared< task_type >( std::forward< F >( f ) );
+    auto fut  = task->get_future();
+    post( [task] { ( *task )(); } );
+    return fut;
+  }
+
+  template < class F >
+  void post( F&& f )
+  {
+    {
+      std::lock_guard< std::mutex > locker{m_lock};
+      m_queue.emplace_back( std::forward< F >( f ) );
+    }
+    m_cv.notify_one();
+  }
+
+private:
+  void run()
+  {
+    for ( ;; )
+    {
+      std::function< void() > task;
+      {
+        std::unique_lock< std::mutex > locker{m_lock};
+        m_cv.wait( locker, [this] { return m_stop || !m_queue.empty(); } );
+        if ( m_queue.empty() )
+        {
+          return;
+        }
+        task = std::move( m_queue.front() );
+        m_queue.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex                            m_lock;
+  std::condition_variable               m_cv;
+  std::deque< std::function< void() > > m_queue;
+  bool                                  m_stop{false};
+  std::vector< std::thread >            m_workers;
+};
+
+// tiny tasks submitted from outside, each with its own future
+template < class Pool >
+void submit_throughput( const std::string& name, size_t threads, size_t tasks )
+{
+  Pool pool( threads );
+
+  auto start = clock_type::now();
+
+  std::vector< std::future< size_t > > futs;
+  futs.reserve( tasks );
+  for ( size_t ix = 0; ix < tasks; ++ix )
+  {
+    futs.push_back( pool.submit( [ix] { return ix; } ) );
+  }
+  size_t sum = 0;
+  for ( auto& f : futs )
+  {
+    sum += f.get();
+  }
+  EXPECT_EQ( sum, tasks * ( tasks - 1 ) / 2 );
+
+  bench::report( name, threads, double( tasks ), "tasks", start );
+}
+
+// fork join: every task spawns two children until depth runs out. this is
+// where tasks are submitted from the workers themselves.
+template < class Pool >
+struct spawn_tree
+{
+  Pool*                 pool{nullptr};
+  std::atomic< size_t > pending{1};
+  std::promise< void >  done;
+
+  void node( int depth )
+  {
+    if ( depth > 0 )
+    {
+      pending.fetch_add( 2 );
+      pool->post( [this, depth] { node( depth - 1 ); } );
+      pool->post( [this, depth] { node( depth - 1 ); } );
+    }
+    if ( pending.fetch_sub( 1 ) == 1 )
+    {
+      done.set_value();
+    }
+  }
+};
+
+template < class Pool >
+void spawn_throughput( const std::string& name, size_t threads, int depth )
+{
+  // outlives the pool, the last task may still be inside set_value() when get() returns
+  spawn_tree< Pool > tree;
+  auto               finished = tree.done.get_future();
+
+  Pool pool( threads );
+  tree.pool = &pool;
+
+  auto start = clock_type::now();
+  pool.post( [&] { tree.node( depth ); } );
+  finished.get();
+
+  bench::report( name, threads, double( ( size_t( 2 ) << depth ) - 1 ), "tasks", start );
+}
+} // namespace
+
+TEST( ThreadPoolBench, Submit )
+{
+  for ( size_t threads : thread_counts() )
+  {
+    submit_throughput< mutex_deque_pool >( "mutex+deque submit", threads, 200000 );
+    submit_throughput< thread_pool >( "work stealing submit", threads, 200000 );
+  }
+}
+
+TEST( ThreadPoolBench, Spawn )
+{
+  for ( size_t threads : thread_counts() )
+  {
+    spawn_throughput< mutex_deque_pool >( "mutex+deque spawn", threads, 18 );
+    spawn_throughput< thread_pool >( "work stealing spawn", threads, 18 );
+  }
+}
+
+// what pool.stats() shows after the spawn benchmark, and what taking it costs
+TEST( ThreadPoolBench, Stats )
+{
+  spawn_tree< thread_pool > tree;
+  auto                      finished = tree.done.get_future();
+
+  thread_pool pool( cpus() );
+  tree.pool = &pool;
+  pool.post( [&] { tree.node( 18 ); } );
+  finished.get();
+  pool.stats().report( std::cout );
+
+  constexpr size_t snapshots = 1000;
+  auto             start     = clock_type::now();
+  for ( size_t ix = 0; ix < snapshots; ++ix )
+  {
+    pool.stats();
+  }
+  std::chrono::duration< double, std::micro > elapsed = clock_type::now() - start;
+  std::cout << "stats() " << elapsed.count() / snapshots << "us" << std::endl;
+}
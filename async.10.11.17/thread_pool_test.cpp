@@ -0,0 +1,512 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+using namespace std::chrono_literals;
+
+TEST( ChaseLevDeque, OwnerIsLifoThievesAreFifo )
+{
+  chase_lev_deque< int > dq( 4 );
+  for ( int ix = 0; ix < 10; ++ix )
+  {
+    dq.push( ix ); // past the initial capacity, forces a grow
+  }
+  EXPECT_EQ( dq.size(), 10u );
+
+  int value = -1;
+  ASSERT_TRUE( dq.pop( value ) );
+  EXPECT_EQ( value, 9 );
+  ASSERT_TRUE( dq.steal( value ) );
+  EXPECT_EQ( value, 0 );
+  ASSERT_TRUE( dq.steal( value ) );
+  EXPECT_EQ( value, 1 );
+
+  while ( dq.pop( value ) )
+  {
+  }
+  EXPECT_EQ( value, 2 );
+  EXPECT_TRUE( dq.empty() );
+  EXPECT_FALSE( dq.steal( value ) );
+}
+
+TEST( ChaseLevDeque, EveryValueTakenOnce )
+{
+  constexpr int count   = 200000;
+  constexpr int thieves = 3;
+
+  chase_lev_deque< int >         dq( 16 );
+  std::vector< std::atomic_int > seen( count );
+  std::atomic< bool >            done{false};
+  std::vector< std::thread >     threads;
+
+  for ( int t = 0; t < thieves; ++t )
+  {
+    threads.emplace_back( [&] {
+      int value;
+      while ( !done.load() || !dq.empty() )
+      {
+        if ( dq.steal( value ) )
+        {
+          seen[value].fetch_add( 1 );
+        }
+      }
+    } );
+  }
+
+  // the owner pushes everything and pops every third value itself
+  int value;
+  for ( int ix = 0; ix < count; ++ix )
+  {
+    dq.push( ix );
+    if ( ix % 3 == 0 && dq.pop( value ) )
+    {
+      seen[value].fetch_add( 1 );
+    }
+  }
+  while ( dq.pop( value ) )
+  {
+    seen[value].fetch_add( 1 );
+  }
+  done = true;
+
+  for ( auto& t : threads )
+  {
+    t.join();
+  }
+
+  for ( int ix = 0; ix < count; ++ix )
+  {
+    ASSERT_EQ( seen[ix].load(), 1 ) << "value " << ix;
+  }
+}
+
+TEST( ThreadPool, SubmitAnySignature )
+{
+  thread_pool pool( 2 );
+
+  auto nothing = pool.submit( [] {} );
+  auto greet   = pool.submit( []( std::string who ) { return "hello " + who; }, "pool" );
+  auto sum     = pool.submit( []( int a, int b ) { return a + b; }, 2, 3 );
+  auto owned   = pool.submit( []( std::unique_ptr< int > p ) { return *p * 2; },
+                            std::unique_ptr< int >( new int( 21 ) ) );
+
+  nothing.get();
+  EXPECT_EQ( greet.get(), "hello pool" );
+  EXPECT_EQ( sum.get(), 5 );
+  EXPECT_EQ( owned.get(), 42 );
+}
+
+TEST( ThreadPool, ExceptionReachesFuture )
+{
+  thread_pool pool( 1 );
+
+  auto fut = pool.submit( []() -> int { throw std::runtime_error( "boom" ); } );
+  EXPECT_THROW( fut.get(), std::runtime_error );
+
+  // the worker survived
+  auto after = pool.submit( [] { return 7; } );
+  EXPECT_EQ( after.get(), 7 );
+}
+
+TEST( ThreadPool, ManyTasksFromManyThreads )
+{
+  constexpr size_t producers = 4;
+  constexpr size_t per       = 10000;
+
+  thread_pool           pool( 3 );
+  std::atomic< size_t > ran{0};
+
+  std::vector< std::thread > threads;
+  for ( size_t p = 0; p < producers; ++p )
+  {
+    threads.emplace_back( [&] {
+      std::vector< std::future< size_t > > futs;
+      for ( size_t ix = 0; ix < per; ++ix )
+      {
+        futs.push_back( pool.submit( [&ran, ix] {
+          ran.fetch_add( 1 );
+          return ix;
+        } ) );
+      }
+      for ( size_t ix = 0; ix < per; ++ix )
+      {
+        EXPECT_EQ( futs[ix].get(), ix );
+      }
+    } );
+  }
+  for ( auto& t : threads )
+  {
+    t.join();
+  }
+
+  EXPECT_EQ( ran.load(), producers * per );
+}
+
+namespace
+{
+// binary fork tree, each task spawns its children onto its worker's own deque
+void spawn_tree( thread_pool& pool, int depth, std::atomic< size_t >& leaves,
+                 std::atomic< size_t >& pending, std::promise< void >& done )
+{
+  if ( depth == 0 )
+  {
+    leaves.fetch_add( 1 );
+  }
+  else
+  {
+    pending.fetch_add( 2 );
+    for ( int child = 0; child < 2; ++child )
+    {
+      pool.post( [&pool, depth, &leaves, &pending, &done] {
+        spawn_tree( pool, depth - 1, leaves, pending, done );
+      } );
+    }
+  }
+
+  if ( pending.fetch_sub( 1 ) == 1 )
+  {
+    done.set_value();
+  }
+}
+} // namespace
+
+TEST( ThreadPool, NestedSpawnIsStolen )
+{
+  // declared ahead of the pool so they outlive its workers
+  std::atomic< size_t > leaves{0};
+  std::atomic< size_t > pending{1};
+  std::promise< void >  done;
+  auto                  finished = done.get_future();
+  thread_pool           pool( 4 );
+
+  pool.post( [&] {
+    EXPECT_TRUE( pool.on_worker() );
+    spawn_tree( pool, 14, leaves, pending, done );
+  } );
+
+  finished.get();
+  EXPECT_EQ( leaves.load(), size_t( 1 ) << 14 );
+  EXPECT_FALSE( pool.on_worker() );
+}
+
+TEST( ThreadPool, StatsCountWhatRan )
+{
+  std::atomic< size_t > leaves{0};
+  std::atomic< size_t > pending{1};
+  std::promise< void >  done;
+  auto                  finished = done.get_future();
+  thread_pool           pool( 4 );
+
+  pool.post( [&] { spawn_tree( pool, 12, leaves, pending, done ); } );
+  finished.get();
+  pool.shutdown(); // the last tasks are counted once they return
+
+  const pool_stats s = pool.stats();
+  ASSERT_EQ( s.workers.size(), 4u );
+  EXPECT_EQ( s.executed(), ( size_t( 1 ) << 13 ) - 1 );
+  EXPECT_LE( s.steals(), s.executed() );
+  EXPECT_EQ( s.inject_high_water, 1u );
+
+  uint64_t sampled = 0, deepest = 0;
+  for ( auto& w : s.workers )
+  {
+    EXPECT_EQ( w.wait.count(), w.run.count() );
+    sampled += w.wait.count();
+    deepest = std::max< uint64_t >( deepest, w.high_water );
+  }
+  // one in stats_sample_every per queueing thread
+  EXPECT_GE( sampled, s.executed() / stats_sample_every - 4 );
+  EXPECT_LE( sampled, s.executed() / stats_sample_every + 4 );
+  EXPECT_GE( deepest, 2u );
+
+  pool.reset_stats();
+  EXPECT_EQ( pool.stats().executed(), 0u );
+}
+
+// a reset while tasks run: what ran before it stays out, what ran after is in
+TEST( ThreadPool, ResetStatsWhileRunning )
+{
+  constexpr size_t      tasks = 20000;
+  std::atomic< size_t > ran{0};
+  thread_pool           pool( 2 );
+  for ( size_t ix = 0; ix < tasks; ++ix )
+  {
+    pool.post( [&] { ran.fetch_add( 1 ); } );
+  }
+  while ( ran.load() < tasks / 4 )
+  {
+    std::this_thread::yield();
+  }
+
+  const size_t before = ran.load();
+  pool.reset_stats();
+  const size_t after = ran.load();
+  pool.shutdown();
+
+  // a task that returned just before the reset may still be counted after it
+  const uint64_t counted = pool.stats().executed();
+  EXPECT_LE( counted, tasks - before + 2 );
+  EXPECT_GE( counted, tasks - after );
+}
+
+TEST( ThreadPool, StatsSplitBusyFromIdle )
+{
+  thread_pool pool( 1 );
+  std::this_thread::sleep_for( 50ms );
+
+  // one long task holds the worker while the shared queue backs up behind it
+  std::promise< void > release;
+  auto                 gate = release.get_future().share();
+  pool.post( [gate] {
+    gate.wait();
+    const auto until = std::chrono::steady_clock::now() + 50ms;
+    while ( std::chrono::steady_clock::now() < until )
+    {
+    }
+  } );
+  for ( int ix = 0; ix < 100; ++ix )
+  {
+    pool.post( [] {} );
+  }
+  release.set_value();
+  pool.shutdown();
+
+  const pool_stats s = pool.stats();
+  EXPECT_EQ( s.executed(), 101u );
+  EXPECT_GE( s.inject_high_water, 100u );
+
+  const worker_stats& w = s.workers[0];
+  EXPECT_GE( w.parks, 1u );
+  EXPECT_GE( w.idle, 40ms );
+  EXPECT_GE( w.busy, 40ms );
+  EXPECT_GT( w.busy_fraction(), 0.0 );
+  EXPECT_LT( w.busy_fraction(), 1.0 );
+
+  std::ostringstream out;
+  s.report( out );
+  EXPECT_THAT( out.str(), ::testing::HasSubstr( "pool: workers=1 executed=101" ) );
+  EXPECT_THAT( out.str(), ::testing::HasSubstr( "worker 0: executed=101" ) );
+}
+
+TEST( ThreadPool, StatsReporterDumpsPeriodically )
+{
+  thread_pool        pool( 2 );
+  std::ostringstream out;
+  {
+    stats_reporter dump( pool, out, 10ms );
+    pool.submit( [] {} ).get();
+    std::this_thread::sleep_for( 100ms );
+  }
+  const std::string text  = out.str();
+  size_t            dumps = 0;
+  for ( size_t at = 0; ( at = text.find( "pool:", at ) ) != std::string::npos; ++at )
+  {
+    ++dumps;
+  }
+  EXPECT_GE( dumps, 2u );
+  EXPECT_THAT( text, ::testing::HasSubstr( "worker 1:" ) );
+}
+
+TEST( ThreadPool, ShutdownDrainsQueuedWork )
+{
+  std::atomic< int > ran{0};
+  {
+    thread_pool pool( 2 );
+    for ( int ix = 0; ix < 1000; ++ix )
+    {
+      pool.post( [&] {
+        std::this_thread::sleep_for( 10us );
+        ran.fetch_add( 1 );
+      } );
+    }
+  } // destructor shuts down
+
+  EXPECT_EQ( ran.load(), 1000 );
+}
+
+TEST( ThreadPool, SubmitAfterShutdownThrows )
+{
+  thread_pool pool( 1 );
+  pool.shutdown();
+  pool.shutdown(); // idempotent
+
+  EXPECT_THROW( pool.submit( [] {} ), std::runtime_error );
+}
+
+TEST( ThreadPool, CancelledWhileQueuedNeverRuns )
+{
+  thread_pool                pool( 1 );
+  std::promise< void >       gate;
+  std::shared_future< void > open = gate.get_future().share();
+  pool.post( [open] { open.wait(); } );
+
+  // queued behind the blocked worker
+  stop_source                       source;
+  auto                              witness = std::make_shared< int >( 0 );
+  std::atomic< int >                ran{0};
+  std::vector< std::future< int > > futures;
+  for ( int ix = 0; ix < 100; ++ix )
+  {
+    futures.push_back( pool.submit( source.get_token(), [witness, &ran, ix] {
+      ran += 1;
+      return ix;
+    } ) );
+  }
+  std::atomic< int > posted{0};
+  pool.post( source.get_token(), [&] { posted += 1; } );
+  EXPECT_EQ( witness.use_count(), 101 );
+
+  // the futures complete at the stop, with the worker still blocked, and the
+  // captures are released there and then
+  source.request_stop();
+  for ( auto& f : futures )
+  {
+    ASSERT_EQ( f.wait_for( 0s ), std::future_status::ready );
+    EXPECT_THROW( f.get(), operation_cancelled );
+  }
+  EXPECT_EQ( witness.use_count(), 1 );
+
+  gate.set_value();
+  pool.shutdown();
+  EXPECT_EQ( ran.load(), 0 );
+  EXPECT_EQ( posted.load(), 0 );
+
+  // a stopped token cancels at submit
+  thread_pool again( 1 );
+  EXPECT_THROW( again.submit( source.get_token(), [] { return 1; } ).get(), operation_cancelled );
+}
+
+TEST( ThreadPool, RunningTaskSeesItsToken )
+{
+  thread_pool pool( 2 );
+  stop_source source;
+
+  std::atomic< bool > started{false};
+  auto                spinner = [&]( const stop_token& token, long step ) {
+    started    = true;
+    long spins = 0;
+    while ( !token.stop_requested() )
+    {
+      spins += step;
+    }
+    return spins;
+  };
+  auto spin = pool.submit( source.get_token(), spinner, 1L );
+  while ( !started )
+  {
+    std::this_thread::yield();
+  }
+  source.request_stop();
+  // already running: it finishes normally, cut short by the token
+  EXPECT_GE( spin.get(), 0 );
+
+  // tasks that never look at the token run as usual while it is not stopped
+  stop_source other;
+  auto        add = []( int a, int b ) { return a + b; };
+  EXPECT_EQ( pool.submit( other.get_token(), add, 2, 3 ).get(), 5 );
+}
+
+// move only callables go through post() as they are
+TEST( ThreadPool, RunsPackagedTask )
+{
+  thread_pool pool( 1 );
+
+  std::packaged_task< std::string() > task( [] { return std::string( "hello!!!" ); } );
+  std::future< std::string >          fu = task.get_future();
+
+  pool.post( std::move( task ) );
+  EXPECT_EQ( fu.get(), "hello!!!" );
+}
+
+TEST( ThreadPool, PostToRunsOnThatWorker )
+{
+  std::vector< std::atomic< size_t > > wrong( 4 );
+  std::atomic< size_t >                ran{0};
+  {
+    thread_pool pool( 4 );
+    for ( size_t ix = 0; ix < 4000; ++ix )
+    {
+      const size_t worker = ix % 4;
+      pool.post_to( worker, [&, worker] {
+        if ( pool.worker_index() != worker )
+        {
+          wrong[worker].fetch_add( 1 );
+        }
+        // mail sent from a worker stays addressed too
+        pool.post_to( worker + 1, [&, worker] {
+          if ( pool.worker_index() != ( worker + 1 ) % 4 )
+          {
+            wrong[worker].fetch_add( 1 );
+          }
+          ran.fetch_add( 1 );
+        } );
+        ran.fetch_add( 1 );
+      } );
+    }
+    EXPECT_EQ( pool.worker_index(), pool.size() );
+
+    // while stopping, mail from a worker falls back to the sender's own deque
+    while ( ran.load() < 8000 )
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  EXPECT_EQ( ran.load(), 8000u );
+  for ( auto& w : wrong )
+  {
+    EXPECT_EQ( w.load(), 0u );
+  }
+
+  thread_pool stopped( 1 );
+  stopped.shutdown();
+  EXPECT_THROW( stopped.post_to( 0, [] {} ), std::runtime_error );
+}
+
+TEST( ThreadPool, PinnedWorkersRunWherePlaced )
+{
+  const auto& topology = cpu_topology::system();
+
+  for ( placement where : {placement::per_core, placement::per_cache} )
+  {
+    thread_pool pool( 0, where );
+    EXPECT_EQ( pool.size(), topology.natural_workers( where ) );
+
+    std::vector< std::atomic< int > > strays( pool.size() );
+    for ( size_t ix = 0; ix < pool.size() * 8; ++ix )
+    {
+      const size_t worker = ix % pool.size();
+      pool.post_to( worker, [&, worker] {
+        const auto cpus = pool.worker_cpus( worker );
+        const int  cpu  = sched_getcpu();
+        if ( std::find( cpus.begin(), cpus.end(), unsigned( cpu ) ) == cpus.end() )
+        {
+          strays[worker].fetch_add( 1 );
+        }
+      } );
+    }
+    pool.shutdown();
+
+    for ( auto& s : strays )
+    {
+      EXPECT_EQ( s.load(), 0 );
+    }
+  }
+
+  // unplaced pools leave the scheduler alone
+  thread_pool loose( 2 );
+  EXPECT_TRUE( loose.worker_cpus( 0 ).empty() );
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+// one thread running callbacks at their deadlines, kept in a binary heap.
+// callbacks run on the timer thread and should be short: hand real work to an
+// executor. timers still pending when the queue is destroyed are dropped unrun.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+class timer_queue
+{
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  timer_queue()
+      : m_thread( [this] { run(); } )
+  {
+  }
+
+  timer_queue( const timer_queue& ) = delete;
+  timer_queue& operator=( const timer_queue& ) = delete;
+
+  ~timer_queue()
+  {
+    {
+      std::lock_guard< std::mutex > locker{m_lock};
+      m_stop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+
+    for ( auto& e : m_heap )
+    {
+      delete e.fn;
+    }
+  }
+
+  template < class F >
+  void schedule_at( clock_type::time_point deadline, F&& fn )
+  {
+    using task_type = detail::pool_task_impl< std::decay_t< F > >;
+    std::unique_ptr< detail::pool_task > task( new task_type( std::forward< F >( fn ) ) );
+
+    bool earliest;
+    {
+      std::lock_guard< std::mutex > locker{m_lock};
+      m_heap.push_back( entry{deadline, m_sequence++, task.get()} );
+      std::push_heap( m_heap.begin(), m_heap.end(), later );
+      task.release();
+      earliest = m_heap.front().seq == m_sequence - 1;
+    }
+    // only a new earliest deadline changes how long the timer thread should sleep
+    if ( earliest )
+    {
+      m_cv.notify_one();
+    }
+  }
+
+  template < class Rep, class Period, class F >
+  void schedule_after( std::chrono::duration< Rep, Period > delay, F&& fn )
+  {
+    schedule_at( clock_type::now() + std::chrono::duration_cast< clock_type::duration >( delay ),
+                 std::forward< F >( fn ) );
+  }
+
+  size_t pending() const
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+    return m_heap.size();
+  }
+
+private:
+  struct entry
+  {
+    clock_type::time_point deadline;
+    uint64_t               seq; // equal deadlines fire in scheduling order
+    detail::pool_task*     fn;
+  };
+
+  static bool later( const entry& a, const entry& b )
+  {
+    return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+  }
+
+  void run()
+  {
+    std::unique_lock< std::mutex > locker{m_lock};
+    while ( !m_stop )
+    {
+      if ( m_heap.empty() )
+      {
+        m_cv.wait( locker );
+        continue;
+      }
+
+      auto deadline = m_heap.front().deadline;
+      if ( clock_type::now() < deadline )
+      {
+        m_cv.wait_until( locker, deadline );
+        continue;
+      }
+
+      std::pop_heap( m_heap.begin(), m_heap.end(), later );
+      std::unique_ptr< detail::pool_task > fn( m_heap.back().fn );
+      m_heap.pop_back();
+
+      locker.unlock();
+      fn->run();
+      fn.reset();
+      locker.lock();
+    }
+  }
+
+  mutable std::mutex      m_lock;
+  std::condition_variable m_cv;
+  std::vector< entry >    m_heap;
+  uint64_t                m_sequence{0};
+  bool                    m_stop{false};
+  std::thread             m_thread; // last, starts once the rest is built
+}; // timer_queue
@@ -0,0 +1,454 @@
+#pragma once
+
+// a hierarchical timing wheel for large numbers of timeouts, most of which are
+// cancelled before they fire. same interface as timer_queue, so delay() in
+// task.hpp takes either, plus a timer_handle from every schedule call.
+//
+// time is cut into ticks (1ms unless given). four levels of 256 slots cover
+// 2^32 ticks: level 0 holds the next 256 ticks one slot each, level n holds
+// 256^n ticks a slot and is spread into the levels below when the wheel gets
+// there. a slot is an intrusive list, so scheduling and cancelling are a few
+// pointer writes under the lock, independent of how many timers are pending.
+// deadlines past the top level wait in its last slot and are placed again.
+//
+// one thread drives the wheel. it sleeps until the next non-empty slot, found
+// through a bitmap per level, so an idle or sparse wheel does not tick. timers
+// fire on that thread at the first tick boundary at or after their deadline,
+// never early and at most a tick plus wakeup latency late. callbacks should be
+// short: hand real work to an executor. timers still pending when the wheel is
+// destroyed are dropped unrun; handles must not outlive their wheel.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+class timer_wheel;
+
+namespace detail
+{
+// a pending timer, or the sentinel of a circular list of them
+struct timer_node
+{
+  timer_node* prev       = this;
+  timer_node* next       = this;
+  uint64_t    tick       = 0;
+  uint64_t    generation = 0; // bumped on reuse, stale handles stop matching
+  pool_task*  fn         = nullptr;
+  uint32_t    slot       = 0;
+
+  bool empty() const
+  {
+    return next == this;
+  }
+
+  void push_back( timer_node* n )
+  {
+    n->prev    = prev;
+    n->next    = this;
+    prev->next = n;
+    prev       = n;
+  }
+
+  void unlink()
+  {
+    prev->next = next;
+    next->prev = prev;
+    prev = next = this;
+  }
+
+  // moves every node of other to the end of this list
+  void splice( timer_node& other )
+  {
+    if ( other.empty() )
+    {
+      return;
+    }
+    other.next->prev = prev;
+    prev->next       = other.next;
+    other.prev->next = this;
+    prev             = other.prev;
+    other.prev = other.next = &other;
+  }
+};
+} // namespace detail
+
+// refers to one scheduled timer; cheap to copy, default constructed refers to none
+class timer_handle
+{
+public:
+  timer_handle() = default;
+
+  // true if the timer had not fired yet and now never will
+  bool cancel();
+
+  // scheduled and neither fired nor cancelled
+  bool pending() const;
+
+private:
+  friend class timer_wheel;
+
+  timer_handle( timer_wheel* wheel, detail::timer_node* node, uint64_t generation )
+      : m_wheel( wheel )
+      , m_node( node )
+      , m_generation( generation )
+  {
+  }
+
+  timer_wheel*        m_wheel      = nullptr;
+  detail::timer_node* m_node       = nullptr;
+  uint64_t            m_generation = 0;
+}; // timer_handle
+
+class timer_wheel
+{
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  explicit timer_wheel( clock_type::duration tick = std::chrono::milliseconds( 1 ) )
+      : m_tick( tick )
+      , m_origin( clock_type::now() )
+      , m_thread( [this] { run(); } )
+  {
+  }
+
+  timer_wheel( const timer_wheel& ) = delete;
+  timer_wheel& operator=( const timer_wheel& ) = delete;
+
+  ~timer_wheel()
+  {
+    {
+      std::lock_guard< std::mutex > locker{m_lock};
+      m_stop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+
+    for ( auto* list = m_slots; list != m_slots + slot_count; ++list )
+    {
+      drop( *list );
+    }
+    drop( m_due );
+  }
+
+  template < class F >
+  timer_handle schedule_at( clock_type::time_point deadline, F&& fn )
+  {
+    using task_type = detail::pool_task_impl< std::decay_t< F > >;
+    std::unique_ptr< detail::pool_task > task( new task_type( std::forward< F >( fn ) ) );
+    const uint64_t                       tick = tick_after( deadline );
+
+    bool         wake;
+    timer_handle handle;
+    {
+      std::lock_guard< std::mutex > locker{m_lock};
+      detail::timer_node* node = allocate();
+      node->tick               = tick;
+      node->fn                 = task.release();
+      place( node );
+      ++m_pending;
+      handle = timer_handle( this, node, node->generation );
+
+      // only a tick before the one the driver sleeps until needs to wake it
+      wake = tick < m_wake;
+      if ( wake )
+      {
+        m_wake = tick;
+      }
+    }
+    if ( wake )
+    {
+      m_cv.notify_one();
+    }
+    return handle;
+  }
+
+  template < class Rep, class Period, class F >
+  timer_handle schedule_after( std::chrono::duration< Rep, Period > delay, F&& fn )
+  {
+    return schedule_at(
+        clock_type::now() + std::chrono::duration_cast< clock_type::duration >( delay ),
+        std::forward< F >( fn ) );
+  }
+
+  size_t pending() const
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+    return m_pending;
+  }
+
+  clock_type::duration tick() const
+  {
+    return m_tick;
+  }
+
+private:
+  friend class timer_handle;
+
+  static constexpr unsigned levels     = 4;
+  static constexpr unsigned slot_bits  = 8;
+  static constexpr unsigned slots      = 1u << slot_bits;
+  static constexpr unsigned slot_count = levels * slots;
+  static constexpr unsigned chunk      = 256;
+  static constexpr uint64_t never      = std::numeric_limits< uint64_t >::max();
+  static constexpr uint32_t no_slot    = ~0u;
+
+  // the first tick that starts at or after t
+  uint64_t tick_after( clock_type::time_point t ) const
+  {
+    if ( t <= m_origin )
+    {
+      return 0;
+    }
+    return uint64_t( ( t - m_origin + m_tick - clock_type::duration( 1 ) ) / m_tick );
+  }
+
+  // the tick t falls in
+  uint64_t tick_of( clock_type::time_point t ) const
+  {
+    return uint64_t( ( t - m_origin ) / m_tick );
+  }
+
+  // into the lowest level whose slots reach node->tick from m_current
+  void place( detail::timer_node* node )
+  {
+    const uint64_t tick  = std::max( node->tick, m_current );
+    unsigned       level = 0;
+    while ( level + 1 < levels
+            && ( tick >> ( level * slot_bits ) ) - ( m_current >> ( level * slot_bits ) ) >= slots )
+    {
+      ++level;
+    }
+    const unsigned shift = level * slot_bits;
+    uint64_t       index = tick >> shift;
+    if ( index - ( m_current >> shift ) >= slots )
+    {
+      // beyond the top level: its furthest slot, placed again from there
+      index = ( m_current >> shift ) + slots - 1;
+    }
+
+    const uint32_t slot = level * slots + uint32_t( index & ( slots - 1 ) );
+    node->slot          = slot;
+    m_slots[slot].push_back( node );
+    m_occupied[slot / 64] |= uint64_t( 1 ) << ( slot % 64 );
+  }
+
+  void unlink( detail::timer_node* node )
+  {
+    node->unlink();
+    if ( node->slot != no_slot && m_slots[node->slot].empty() )
+    {
+      m_occupied[node->slot / 64] &= ~( uint64_t( 1 ) << ( node->slot % 64 ) );
+    }
+  }
+
+  // empties a slot, the caller re-places or fires what it held
+  void take( uint32_t slot, detail::timer_node& into )
+  {
+    into.splice( m_slots[slot] );
+    m_occupied[slot / 64] &= ~( uint64_t( 1 ) << ( slot % 64 ) );
+  }
+
+  // circular distance from index to the first occupied slot of level, slots if none
+  unsigned next_occupied( unsigned level, unsigned index ) const
+  {
+    const uint64_t* words = m_occupied + level * ( slots / 64 );
+    for ( unsigned distance = 0; distance < slots; )
+    {
+      const unsigned at   = ( index + distance ) & ( slots - 1 );
+      const uint64_t bits = words[at / 64] >> ( at % 64 );
+      if ( bits )
+      {
+        return distance + unsigned( __builtin_ctzll( bits ) );
+      }
+      distance += 64 - at % 64;
+    }
+    return slots;
+  }
+
+  // the first tick from m_current at which a slot fires or spreads, never if empty
+  uint64_t next_event() const
+  {
+    uint64_t next = never;
+    for ( unsigned level = 0; level < levels; ++level )
+    {
+      const unsigned shift    = level * slot_bits;
+      const uint64_t index    = m_current >> shift;
+      const unsigned distance = next_occupied( level, unsigned( index & ( slots - 1 ) ) );
+      if ( distance < slots )
+      {
+        next = std::min( next, std::max( ( index + distance ) << shift, m_current ) );
+      }
+    }
+    return next;
+  }
+
+  // moves everything due by now to m_due, spreading higher levels on the way
+  void advance( uint64_t now )
+  {
+    while ( m_current <= now )
+    {
+      const uint64_t next = next_event();
+      if ( next > now )
+      {
+        m_current = now + 1;
+        return;
+      }
+      m_current = next;
+
+      for ( unsigned level = 1; level < levels; ++level )
+      {
+        const unsigned shift = level * slot_bits;
+        if ( m_current & ( ( uint64_t( 1 ) << shift ) - 1 ) )
+        {
+          break;
+        }
+        detail::timer_node spread;
+        take( level * slots + uint32_t( ( m_current >> shift ) & ( slots - 1 ) ), spread );
+        while ( !spread.empty() )
+        {
+          detail::timer_node* node = spread.next;
+          node->unlink();
+          place( node );
+        }
+      }
+
+      const uint32_t slot = uint32_t( m_current & ( slots - 1 ) );
+      if ( m_occupied[slot / 64] & ( uint64_t( 1 ) << ( slot % 64 ) ) )
+      {
+        for ( auto* node = m_slots[slot].next; node != &m_slots[slot]; node = node->next )
+        {
+          node->slot = no_slot;
+        }
+        take( slot, m_due );
+      }
+      ++m_current;
+    }
+  }
+
+  void run()
+  {
+    std::unique_lock< std::mutex > locker{m_lock};
+    while ( !m_stop )
+    {
+      m_wake = 0;
+      advance( tick_of( clock_type::now() ) );
+
+      if ( !m_due.empty() )
+      {
+        detail::timer_node*                  node = m_due.next;
+        std::unique_ptr< detail::pool_task > fn( node->fn );
+        node->unlink();
+        release( node );
+        --m_pending;
+
+        locker.unlock();
+        fn->run();
+        fn.reset();
+        locker.lock();
+        continue;
+      }
+
+      m_wake = next_event();
+      if ( m_wake == never )
+      {
+        m_cv.wait( locker );
+      }
+      else
+      {
+        m_cv.wait_until( locker, m_origin + m_tick * m_wake );
+      }
+    }
+  }
+
+  bool cancel( detail::timer_node* node, uint64_t generation )
+  {
+    std::unique_ptr< detail::pool_task > fn;
+    {
+      std::lock_guard< std::mutex > locker{m_lock};
+      if ( node->generation != generation || !node->fn )
+      {
+        return false;
+      }
+      fn.reset( node->fn );
+      unlink( node );
+      release( node );
+      --m_pending;
+    }
+    return true;
+  }
+
+  bool is_pending( const detail::timer_node* node, uint64_t generation ) const
+  {
+    std::lock_guard< std::mutex > locker{m_lock};
+    return node->generation == generation && node->fn;
+  }
+
+  detail::timer_node* allocate()
+  {
+    if ( m_free.empty() )
+    {
+      m_chunks.emplace_back( new detail::timer_node[chunk] );
+      for ( unsigned ix = 0; ix < chunk; ++ix )
+      {
+        m_free.push_back( &m_chunks.back()[ix] );
+      }
+    }
+    detail::timer_node* node = m_free.next;
+    node->unlink();
+    return node;
+  }
+
+  void release( detail::timer_node* node )
+  {
+    node->fn = nullptr;
+    ++node->generation;
+    m_free.push_back( node );
+  }
+
+  void drop( detail::timer_node& list )
+  {
+    for ( auto* node = list.next; node != &list; node = node->next )
+    {
+      delete node->fn;
+    }
+  }
+
+  const clock_type::duration   m_tick;
+  const clock_type::time_point m_origin;
+
+  mutable std::mutex      m_lock;
+  std::condition_variable m_cv;
+  uint64_t                m_current = 0; // the next tick to process
+  uint64_t                m_wake    = 0; // the tick the driver sleeps until, 0 while awake
+  size_t                  m_pending = 0;
+  bool                    m_stop    = false;
+
+  detail::timer_node m_slots[slot_count];
+  uint64_t           m_occupied[slot_count / 64] = {};
+  detail::timer_node m_due;  // fired, waiting for the driver to run them
+  detail::timer_node m_free; // nodes to reuse
+
+  std::vector< std::unique_ptr< detail::timer_node[] > > m_chunks;
+
+  std::thread m_thread; // last, starts once the rest is built
+}; // timer_wheel
+
+inline bool timer_handle::cancel()
+{
+  return m_wheel && m_wheel->cancel( m_node, m_generation );
+}
+
+inline bool timer_handle::pending() const
+{
+  return m_wheel && m_wheel->is_pending( m_node, m_generation );
+}
@@ -0,0 +1,133 @@
+// timer_wheel against the heap in timer_queue. scheduling 1M timeouts 1-10s out,
+// cancelling them all again (the wheel only, the heap cannot), and the common
+// timeout pattern of scheduling one and cancelling it right after. then firing
+// jitter: 20000 timers 1-500ms out, lateness against their deadlines as
+// p50 / p99 / max, on the heap and on wheels ticking every 1ms and 100us.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "stopwatch.hpp"
+#include "timer_queue.hpp"
+#include "timer_wheel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+constexpr size_t timers = 1000000;
+constexpr size_t fires  = 20000;
+
+void report( const std::string& name, size_t ops, clock_type::time_point start )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << ops / elapsed.count() / 1e6 << "M/s" << std::endl;
+}
+
+std::vector< clock_type::duration > random_delays( size_t count, int lo_ms, int hi_ms )
+{
+  std::mt19937                             gen( 5 );
+  std::uniform_int_distribution< int64_t > pick( lo_ms * 1000, hi_ms * 1000 );
+  std::vector< clock_type::duration >      delays( count );
+  for ( auto& d : delays )
+  {
+    d = std::chrono::microseconds( pick( gen ) );
+  }
+  return delays;
+}
+
+template < class Timers >
+void jitter( const std::string& name, Timers& t )
+{
+  const auto            delays = random_delays( fires, 1, 500 );
+  latency_histogram     late;
+  std::atomic< size_t > fired{0};
+
+  for ( auto d : delays )
+  {
+    const auto deadline = clock_type::now() + d;
+    t.schedule_at( deadline, [&, deadline] {
+      late.record( uint64_t( ( clock_type::now() - deadline ).count() ) );
+      fired.fetch_add( 1, std::memory_order_relaxed );
+    } );
+  }
+  while ( fired.load() < fires )
+  {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+  }
+
+  const histogram_snapshot s = late.snapshot();
+  std::cout << name << " lateness p50=" << s.percentile( 0.5 ) / 1e3
+            << "us p99=" << s.percentile( 0.99 ) / 1e3 << "us max=" << s.max() / 1e3 << "us"
+            << std::endl;
+}
+} // namespace
+
+TEST( TimerWheelBench, ScheduleAndCancel )
+{
+  const auto delays = random_delays( timers, 1000, 10000 );
+
+  {
+    timer_queue heap;
+    auto        start = clock_type::now();
+    for ( auto d : delays )
+    {
+      heap.schedule_after( d, [] {} );
+    }
+    report( "timer_queue schedule", timers, start );
+  }
+
+  timer_wheel                 wheel;
+  std::vector< timer_handle > handles;
+  handles.reserve( timers );
+
+  auto start = clock_type::now();
+  for ( auto d : delays )
+  {
+    handles.push_back( wheel.schedule_after( d, [] {} ) );
+  }
+  report( "timer_wheel schedule", timers, start );
+
+  start = clock_type::now();
+  for ( auto& h : handles )
+  {
+    h.cancel();
+  }
+  report( "timer_wheel cancel", timers, start );
+
+  // nodes are reused from here on
+  start = clock_type::now();
+  for ( auto d : delays )
+  {
+    wheel.schedule_after( d, [] {} ).cancel();
+  }
+  report( "timer_wheel schedule + cancel", timers, start );
+  EXPECT_EQ( wheel.pending(), 0u );
+}
+
+TEST( TimerWheelBench, Jitter )
+{
+  {
+    timer_queue heap;
+    jitter( "timer_queue", heap );
+  }
+  {
+    timer_wheel wheel;
+    jitter( "timer_wheel 1ms ticks", wheel );
+  }
+  {
+    timer_wheel wheel( std::chrono::microseconds( 100 ) );
+    jitter( "timer_wheel 100us ticks", wheel );
+  }
+}
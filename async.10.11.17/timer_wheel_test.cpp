@@ -0,0 +1,196 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "timer_wheel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+// clang-format on
+
+using namespace std::chrono_literals;
+
+namespace
+{
+using clock_type = timer_wheel::clock_type;
+
+template < class Pred >
+bool eventually( Pred pred, clock_type::duration limit = 5s )
+{
+  const auto until = clock_type::now() + limit;
+  while ( !pred() )
+  {
+    if ( clock_type::now() > until )
+    {
+      return false;
+    }
+    std::this_thread::sleep_for( 1ms );
+  }
+  return true;
+}
+} // namespace
+
+TEST( TimerWheel, FiresInOrderNeverEarly )
+{
+  timer_wheel wheel;
+
+  struct firing
+  {
+    clock_type::time_point deadline, fired;
+  };
+  std::mutex                           lock;
+  std::vector< firing >                fired;
+  std::mt19937                         gen( 7 );
+  std::uniform_int_distribution< int > pick( 0, 50000 );
+
+  const auto now = clock_type::now();
+  for ( int ix = 0; ix < 200; ++ix )
+  {
+    const auto deadline = now + std::chrono::microseconds( pick( gen ) );
+    wheel.schedule_at( deadline, [&, deadline] {
+      std::lock_guard< std::mutex > locker{lock};
+      fired.push_back( firing{deadline, clock_type::now()} );
+    } );
+  }
+  auto all_fired = [&] { return wheel.pending() == 0; };
+  ASSERT_TRUE( eventually( all_fired ) );
+
+  ASSERT_EQ( fired.size(), 200u );
+  for ( size_t ix = 0; ix < fired.size(); ++ix )
+  {
+    EXPECT_GE( fired[ix].fired, fired[ix].deadline );
+    // tick granularity: a later tick never fires before an earlier one
+    if ( ix > 0 )
+    {
+      EXPECT_LT( fired[ix - 1].deadline, fired[ix].deadline + wheel.tick() );
+    }
+  }
+}
+
+TEST( TimerWheel, Cancels )
+{
+  timer_wheel        wheel;
+  std::atomic< int > ran{0};
+
+  timer_handle later = wheel.schedule_after( 30ms, [&] { ran += 1; } );
+  EXPECT_TRUE( later.pending() );
+  EXPECT_TRUE( later.cancel() );
+  EXPECT_FALSE( later.pending() );
+  EXPECT_FALSE( later.cancel() );
+  EXPECT_EQ( wheel.pending(), 0u );
+
+  timer_handle soon = wheel.schedule_after( 1ms, [&] { ran += 10; } );
+  auto         ten  = [&] { return ran.load() == 10; };
+  ASSERT_TRUE( eventually( ten ) );
+  EXPECT_FALSE( soon.pending() );
+  EXPECT_FALSE( soon.cancel() );
+
+  // the node is reused, the old handle does not reach the new timer
+  timer_handle reused = wheel.schedule_after( 1h, [&] { ran += 100; } );
+  EXPECT_FALSE( soon.cancel() );
+  EXPECT_FALSE( later.cancel() );
+  EXPECT_TRUE( reused.pending() );
+  EXPECT_TRUE( reused.cancel() );
+
+  std::this_thread::sleep_for( 50ms );
+  EXPECT_EQ( ran.load(), 10 );
+  EXPECT_FALSE( timer_handle().cancel() );
+}
+
+TEST( TimerWheel, SpreadsDownTheLevels )
+{
+  // 10us ticks: level 0 reaches 2.56ms, level 1 655ms, level 2 168s
+  timer_wheel wheel( 10us );
+
+  std::mutex                                lock;
+  std::vector< clock_type::duration >       late;
+  const std::vector< clock_type::duration > delays{500us, 2ms, 5ms, 40ms, 700ms, 900ms};
+
+  for ( auto d : delays )
+  {
+    const auto deadline = clock_type::now() + d;
+    wheel.schedule_at( deadline, [&, deadline] {
+      std::lock_guard< std::mutex > locker{lock};
+      late.push_back( clock_type::now() - deadline );
+    } );
+  }
+  // past the top level, cancelled again
+  timer_handle far = wheel.schedule_after( 24h * 365, [] {} );
+
+  auto fired = [&] { return wheel.pending() == 1; };
+  ASSERT_TRUE( eventually( fired ) );
+  ASSERT_EQ( late.size(), delays.size() );
+  for ( auto l : late )
+  {
+    EXPECT_GE( l, 0us );
+    EXPECT_LT( l, 100ms );
+  }
+  EXPECT_TRUE( far.cancel() );
+}
+
+TEST( TimerWheel, ManyTimersHalfCancelled )
+{
+  constexpr int count = 100000;
+
+  timer_wheel                          wheel;
+  std::atomic< int >                   ran{0}, wrong{0};
+  std::mt19937                         gen( 11 );
+  std::uniform_int_distribution< int > pick( 300, 400 );
+  std::vector< timer_handle >          handles;
+
+  for ( int ix = 0; ix < count; ++ix )
+  {
+    handles.push_back( wheel.schedule_after( std::chrono::milliseconds( pick( gen ) ), [&, ix] {
+      ran += 1;
+      wrong += ix % 2;
+    } ) );
+  }
+  int cancelled = 0;
+  for ( int ix = 1; ix < count; ix += 2 )
+  {
+    cancelled += handles[ix].cancel();
+  }
+  // some may have fired already on a slow machine
+  EXPECT_GT( cancelled, count / 4 );
+
+  auto all_fired = [&] { return wheel.pending() == 0; };
+  ASSERT_TRUE( eventually( all_fired ) );
+  EXPECT_EQ( ran.load(), count - cancelled );
+  EXPECT_EQ( wrong.load(), count / 2 - cancelled );
+}
+
+TEST( TimerWheel, CallbacksScheduleMore )
+{
+  timer_wheel        wheel;
+  std::atomic< int > hops{0};
+
+  std::function< void() > hop = [&] {
+    if ( ++hops < 20 )
+    {
+      wheel.schedule_after( 1ms, hop );
+    }
+  };
+  wheel.schedule_after( 0ms, hop );
+
+  auto twenty = [&] { return hops.load() == 20; };
+  EXPECT_TRUE( eventually( twenty ) );
+}
+
+TEST( TimerWheel, DropsPendingOnDestruction )
+{
+  auto witness = std::make_shared< int >( 0 );
+  {
+    timer_wheel wheel;
+    wheel.schedule_after( 1h, [witness] { ++*witness; } );
+    wheel.schedule_after( 2h, [witness] { ++*witness; } );
+    EXPECT_EQ( witness.use_count(), 3 );
+  }
+  EXPECT_EQ( witness.use_count(), 1 );
+  EXPECT_EQ( *witness, 0 );
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+// which cpus share a core, a last level cache and a NUMA node, read from sysfs,
+// and where to put pool workers given that. SMT siblings split one core's
+// execution units and two workers on them run at well under twice one; workers
+// spread over sockets pay remote memory and cross socket cache traffic on every
+// steal. placement::per_core gives each worker a core of its own, per_cache keeps
+// each worker inside one L3 domain and fills domains one after another, so
+// neighbouring worker indices share a cache.
+//
+// only cpus this process may run on count (containers and taskset restrict
+// them). without sysfs every allowed cpu is taken as its own core behind one
+// shared cache on node 0.
+
+#include <dirent.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class placement
+{
+  none,      // let the scheduler decide
+  per_core,  // each worker pinned to one cpu of its own physical core
+  per_cache, // each worker free within one last level cache domain
+};
+
+struct cpu_info
+{
+  unsigned id;      // os cpu number
+  unsigned core;    // index into cpu_topology::cores()
+  unsigned cache;   // index into cpu_topology::cache_domains()
+  unsigned node;    // numa node number
+  unsigned package; // socket
+};
+
+namespace detail
+{
+// "0-3,8,10-11" into its cpu numbers, sorted
+inline std::vector< unsigned > parse_cpu_list( const std::string& list )
+{
+  std::vector< unsigned > cpus;
+  size_t                  pos = 0;
+  while ( pos < list.size() )
+  {
+    size_t end = list.find( ',', pos );
+    if ( end == std::string::npos )
+    {
+      end = list.size();
+    }
+    const std::string range = list.substr( pos, end - pos );
+    pos                     = end + 1;
+
+    const size_t dash = range.find( '-' );
+    if ( range.empty() || !isdigit( (unsigned char)range[0] ) )
+    {
+      continue;
+    }
+    const unsigned first = unsigned( std::strtoul( range.c_str(), nullptr, 10 ) );
+    const unsigned last  = dash == std::string::npos
+                               ? first
+                               : unsigned( std::strtoul( range.c_str() + dash + 1, nullptr, 10 ) );
+    for ( unsigned cpu = first; cpu <= last; ++cpu )
+    {
+      cpus.push_back( cpu );
+    }
+  }
+  std::sort( cpus.begin(), cpus.end() );
+  cpus.erase( std::unique( cpus.begin(), cpus.end() ), cpus.end() );
+  return cpus;
+}
+
+// first line of a sysfs file, empty if it is not there
+inline std::string read_sysfs( const std::string& path )
+{
+  std::ifstream in( path );
+  std::string   line;
+  std::getline( in, line );
+  return line;
+}
+
+// entries of dir starting with prefix and followed by a number, as those numbers
+inline std::vector< unsigned > numbered_entries( const std::string& dir, const std::string& prefix )
+{
+  std::vector< unsigned > found;
+  if ( DIR* d = opendir( dir.c_str() ) )
+  {
+    while ( dirent* entry = readdir( d ) )
+    {
+      const std::string name = entry->d_name;
+      if ( name.size() > prefix.size() && name.compare( 0, prefix.size(), prefix ) == 0
+           && isdigit( (unsigned char)name[prefix.size()] ) )
+      {
+        found.push_back( unsigned( std::strtoul( name.c_str() + prefix.size(), nullptr, 10 ) ) );
+      }
+    }
+    closedir( d );
+  }
+  std::sort( found.begin(), found.end() );
+  return found;
+}
+
+// restrict the calling thread to cpus. false if the kernel refused, the thread
+// then runs wherever it did before.
+inline bool pin_current_thread( const std::vector< unsigned >& cpus )
+{
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  for ( unsigned cpu : cpus )
+  {
+    if ( cpu < CPU_SETSIZE )
+    {
+      CPU_SET( cpu, &set );
+    }
+  }
+  return CPU_COUNT( &set ) > 0 && sched_setaffinity( 0, sizeof( set ), &set ) == 0;
+}
+} // namespace detail
+
+class cpu_topology
+{
+public:
+  // read sysfs under root, "/sys/devices/system" on a real machine. allowed_only
+  // drops cpus outside this process's affinity mask.
+  static cpu_topology discover( const std::string& root = "/sys/devices/system",
+                                bool               allowed_only = true )
+  {
+    cpu_topology topo;
+
+    auto      cpus = detail::parse_cpu_list( detail::read_sysfs( root + "/cpu/online" ) );
+    cpu_set_t allowed;
+    if ( allowed_only && sched_getaffinity( 0, sizeof( allowed ), &allowed ) == 0 )
+    {
+      if ( cpus.empty() )
+      {
+        for ( unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+        {
+          if ( CPU_ISSET( cpu, &allowed ) )
+          {
+            cpus.push_back( cpu );
+          }
+        }
+      }
+      else
+      {
+        cpus.erase( std::remove_if( cpus.begin(), cpus.end(),
+                                    [&]( unsigned cpu ) {
+                                      return cpu >= CPU_SETSIZE || !CPU_ISSET( cpu, &allowed );
+                                    } ),
+                    cpus.end() );
+      }
+    }
+    if ( cpus.empty() )
+    {
+      for ( unsigned cpu = 0; cpu < std::max( 1u, std::thread::hardware_concurrency() ); ++cpu )
+      {
+        cpus.push_back( cpu );
+      }
+    }
+
+    std::map< unsigned, unsigned > node_of;
+    for ( unsigned node : detail::numbered_entries( root + "/node", "node" ) )
+    {
+      const std::string path = root + "/node/node" + std::to_string( node ) + "/cpulist";
+      for ( unsigned cpu : detail::parse_cpu_list( detail::read_sysfs( path ) ) )
+      {
+        node_of[cpu] = node;
+      }
+    }
+
+    // a core is named by its first SMT sibling, a cache domain by the first cpu
+    // sharing the highest level data or unified cache
+    struct raw
+    {
+      unsigned id, core_key, cache_key, node, package;
+    };
+    std::vector< raw > raws;
+    for ( unsigned cpu : cpus )
+    {
+      const std::string dir = root + "/cpu/cpu" + std::to_string( cpu );
+
+      raw r{cpu, cpu, cpus.front(), node_of.count( cpu ) ? node_of[cpu] : 0, 0};
+
+      auto siblings
+          = detail::parse_cpu_list( detail::read_sysfs( dir + "/topology/thread_siblings_list" ) );
+      if ( !siblings.empty() )
+      {
+        r.core_key = siblings.front();
+      }
+      const std::string package = detail::read_sysfs( dir + "/topology/physical_package_id" );
+      if ( !package.empty() )
+      {
+        r.package = unsigned( std::strtoul( package.c_str(), nullptr, 10 ) );
+      }
+
+      unsigned top = 0;
+      for ( unsigned index : detail::numbered_entries( dir + "/cache", "index" ) )
+      {
+        const std::string cache = dir + "/cache/index" + std::to_string( index );
+        if ( detail::read_sysfs( cache + "/type" ) == "Instruction" )
+        {
+          continue;
+        }
+        const unsigned level = unsigned(
+            std::strtoul( detail::read_sysfs( cache + "/level" ).c_str(), nullptr, 10 ) );
+        auto shared = detail::parse_cpu_list( detail::read_sysfs( cache + "/shared_cpu_list" ) );
+        if ( level > top && !shared.empty() )
+        {
+          top         = level;
+          r.cache_key = shared.front();
+        }
+      }
+      raws.push_back( r );
+    }
+
+    // cpus ordered so that everything sharing a node, then a cache, then a core
+    // sits together: cores(), cache_domains() and placements follow that order
+    std::stable_sort( raws.begin(), raws.end(), []( const raw& a, const raw& b ) {
+      if ( a.node != b.node )
+      {
+        return a.node < b.node;
+      }
+      if ( a.cache_key != b.cache_key )
+      {
+        return a.cache_key < b.cache_key;
+      }
+      return a.core_key < b.core_key;
+    } );
+
+    std::map< unsigned, unsigned > core_index, cache_index, node_index;
+    for ( const raw& r : raws )
+    {
+      if ( !core_index.count( r.core_key ) )
+      {
+        core_index[r.core_key] = unsigned( topo.m_cores.size() );
+        topo.m_cores.emplace_back();
+      }
+      if ( !cache_index.count( r.cache_key ) )
+      {
+        cache_index[r.cache_key] = unsigned( topo.m_caches.size() );
+        topo.m_caches.emplace_back();
+      }
+      if ( !node_index.count( r.node ) )
+      {
+        node_index[r.node] = unsigned( topo.m_nodes.size() );
+        topo.m_nodes.emplace_back();
+      }
+
+      const unsigned core  = core_index[r.core_key];
+      const unsigned cache = cache_index[r.cache_key];
+      topo.m_cores[core].push_back( r.id );
+      topo.m_caches[cache].push_back( r.id );
+      topo.m_nodes[node_index[r.node]].push_back( r.id );
+      topo.m_cpus.push_back( cpu_info{r.id, core, cache, r.node, r.package} );
+    }
+
+    for ( auto* groups : {&topo.m_cores, &topo.m_caches, &topo.m_nodes} )
+    {
+      for ( auto& group : *groups )
+      {
+        std::sort( group.begin(), group.end() );
+      }
+    }
+    return topo;
+  }
+
+  // this machine, discovered on first use
+  static const cpu_topology& system()
+  {
+    static const cpu_topology topo = discover();
+    return topo;
+  }
+
+  // usable cpus, grouped by node, cache and core
+  const std::vector< cpu_info >& cpus() const
+  {
+    return m_cpus;
+  }
+
+  // the SMT siblings of each physical core
+  const std::vector< std::vector< unsigned > >& cores() const
+  {
+    return m_cores;
+  }
+
+  // the cpus behind each last level cache
+  const std::vector< std::vector< unsigned > >& cache_domains() const
+  {
+    return m_caches;
+  }
+
+  // the cpus of each numa node, in node number order
+  const std::vector< std::vector< unsigned > >& nodes() const
+  {
+    return m_nodes;
+  }
+
+  // the worker count a placement would pick: cores for per_core, cpus otherwise
+  size_t natural_workers( placement where ) const
+  {
+    return where == placement::per_core ? m_cores.size() : m_cpus.size();
+  }
+
+  // the cpus each of workers workers may run on, empty sets for placement::none.
+  // per_core runs out of cores at cores().size() and carries on with second
+  // siblings; per_cache shares workers among domains by their cpu counts.
+  std::vector< std::vector< unsigned > > place( placement where, size_t workers ) const
+  {
+    std::vector< std::vector< unsigned > > sets( workers );
+    if ( where == placement::per_core )
+    {
+      for ( size_t ix = 0; ix < workers; ++ix )
+      {
+        const auto& core = m_cores[ix % m_cores.size()];
+        sets[ix]         = {core[( ix / m_cores.size() ) % core.size()]};
+      }
+    }
+    else if ( where == placement::per_cache )
+    {
+      for ( size_t ix = 0; ix < workers; ++ix )
+      {
+        // the cpu this worker would get if workers were spread evenly over all
+        // cpus, and the domain that cpu is in
+        sets[ix] = m_caches[m_cpus[ix * m_cpus.size() / workers].cache];
+      }
+    }
+    return sets;
+  }
+
+private:
+  std::vector< cpu_info >                m_cpus;
+  std::vector< std::vector< unsigned > > m_cores;
+  std::vector< std::vector< unsigned > > m_caches;
+  std::vector< std::vector< unsigned > > m_nodes;
+};
@@ -0,0 +1,154 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "topology.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+// clang-format on
+
+namespace
+{
+namespace fs = std::filesystem;
+
+using cpu_sets = std::vector< std::vector< unsigned > >;
+
+void put( const fs::path& file, const std::string& line )
+{
+  fs::create_directories( file.parent_path() );
+  std::ofstream( file ) << line << "\n";
+}
+
+// two sockets, each one numa node with one L3 and two cores of two SMT threads.
+// siblings are numbered the way linux usually does it, n and n + cores per socket.
+struct fake_sysfs
+{
+  fake_sysfs()
+  {
+    char dir[] = "/tmp/topology_test.XXXXXX";
+    root       = mkdtemp( dir );
+
+    put( root / "cpu/online", "0-7" );
+    put( root / "node/node0/cpulist", "0-3" );
+    put( root / "node/node1/cpulist", "4-7" );
+    for ( unsigned cpu = 0; cpu < 8; ++cpu )
+    {
+      const fs::path    dir      = root / ( "cpu/cpu" + std::to_string( cpu ) );
+      const unsigned    socket   = cpu / 4;
+      const unsigned    sibling  = socket * 4 + ( cpu + 2 ) % 4;
+      const std::string siblings = std::to_string( std::min( cpu, sibling ) ) + ","
+                                   + std::to_string( std::max( cpu, sibling ) );
+
+      put( dir / "topology/physical_package_id", std::to_string( socket ) );
+      put( dir / "topology/thread_siblings_list", siblings );
+      put( dir / "cache/index0/level", "1" );
+      put( dir / "cache/index0/type", "Data" );
+      put( dir / "cache/index0/shared_cpu_list", siblings );
+      put( dir / "cache/index1/level", "1" );
+      put( dir / "cache/index1/type", "Instruction" );
+      put( dir / "cache/index1/shared_cpu_list", siblings );
+      put( dir / "cache/index2/level", "2" );
+      put( dir / "cache/index2/type", "Unified" );
+      put( dir / "cache/index2/shared_cpu_list", siblings );
+      put( dir / "cache/index3/level", "3" );
+      put( dir / "cache/index3/type", "Unified" );
+      put( dir / "cache/index3/shared_cpu_list", socket ? "4-7" : "0-3" );
+    }
+  }
+
+  ~fake_sysfs()
+  {
+    fs::remove_all( root );
+  }
+
+  fs::path root;
+};
+} // namespace
+
+TEST( Topology, ParsesCpuLists )
+{
+  EXPECT_EQ( detail::parse_cpu_list( "0-3,8,10-11" ),
+             ( std::vector< unsigned >{0, 1, 2, 3, 8, 10, 11} ) );
+  EXPECT_EQ( detail::parse_cpu_list( "5" ), ( std::vector< unsigned >{5} ) );
+  EXPECT_EQ( detail::parse_cpu_list( "3,1,1-2" ), ( std::vector< unsigned >{1, 2, 3} ) );
+  EXPECT_TRUE( detail::parse_cpu_list( "" ).empty() );
+}
+
+TEST( Topology, CoresCachesAndNodes )
+{
+  fake_sysfs   sysfs;
+  cpu_topology topo = cpu_topology::discover( sysfs.root.string(), false );
+
+  ASSERT_EQ( topo.cpus().size(), 8u );
+  EXPECT_EQ( topo.cores(), ( cpu_sets{{0, 2}, {1, 3}, {4, 6}, {5, 7}} ) );
+  EXPECT_EQ( topo.cache_domains(), ( cpu_sets{{0, 1, 2, 3}, {4, 5, 6, 7}} ) );
+  EXPECT_EQ( topo.nodes(), ( cpu_sets{{0, 1, 2, 3}, {4, 5, 6, 7}} ) );
+
+  for ( const cpu_info& cpu : topo.cpus() )
+  {
+    EXPECT_EQ( cpu.node, cpu.id / 4 );
+    EXPECT_EQ( cpu.package, cpu.id / 4 );
+    EXPECT_EQ( cpu.cache, cpu.id / 4 );
+    EXPECT_EQ( topo.cores()[cpu.core][0] % 4, cpu.id % 2 );
+  }
+}
+
+TEST( Topology, Placements )
+{
+  fake_sysfs   sysfs;
+  cpu_topology topo = cpu_topology::discover( sysfs.root.string(), false );
+
+  EXPECT_EQ( topo.natural_workers( placement::per_core ), 4u );
+  EXPECT_EQ( topo.natural_workers( placement::per_cache ), 8u );
+  EXPECT_EQ( topo.natural_workers( placement::none ), 8u );
+
+  // a core each, then the second siblings
+  EXPECT_EQ( topo.place( placement::per_core, 4 ), ( cpu_sets{{0}, {1}, {4}, {5}} ) );
+  EXPECT_EQ( topo.place( placement::per_core, 6 ), ( cpu_sets{{0}, {1}, {4}, {5}, {2}, {3}} ) );
+
+  // neighbours share a domain, domains get their share
+  const std::vector< unsigned > first{0, 1, 2, 3}, second{4, 5, 6, 7};
+  EXPECT_EQ( topo.place( placement::per_cache, 2 ), ( cpu_sets{first, second} ) );
+  EXPECT_EQ( topo.place( placement::per_cache, 4 ), ( cpu_sets{first, first, second, second} ) );
+
+  EXPECT_EQ( topo.place( placement::none, 3 ), cpu_sets( 3 ) );
+}
+
+TEST( Topology, WithoutSysfs )
+{
+  cpu_topology topo = cpu_topology::discover( "/nonexistent", false );
+
+  ASSERT_FALSE( topo.cpus().empty() );
+  EXPECT_EQ( topo.cores().size(), topo.cpus().size() );
+  EXPECT_EQ( topo.cache_domains().size(), 1u );
+  EXPECT_EQ( topo.nodes().size(), 1u );
+}
+
+TEST( Topology, ThisMachine )
+{
+  const cpu_topology& topo = cpu_topology::system();
+  ASSERT_FALSE( topo.cpus().empty() );
+
+  // every cpu in exactly one core, one domain and one node
+  for ( auto* groups : {&topo.cores(), &topo.cache_domains(), &topo.nodes()} )
+  {
+    std::multiset< unsigned > seen;
+    for ( auto& group : *groups )
+    {
+      seen.insert( group.begin(), group.end() );
+    }
+    EXPECT_EQ( seen.size(), topo.cpus().size() );
+    for ( const cpu_info& cpu : topo.cpus() )
+    {
+      EXPECT_EQ( seen.count( cpu.id ), 1u );
+    }
+  }
+
+  EXPECT_TRUE( detail::pin_current_thread( topo.cores()[0] ) );
+  EXPECT_EQ( unsigned( sched_getcpu() ), topo.cores()[0][0] );
+}
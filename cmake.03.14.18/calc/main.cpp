@@ -3,5 +3,5 @@
 
 int main( int argc, char** argv )
 {
-  std::cout << " ADD 1+1=" << add( 1, 1 ) << std::endl;
+  std::cout << " ADD 1+1=" << slowmath::add( 1, 1 ) << std::endl;
 }
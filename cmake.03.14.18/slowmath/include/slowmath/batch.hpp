@@ -0,0 +1,82 @@
+#pragma once
+
+// whole arrays at once: out[i] = a[i] op b[i], one call per array instead of one
+// out of line call per element. the library carries AVX-512, AVX2 and baseline
+// builds of every loop and uses the best one the cpu has.
+//
+// int and int64_t wrap around on overflow where the scalar operations are
+// undefined. integer division by zero is undefined here too. out may be the
+// same array as a or b.
+//
+// the std::span overloads need C++20 and throw std::invalid_argument unless all
+// three spans are the same size. the pointer overloads work with any standard.
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined( __has_include )
+#if __has_include( <span> ) && __cplusplus > 201703L
+#include <span>
+#define SLOWMATH_HAS_SPAN 1
+#endif
+#endif
+
+void add( const int* a, const int* b, int* out, std::size_t n );
+void add( const std::int64_t* a, const std::int64_t* b, std::int64_t* out, std::size_t n );
+void add( const float* a, const float* b, float* out, std::size_t n );
+void add( const double* a, const double* b, double* out, std::size_t n );
+
+void subtract( const int* a, const int* b, int* out, std::size_t n );
+void subtract( const std::int64_t* a, const std::int64_t* b, std::int64_t* out, std::size_t n );
+void subtract( const float* a, const float* b, float* out, std::size_t n );
+void subtract( const double* a, const double* b, double* out, std::size_t n );
+
+void multiply( const int* a, const int* b, int* out, std::size_t n );
+void multiply( const std::int64_t* a, const std::int64_t* b, std::int64_t* out, std::size_t n );
+void multiply( const float* a, const float* b, float* out, std::size_t n );
+void multiply( const double* a, const double* b, double* out, std::size_t n );
+
+void divide( const int* a, const int* b, int* out, std::size_t n );
+void divide( const std::int64_t* a, const std::int64_t* b, std::int64_t* out, std::size_t n );
+void divide( const float* a, const float* b, float* out, std::size_t n );
+void divide( const double* a, const double* b, double* out, std::size_t n );
+
+#if SLOWMATH_HAS_SPAN
+inline std::size_t batch_size( std::size_t a, std::size_t b, std::size_t out )
+{
+  if ( a != out || b != out )
+  {
+    throw std::invalid_argument( "slowmath: batch operands differ in size" );
+  }
+  return out;
+}
+
+#define SLOWMATH_SPAN_OVERLOAD( op, T )                                                            \
+  inline void op( std::span< const T > a, std::span< const T > b, std::span< T > out )             \
+  {                                                                                                \
+    op( a.data(), b.data(), out.data(), batch_size( a.size(), b.size(), out.size() ) );            \
+  }
+
+SLOWMATH_SPAN_OVERLOAD( add, int )
+SLOWMATH_SPAN_OVERLOAD( add, std::int64_t )
+SLOWMATH_SPAN_OVERLOAD( add, float )
+SLOWMATH_SPAN_OVERLOAD( add, double )
+
+SLOWMATH_SPAN_OVERLOAD( subtract, int )
+SLOWMATH_SPAN_OVERLOAD( subtract, std::int64_t )
+SLOWMATH_SPAN_OVERLOAD( subtract, float )
+SLOWMATH_SPAN_OVERLOAD( subtract, double )
+
+SLOWMATH_SPAN_OVERLOAD( multiply, int )
+SLOWMATH_SPAN_OVERLOAD( multiply, std::int64_t )
+SLOWMATH_SPAN_OVERLOAD( multiply, float )
+SLOWMATH_SPAN_OVERLOAD( multiply, double )
+
+SLOWMATH_SPAN_OVERLOAD( divide, int )
+SLOWMATH_SPAN_OVERLOAD( divide, std::int64_t )
+SLOWMATH_SPAN_OVERLOAD( divide, float )
+SLOWMATH_SPAN_OVERLOAD( divide, double )
+
+#undef SLOWMATH_SPAN_OVERLOAD
+#endif
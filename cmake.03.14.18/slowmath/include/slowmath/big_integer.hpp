@@ -0,0 +1,250 @@
+#pragma once
+
+// integers of any size, for sums and products that have to be exact:
+//
+//   slowmath::big_integer total;
+//   for ( auto v : values ) total += v;              // never overflows
+//   slowmath::big_integer f( "123456789012345678901234567890" );
+//   std::cout << f * f << "\n";
+//
+// sign and magnitude, the magnitude in 64 bit limbs, least significant first.
+// up to two limbs live in the object itself, and adding, subtracting or
+// multiplying values of one limb is done in 128 bit registers: no allocation
+// and no loop. longer values are on the heap, where += and -= reuse the storage
+// they have. long products use Karatsuba's three half size products in place of
+// four, shorter ones the schoolbook method.
+//
+// needs a 64 bit GCC or clang, for unsigned __int128.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace slowmath
+{
+class big_integer
+{
+public:
+  typedef std::uint64_t limb;
+
+  big_integer() = default;
+
+  // any integer type: unsigned ones keep their value rather than wrapping
+  // through long long
+  template < class T,
+             typename std::enable_if< std::is_integral< T >::value && std::is_signed< T >::value,
+                                      int >::type = 0 >
+  big_integer( T value )
+  {
+    assign( __int128( value ) );
+  }
+
+  template < class T,
+             typename std::enable_if< std::is_integral< T >::value && !std::is_signed< T >::value,
+                                      int >::type = 0 >
+  big_integer( T value )
+  {
+    assign( ( unsigned __int128 )( value ), false );
+  }
+
+  // decimal digits, with an optional leading - or +. throws std::invalid_argument
+  // for anything else, an empty string included.
+  explicit big_integer( const std::string& decimal );
+
+  big_integer( const big_integer& other );
+  big_integer( big_integer&& other ) noexcept;
+  big_integer& operator=( const big_integer& other );
+  big_integer& operator=( big_integer&& other ) noexcept;
+
+  big_integer& operator+=( const big_integer& b )
+  {
+    sum( *this, b, false, *this );
+    return *this;
+  }
+
+  big_integer& operator-=( const big_integer& b )
+  {
+    sum( *this, b, true, *this );
+    return *this;
+  }
+
+  big_integer& operator*=( const big_integer& b )
+  {
+    if ( m_size <= 1 && b.m_size <= 1 )
+    {
+      product( *this, b, *this );
+    }
+    else
+    {
+      big_integer r;
+      multiply( *this, b, r );
+      *this = std::move( r );
+    }
+    return *this;
+  }
+
+  friend big_integer operator+( const big_integer& a, const big_integer& b )
+  {
+    big_integer r;
+    sum( a, b, false, r );
+    return r;
+  }
+
+  friend big_integer operator-( const big_integer& a, const big_integer& b )
+  {
+    big_integer r;
+    sum( a, b, true, r );
+    return r;
+  }
+
+  friend big_integer operator*( const big_integer& a, const big_integer& b )
+  {
+    big_integer r;
+    product( a, b, r );
+    return r;
+  }
+
+  big_integer operator-() const
+  {
+    big_integer r( *this );
+    r.m_negative = m_size != 0 && !m_negative;
+    return r;
+  }
+
+  // -1, 0 or 1
+  int sign() const
+  {
+    return m_size == 0 ? 0 : m_negative ? -1 : 1;
+  }
+
+  // bits in the magnitude, 0 for 0
+  std::size_t bits() const;
+
+  // throws std::overflow_error unless the value fits
+  std::int64_t to_int64() const;
+
+  std::string to_string() const;
+
+  // less than 0, 0 or greater than 0 as a is less than, equal to or greater than b
+  friend int compare( const big_integer& a, const big_integer& b );
+
+  friend bool operator==( const big_integer& a, const big_integer& b )
+  {
+    return compare( a, b ) == 0;
+  }
+
+  friend bool operator!=( const big_integer& a, const big_integer& b )
+  {
+    return compare( a, b ) != 0;
+  }
+
+  friend bool operator<( const big_integer& a, const big_integer& b )
+  {
+    return compare( a, b ) < 0;
+  }
+
+  friend bool operator<=( const big_integer& a, const big_integer& b )
+  {
+    return compare( a, b ) <= 0;
+  }
+
+  friend bool operator>( const big_integer& a, const big_integer& b )
+  {
+    return compare( a, b ) > 0;
+  }
+
+  friend bool operator>=( const big_integer& a, const big_integer& b )
+  {
+    return compare( a, b ) >= 0;
+  }
+
+  friend std::ostream& operator<<( std::ostream& os, const big_integer& v )
+  {
+    return os << v.to_string();
+  }
+
+private:
+  static constexpr std::size_t inline_limbs = 2;
+
+  const limb* limbs() const
+  {
+    return m_heap ? m_heap.get() : m_inline;
+  }
+
+  limb* limbs()
+  {
+    return m_heap ? m_heap.get() : m_inline;
+  }
+
+  // the value of one of at most one limb
+  __int128 small() const
+  {
+    const __int128 magnitude = m_size != 0 ? __int128( limbs()[0] ) : 0;
+    return m_negative ? -magnitude : magnitude;
+  }
+
+  // either fits the two limbs every big_integer has room for
+  void assign( __int128 value )
+  {
+    assign( value < 0 ? 0 - ( unsigned __int128 )( value ) : ( unsigned __int128 )( value ),
+            value < 0 );
+  }
+
+  void assign( unsigned __int128 magnitude, bool negative )
+  {
+    limb* p    = limbs();
+    p[0]       = limb( magnitude );
+    p[1]       = limb( magnitude >> 64 );
+    m_size     = p[1] != 0 ? 2 : p[0] != 0 ? 1 : 0;
+    m_negative = negative && m_size != 0;
+  }
+
+  // r = a + b, or a - b. r may be a or b.
+  static void sum( const big_integer& a, const big_integer& b, bool subtract, big_integer& r )
+  {
+    if ( a.m_size <= 1 && b.m_size <= 1 )
+    {
+      r.assign( subtract ? a.small() - b.small() : a.small() + b.small() );
+    }
+    else
+    {
+      add( a, b, subtract, r );
+    }
+  }
+
+  // r = a * b. r may be a or b when both have at most one limb.
+  static void product( const big_integer& a, const big_integer& b, big_integer& r )
+  {
+    if ( a.m_size <= 1 && b.m_size <= 1 )
+    {
+      const unsigned __int128 x = a.m_size != 0 ? a.limbs()[0] : 0;
+      const unsigned __int128 y = b.m_size != 0 ? b.limbs()[0] : 0;
+      r.assign( x * y, a.m_negative != b.m_negative );
+    }
+    else
+    {
+      multiply( a, b, r );
+    }
+  }
+
+  // the rest of sum() and product(), out of line. r may not be a or b in multiply.
+  static void add( const big_integer& a, const big_integer& b, bool subtract, big_integer& r );
+  static void multiply( const big_integer& a, const big_integer& b, big_integer& r );
+
+  // room for n limbs, keeping the current ones
+  void reserve( std::size_t n );
+
+  // drops zero limbs from the top, and the sign of 0
+  void trim();
+
+  std::size_t               m_size{0};
+  std::size_t               m_capacity{inline_limbs};
+  bool                      m_negative{false};
+  limb                      m_inline[inline_limbs]{};
+  std::unique_ptr< limb[] > m_heap;
+}; // big_integer
+} // namespace slowmath
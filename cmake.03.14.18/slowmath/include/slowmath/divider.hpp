@@ -0,0 +1,154 @@
+#pragma once
+
+// division by a divisor known only at run time but used many times: the divider
+// works out a multiplier and shift once, then each quotient is a multiply, a
+// shift and two adds instead of an idiv, and a whole array of them vectorizes.
+//
+//   slowmath::divider by7( 7 );
+//   int q = by7.divide( n );             // n / 7
+//   divide( a, by7, out, n );            // out[i] = a[i] / 7, found by ADL
+//
+// quotients are exactly those of /, rounded toward zero. a divider of 0 throws
+// std::domain_error when built. INT_MIN / -1, the one quotient an int cannot
+// hold, wraps to INT_MIN. checked_divide() throws std::overflow_error there
+// instead. building a divider costs a 64 bit division, about what two idivs
+// cost, so it pays once a divisor is used for more than a few divisions.
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "slowmath/batch.hpp"
+
+namespace slowmath
+{
+class divider
+{
+public:
+  explicit divider( int d ) : m_divisor( d )
+  {
+    if ( d == 0 )
+    {
+      throw std::domain_error( "slowmath: division by zero" );
+    }
+    if ( d == 1 || d == -1 )
+    {
+      // n * 0, plus or minus n, exact: nothing to round
+      m_add = d;
+      return;
+    }
+
+    // the multiplier is 2^(32 + shift) / |d| rounded up, with one more bit of
+    // shift when 32 bits of it leave too large an error; that 33rd bit is the
+    // extra n added. as in libdivide, one 64 bit division instead of Hacker's
+    // Delight's loop over bits, so building one stays cheap.
+    const std::uint32_t ad   = d < 0 ? 0u - std::uint32_t( d ) : std::uint32_t( d );
+    const int           log2 = floor_log2( ad );
+    const std::int32_t  sign = d < 0 ? -1 : 1;
+
+    std::uint32_t magic;
+    if ( ( ad & ( ad - 1 ) ) == 0 )
+    {
+      magic   = 0x80000001u;
+      m_shift = log2 - 1;
+      m_add   = sign;
+    }
+    else
+    {
+      const std::uint64_t power = std::uint64_t( 1 ) << ( 31 + log2 );
+      std::uint64_t       q     = power / ad;
+      const std::uint32_t rem   = std::uint32_t( power - q * ad );
+      if ( ad - rem < ( 1u << log2 ) )
+      {
+        m_shift = log2 - 1;
+      }
+      else
+      {
+        q += q + ( std::uint64_t( rem ) * 2 >= ad ? 1 : 0 );
+        m_shift = log2;
+        m_add   = sign;
+      }
+      magic = std::uint32_t( q + 1 );
+    }
+    m_magic = std::int32_t( d < 0 ? 0u - magic : magic );
+    m_round = 1;
+  }
+
+  int divisor() const
+  {
+    return m_divisor;
+  }
+
+  // n / divisor(), INT_MIN / -1 wrapping to INT_MIN
+  int divide( int n ) const
+  {
+    const std::uint32_t high = std::uint32_t( ( std::int64_t( m_magic ) * n ) >> 32 );
+    std::int32_t        q    = std::int32_t( high + std::uint32_t( m_add ) * std::uint32_t( n ) );
+    q >>= m_shift;
+    // the shift rounded negative quotients down, toward zero is one more
+    return int( q + std::int32_t( ( std::uint32_t( q ) >> 31 ) & m_round ) );
+  }
+
+  int operator()( int n ) const
+  {
+    return divide( n );
+  }
+
+private:
+  static int floor_log2( std::uint32_t x )
+  {
+#if defined( __GNUC__ )
+    return 31 - __builtin_clz( x );
+#else
+    int log2 = 0;
+    while ( x >>= 1 )
+    {
+      ++log2;
+    }
+    return log2;
+#endif
+  }
+
+  int           m_divisor;
+  std::int32_t  m_magic{0};
+  std::int32_t  m_add{0};   // 1, 0 or -1: n times this added to the high half
+  int           m_shift{0};
+  std::uint32_t m_round{0}; // 1 but for +-1, whose quotients are exact
+}; // divider
+
+// a / b, throwing std::domain_error for b == 0 and std::overflow_error for
+// INT_MIN / -1 where / is undefined
+inline int checked_divide( int a, int b )
+{
+  if ( b == 0 )
+  {
+    throw std::domain_error( "slowmath: division by zero" );
+  }
+  if ( b == -1 && a == INT_MIN )
+  {
+    throw std::overflow_error( "slowmath: INT_MIN / -1 overflows" );
+  }
+  return a / b;
+}
+
+// a / d.divisor(), throwing std::overflow_error for INT_MIN / -1
+inline int checked_divide( int a, const divider& d )
+{
+  if ( d.divisor() == -1 && a == INT_MIN )
+  {
+    throw std::overflow_error( "slowmath: INT_MIN / -1 overflows" );
+  }
+  return d.divide( a );
+}
+
+// out[i] = a[i] / d, vectorized like the other batch operations. out may be a.
+void divide( const int* a, const divider& d, int* out, std::size_t n );
+
+#if SLOWMATH_HAS_SPAN
+inline void divide( std::span< const int > a, const divider& d, std::span< int > out )
+{
+  divide( a.data(), d, out.data(), batch_size( a.size(), a.size(), out.size() ) );
+}
+#endif
+} // namespace slowmath
@@ -0,0 +1,33 @@
+#pragma once
+
+// the operations as constexpr inline functions, for callers that want them
+// inlined and constant folded without link time optimization:
+//
+//   static_assert( slowmath::add( 1, 2 ) == 3, "" );
+//
+// the out of line add(), subtract(), ... in the library forward to these, so
+// both give the same results. they live in namespace slowmath to stay apart
+// from those, a using namespace slowmath makes unqualified calls ambiguous.
+
+namespace slowmath
+{
+constexpr int add( int a, int b )
+{
+  return a + b;
+}
+
+constexpr int subtract( int a, int b )
+{
+  return a - b;
+}
+
+constexpr int multiply( int a, int b )
+{
+  return a * b;
+}
+
+constexpr int divide( int a, int b )
+{
+  return a / b;
+}
+} // namespace slowmath
@@ -0,0 +1,272 @@
+#pragma once
+
+// what add, subtract and multiply do when the result does not fit, chosen at
+// compile time by a policy, for any signed integer type:
+//
+//   slowmath::add< slowmath::wrapping >( a, b )   // two's complement wrap
+//   slowmath::add< slowmath::checked >( a, b )    // throws std::overflow_error
+//   slowmath::add< slowmath::saturating >( a, b ) // clamps to min / max
+//   slowmath::add< slowmath::widening >( a, b )   // exact, in the next wider type
+//
+//   slowmath::add< slowmath::saturating >( a, b, out, n ) // whole arrays
+//
+// none of them is undefined, unlike plain int arithmetic and add() and co.
+// overflow is found with GCC and clang's __builtin_*_overflow, which read the
+// flag the instruction sets anyway, so checked and saturating scalars cost a
+// branch.
+//
+// the batch forms are inline loops over the scalars, vectorized by the caller's
+// compiler where the policy allows, except saturating ones on int8_t, int16_t,
+// int and int64_t, which the library builds per isa like the other batch
+// operations: padds / psubs for 8 and 16 bit adds and subtracts, compares and
+// blends for the rest but int64_t multiply, which has no vector form and stays
+// one checked multiply per element. out may be a or b.
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace slowmath
+{
+// the signed type twice as wide, which holds any sum, difference or product
+template < class T, std::size_t = sizeof( T ) >
+struct wider;
+
+template < class T >
+struct wider< T, 1 >
+{
+  typedef std::int16_t type;
+};
+
+template < class T >
+struct wider< T, 2 >
+{
+  typedef std::int32_t type;
+};
+
+template < class T >
+struct wider< T, 4 >
+{
+  typedef std::int64_t type;
+};
+
+#if defined( __SIZEOF_INT128__ )
+template < class T >
+struct wider< T, 8 >
+{
+  typedef __int128 type;
+};
+#endif
+
+namespace detail
+{
+template < class T >
+struct signed_integer
+{
+  static_assert( std::is_integral< T >::value && std::is_signed< T >::value,
+                 "slowmath: overflow policies take signed integers" );
+  // what T promotes to, unsigned: wraps where T would overflow
+  typedef typename std::make_unsigned< decltype( T() + T() ) >::type unsigned_type;
+};
+} // namespace detail
+
+struct wrapping
+{
+  template < class T >
+  using result = T;
+
+  template < class T >
+  static T add( T a, T b )
+  {
+    typedef typename detail::signed_integer< T >::unsigned_type U;
+    return T( U( a ) + U( b ) );
+  }
+
+  template < class T >
+  static T subtract( T a, T b )
+  {
+    typedef typename detail::signed_integer< T >::unsigned_type U;
+    return T( U( a ) - U( b ) );
+  }
+
+  template < class T >
+  static T multiply( T a, T b )
+  {
+    typedef typename detail::signed_integer< T >::unsigned_type U;
+    return T( U( a ) * U( b ) );
+  }
+};
+
+struct checked
+{
+  template < class T >
+  using result = T;
+
+  template < class T >
+  static T add( T a, T b )
+  {
+    T r;
+    if ( __builtin_add_overflow( a, b, &r ) )
+    {
+      throw std::overflow_error( "slowmath: add overflows" );
+    }
+    return r;
+  }
+
+  template < class T >
+  static T subtract( T a, T b )
+  {
+    T r;
+    if ( __builtin_sub_overflow( a, b, &r ) )
+    {
+      throw std::overflow_error( "slowmath: subtract overflows" );
+    }
+    return r;
+  }
+
+  template < class T >
+  static T multiply( T a, T b )
+  {
+    T r;
+    if ( __builtin_mul_overflow( a, b, &r ) )
+    {
+      throw std::overflow_error( "slowmath: multiply overflows" );
+    }
+    return r;
+  }
+};
+
+struct saturating
+{
+  template < class T >
+  using result = T;
+
+  template < class T >
+  static T add( T a, T b )
+  {
+    T r;
+    if ( __builtin_add_overflow( a, b, &r ) )
+    {
+      return b < 0 ? std::numeric_limits< T >::min() : std::numeric_limits< T >::max();
+    }
+    return r;
+  }
+
+  template < class T >
+  static T subtract( T a, T b )
+  {
+    T r;
+    if ( __builtin_sub_overflow( a, b, &r ) )
+    {
+      return b < 0 ? std::numeric_limits< T >::max() : std::numeric_limits< T >::min();
+    }
+    return r;
+  }
+
+  template < class T >
+  static T multiply( T a, T b )
+  {
+    T r;
+    if ( __builtin_mul_overflow( a, b, &r ) )
+    {
+      return ( a < 0 ) != ( b < 0 ) ? std::numeric_limits< T >::min()
+                                     : std::numeric_limits< T >::max();
+    }
+    return r;
+  }
+};
+
+struct widening
+{
+  template < class T >
+  using result = typename wider< T >::type;
+
+  template < class T >
+  static result< T > add( T a, T b )
+  {
+    return result< T >( result< T >( a ) + result< T >( b ) );
+  }
+
+  template < class T >
+  static result< T > subtract( T a, T b )
+  {
+    return result< T >( result< T >( a ) - result< T >( b ) );
+  }
+
+  template < class T >
+  static result< T > multiply( T a, T b )
+  {
+    return result< T >( result< T >( a ) * result< T >( b ) );
+  }
+};
+
+template < class Policy, class T >
+typename Policy::template result< T > add( T a, T b )
+{
+  return Policy::add( a, b );
+}
+
+template < class Policy, class T >
+typename Policy::template result< T > subtract( T a, T b )
+{
+  return Policy::subtract( a, b );
+}
+
+template < class Policy, class T >
+typename Policy::template result< T > multiply( T a, T b )
+{
+  return Policy::multiply( a, b );
+}
+
+// out[i] = a[i] op b[i] under Policy
+template < class Policy, class T >
+void add( const T* a, const T* b, typename Policy::template result< T >* out, std::size_t n )
+{
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    out[ix] = Policy::add( a[ix], b[ix] );
+  }
+}
+
+template < class Policy, class T >
+void subtract( const T* a, const T* b, typename Policy::template result< T >* out, std::size_t n )
+{
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    out[ix] = Policy::subtract( a[ix], b[ix] );
+  }
+}
+
+template < class Policy, class T >
+void multiply( const T* a, const T* b, typename Policy::template result< T >* out, std::size_t n )
+{
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    out[ix] = Policy::multiply( a[ix], b[ix] );
+  }
+}
+
+// in the library, vectorized
+#define SLOWMATH_SATURATING_BATCH( op, T )                                                         \
+  template <>                                                                                      \
+  void op< saturating, T >( const T* a, const T* b, T* out, std::size_t n );
+
+SLOWMATH_SATURATING_BATCH( add, std::int8_t )
+SLOWMATH_SATURATING_BATCH( add, std::int16_t )
+SLOWMATH_SATURATING_BATCH( add, std::int32_t )
+SLOWMATH_SATURATING_BATCH( add, std::int64_t )
+
+SLOWMATH_SATURATING_BATCH( subtract, std::int8_t )
+SLOWMATH_SATURATING_BATCH( subtract, std::int16_t )
+SLOWMATH_SATURATING_BATCH( subtract, std::int32_t )
+SLOWMATH_SATURATING_BATCH( subtract, std::int64_t )
+
+SLOWMATH_SATURATING_BATCH( multiply, std::int8_t )
+SLOWMATH_SATURATING_BATCH( multiply, std::int16_t )
+SLOWMATH_SATURATING_BATCH( multiply, std::int32_t )
+SLOWMATH_SATURATING_BATCH( multiply, std::int64_t )
+
+#undef SLOWMATH_SATURATING_BATCH
+} // namespace slowmath
@@ -1,5 +1,14 @@
 #pragma once
 
+// the out of line operations, kept for code linking against the library.
+// slowmath::add() and co in inline.hpp are the same, but inlinable.
+
+#include "slowmath/batch.hpp"
+#include "slowmath/big_integer.hpp"
+#include "slowmath/divider.hpp"
+#include "slowmath/inline.hpp"
+#include "slowmath/overflow.hpp"
+
 int add( int a, int b );
 
 int subtract( int a, int b );
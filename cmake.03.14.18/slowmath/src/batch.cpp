@@ -0,0 +1,166 @@
+#include "slowmath/batch.hpp"
+#include "slowmath/divider.hpp"
+
+#include "clones.hpp"
+
+#include <type_traits>
+
+namespace
+{
+// integers are computed in their unsigned type, which wraps instead of overflowing
+template < class T, bool = std::is_integral< T >::value >
+struct arithmetic
+{
+  typedef typename std::make_unsigned< T >::type type;
+};
+
+template < class T >
+struct arithmetic< T, false >
+{
+  typedef T type;
+};
+
+struct plus
+{
+  template < class T >
+  T operator()( T x, T y ) const
+  {
+    typedef typename arithmetic< T >::type U;
+    return T( U( x ) + U( y ) );
+  }
+};
+
+struct minus
+{
+  template < class T >
+  T operator()( T x, T y ) const
+  {
+    typedef typename arithmetic< T >::type U;
+    return T( U( x ) - U( y ) );
+  }
+};
+
+struct times
+{
+  template < class T >
+  T operator()( T x, T y ) const
+  {
+    typedef typename arithmetic< T >::type U;
+    return T( U( x ) * U( y ) );
+  }
+};
+
+struct over
+{
+  template < class T >
+  T operator()( T x, T y ) const
+  {
+    return x / y;
+  }
+};
+
+// inlined into each build of its callers, and vectorized for that build's isa
+template < class T, class Op >
+inline void apply( const T* a, const T* b, T* out, std::size_t n, Op op )
+{
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    out[ix] = op( a[ix], b[ix] );
+  }
+}
+} // namespace
+
+SLOWMATH_CLONES void add( const int* a, const int* b, int* out, std::size_t n )
+{
+  apply( a, b, out, n, plus() );
+}
+
+SLOWMATH_CLONES void add( const std::int64_t* a, const std::int64_t* b, std::int64_t* out,
+                          std::size_t n )
+{
+  apply( a, b, out, n, plus() );
+}
+
+SLOWMATH_CLONES void add( const float* a, const float* b, float* out, std::size_t n )
+{
+  apply( a, b, out, n, plus() );
+}
+
+SLOWMATH_CLONES void add( const double* a, const double* b, double* out, std::size_t n )
+{
+  apply( a, b, out, n, plus() );
+}
+
+SLOWMATH_CLONES void subtract( const int* a, const int* b, int* out, std::size_t n )
+{
+  apply( a, b, out, n, minus() );
+}
+
+SLOWMATH_CLONES void subtract( const std::int64_t* a, const std::int64_t* b, std::int64_t* out,
+                               std::size_t n )
+{
+  apply( a, b, out, n, minus() );
+}
+
+SLOWMATH_CLONES void subtract( const float* a, const float* b, float* out, std::size_t n )
+{
+  apply( a, b, out, n, minus() );
+}
+
+SLOWMATH_CLONES void subtract( const double* a, const double* b, double* out, std::size_t n )
+{
+  apply( a, b, out, n, minus() );
+}
+
+SLOWMATH_CLONES void multiply( const int* a, const int* b, int* out, std::size_t n )
+{
+  apply( a, b, out, n, times() );
+}
+
+SLOWMATH_CLONES_NO_AVX512 void multiply( const std::int64_t* a, const std::int64_t* b,
+                                         std::int64_t* out, std::size_t n )
+{
+  apply( a, b, out, n, times() );
+}
+
+SLOWMATH_CLONES void multiply( const float* a, const float* b, float* out, std::size_t n )
+{
+  apply( a, b, out, n, times() );
+}
+
+SLOWMATH_CLONES void multiply( const double* a, const double* b, double* out, std::size_t n )
+{
+  apply( a, b, out, n, times() );
+}
+
+// no vector instruction divides integers, these stay one idiv per element
+void divide( const int* a, const int* b, int* out, std::size_t n )
+{
+  apply( a, b, out, n, over() );
+}
+
+void divide( const std::int64_t* a, const std::int64_t* b, std::int64_t* out, std::size_t n )
+{
+  apply( a, b, out, n, over() );
+}
+
+// but a multiply and shift by one divisor does, 8 or 16 lanes of vpmuldq
+SLOWMATH_CLONES void slowmath::divide( const int* a, const divider& d, int* out, std::size_t n )
+{
+  // a copy, which stores to out cannot change, so its fields stay in registers
+  const divider by = d;
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    out[ix] = by.divide( a[ix] );
+  }
+}
+
+SLOWMATH_CLONES void divide( const float* a, const float* b, float* out, std::size_t n )
+{
+  apply( a, b, out, n, over() );
+}
+
+SLOWMATH_CLONES void divide( const double* a, const double* b, double* out, std::size_t n )
+{
+  apply( a, b, out, n, over() );
+}
@@ -0,0 +1,462 @@
+#include "slowmath/big_integer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using slowmath::big_integer;
+
+namespace
+{
+typedef big_integer::limb limb;
+typedef unsigned __int128 wide;
+
+// below this many limbs a side, the schoolbook product's n^2 multiplies cost
+// less than Karatsuba's additions, subtractions and scratch space
+constexpr std::size_t karatsuba_threshold = 32;
+
+// the largest power of 10 in a limb, and its digits
+constexpr limb        decimal_base   = 10000000000000000000ull;
+constexpr std::size_t decimal_digits = 19;
+
+// r[0, n) = a[0, n) + b[0, n) + carry, returning the carry out. r may be a or b.
+limb add_n( limb* r, const limb* a, const limb* b, std::size_t n, limb carry = 0 )
+{
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    const wide s = wide( a[ix] ) + b[ix] + carry;
+    r[ix]        = limb( s );
+    carry        = limb( s >> 64 );
+  }
+  return carry;
+}
+
+// r[0, n) = a[0, n) + carry, carry 0 or 1. in place, stops where the carry does.
+limb add_1( limb* r, const limb* a, std::size_t n, limb carry )
+{
+  std::size_t ix = 0;
+  for ( ; ix < n && carry != 0; ++ix )
+  {
+    r[ix] = a[ix] + 1;
+    carry = r[ix] == 0 ? 1 : 0;
+  }
+  if ( r != a )
+  {
+    std::copy( a + ix, a + n, r + ix );
+  }
+  return carry;
+}
+
+// r[0, n) = a[0, n) - b[0, n) - borrow, returning the borrow out. r may be a or b.
+limb sub_n( limb* r, const limb* a, const limb* b, std::size_t n, limb borrow = 0 )
+{
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    const wide d = wide( a[ix] ) - b[ix] - borrow;
+    r[ix]        = limb( d );
+    borrow       = limb( d >> 64 ) & 1;
+  }
+  return borrow;
+}
+
+// r[0, n) = a[0, n) - borrow, borrow 0 or 1. in place, stops where the borrow does.
+limb sub_1( limb* r, const limb* a, std::size_t n, limb borrow )
+{
+  std::size_t ix = 0;
+  for ( ; ix < n && borrow != 0; ++ix )
+  {
+    borrow = a[ix] == 0 ? 1 : 0;
+    r[ix]  = a[ix] - 1;
+  }
+  if ( r != a )
+  {
+    std::copy( a + ix, a + n, r + ix );
+  }
+  return borrow;
+}
+
+int compare_n( const limb* a, std::size_t na, const limb* b, std::size_t nb )
+{
+  if ( na != nb )
+  {
+    return na < nb ? -1 : 1;
+  }
+  for ( std::size_t ix = na; ix-- > 0; )
+  {
+    if ( a[ix] != b[ix] )
+    {
+      return a[ix] < b[ix] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// r[0, na + nb) = a[0, na) * b[0, nb). r overlaps neither.
+void schoolbook( limb* r, const limb* a, std::size_t na, const limb* b, std::size_t nb )
+{
+  std::fill( r, r + na + nb, limb( 0 ) );
+  for ( std::size_t ix = 0; ix < na; ++ix )
+  {
+    limb carry = 0;
+    for ( std::size_t jx = 0; jx < nb; ++jx )
+    {
+      const wide p = wide( a[ix] ) * b[jx] + r[ix + jx] + carry;
+      r[ix + jx]   = limb( p );
+      carry        = limb( p >> 64 );
+    }
+    r[ix + nb] = carry;
+  }
+}
+
+// limbs of scratch karatsuba() needs for n limb operands
+std::size_t karatsuba_scratch( std::size_t n )
+{
+  if ( n < karatsuba_threshold )
+  {
+    return 0;
+  }
+  const std::size_t high = n - n / 2;
+  return 4 * ( high + 1 ) + karatsuba_scratch( high + 1 );
+}
+
+// r[0, 2n) = a[0, n) * b[0, n), with a = a1 B + a0, b = b1 B + b0 and
+//   a b = a1 b1 B^2 + ( ( a0 + a1 )( b0 + b1 ) - a0 b0 - a1 b1 ) B + a0 b0
+void karatsuba( limb* r, const limb* a, const limb* b, std::size_t n, limb* scratch )
+{
+  if ( n < karatsuba_threshold )
+  {
+    schoolbook( r, a, n, b, n );
+    return;
+  }
+
+  const std::size_t low = n / 2, high = n - low; // high >= low
+
+  // a0 b0 and a1 b1 straight into their places in r
+  karatsuba( r, a, b, low, scratch );
+  karatsuba( r + 2 * low, a + low, b + low, high, scratch );
+
+  limb* sa   = scratch;
+  limb* sb   = sa + high + 1;
+  limb* mid  = sb + high + 1;
+  limb* next = mid + 2 * ( high + 1 );
+
+  sa[high] = add_1( sa + low, a + 2 * low, high - low, add_n( sa, a + low, a, low ) );
+  sb[high] = add_1( sb + low, b + 2 * low, high - low, add_n( sb, b + low, b, low ) );
+  karatsuba( mid, sa, sb, high + 1, next );
+
+  const std::size_t mid_size = 2 * ( high + 1 );
+  sub_1( mid + 2 * low, mid + 2 * low, mid_size - 2 * low, sub_n( mid, mid, r, 2 * low ) );
+  sub_1( mid + 2 * high, mid + 2 * high, mid_size - 2 * high,
+         sub_n( mid, mid, r + 2 * low, 2 * high ) );
+
+  // the middle term is less than B^( n + high ), its top limbs zero
+  add_1( r + low + mid_size, r + low + mid_size, n + high - mid_size,
+         add_n( r + low, r + low, mid, mid_size ) );
+}
+
+// r[0, na + nb) = a[0, na) * b[0, nb), na >= nb. r overlaps neither.
+void multiply_n( limb* r, const limb* a, std::size_t na, const limb* b, std::size_t nb )
+{
+  if ( nb < karatsuba_threshold )
+  {
+    schoolbook( r, a, na, b, nb );
+    return;
+  }
+
+  std::vector< limb > scratch( karatsuba_scratch( nb ) + 2 * nb );
+  if ( na == nb )
+  {
+    karatsuba( r, a, b, nb, scratch.data() );
+    return;
+  }
+
+  // a in pieces of nb limbs, a balanced product each, added in at their offsets
+  limb* piece = scratch.data() + karatsuba_scratch( nb );
+  std::fill( r, r + na + nb, limb( 0 ) );
+  std::size_t offset = 0;
+  for ( ; offset + nb <= na; offset += nb )
+  {
+    karatsuba( piece, a + offset, b, nb, scratch.data() );
+    limb* at = r + offset;
+    add_1( at + 2 * nb, at + 2 * nb, na - offset - nb, add_n( at, at, piece, 2 * nb ) );
+  }
+  if ( offset < na )
+  {
+    const std::size_t rest = na - offset;
+    multiply_n( piece, b, nb, a + offset, rest );
+    add_n( r + offset, r + offset, piece, nb + rest );
+  }
+}
+
+// a[0, n) = a[0, n) * m + add, returning the limb carried out
+limb multiply_add_1( limb* a, std::size_t n, limb m, limb add )
+{
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    const wide p = wide( a[ix] ) * m + add;
+    a[ix]        = limb( p );
+    add          = limb( p >> 64 );
+  }
+  return add;
+}
+
+// a[0, n) = a[0, n) / d, returning the remainder
+limb divide_1( limb* a, std::size_t n, limb d )
+{
+  limb remainder = 0;
+  for ( std::size_t ix = n; ix-- > 0; )
+  {
+    const wide x = ( wide( remainder ) << 64 ) | a[ix];
+    a[ix]        = limb( x / d );
+    remainder    = limb( x % d );
+  }
+  return remainder;
+}
+} // namespace
+
+big_integer::big_integer( const std::string& decimal )
+{
+  std::size_t first = 0;
+  if ( !decimal.empty() && ( decimal[0] == '-' || decimal[0] == '+' ) )
+  {
+    first = 1;
+  }
+  if ( first == decimal.size() ||
+       decimal.find_first_not_of( "0123456789", first ) != std::string::npos )
+  {
+    throw std::invalid_argument( "slowmath: not a decimal integer: \"" + decimal + "\"" );
+  }
+
+  // 19 digits at a time, the first piece taking what is left over
+  const std::size_t digits = decimal.size() - first;
+  reserve( digits / decimal_digits + 1 );
+  limb*       p     = limbs();
+  std::size_t piece = digits % decimal_digits == 0 ? decimal_digits : digits % decimal_digits;
+  for ( std::size_t at = first; at < decimal.size(); at += piece, piece = decimal_digits )
+  {
+    limb value = 0;
+    limb scale = 1;
+    for ( std::size_t ix = at; ix < at + piece; ++ix )
+    {
+      value = value * 10 + limb( decimal[ix] - '0' );
+      scale *= 10;
+    }
+    const limb carry = multiply_add_1( p, m_size, scale, value );
+    if ( carry != 0 )
+    {
+      p[m_size++] = carry;
+    }
+  }
+  m_negative = decimal[0] == '-';
+  trim();
+}
+
+big_integer::big_integer( const big_integer& other )
+    : m_size( other.m_size ), m_negative( other.m_negative )
+{
+  if ( m_size > inline_limbs )
+  {
+    m_heap.reset( new limb[m_size] );
+    m_capacity = m_size;
+  }
+  std::copy( other.limbs(), other.limbs() + m_size, limbs() );
+}
+
+big_integer::big_integer( big_integer&& other ) noexcept
+    : m_size( other.m_size ),
+      m_capacity( other.m_capacity ),
+      m_negative( other.m_negative ),
+      m_heap( std::move( other.m_heap ) )
+{
+  std::copy( other.m_inline, other.m_inline + inline_limbs, m_inline );
+  other.m_size     = 0;
+  other.m_capacity = inline_limbs;
+  other.m_negative = false;
+}
+
+big_integer& big_integer::operator=( const big_integer& other )
+{
+  if ( this != &other )
+  {
+    m_size = 0;
+    reserve( other.m_size );
+    std::copy( other.limbs(), other.limbs() + other.m_size, limbs() );
+    m_size     = other.m_size;
+    m_negative = other.m_negative;
+  }
+  return *this;
+}
+
+big_integer& big_integer::operator=( big_integer&& other ) noexcept
+{
+  if ( this != &other )
+  {
+    std::copy( other.m_inline, other.m_inline + inline_limbs, m_inline );
+    m_heap           = std::move( other.m_heap );
+    m_size           = other.m_size;
+    m_capacity       = other.m_capacity;
+    m_negative       = other.m_negative;
+    other.m_size     = 0;
+    other.m_capacity = inline_limbs;
+    other.m_negative = false;
+  }
+  return *this;
+}
+
+void big_integer::add( const big_integer& a, const big_integer& b, bool subtract,
+                       big_integer& r )
+{
+  // before r, which may be either, changes
+  const bool a_negative = a.m_negative;
+  const bool b_negative = b.m_negative != subtract;
+
+  if ( a_negative == b_negative )
+  {
+    const big_integer& longer  = a.m_size >= b.m_size ? a : b;
+    const big_integer& shorter = a.m_size >= b.m_size ? b : a;
+    const std::size_t  n = longer.m_size, m = shorter.m_size;
+
+    // room for the carry too when r has to allocate anyway; otherwise only on a
+    // carry, so sums that stay within the inline limbs never allocate
+    r.reserve( n <= r.m_capacity ? n : n + 1 );
+    limb*      pr    = r.limbs();
+    const limb carry = add_1( pr + m, longer.limbs() + m, n - m,
+                              add_n( pr, longer.limbs(), shorter.limbs(), m ) );
+    r.m_size         = n;
+    r.m_negative     = a_negative;
+    if ( carry != 0 )
+    {
+      r.reserve( n + 1 );
+      r.limbs()[n] = carry;
+      r.m_size     = n + 1;
+    }
+    return;
+  }
+
+  const int order = compare_n( a.limbs(), a.m_size, b.limbs(), b.m_size );
+  if ( order == 0 )
+  {
+    r.m_size     = 0;
+    r.m_negative = false;
+    return;
+  }
+
+  const big_integer& larger  = order > 0 ? a : b;
+  const big_integer& smaller = order > 0 ? b : a;
+  const std::size_t  n = larger.m_size, m = smaller.m_size;
+
+  r.reserve( n );
+  limb* pr = r.limbs();
+  sub_1( pr + m, larger.limbs() + m, n - m, sub_n( pr, larger.limbs(), smaller.limbs(), m ) );
+  r.m_size     = n;
+  r.m_negative = order > 0 ? a_negative : b_negative;
+  r.trim();
+}
+
+void big_integer::multiply( const big_integer& a, const big_integer& b, big_integer& r )
+{
+  if ( a.m_size == 0 || b.m_size == 0 )
+  {
+    r.m_size     = 0;
+    r.m_negative = false;
+    return;
+  }
+
+  const big_integer& longer  = a.m_size >= b.m_size ? a : b;
+  const big_integer& shorter = a.m_size >= b.m_size ? b : a;
+
+  r.m_size = 0;
+  r.reserve( a.m_size + b.m_size );
+  multiply_n( r.limbs(), longer.limbs(), longer.m_size, shorter.limbs(), shorter.m_size );
+  r.m_size     = a.m_size + b.m_size;
+  r.m_negative = a.m_negative != b.m_negative;
+  r.trim();
+}
+
+void big_integer::reserve( std::size_t n )
+{
+  if ( n <= m_capacity )
+  {
+    return;
+  }
+  // half again, so a total grown a limb at a time is copied O(log n) times
+  const std::size_t         capacity = std::max( n, m_capacity + m_capacity / 2 );
+  std::unique_ptr< limb[] > heap( new limb[capacity] );
+  std::copy( limbs(), limbs() + m_size, heap.get() );
+  m_heap     = std::move( heap );
+  m_capacity = capacity;
+}
+
+void big_integer::trim()
+{
+  const limb* p = limbs();
+  while ( m_size > 0 && p[m_size - 1] == 0 )
+  {
+    --m_size;
+  }
+  m_negative = m_negative && m_size != 0;
+}
+
+std::size_t big_integer::bits() const
+{
+  if ( m_size == 0 )
+  {
+    return 0;
+  }
+  return 64 * m_size - std::size_t( __builtin_clzll( limbs()[m_size - 1] ) );
+}
+
+std::int64_t big_integer::to_int64() const
+{
+  const limb magnitude = m_size != 0 ? limbs()[0] : 0;
+  const limb limit     = limb( INT64_MAX ) + ( m_negative ? 1 : 0 );
+  if ( m_size > 1 || magnitude > limit )
+  {
+    throw std::overflow_error( "slowmath: big_integer does not fit int64_t" );
+  }
+  return m_negative ? std::int64_t( 0 - magnitude ) : std::int64_t( magnitude );
+}
+
+std::string big_integer::to_string() const
+{
+  if ( m_size == 0 )
+  {
+    return "0";
+  }
+
+  // 19 digits at a time off the bottom
+  std::vector< limb > magnitude( limbs(), limbs() + m_size );
+  std::vector< limb > pieces;
+  std::size_t         n = m_size;
+  while ( n > 0 )
+  {
+    pieces.push_back( divide_1( magnitude.data(), n, decimal_base ) );
+    while ( n > 0 && magnitude[n - 1] == 0 )
+    {
+      --n;
+    }
+  }
+
+  std::string decimal = m_negative ? "-" : "";
+  decimal += std::to_string( pieces.back() );
+  for ( std::size_t ix = pieces.size() - 1; ix-- > 0; )
+  {
+    const std::string piece = std::to_string( pieces[ix] );
+    decimal.append( decimal_digits - piece.size(), '0' );
+    decimal += piece;
+  }
+  return decimal;
+}
+
+namespace slowmath
+{
+int compare( const big_integer& a, const big_integer& b )
+{
+  if ( a.sign() != b.sign() )
+  {
+    return a.sign() < b.sign() ? -1 : 1;
+  }
+  const int order = compare_n( a.limbs(), a.m_size, b.limbs(), b.m_size );
+  return a.m_negative ? -order : order;
+}
+} // namespace slowmath
@@ -0,0 +1,19 @@
+#pragma once
+
+// every vectorizable loop is compiled three times, for x86-64-v4 (AVX-512), for
+// AVX2 and for the baseline. the dynamic loader binds each function to the best
+// build the cpu runs, once, so calls pay no dispatch of their own.
+//
+// loops the vectorizer cannot write are written per isa by hand instead, as
+// versions of one function with target( "default" ), target( "avx2" ) and so on,
+// which the loader picks between the same way.
+#if defined( __x86_64__ ) && defined( __GNUC__ ) && !defined( __clang__ )
+#define SLOWMATH_MULTIVERSION 1
+#define SLOWMATH_CLONES __attribute__( ( target_clones( "arch=x86-64-v4", "avx2", "default" ) ) )
+// AVX-512's 64 bit multiply, vpmullq, runs at half the speed of AVX2's three
+// 32 bit multiplies on current cores
+#define SLOWMATH_CLONES_NO_AVX512 __attribute__( ( target_clones( "avx2", "default" ) ) )
+#else
+#define SLOWMATH_CLONES
+#define SLOWMATH_CLONES_NO_AVX512
+#endif
@@ -1,21 +1,23 @@
 #include "operations.hpp"
 
+#include "slowmath/inline.hpp"
+
 int add( int a, int b )
 {
-  return a + b;
+  return slowmath::add( a, b );
 }
 
 int subtract( int a, int b )
 {
-  return a - b;
+  return slowmath::subtract( a, b );
 }
 
 int multiply( int a, int b )
 {
-  return a * b;
+  return slowmath::multiply( a, b );
 }
 
 int divide( int a, int b )
 {
-  return a / b;
+  return slowmath::divide( a, b );
 }
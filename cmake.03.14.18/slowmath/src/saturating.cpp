@@ -0,0 +1,369 @@
+#include "slowmath/overflow.hpp"
+
+#include "clones.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#if SLOWMATH_MULTIVERSION
+#include <immintrin.h>
+#endif
+
+using slowmath::saturating;
+
+namespace
+{
+template < class T, class W >
+inline T clamp( W r )
+{
+  return T( std::min< W >( std::max< W >( r, std::numeric_limits< T >::min() ),
+                           std::numeric_limits< T >::max() ) );
+}
+
+// the vectorizer turns neither __builtin_*_overflow nor its results into
+// vector code. these are the same results in forms it does turn into vectors:
+// narrow types computed in a wider one and clamped, the others wrapped and the
+// overflowed lanes blended with the bound on a's side.
+template < class T >
+inline T sign_bound( T a )
+{
+  return T( ( a >> ( std::numeric_limits< T >::digits ) ) ^ std::numeric_limits< T >::max() );
+}
+
+struct adds
+{
+  template < class T >
+  T operator()( T a, T b ) const
+  {
+    typedef typename std::make_unsigned< T >::type U;
+    const U r = U( U( a ) + U( b ) );
+    // operands of one sign and a result of the other
+    return T( ( U( a ) ^ r ) & ( U( b ) ^ r ) ) < 0 ? sign_bound( a ) : T( r );
+  }
+};
+
+struct subs
+{
+  template < class T >
+  T operator()( T a, T b ) const
+  {
+    typedef typename std::make_unsigned< T >::type U;
+    const U r = U( U( a ) - U( b ) );
+    // operands of different signs and a result of b's
+    return T( ( U( a ) ^ U( b ) ) & ( U( a ) ^ r ) ) < 0 ? sign_bound( a ) : T( r );
+  }
+};
+
+struct muls
+{
+  template < class T >
+  T operator()( T a, T b ) const
+  {
+    typedef typename slowmath::wider< T >::type W;
+    return clamp< T >( W( a ) * W( b ) );
+  }
+
+  // no vector instruction gives a 128 bit product
+  std::int64_t operator()( std::int64_t a, std::int64_t b ) const
+  {
+    return saturating::multiply( a, b );
+  }
+};
+
+template < class T, class Op >
+inline void apply( const T* a, const T* b, T* out, std::size_t n, Op op )
+{
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    out[ix] = op( a[ix], b[ix] );
+  }
+}
+
+SLOWMATH_CLONES void add_words( const std::int32_t* a, const std::int32_t* b, std::int32_t* out,
+                                std::size_t n )
+{
+  apply( a, b, out, n, adds() );
+}
+
+SLOWMATH_CLONES void add_words( const std::int64_t* a, const std::int64_t* b, std::int64_t* out,
+                                std::size_t n )
+{
+  apply( a, b, out, n, adds() );
+}
+
+SLOWMATH_CLONES void subtract_words( const std::int32_t* a, const std::int32_t* b,
+                                     std::int32_t* out, std::size_t n )
+{
+  apply( a, b, out, n, subs() );
+}
+
+SLOWMATH_CLONES void subtract_words( const std::int64_t* a, const std::int64_t* b,
+                                     std::int64_t* out, std::size_t n )
+{
+  apply( a, b, out, n, subs() );
+}
+
+SLOWMATH_CLONES void multiply_lanes( const std::int8_t* a, const std::int8_t* b, std::int8_t* out,
+                                     std::size_t n )
+{
+  apply( a, b, out, n, muls() );
+}
+
+SLOWMATH_CLONES void multiply_lanes( const std::int16_t* a, const std::int16_t* b,
+                                     std::int16_t* out, std::size_t n )
+{
+  apply( a, b, out, n, muls() );
+}
+
+SLOWMATH_CLONES void multiply_lanes( const std::int32_t* a, const std::int32_t* b,
+                                     std::int32_t* out, std::size_t n )
+{
+  apply( a, b, out, n, muls() );
+}
+
+void multiply_lanes( const std::int64_t* a, const std::int64_t* b, std::int64_t* out,
+                     std::size_t n )
+{
+  apply( a, b, out, n, muls() );
+}
+
+#if SLOWMATH_MULTIVERSION
+// 8 and 16 bit lanes have saturating add and subtract instructions, padds and
+// psubs, one instruction where the forms above take five or six. GCC does not
+// generate them from any scalar code, so these loops are written per isa.
+#define SLOWMATH_AVX2 __attribute__( ( target( "avx2" ) ) )
+#define SLOWMATH_AVX512 __attribute__( ( target( "avx512bw" ) ) )
+
+// the elements after the last whole vector
+template < class T >
+inline void tail( const T* a, const T* b, T* out, std::size_t ix, std::size_t n, bool subtract )
+{
+  for ( ; ix < n; ++ix )
+  {
+    out[ix] = subtract ? subs()( a[ix], b[ix] ) : adds()( a[ix], b[ix] );
+  }
+}
+
+struct sse2
+{
+  static __m128i adds( __m128i x, __m128i y, std::int8_t )
+  {
+    return _mm_adds_epi8( x, y );
+  }
+  static __m128i adds( __m128i x, __m128i y, std::int16_t )
+  {
+    return _mm_adds_epi16( x, y );
+  }
+  static __m128i subs( __m128i x, __m128i y, std::int8_t )
+  {
+    return _mm_subs_epi8( x, y );
+  }
+  static __m128i subs( __m128i x, __m128i y, std::int16_t )
+  {
+    return _mm_subs_epi16( x, y );
+  }
+
+  template < class T >
+  static void lanes( const T* a, const T* b, T* out, std::size_t n, bool subtract )
+  {
+    std::size_t ix = 0;
+    for ( ; ix + 16 / sizeof( T ) <= n; ix += 16 / sizeof( T ) )
+    {
+      const __m128i x = _mm_loadu_si128( reinterpret_cast< const __m128i* >( a + ix ) );
+      const __m128i y = _mm_loadu_si128( reinterpret_cast< const __m128i* >( b + ix ) );
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( out + ix ),
+                        subtract ? subs( x, y, T() ) : adds( x, y, T() ) );
+    }
+    tail( a, b, out, ix, n, subtract );
+  }
+};
+
+struct avx2
+{
+  SLOWMATH_AVX2 static __m256i adds( __m256i x, __m256i y, std::int8_t )
+  {
+    return _mm256_adds_epi8( x, y );
+  }
+  SLOWMATH_AVX2 static __m256i adds( __m256i x, __m256i y, std::int16_t )
+  {
+    return _mm256_adds_epi16( x, y );
+  }
+  SLOWMATH_AVX2 static __m256i subs( __m256i x, __m256i y, std::int8_t )
+  {
+    return _mm256_subs_epi8( x, y );
+  }
+  SLOWMATH_AVX2 static __m256i subs( __m256i x, __m256i y, std::int16_t )
+  {
+    return _mm256_subs_epi16( x, y );
+  }
+
+  template < class T >
+  SLOWMATH_AVX2 static void lanes( const T* a, const T* b, T* out, std::size_t n, bool subtract )
+  {
+    std::size_t ix = 0;
+    for ( ; ix + 32 / sizeof( T ) <= n; ix += 32 / sizeof( T ) )
+    {
+      const __m256i x = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( a + ix ) );
+      const __m256i y = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( b + ix ) );
+      _mm256_storeu_si256( reinterpret_cast< __m256i* >( out + ix ),
+                           subtract ? subs( x, y, T() ) : adds( x, y, T() ) );
+    }
+    tail( a, b, out, ix, n, subtract );
+  }
+};
+
+struct avx512
+{
+  SLOWMATH_AVX512 static __m512i adds( __m512i x, __m512i y, std::int8_t )
+  {
+    return _mm512_adds_epi8( x, y );
+  }
+  SLOWMATH_AVX512 static __m512i adds( __m512i x, __m512i y, std::int16_t )
+  {
+    return _mm512_adds_epi16( x, y );
+  }
+  SLOWMATH_AVX512 static __m512i subs( __m512i x, __m512i y, std::int8_t )
+  {
+    return _mm512_subs_epi8( x, y );
+  }
+  SLOWMATH_AVX512 static __m512i subs( __m512i x, __m512i y, std::int16_t )
+  {
+    return _mm512_subs_epi16( x, y );
+  }
+
+  template < class T >
+  SLOWMATH_AVX512 static void lanes( const T* a, const T* b, T* out, std::size_t n, bool subtract )
+  {
+    std::size_t ix = 0;
+    for ( ; ix + 64 / sizeof( T ) <= n; ix += 64 / sizeof( T ) )
+    {
+      const __m512i x = _mm512_loadu_si512( a + ix );
+      const __m512i y = _mm512_loadu_si512( b + ix );
+      _mm512_storeu_si512( out + ix, subtract ? subs( x, y, T() ) : adds( x, y, T() ) );
+    }
+    tail( a, b, out, ix, n, subtract );
+  }
+};
+
+#define SLOWMATH_LANES( T )                                                                        \
+  __attribute__( ( target( "default" ) ) ) void add_lanes( const T* a, const T* b, T* out,         \
+                                                           std::size_t n, bool subtract )          \
+  {                                                                                                \
+    sse2::lanes( a, b, out, n, subtract );                                                         \
+  }                                                                                                \
+  SLOWMATH_AVX2 void add_lanes( const T* a, const T* b, T* out, std::size_t n, bool subtract )     \
+  {                                                                                                \
+    avx2::lanes( a, b, out, n, subtract );                                                         \
+  }                                                                                                \
+  __attribute__( ( target( "arch=x86-64-v4" ) ) ) void add_lanes( const T* a, const T* b, T* out,  \
+                                                                   std::size_t n, bool subtract )  \
+  {                                                                                                \
+    avx512::lanes( a, b, out, n, subtract );                                                       \
+  }
+
+SLOWMATH_LANES( std::int8_t )
+SLOWMATH_LANES( std::int16_t )
+
+#undef SLOWMATH_LANES
+#else
+template < class T >
+void add_lanes( const T* a, const T* b, T* out, std::size_t n, bool subtract )
+{
+  if ( subtract )
+  {
+    apply( a, b, out, n, subs() );
+  }
+  else
+  {
+    apply( a, b, out, n, adds() );
+  }
+}
+#endif
+} // namespace
+
+namespace slowmath
+{
+template <>
+void add< saturating, std::int8_t >( const std::int8_t* a, const std::int8_t* b, std::int8_t* out,
+                                     std::size_t n )
+{
+  add_lanes( a, b, out, n, false );
+}
+
+template <>
+void add< saturating, std::int16_t >( const std::int16_t* a, const std::int16_t* b,
+                                      std::int16_t* out, std::size_t n )
+{
+  add_lanes( a, b, out, n, false );
+}
+
+template <>
+void add< saturating, std::int32_t >( const std::int32_t* a, const std::int32_t* b,
+                                      std::int32_t* out, std::size_t n )
+{
+  add_words( a, b, out, n );
+}
+
+template <>
+void add< saturating, std::int64_t >( const std::int64_t* a, const std::int64_t* b,
+                                      std::int64_t* out, std::size_t n )
+{
+  add_words( a, b, out, n );
+}
+
+template <>
+void subtract< saturating, std::int8_t >( const std::int8_t* a, const std::int8_t* b,
+                                          std::int8_t* out, std::size_t n )
+{
+  add_lanes( a, b, out, n, true );
+}
+
+template <>
+void subtract< saturating, std::int16_t >( const std::int16_t* a, const std::int16_t* b,
+                                           std::int16_t* out, std::size_t n )
+{
+  add_lanes( a, b, out, n, true );
+}
+
+template <>
+void subtract< saturating, std::int32_t >( const std::int32_t* a, const std::int32_t* b,
+                                           std::int32_t* out, std::size_t n )
+{
+  subtract_words( a, b, out, n );
+}
+
+template <>
+void subtract< saturating, std::int64_t >( const std::int64_t* a, const std::int64_t* b,
+                                           std::int64_t* out, std::size_t n )
+{
+  subtract_words( a, b, out, n );
+}
+
+template <>
+void multiply< saturating, std::int8_t >( const std::int8_t* a, const std::int8_t* b,
+                                          std::int8_t* out, std::size_t n )
+{
+  multiply_lanes( a, b, out, n );
+}
+
+template <>
+void multiply< saturating, std::int16_t >( const std::int16_t* a, const std::int16_t* b,
+                                           std::int16_t* out, std::size_t n )
+{
+  multiply_lanes( a, b, out, n );
+}
+
+template <>
+void multiply< saturating, std::int32_t >( const std::int32_t* a, const std::int32_t* b,
+                                           std::int32_t* out, std::size_t n )
+{
+  multiply_lanes( a, b, out, n );
+}
+
+template <>
+void multiply< saturating, std::int64_t >( const std::int64_t* a, const std::int64_t* b,
+                                           std::int64_t* out, std::size_t n )
+{
+  multiply_lanes( a, b, out, n );
+}
+} // namespace slowmath
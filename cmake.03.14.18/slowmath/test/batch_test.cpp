@@ -0,0 +1,144 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "slowmath/slowmath.hpp"
+// clang-format on
+
+namespace
+{
+template < class T >
+std::vector< T > random_values( std::size_t n, T lo, T hi, unsigned seed )
+{
+  std::mt19937     gen( seed );
+  std::vector< T > values( n );
+  for ( auto& v : values )
+  {
+    if constexpr ( std::is_integral< T >::value )
+    {
+      v = std::uniform_int_distribution< T >( lo, hi )( gen );
+    }
+    else
+    {
+      v = std::uniform_real_distribution< T >( lo, hi )( gen );
+    }
+  }
+  return values;
+}
+} // namespace
+
+// every length up to a few vectors, so every tail path runs
+TEST( SlowMathBatch, MatchesTheScalarOperations )
+{
+  for ( std::size_t n = 0; n < 70; ++n )
+  {
+    const auto a = random_values< int >( n, -30000, 30000, unsigned( n ) );
+    auto       b = random_values< int >( n, -30000, 30000, unsigned( n + 100 ) );
+    for ( auto& v : b )
+    {
+      v = v == 0 ? 1 : v;
+    }
+
+    std::vector< int > sum( n ), difference( n ), product( n ), quotient( n );
+    add( a, b, sum );
+    subtract( a, b, difference );
+    multiply( a, b, product );
+    divide( a, b, quotient );
+
+    for ( std::size_t ix = 0; ix < n; ++ix )
+    {
+      EXPECT_EQ( sum[ix], add( a[ix], b[ix] ) );
+      EXPECT_EQ( difference[ix], subtract( a[ix], b[ix] ) );
+      EXPECT_EQ( product[ix], multiply( a[ix], b[ix] ) );
+      EXPECT_EQ( quotient[ix], divide( a[ix], b[ix] ) );
+    }
+  }
+}
+
+TEST( SlowMathBatch, EveryType )
+{
+  const std::size_t n = 1000;
+
+  const auto a64 = random_values< std::int64_t >( n, -( 1ll << 40 ), 1ll << 40, 1 );
+  const auto b64 = random_values< std::int64_t >( n, 1, 1 << 20, 2 );
+  const auto af  = random_values< float >( n, -100.0f, 100.0f, 3 );
+  const auto bf  = random_values< float >( n, 0.5f, 100.0f, 4 );
+  const auto ad  = random_values< double >( n, -1e6, 1e6, 5 );
+  const auto bd  = random_values< double >( n, 0.5, 1e6, 6 );
+
+  std::vector< std::int64_t > p64( n ), q64( n );
+  std::vector< float >        sf( n ), df( n );
+  std::vector< double >       pd( n ), qd( n );
+  multiply( a64, b64, p64 );
+  divide( a64, b64, q64 );
+  add( af, bf, sf );
+  divide( af, bf, df );
+  multiply( ad, bd, pd );
+  subtract( ad, bd, qd );
+
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    EXPECT_EQ( p64[ix], a64[ix] * b64[ix] );
+    EXPECT_EQ( q64[ix], a64[ix] / b64[ix] );
+    EXPECT_EQ( sf[ix], af[ix] + bf[ix] );
+    EXPECT_EQ( df[ix], af[ix] / bf[ix] );
+    EXPECT_EQ( pd[ix], ad[ix] * bd[ix] );
+    EXPECT_EQ( qd[ix], ad[ix] - bd[ix] );
+  }
+}
+
+TEST( SlowMathBatch, IntegersWrap )
+{
+  const std::vector< int > a{INT_MAX, INT_MIN, INT_MAX, 1 << 16};
+  const std::vector< int > b{1, 1, 2, 1 << 16};
+  std::vector< int >       out( a.size() );
+
+  add( a, b, out );
+  EXPECT_EQ( out[0], INT_MIN );
+  subtract( a, b, out );
+  EXPECT_EQ( out[1], INT_MAX );
+  multiply( a, b, out );
+  EXPECT_EQ( out[2], -2 );
+  EXPECT_EQ( out[3], 0 );
+
+  const std::vector< std::int64_t > big{INT64_MAX};
+  std::vector< std::int64_t >       big_out( 1 );
+  add( big, big, big_out );
+  EXPECT_EQ( big_out[0], -2 );
+}
+
+TEST( SlowMathBatch, InPlaceAndPointers )
+{
+  std::vector< int > a( 100, 3 );
+  std::vector< int > b( 100, 4 );
+
+  add( a, b, a );
+  EXPECT_THAT( a, ::testing::Each( 7 ) );
+  multiply( a.data(), a.data(), a.data(), a.size() );
+  EXPECT_THAT( a, ::testing::Each( 49 ) );
+
+  // a subrange, the rest untouched
+  subtract( a.data() + 10, b.data(), a.data() + 10, 5 );
+  EXPECT_EQ( a[9], 49 );
+  EXPECT_EQ( a[10], 45 );
+  EXPECT_EQ( a[14], 45 );
+  EXPECT_EQ( a[15], 49 );
+}
+
+TEST( SlowMathBatch, SpanSizesMustMatch )
+{
+  std::vector< double > a( 4 ), b( 5 ), out( 4 );
+  std::span< double >   shorter( out.data(), 3 );
+
+  EXPECT_THROW( add( a, b, out ), std::invalid_argument );
+  EXPECT_THROW( add( a, a, shorter ), std::invalid_argument );
+  EXPECT_NO_THROW( add( a, a, out ) );
+}
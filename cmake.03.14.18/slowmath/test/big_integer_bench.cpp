@@ -0,0 +1,79 @@
+// big_integer add and multiply at 64, 256, 1024 and 4096 bits: a + b into a new
+// value, += into one that has room already, and a * b.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "slowmath/slowmath.hpp"
+// clang-format on
+
+using slowmath::big_integer;
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+// each measurement runs this long, checking the clock every batch operations
+constexpr std::chrono::milliseconds period( 200 );
+constexpr std::size_t               batch = 256;
+
+big_integer random_value( std::size_t bits, std::mt19937& gen )
+{
+  // one decimal digit is log2( 10 ) bits
+  const std::size_t                    digits = std::size_t( double( bits ) / 3.3219281 );
+  std::uniform_int_distribution< int > digit( 0, 9 ), lead( 1, 9 );
+  std::string                          s( 1, char( '0' + lead( gen ) ) );
+  while ( s.size() < digits )
+  {
+    s += char( '0' + digit( gen ) );
+  }
+  return big_integer( s );
+}
+
+template < class Op >
+void measure( const std::string& name, Op op )
+{
+  std::size_t ops   = 0;
+  auto        start = clock_type::now();
+  do
+  {
+    for ( std::size_t ix = 0; ix < batch; ++ix )
+    {
+      op();
+    }
+    ops += batch;
+  } while ( clock_type::now() - start < period );
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << ops / elapsed.count() / 1e6 << "M/s" << std::endl;
+}
+} // namespace
+
+TEST( SlowMathBench, BigInteger )
+{
+  std::mt19937 gen( 1 );
+  for ( std::size_t bits : {64, 256, 1024, 4096} )
+  {
+    const big_integer a = random_value( bits, gen ), b = random_value( bits, gen );
+    const std::string size = std::to_string( bits ) + " bits";
+    big_integer       r;
+
+    measure( size + ", a + b", [&] { r = a + b; } );
+
+    // the total keeps its size: b added and taken away again
+    big_integer total = a;
+    measure( size + ", total += b", [&] {
+      total += b;
+      total -= b;
+    } );
+
+    measure( size + ", a * b", [&] { r = a * b; } );
+    EXPECT_EQ( total, a );
+    EXPECT_EQ( r, b * a );
+  }
+}
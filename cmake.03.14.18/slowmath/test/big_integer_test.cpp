@@ -0,0 +1,228 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "slowmath/slowmath.hpp"
+// clang-format on
+
+using slowmath::big_integer;
+
+// every allocation in the program, to show which operations make none
+namespace
+{
+std::size_t allocations = 0;
+}
+
+void* operator new( std::size_t n )
+{
+  ++allocations;
+  if ( void* p = std::malloc( n != 0 ? n : 1 ) )
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete( void* p ) noexcept
+{
+  std::free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+  std::free( p );
+}
+
+namespace
+{
+std::string to_string( __int128 v )
+{
+  if ( v == 0 )
+  {
+    return "0";
+  }
+  const bool              negative = v < 0;
+  const unsigned __int128 u        = ( unsigned __int128 )( v );
+  unsigned __int128       m        = negative ? 0 - u : u;
+  std::string             digits;
+  for ( ; m != 0; m /= 10 )
+  {
+    digits.insert( digits.begin(), char( '0' + int( m % 10 ) ) );
+  }
+  return negative ? "-" + digits : digits;
+}
+
+std::string random_decimal( std::size_t digits, std::mt19937& gen )
+{
+  std::uniform_int_distribution< int > digit( 0, 9 ), lead( 1, 9 );
+  std::string                          s( 1, char( '0' + lead( gen ) ) );
+  while ( s.size() < digits )
+  {
+    s += char( '0' + digit( gen ) );
+  }
+  return s;
+}
+
+// ( 10^n - 1 )( 10^m - 1 ), n >= m, written out
+std::string nines_product( std::size_t n, std::size_t m )
+{
+  return std::string( m - 1, '9' ) + "8" + std::string( n - m, '9' ) + std::string( m - 1, '0' ) +
+         "1";
+}
+} // namespace
+
+TEST( SlowMathBigInteger, SmallValuesMatchInt128 )
+{
+  std::mt19937                               gen( 1 );
+  std::uniform_int_distribution< long long > any( LLONG_MIN, LLONG_MAX );
+
+  for ( int round = 0; round < 20000; ++round )
+  {
+    const long long   x = any( gen ), y = round % 2 == 0 ? any( gen ) : round - 10000;
+    const big_integer a( x ), b( y );
+
+    ASSERT_EQ( ( a + b ).to_string(), to_string( __int128( x ) + y ) );
+    ASSERT_EQ( ( a - b ).to_string(), to_string( __int128( x ) - y ) );
+    ASSERT_EQ( ( a * b ).to_string(), to_string( __int128( x ) * y ) );
+    ASSERT_EQ( compare( a, b ) < 0, x < y );
+    ASSERT_EQ( a.to_int64(), x );
+  }
+}
+
+TEST( SlowMathBigInteger, SmallValuesDoNotAllocate )
+{
+  const big_integer a( LLONG_MAX ), b( LLONG_MIN );
+  big_integer       total;
+
+  const std::size_t before = allocations;
+  total += a;
+  total += a;     // past int64_t
+  total -= b * b; // two limbs
+  total += total;
+  const big_integer c = a * b + a - b;
+  EXPECT_EQ( allocations, before );
+
+  EXPECT_EQ( total.to_string(),
+             to_string( ( __int128( LLONG_MAX ) * 2 - __int128( LLONG_MIN ) * LLONG_MIN ) * 2 ) );
+  EXPECT_EQ( c.to_string(),
+             to_string( __int128( LLONG_MAX ) * LLONG_MIN + LLONG_MAX - __int128( LLONG_MIN ) ) );
+}
+
+TEST( SlowMathBigInteger, AddingInPlaceReusesStorage )
+{
+  big_integer       total( std::string( 200, '7' ) );
+  const big_integer one( 1 );
+
+  const std::size_t before = allocations;
+  for ( int round = 0; round < 1000; ++round )
+  {
+    total += one;
+    total -= 3;
+  }
+  EXPECT_EQ( allocations, before );
+  EXPECT_EQ( total, big_integer( std::string( 200, '7' ) ) - 2000 );
+}
+
+TEST( SlowMathBigInteger, Strings )
+{
+  std::mt19937 gen( 2 );
+  for ( std::size_t digits = 1; digits < 200; digits += 7 )
+  {
+    const std::string s = random_decimal( digits, gen );
+    EXPECT_EQ( big_integer( s ).to_string(), s );
+    EXPECT_EQ( big_integer( "-" + s ).to_string(), "-" + s );
+  }
+  EXPECT_EQ( big_integer( "+000123" ).to_string(), "123" );
+  EXPECT_EQ( big_integer( "-0" ).to_string(), "0" );
+  EXPECT_EQ( big_integer( "10000000000000000000" ).to_string(), "10000000000000000000" );
+
+  std::ostringstream os;
+  os << big_integer( "-18446744073709551616" );
+  EXPECT_EQ( os.str(), "-18446744073709551616" );
+
+  for ( const char* bad : {"", "-", "+", "12a", " 1", "1-", "--1"} )
+  {
+    EXPECT_THROW( big_integer{std::string( bad )}, std::invalid_argument ) << bad;
+  }
+}
+
+TEST( SlowMathBigInteger, Limits )
+{
+  EXPECT_EQ( big_integer( LLONG_MIN ).to_int64(), LLONG_MIN );
+  EXPECT_EQ( ( big_integer( LLONG_MIN ) - 1 + 1 ).to_int64(), LLONG_MIN );
+  EXPECT_THROW( ( big_integer( LLONG_MAX ) + 1 ).to_int64(), std::overflow_error );
+  EXPECT_THROW( ( big_integer( LLONG_MIN ) - 1 ).to_int64(), std::overflow_error );
+
+  // unsigned values above LLONG_MAX keep their value
+  big_integer total;
+  total += std::uint64_t( 18000000000000000000ull );
+  EXPECT_EQ( total.to_string(), "18000000000000000000" );
+  EXPECT_EQ( big_integer( ULLONG_MAX ).to_string(), "18446744073709551615" );
+  EXPECT_EQ( big_integer( std::size_t( -1 ) ) + 1, big_integer( "18446744073709551616" ) );
+  EXPECT_EQ( big_integer( 0u ).sign(), 0 );
+  EXPECT_EQ( big_integer( short( -7 ) ).to_int64(), -7 );
+
+  EXPECT_EQ( big_integer().bits(), 0u );
+  EXPECT_EQ( big_integer( -1 ).bits(), 1u );
+  EXPECT_EQ( ( big_integer( LLONG_MAX ) * 4 ).bits(), 65u );
+  EXPECT_EQ( big_integer( 0 ).sign(), 0 );
+  EXPECT_EQ( ( -big_integer( 5 ) ).sign(), -1 );
+  EXPECT_EQ( ( -big_integer( 0 ) ).sign(), 0 );
+}
+
+// products of every shape: short, long, either side of the Karatsuba
+// threshold, and unbalanced
+TEST( SlowMathBigInteger, Products )
+{
+  const std::size_t lengths[] = {1, 19, 20, 100, 600, 630, 1000, 1400, 3000, 7000};
+  for ( std::size_t n : lengths )
+  {
+    for ( std::size_t m : lengths )
+    {
+      if ( m > n )
+      {
+        continue;
+      }
+      const big_integer a( std::string( n, '9' ) ), b( std::string( m, '9' ) );
+      ASSERT_EQ( ( a * b ).to_string(), nines_product( n, m ) ) << n << " x " << m;
+      ASSERT_EQ( ( b * -a ).to_string(), "-" + nines_product( n, m ) ) << n << " x " << m;
+    }
+  }
+}
+
+TEST( SlowMathBigInteger, Identities )
+{
+  std::mt19937 gen( 3 );
+  for ( std::size_t digits = 5; digits < 6000; digits = digits * 3 / 2 )
+  {
+    const big_integer a( random_decimal( digits, gen ) );
+    const big_integer b( "-" + random_decimal( digits / 3 + 1, gen ) );
+    const big_integer c( random_decimal( digits + 17, gen ) );
+
+    EXPECT_EQ( a + b - b, a ) << digits;
+    EXPECT_EQ( a - a, big_integer() ) << digits;
+    EXPECT_EQ( a * b, b * a ) << digits;
+    EXPECT_EQ( a * ( b + c ), a * b + a * c ) << digits;
+    EXPECT_EQ( ( a + c ) * ( a - c ), a * a - c * c ) << digits;
+    EXPECT_LT( b, a );
+    EXPECT_LT( a, c );
+    EXPECT_GT( -b, b );
+
+    big_integer d( a );
+    d *= c;
+    d -= a * c;
+    EXPECT_EQ( d.sign(), 0 );
+    d = a;
+    d += d;
+    EXPECT_EQ( d, a * 2 );
+  }
+}
@@ -0,0 +1,62 @@
+// what a call costs: summing an array through the library's out of line add()
+// against slowmath::add() from inline.hpp, which the compiler inlines and
+// vectorizes. configure with -DSLOWMATH_LTO=ON and the first one is inlined
+// at link time too.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "slowmath/slowmath.hpp"
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t values = 1024;
+constexpr std::size_t rounds = 100000;
+
+void report( const std::string& name, int total, clock_type::time_point start )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << values * rounds / elapsed.count() / 1e6 << "M/s"
+            << " (total " << total << ")" << std::endl;
+}
+} // namespace
+
+TEST( SlowMathBench, CallOverhead )
+{
+  std::vector< int > v( values );
+  for ( std::size_t ix = 0; ix < values; ++ix )
+  {
+    v[ix] = int( ix % 7 );
+  }
+
+  auto start = clock_type::now();
+  int  total = 0;
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    for ( int x : v )
+    {
+      total = add( total, x );
+    }
+  }
+  report( "add(), out of line", total, start );
+
+  start = clock_type::now();
+  total = 0;
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    for ( int x : v )
+    {
+      total = slowmath::add( total, x );
+    }
+  }
+  report( "slowmath::add(), inline", total, start );
+}
@@ -0,0 +1,115 @@
+// a divider against idiv. with one divisor for the whole array the divider is
+// built once, scalar and batch; with a different divisor per element it is
+// built for every division, which is the case it does not pay for.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "slowmath/slowmath.hpp"
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t values = 1024;
+constexpr std::size_t rounds = 20000;
+
+void report( const std::string& name, clock_type::time_point start )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << values * rounds / elapsed.count() / 1e6 << "M/s" << std::endl;
+}
+
+void consume( const std::vector< int >& out )
+{
+  volatile int sink = out[out.size() / 2];
+  (void)sink;
+}
+
+std::vector< int > random_values( int lo, int hi, unsigned seed )
+{
+  std::mt19937                         gen( seed );
+  std::uniform_int_distribution< int > dist( lo, hi );
+  std::vector< int >                   v( values );
+  for ( auto& x : v )
+  {
+    x = dist( gen );
+  }
+  return v;
+}
+} // namespace
+
+TEST( SlowMathBench, FixedDivisor )
+{
+  const auto         a = random_values( -1000000000, 1000000000, 1 );
+  std::vector< int > out( values );
+
+  // from a volatile, so the compiler cannot see the divisor and do this itself
+  volatile int hidden = 7;
+  const int    d      = hidden;
+
+  auto start = clock_type::now();
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    for ( std::size_t ix = 0; ix < values; ++ix )
+    {
+      out[ix] = a[ix] / d;
+    }
+    consume( out );
+  }
+  report( "fixed divisor, idiv", start );
+
+  const slowmath::divider by( d );
+  start = clock_type::now();
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    for ( std::size_t ix = 0; ix < values; ++ix )
+    {
+      out[ix] = by.divide( a[ix] );
+    }
+    consume( out );
+  }
+  report( "fixed divisor, divider inline loop", start );
+
+  start = clock_type::now();
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    divide( a.data(), by, out.data(), values );
+    consume( out );
+  }
+  report( "fixed divisor, divider batch", start );
+}
+
+TEST( SlowMathBench, RandomDivisors )
+{
+  const auto         a = random_values( -1000000000, 1000000000, 2 );
+  const auto         b = random_values( 1, 1000000, 3 );
+  std::vector< int > out( values );
+
+  auto start = clock_type::now();
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    divide( a.data(), b.data(), out.data(), values );
+    consume( out );
+  }
+  report( "random divisors, idiv batch", start );
+
+  start = clock_type::now();
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    for ( std::size_t ix = 0; ix < values; ++ix )
+    {
+      out[ix] = slowmath::divider( b[ix] ).divide( a[ix] );
+    }
+    consume( out );
+  }
+  report( "random divisors, a divider each", start );
+}
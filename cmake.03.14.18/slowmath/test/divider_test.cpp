@@ -0,0 +1,121 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <climits>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "slowmath/slowmath.hpp"
+// clang-format on
+
+namespace
+{
+// the divisors whose magic numbers take each branch, and the extremes
+const std::vector< int > awkward_divisors{
+    1, -1, 2, -2, 3, -3, 5, -5, 6, 7, -7, 10, 641, 1 << 20, -( 1 << 20 ), 1000000007, -1000000007,
+    INT_MAX, INT_MAX - 1, INT_MIN, INT_MIN + 1};
+
+const std::vector< int > awkward_numerators{0,  1,   -1,      INT_MAX, INT_MIN, INT_MAX - 1,
+                                            INT_MIN + 1, 7, -7, 100, -100};
+} // namespace
+
+TEST( SlowMathDivider, AwkwardValues )
+{
+  for ( int d : awkward_divisors )
+  {
+    const slowmath::divider by( d );
+    EXPECT_EQ( by.divisor(), d );
+    for ( int n : awkward_numerators )
+    {
+      if ( d == -1 && n == INT_MIN )
+      {
+        continue;
+      }
+      EXPECT_EQ( by.divide( n ), n / d ) << n << " / " << d;
+    }
+  }
+}
+
+TEST( SlowMathDivider, RandomValues )
+{
+  std::mt19937                         gen( 1 );
+  std::uniform_int_distribution< int > any( INT_MIN, INT_MAX );
+  std::uniform_int_distribution< int > small( -100, 100 );
+
+  for ( int round = 0; round < 100000; ++round )
+  {
+    const int n = any( gen );
+    for ( int d : {any( gen ), small( gen )} )
+    {
+      if ( d == 0 || ( d == -1 && n == INT_MIN ) )
+      {
+        continue;
+      }
+      ASSERT_EQ( slowmath::divider( d )( n ), n / d ) << n << " / " << d;
+    }
+  }
+}
+
+// every length up to a few vectors, so every tail path runs
+TEST( SlowMathDivider, BatchMatchesScalar )
+{
+  std::mt19937                         gen( 2 );
+  std::uniform_int_distribution< int > any( INT_MIN, INT_MAX );
+
+  for ( int d : awkward_divisors )
+  {
+    const slowmath::divider by( d );
+    for ( std::size_t n = 0; n < 70; ++n )
+    {
+      std::vector< int > a( n ), out( n );
+      for ( auto& v : a )
+      {
+        v = any( gen );
+      }
+      divide( a, by, out );
+      for ( std::size_t ix = 0; ix < n; ++ix )
+      {
+        ASSERT_EQ( out[ix], by.divide( a[ix] ) ) << a[ix] << " / " << d;
+      }
+    }
+  }
+}
+
+TEST( SlowMathDivider, InPlace )
+{
+  std::vector< int > a{70, -70, 71, -71};
+  divide( a.data(), slowmath::divider( 7 ), a.data(), a.size() );
+  EXPECT_THAT( a, ::testing::ElementsAre( 10, -10, 10, -10 ) );
+}
+
+TEST( SlowMathDivider, ByZeroThrows )
+{
+  EXPECT_THROW( slowmath::divider( 0 ), std::domain_error );
+  EXPECT_THROW( slowmath::checked_divide( 1, 0 ), std::domain_error );
+}
+
+TEST( SlowMathDivider, MinByMinusOne )
+{
+  const slowmath::divider by( -1 );
+
+  // wraps unchecked, the batch too
+  EXPECT_EQ( by.divide( INT_MIN ), INT_MIN );
+  std::vector< int > a{INT_MIN, INT_MAX}, out( 2 );
+  divide( a, by, out );
+  EXPECT_THAT( out, ::testing::ElementsAre( INT_MIN, -INT_MAX ) );
+
+  EXPECT_THROW( slowmath::checked_divide( INT_MIN, -1 ), std::overflow_error );
+  EXPECT_THROW( slowmath::checked_divide( INT_MIN, by ), std::overflow_error );
+  EXPECT_EQ( slowmath::checked_divide( INT_MIN, 1 ), INT_MIN );
+  EXPECT_EQ( slowmath::checked_divide( INT_MAX, by ), -INT_MAX );
+  EXPECT_EQ( slowmath::checked_divide( -7, slowmath::divider( 2 ) ), -3 );
+}
+
+TEST( SlowMathDivider, SpanSizesMustMatch )
+{
+  std::vector< int > a( 4 ), out( 3 );
+  EXPECT_THROW( divide( a, slowmath::divider( 3 ), out ), std::invalid_argument );
+}
@@ -0,0 +1,35 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <climits>
+
+#include "slowmath/slowmath.hpp"
+// clang-format on
+
+// folded at compile time
+static_assert( slowmath::add( 1, 2 ) == 3, "add" );
+static_assert( slowmath::subtract( 1, 2 ) == -1, "subtract" );
+static_assert( slowmath::multiply( -3, 7 ) == -21, "multiply" );
+static_assert( slowmath::divide( -7, 2 ) == -3, "divide truncates" );
+
+TEST( SlowMathInline, SameAsTheLibrary )
+{
+  // small enough that no sum, difference or product overflows
+  const int values[] = {-40000, -1000, -7, -1, 0, 1, 2, 7, 1000, 40000};
+  for ( int a : values )
+  {
+    for ( int b : values )
+    {
+      EXPECT_EQ( slowmath::add( a, b ), add( a, b ) );
+      EXPECT_EQ( slowmath::subtract( a, b ), subtract( a, b ) );
+      EXPECT_EQ( slowmath::multiply( a, b ), multiply( a, b ) );
+      if ( b != 0 )
+      {
+        EXPECT_EQ( slowmath::divide( a, b ), divide( a, b ) );
+      }
+    }
+  }
+  EXPECT_EQ( slowmath::divide( INT_MIN, 1 ), divide( INT_MIN, 1 ) );
+  EXPECT_EQ( slowmath::add( INT_MAX, INT_MIN ), add( INT_MAX, INT_MIN ) );
+}
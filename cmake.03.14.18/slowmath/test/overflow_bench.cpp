@@ -0,0 +1,117 @@
+// what each overflow policy costs over wrapping: the scalars in a loop written
+// here, then the saturating batches against that loop and, for int and int64,
+// the wrapping batch.
+
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "slowmath/slowmath.hpp"
+// clang-format on
+
+namespace
+{
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t values = 1024;
+constexpr std::size_t rounds = 80000;
+
+void report( const std::string& name, clock_type::time_point start )
+{
+  std::chrono::duration< double > elapsed = clock_type::now() - start;
+  std::cout << name << " " << values * rounds / elapsed.count() / 1e6 << "M/s" << std::endl;
+}
+
+template < class T >
+void consume( const std::vector< T >& out )
+{
+  volatile T sink = out[out.size() / 2];
+  (void)sink;
+}
+
+template < class Policy >
+void scalar_loop( const std::string& name )
+{
+  typedef typename Policy::template result< int > R;
+
+  std::vector< int > a( values, 3 ), b( values, 5 );
+  std::vector< R >   out( values );
+
+  auto start = clock_type::now();
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    for ( std::size_t ix = 0; ix < values; ++ix )
+    {
+      out[ix] = slowmath::add< Policy >( a[ix], b[ix] );
+    }
+    consume( out );
+  }
+  report( "int add, " + name + " scalars", start );
+}
+
+template < class T >
+void saturating_batch( const std::string& name )
+{
+  std::vector< T > a( values, T( 3 ) ), b( values, T( 5 ) ), out( values );
+
+  auto start = clock_type::now();
+  if constexpr ( sizeof( T ) >= sizeof( int ) )
+  {
+    for ( std::size_t round = 0; round < rounds; ++round )
+    {
+      add( a.data(), b.data(), out.data(), values );
+      consume( out );
+    }
+    report( name + " add, wrapping batch", start );
+  }
+
+  start = clock_type::now();
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    for ( std::size_t ix = 0; ix < values; ++ix )
+    {
+      out[ix] = slowmath::add< slowmath::saturating >( a[ix], b[ix] );
+    }
+    consume( out );
+  }
+  report( name + " add, saturating scalars", start );
+
+  start = clock_type::now();
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    slowmath::add< slowmath::saturating >( a.data(), b.data(), out.data(), values );
+    consume( out );
+  }
+  report( name + " add, saturating batch", start );
+
+  start = clock_type::now();
+  for ( std::size_t round = 0; round < rounds; ++round )
+  {
+    slowmath::multiply< slowmath::saturating >( a.data(), b.data(), out.data(), values );
+    consume( out );
+  }
+  report( name + " multiply, saturating batch", start );
+}
+} // namespace
+
+TEST( SlowMathBench, PolicyScalars )
+{
+  scalar_loop< slowmath::wrapping >( "wrapping" );
+  scalar_loop< slowmath::checked >( "checked" );
+  scalar_loop< slowmath::saturating >( "saturating" );
+  scalar_loop< slowmath::widening >( "widening" );
+}
+
+TEST( SlowMathBench, SaturatingBatches )
+{
+  saturating_batch< std::int8_t >( "int8" );
+  saturating_batch< std::int16_t >( "int16" );
+  saturating_batch< std::int32_t >( "int32" );
+  saturating_batch< std::int64_t >( "int64" );
+}
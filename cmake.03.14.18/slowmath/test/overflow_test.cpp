@@ -0,0 +1,156 @@
+// clang-format off
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "slowmath/slowmath.hpp"
+// clang-format on
+
+using slowmath::checked;
+using slowmath::saturating;
+using slowmath::widening;
+using slowmath::wrapping;
+
+namespace
+{
+// half anywhere in T, half within 3 of a bound, where the overflows are
+template < class T >
+std::vector< T > edgy_values( std::size_t n, unsigned seed )
+{
+  typedef std::numeric_limits< T > limits;
+
+  std::mt19937                               gen( seed );
+  std::uniform_int_distribution< long long > any( limits::min(), limits::max() );
+  std::uniform_int_distribution< int >       near( 0, 3 );
+  std::vector< T >                           values( n );
+  for ( std::size_t ix = 0; ix < n; ++ix )
+  {
+    switch ( ix % 4 )
+    {
+    case 0:
+      values[ix] = T( limits::max() - near( gen ) );
+      break;
+    case 1:
+      values[ix] = T( limits::min() + near( gen ) );
+      break;
+    default:
+      values[ix] = T( any( gen ) );
+    }
+  }
+  std::shuffle( values.begin(), values.end(), gen );
+  return values;
+}
+
+template < class T >
+class SlowMathOverflow : public ::testing::Test
+{
+};
+
+typedef ::testing::Types< std::int8_t, std::int16_t, std::int32_t, std::int64_t > signed_types;
+} // namespace
+
+TYPED_TEST_CASE( SlowMathOverflow, signed_types );
+
+TYPED_TEST( SlowMathOverflow, Bounds )
+{
+  typedef TypeParam T;
+  const T           max = std::numeric_limits< T >::max();
+  const T           min = std::numeric_limits< T >::min();
+
+  EXPECT_EQ( slowmath::add< wrapping >( max, T( 1 ) ), min );
+  EXPECT_EQ( slowmath::subtract< wrapping >( min, T( 1 ) ), max );
+  EXPECT_EQ( slowmath::multiply< wrapping >( min, T( -1 ) ), min );
+
+  EXPECT_THROW( slowmath::add< checked >( max, T( 1 ) ), std::overflow_error );
+  EXPECT_THROW( slowmath::add< checked >( min, T( -1 ) ), std::overflow_error );
+  EXPECT_THROW( slowmath::subtract< checked >( min, T( 1 ) ), std::overflow_error );
+  EXPECT_THROW( slowmath::subtract< checked >( T( 0 ), min ), std::overflow_error );
+  EXPECT_THROW( slowmath::multiply< checked >( min, T( -1 ) ), std::overflow_error );
+  EXPECT_THROW( slowmath::multiply< checked >( max, T( 2 ) ), std::overflow_error );
+  EXPECT_EQ( slowmath::add< checked >( max, min ), T( -1 ) );
+  EXPECT_EQ( slowmath::subtract< checked >( T( -1 ), min ), max );
+  EXPECT_EQ( slowmath::multiply< checked >( max, T( -1 ) ), T( min + 1 ) );
+
+  EXPECT_EQ( slowmath::add< saturating >( max, T( 1 ) ), max );
+  EXPECT_EQ( slowmath::add< saturating >( min, min ), min );
+  EXPECT_EQ( slowmath::subtract< saturating >( min, T( 1 ) ), min );
+  EXPECT_EQ( slowmath::subtract< saturating >( T( 0 ), min ), max );
+  EXPECT_EQ( slowmath::subtract< saturating >( T( -1 ), min ), max );
+  EXPECT_EQ( slowmath::multiply< saturating >( min, T( -1 ) ), max );
+  EXPECT_EQ( slowmath::multiply< saturating >( min, min ), max );
+  EXPECT_EQ( slowmath::multiply< saturating >( max, min ), min );
+  EXPECT_EQ( slowmath::multiply< saturating >( T( -2 ), max ), min );
+  EXPECT_EQ( slowmath::multiply< saturating >( T( 0 ), min ), T( 0 ) );
+}
+
+TYPED_TEST( SlowMathOverflow, WideningIsExact )
+{
+  typedef TypeParam                                  T;
+  typedef typename slowmath::wider< TypeParam >::type W;
+  const T max = std::numeric_limits< T >::max();
+  const T min = std::numeric_limits< T >::min();
+
+  static_assert( sizeof( W ) == 2 * sizeof( T ), "" );
+  EXPECT_EQ( slowmath::add< widening >( max, max ), W( max ) * 2 );
+  EXPECT_EQ( slowmath::subtract< widening >( min, max ), W( min ) - max );
+  EXPECT_TRUE( slowmath::multiply< widening >( min, min ) == W( min ) * W( min ) );
+  EXPECT_TRUE( slowmath::multiply< widening >( min, max ) == W( min ) * W( max ) );
+}
+
+// every length up to a few 64 byte vectors, so every tail path runs
+TYPED_TEST( SlowMathOverflow, SaturatingBatchMatchesScalar )
+{
+  typedef TypeParam T;
+
+  for ( std::size_t n = 0; n < 150; ++n )
+  {
+    const auto       a = edgy_values< T >( n, unsigned( n ) );
+    const auto       b = edgy_values< T >( n, unsigned( n + 1000 ) );
+    std::vector< T > sum( n ), difference( n ), product( n );
+
+    slowmath::add< saturating >( a.data(), b.data(), sum.data(), n );
+    slowmath::subtract< saturating >( a.data(), b.data(), difference.data(), n );
+    slowmath::multiply< saturating >( a.data(), b.data(), product.data(), n );
+
+    for ( std::size_t ix = 0; ix < n; ++ix )
+    {
+      ASSERT_EQ( sum[ix], slowmath::add< saturating >( a[ix], b[ix] ) );
+      ASSERT_EQ( difference[ix], slowmath::subtract< saturating >( a[ix], b[ix] ) );
+      ASSERT_EQ( product[ix], slowmath::multiply< saturating >( a[ix], b[ix] ) );
+    }
+  }
+}
+
+TEST( SlowMathOverflow, SaturatingBatchInPlace )
+{
+  std::vector< std::int16_t > a( 100, 30000 );
+  slowmath::add< saturating >( a.data(), a.data(), a.data(), a.size() );
+  EXPECT_THAT( a, ::testing::Each( INT16_MAX ) );
+  slowmath::multiply< saturating >( a.data(), a.data(), a.data(), a.size() );
+  EXPECT_THAT( a, ::testing::Each( INT16_MAX ) );
+}
+
+TEST( SlowMathOverflow, OtherPoliciesBatch )
+{
+  const std::vector< int > a{INT_MAX, 2, INT_MIN};
+  const std::vector< int > b{INT_MAX, 3, 1};
+
+  std::vector< std::int64_t > wide( 3 );
+  slowmath::multiply< widening >( a.data(), b.data(), wide.data(), 3 );
+  EXPECT_THAT( wide, ::testing::ElementsAre( std::int64_t( INT_MAX ) * INT_MAX, 6,
+                                             std::int64_t( INT_MIN ) ) );
+
+  std::vector< int > out( 3 );
+  slowmath::add< wrapping >( a.data(), b.data(), out.data(), 3 );
+  EXPECT_THAT( out, ::testing::ElementsAre( -2, 5, INT_MIN + 1 ) );
+  EXPECT_THROW( slowmath::add< checked >( a.data(), b.data(), out.data(), 3 ),
+                std::overflow_error );
+  EXPECT_NO_THROW( slowmath::add< checked >( a.data() + 1, b.data() + 1, out.data(), 2 ) );
+}